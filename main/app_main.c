@@ -279,7 +279,11 @@ void app_main(void)
     }
 
 #if CONFIG_APP_ENABLE_FACE_DETECTION && CONFIG_APP_ENABLE_STREAMING
-    ESP_LOGW(TAG, "Streaming and face detection simultaneously are not supported. Skipping face detection.");
+    // The stream owns the camera, the detection runs on its frames while a client is streaming.
+    ret = face_detect_start_on_stream(s_mqtt_client);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start face detection task (%s)", esp_err_to_name(ret));
+    }
 #elif CONFIG_APP_ENABLE_FACE_DETECTION
     ret = face_detect_start(camera_fd, s_mqtt_client);
     if (ret != ESP_OK) {
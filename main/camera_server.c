@@ -18,8 +18,15 @@
 #include "esp_heap_caps.h"
 #include "driver/jpeg_encode.h"
 #include "esp_video_ioctl.h"
+#include "dl_image_jpeg_pool.h"
 #include "camera_init.h"
 #include "camera_server.h"
+#if CONFIG_APP_ENABLE_FACE_DETECTION
+#include "face_detect_task.h"
+#endif
+#if CONFIG_APP_STREAM_OVERLAY
+#include "stream_overlay.h"
+#endif
 
 static const char *TAG = "camera_server";
 
@@ -43,12 +50,11 @@ typedef struct {
     SemaphoreHandle_t lock;
 } camera_stream_state_t;
 
+// The encoder engine and its output buffer come from the JPEG engine pool of esp-dl, shared with dl::image.
 typedef struct {
-    jpeg_encoder_handle_t handle;
     jpeg_enc_input_format_t src_format;
     jpeg_down_sampling_type_t sub_sample;
     uint32_t src_stride;
-    uint8_t *out_buf;
     size_t out_buf_size;
     uint8_t quality;
     bool initialized;
@@ -129,6 +135,11 @@ static esp_err_t jpeg_encoder_init(void)
         sub_sample = JPEG_DOWN_SAMPLING_YUV444;
         src_bpp = 24;
         break;
+    case V4L2_PIX_FMT_YUV420:
+        src_format = JPEG_ENCODE_IN_FORMAT_YUV420;
+        sub_sample = JPEG_DOWN_SAMPLING_YUV420;
+        src_bpp = 12;
+        break;
     case V4L2_PIX_FMT_YUV422P:
         src_format = JPEG_ENCODE_IN_FORMAT_YUV422;
         sub_sample = JPEG_DOWN_SAMPLING_YUV422;
@@ -144,36 +155,22 @@ static esp_err_t jpeg_encoder_init(void)
         return ESP_ERR_NOT_SUPPORTED;
     }
 
-    jpeg_encode_engine_cfg_t eng_cfg = {
-        .intr_priority = 0,
-        .timeout_ms = 200,
-    };
+    size_t src_stride = (size_t)s_stream_state.width * s_stream_state.height * src_bpp / 8;
+    size_t out_size = src_stride;
 
-    err = jpeg_new_encoder_engine(&eng_cfg, &s_jpeg_state.handle);
+    // Create the engine and its output buffer now, so that the first frame doesn't pay for them.
+    dl_jpeg_engine_t *engine = NULL;
+    err = dl_jpeg_engine_acquire(DL_JPEG_ENGINE_HW_ENCODER, out_size, pdMS_TO_TICKS(CAMERA_LOCK_TIMEOUT_MS), &engine);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create JPEG encoder (%s)", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Failed to prepare JPEG encoder (%s)", esp_err_to_name(err));
         return err;
     }
-
-    size_t src_stride = (size_t)s_stream_state.width * s_stream_state.height * src_bpp / 8;
-    size_t out_size = src_stride;
-    jpeg_encode_memory_alloc_cfg_t mem_cfg = {
-        .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
-    };
-    size_t actual_size = 0;
-    uint8_t *buf = (uint8_t *)jpeg_alloc_encoder_mem(out_size, &mem_cfg, &actual_size);
-    if (!buf) {
-        jpeg_del_encoder_engine(s_jpeg_state.handle);
-        s_jpeg_state.handle = NULL;
-        ESP_LOGE(TAG, "Failed to allocate JPEG output buffer");
-        return ESP_ERR_NO_MEM;
-    }
+    dl_jpeg_engine_release(engine);
 
     s_jpeg_state.src_format = src_format;
     s_jpeg_state.sub_sample = sub_sample;
     s_jpeg_state.src_stride = src_stride;
-    s_jpeg_state.out_buf = buf;
-    s_jpeg_state.out_buf_size = actual_size ? actual_size : out_size;
+    s_jpeg_state.out_buf_size = out_size;
     s_jpeg_state.quality = 75;
     s_jpeg_state.initialized = true;
 
@@ -183,25 +180,34 @@ static esp_err_t jpeg_encoder_init(void)
 
 static void jpeg_encoder_deinit(void)
 {
-    if (s_jpeg_state.out_buf) {
-        free(s_jpeg_state.out_buf);
-        s_jpeg_state.out_buf = NULL;
-    }
-
-    if (s_jpeg_state.handle) {
-        jpeg_del_encoder_engine(s_jpeg_state.handle);
-        s_jpeg_state.handle = NULL;
-    }
-
+    // The decoders of the pool belong to the detector, only the encoders are dropped.
+    dl_jpeg_engine_pool_free_idle_type(DL_JPEG_ENGINE_HW_ENCODER);
     s_jpeg_state.initialized = false;
 }
 
-static esp_err_t jpeg_encode_frame(const uint8_t *src, size_t src_size, const uint8_t **jpeg_buf, size_t *jpeg_size)
+static esp_err_t jpeg_encoder_acquire(dl_jpeg_engine_t **engine)
 {
     if (!s_jpeg_state.initialized) {
         return ESP_ERR_INVALID_STATE;
     }
 
+    esp_err_t err = dl_jpeg_engine_acquire(DL_JPEG_ENGINE_HW_ENCODER,
+                                           s_jpeg_state.out_buf_size,
+                                           pdMS_TO_TICKS(CAMERA_LOCK_TIMEOUT_MS),
+                                           engine);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to acquire JPEG encoder (%s)", esp_err_to_name(err));
+    }
+    return err;
+}
+
+// The JPEG is in the output buffer of the engine, valid until the engine is released.
+static esp_err_t jpeg_encode_frame(dl_jpeg_engine_t *engine,
+                                   const uint8_t *src,
+                                   size_t src_size,
+                                   const uint8_t **jpeg_buf,
+                                   size_t *jpeg_size)
+{
     jpeg_encode_cfg_t cfg = {
         .src_type = s_jpeg_state.src_format,
         .sub_sample = s_jpeg_state.sub_sample,
@@ -211,23 +217,43 @@ static esp_err_t jpeg_encode_frame(const uint8_t *src, size_t src_size, const ui
     };
 
     uint32_t out_size = 0;
-    esp_err_t err = jpeg_encoder_process(s_jpeg_state.handle,
+    esp_err_t err = jpeg_encoder_process(engine->encoder,
                                          &cfg,
                                          (uint8_t *)src,
                                          src_size,
-                                         s_jpeg_state.out_buf,
-                                         s_jpeg_state.out_buf_size,
+                                         engine->buf,
+                                         engine->buf_size,
                                          &out_size);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "JPEG encode failed (%s)", esp_err_to_name(err));
         return err;
     }
 
-    *jpeg_buf = s_jpeg_state.out_buf;
+    *jpeg_buf = engine->buf;
     *jpeg_size = out_size;
     return ESP_OK;
 }
 
+static int64_t frame_timestamp_us(const struct v4l2_buffer *buf)
+{
+    int64_t ts = (int64_t)buf->timestamp.tv_sec * 1000000LL + buf->timestamp.tv_usec;
+    return ts ? ts : esp_timer_get_time();
+}
+
+// Hands the clean frame to the detection, then draws the overlay on it, right before it is encoded.
+static void process_frame(uint8_t *frame, const struct v4l2_buffer *buf)
+{
+    int64_t ts = frame_timestamp_us(buf);
+#if CONFIG_APP_ENABLE_FACE_DETECTION
+    face_detect_submit_frame(frame, s_stream_state.pixformat, s_stream_state.width, s_stream_state.height, ts);
+#endif
+#if CONFIG_APP_STREAM_OVERLAY
+    stream_overlay_draw(frame, s_stream_state.pixformat, s_stream_state.width, s_stream_state.height, ts);
+#endif
+    (void)frame;
+    (void)ts;
+}
+
 static bool camera_lock_acquire(void)
 {
     if (!s_stream_state.lock) {
@@ -262,7 +288,26 @@ static esp_err_t configure_camera_device(int camera_fd)
         ESP_LOGI(TAG, "Requesting ISP output %ux%u", desired_width, desired_height);
     }
 
-    if (fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_RGB565) {
+    bool switch_to_rgb565 = fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_RGB565;
+#if CONFIG_CAMERA_CAPTURE_YUV420
+    if (fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_YUV420) {
+        switch_to_rgb565 = false;
+    } else {
+        struct v4l2_format yuv420_fmt = fmt;
+        yuv420_fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUV420;
+        yuv420_fmt.fmt.pix.field = V4L2_FIELD_NONE;
+        if (ioctl(camera_fd, VIDIOC_S_FMT, &yuv420_fmt) == 0 &&
+            yuv420_fmt.fmt.pix.pixelformat == V4L2_PIX_FMT_YUV420) {
+            fmt = yuv420_fmt;
+            switch_to_rgb565 = false;
+            ESP_LOGI(TAG, "Switched camera stream to YUV420");
+        } else {
+            ESP_LOGW(TAG, "Failed to switch to YUV420 format, errno=%d", errno);
+        }
+    }
+#endif
+
+    if (switch_to_rgb565) {
         struct v4l2_format rgb_fmt = fmt;
         rgb_fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_RGB565;
         rgb_fmt.fmt.pix.field = V4L2_FIELD_NONE;
@@ -321,6 +366,7 @@ static esp_err_t stream_handler(httpd_req_t *req)
     struct v4l2_buffer buf;
     char part_buf[96];
     mapped_buffer_t *buffers = NULL;
+    dl_jpeg_engine_t *engine = NULL;
     bool stream_started = false;
 
     httpd_resp_set_type(req, STREAM_CONTENT_TYPE);
@@ -376,6 +422,11 @@ static esp_err_t stream_handler(httpd_req_t *req)
         }
     }
 
+    if (jpeg_encoder_acquire(&engine) != ESP_OK) {
+        ret = ESP_FAIL;
+        goto cleanup;
+    }
+
     enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     if (ioctl(s_camera_fd, VIDIOC_STREAMON, &type) < 0) {
         ESP_LOGE(TAG, "Failed to start video stream");
@@ -401,9 +452,11 @@ static esp_err_t stream_handler(httpd_req_t *req)
             continue;
         }
 
+        process_frame((uint8_t *)buffers[buf.index].addr, &buf);
+
         const uint8_t *jpeg_buf = NULL;
         size_t jpeg_size = 0;
-        if (jpeg_encode_frame((const uint8_t *)buffers[buf.index].addr, buf.bytesused, &jpeg_buf, &jpeg_size) != ESP_OK) {
+        if (jpeg_encode_frame(engine, (const uint8_t *)buffers[buf.index].addr, buf.bytesused, &jpeg_buf, &jpeg_size) != ESP_OK) {
             ioctl(s_camera_fd, VIDIOC_QBUF, &buf);
             ret = ESP_FAIL;
             break;
@@ -446,6 +499,7 @@ cleanup:
         free(buffers);
     }
 
+    dl_jpeg_engine_release(engine);
     camera_lock_release();
     ESP_LOGI(TAG, "Stream stopped");
     return ret;
@@ -520,15 +574,20 @@ static esp_err_t capture_handler(httpd_req_t *req)
         goto cleanup;
     }
 
+    process_frame((uint8_t *)buffer.addr, &buf);
+
     const uint8_t *jpeg_buf = NULL;
     size_t jpeg_size = 0;
-    if (jpeg_encode_frame((const uint8_t *)buffer.addr, buf.bytesused, &jpeg_buf, &jpeg_size) == ESP_OK) {
+    dl_jpeg_engine_t *engine = NULL;
+    if (jpeg_encoder_acquire(&engine) == ESP_OK &&
+        jpeg_encode_frame(engine, (const uint8_t *)buffer.addr, buf.bytesused, &jpeg_buf, &jpeg_size) == ESP_OK) {
         httpd_resp_set_type(req, "image/jpeg");
         httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.jpg");
         ret = httpd_resp_send(req, (const char *)jpeg_buf, jpeg_size);
     } else {
         ret = ESP_FAIL;
     }
+    dl_jpeg_engine_release(engine);
 
 cleanup:
     if (stream_started) {
@@ -571,6 +630,18 @@ esp_err_t camera_server_start(int camera_fd)
         return err;
     }
 
+#if CONFIG_APP_STREAM_OVERLAY
+    err = stream_overlay_init();
+    if (err != ESP_OK) {
+        jpeg_encoder_deinit();
+        return err;
+    }
+    if (s_stream_state.pixformat != V4L2_PIX_FMT_RGB565 && s_stream_state.pixformat != V4L2_PIX_FMT_YUV420) {
+        ESP_LOGW(TAG, "The overlay is drawn on RGB565 and YUV420 frames only, not on " V4L2_FMT_STR,
+                 V4L2_FMT_STR_ARG(s_stream_state.pixformat));
+    }
+#endif
+
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 80;
     config.ctrl_port = 32768;
@@ -582,6 +653,9 @@ esp_err_t camera_server_start(int camera_fd)
 
     if (httpd_start(&s_server, &config) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start web server");
+#if CONFIG_APP_STREAM_OVERLAY
+        stream_overlay_deinit();
+#endif
         jpeg_encoder_deinit();
         return ESP_FAIL;
     }
@@ -628,5 +702,8 @@ void camera_server_stop(void)
         s_stream_state.lock = NULL;
     }
 
+#if CONFIG_APP_STREAM_OVERLAY
+    stream_overlay_deinit();
+#endif
     jpeg_encoder_deinit();
 }
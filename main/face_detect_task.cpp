@@ -7,18 +7,25 @@
 #include <sys/mman.h>
 #include <sys/time.h>
 
+#include <algorithm>
+#include <atomic>
 #include <list>
 #include <string>
 #include <vector>
 
 #include "sdkconfig.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "mqtt_client.h"
 #include "esp_timer.h"
 #include "esp_video_ioctl.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "dl_image_color.hpp"
 #include "human_face_detect.hpp"
+#if CONFIG_APP_STREAM_OVERLAY
+#include "stream_overlay.h"
+#endif
 
 namespace {
 
@@ -29,6 +36,20 @@ struct MappedBuffer {
     size_t length = 0;
 };
 
+#if CONFIG_FACE_DET_LUMA_ONLY
+// Formats the luma is read from, the chroma is never used.
+constexpr uint32_t LUMA_FORMATS[] = {V4L2_PIX_FMT_GREY, V4L2_PIX_FMT_YUV420};
+#endif
+
+constexpr float TRACK_MIN_IOU = 0.3f;
+constexpr int TRACK_MAX_MISSES = 3;
+
+struct Track {
+    int box[4];
+    uint16_t id;
+    int misses;
+};
+
 struct FaceDetectContext {
     int camera_fd = -1;
     bool should_stop = false;
@@ -41,10 +62,50 @@ struct FaceDetectContext {
     std::vector<MappedBuffer> buffers;
     HumanFaceDetect *detector = nullptr;
     esp_mqtt_client_handle_t mqtt_client = nullptr;
+    std::vector<Track> tracks;
+    uint16_t next_track_id = 1;
+    // Stream fed mode, the frames are copied from the HTTP stream instead of dequeued from the camera.
+    bool stream_fed = false;
+    std::atomic<bool> accepting_frame{false};
+    int64_t fed_timestamp_us = 0;
+    // Frame copied from the HTTP stream.
+    uint8_t *frame_buf = nullptr;
+    size_t frame_buf_size = 0;
 };
 
 FaceDetectContext s_ctx;
 
+bool reserve_frame_buf(FaceDetectContext &ctx, size_t size)
+{
+    if (size <= ctx.frame_buf_size) {
+        return true;
+    }
+    heap_caps_free(ctx.frame_buf);
+    ctx.frame_buf = static_cast<uint8_t *>(heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    ctx.frame_buf_size = ctx.frame_buf ? size : 0;
+    if (!ctx.frame_buf) {
+        ESP_LOGE(TAG, "Failed to allocate %u bytes for the detection frame", (unsigned)size);
+        return false;
+    }
+    return true;
+}
+
+// The driver may pick another format than the requested one, which counts as a failure.
+bool set_pixformat(int camera_fd, struct v4l2_format &fmt, uint32_t pixformat)
+{
+    if (fmt.fmt.pix.pixelformat == pixformat) {
+        return true;
+    }
+    struct v4l2_format new_fmt = fmt;
+    new_fmt.fmt.pix.pixelformat = pixformat;
+    new_fmt.fmt.pix.field = V4L2_FIELD_NONE;
+    if (ioctl(camera_fd, VIDIOC_S_FMT, &new_fmt) < 0 || new_fmt.fmt.pix.pixelformat != pixformat) {
+        return false;
+    }
+    fmt = new_fmt;
+    return true;
+}
+
 esp_err_t configure_camera_device(FaceDetectContext &ctx)
 {
     struct v4l2_format fmt = {};
@@ -54,14 +115,22 @@ esp_err_t configure_camera_device(FaceDetectContext &ctx)
         return ESP_FAIL;
     }
 
-    if (fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_RGB565) {
-        fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_RGB565;
-        fmt.fmt.pix.field = V4L2_FIELD_NONE;
-        if (ioctl(ctx.camera_fd, VIDIOC_S_FMT, &fmt) < 0) {
-            ESP_LOGE(TAG, "Failed to set RGB565 format, errno=%d", errno);
-            return ESP_FAIL;
+    bool configured = false;
+#if CONFIG_FACE_DET_LUMA_ONLY
+    for (uint32_t pixformat : LUMA_FORMATS) {
+        if (set_pixformat(ctx.camera_fd, fmt, pixformat)) {
+            configured = true;
+            break;
         }
     }
+    if (!configured) {
+        ESP_LOGW(TAG, "No luma format on the camera, detecting on RGB565");
+    }
+#endif
+    if (!configured && !set_pixformat(ctx.camera_fd, fmt, V4L2_PIX_FMT_RGB565)) {
+        ESP_LOGE(TAG, "Failed to set RGB565 format, errno=%d", errno);
+        return ESP_FAIL;
+    }
 
     ctx.width = fmt.fmt.pix.width;
     ctx.height = fmt.fmt.pix.height;
@@ -185,15 +254,127 @@ void publish_results(FaceDetectContext &ctx, const std::list<dl::detect::result_
     }
 }
 
-void detection_task(void *arg)
+float box_iou(const int *a, const int *b)
 {
-    auto *ctx = static_cast<FaceDetectContext *>(arg);
-    do {
-        if (!ctx->detector) {
-            ESP_LOGE(TAG, "Detector not initialized");
-            break;
+    int w = std::min(a[2], b[2]) - std::max(a[0], b[0]);
+    int h = std::min(a[3], b[3]) - std::max(a[1], b[1]);
+    if (w <= 0 || h <= 0) {
+        return 0.0f;
+    }
+    float inter = static_cast<float>(w) * h;
+    float area_a = static_cast<float>(a[2] - a[0]) * (a[3] - a[1]);
+    float area_b = static_cast<float>(b[2] - b[0]) * (b[3] - b[1]);
+    return inter / (area_a + area_b - inter);
+}
+
+// Greedy IoU matching against the faces of the previous detections, the results come sorted by score.
+std::vector<uint16_t> update_tracks(FaceDetectContext &ctx, const std::list<dl::detect::result_t> &results)
+{
+    std::vector<uint16_t> ids;
+    ids.reserve(results.size());
+    std::vector<bool> matched(ctx.tracks.size(), false);
+    std::vector<Track> new_tracks;
+
+    for (const auto &res : results) {
+        if (res.box.size() < 4) {
+            ids.push_back(0);
+            continue;
         }
+        int best = -1;
+        float best_iou = TRACK_MIN_IOU;
+        for (size_t i = 0; i < ctx.tracks.size(); ++i) {
+            if (matched[i]) {
+                continue;
+            }
+            float iou = box_iou(ctx.tracks[i].box, res.box.data());
+            if (iou >= best_iou) {
+                best_iou = iou;
+                best = static_cast<int>(i);
+            }
+        }
+        Track track;
+        std::copy(res.box.begin(), res.box.begin() + 4, track.box);
+        track.misses = 0;
+        if (best >= 0) {
+            matched[best] = true;
+            track.id = ctx.tracks[best].id;
+        } else {
+            track.id = ctx.next_track_id++;
+            if (ctx.next_track_id == 0) {
+                ctx.next_track_id = 1;
+            }
+        }
+        ids.push_back(track.id);
+        new_tracks.push_back(track);
+    }
+
+    // Keep the faces missed for a few detections, so that a blink of the detector does not change their ID.
+    for (size_t i = 0; i < ctx.tracks.size(); ++i) {
+        if (!matched[i] && ++ctx.tracks[i].misses < TRACK_MAX_MISSES) {
+            new_tracks.push_back(ctx.tracks[i]);
+        }
+    }
+    ctx.tracks.swap(new_tracks);
+    return ids;
+}
+
+#if CONFIG_APP_STREAM_OVERLAY
+void update_overlay(FaceDetectContext &ctx,
+                    const std::list<dl::detect::result_t> &results,
+                    const std::vector<uint16_t> &track_ids,
+                    int64_t timestamp_us)
+{
+    stream_overlay_box_t boxes[STREAM_OVERLAY_MAX_BOXES];
+    int num_boxes = 0;
+    auto id = track_ids.begin();
+    for (auto res = results.begin(); res != results.end() && num_boxes < STREAM_OVERLAY_MAX_BOXES; ++res, ++id) {
+        if (res->box.size() < 4) {
+            continue;
+        }
+        stream_overlay_box_t &box = boxes[num_boxes++];
+        box.x1 = res->box[0];
+        box.y1 = res->box[1];
+        box.x2 = res->box[2];
+        box.y2 = res->box[3];
+        box.num_keypoints = std::min<int>(res->keypoint.size() / 2, STREAM_OVERLAY_MAX_KEYPOINTS);
+        for (int i = 0; i < box.num_keypoints * 2; ++i) {
+            box.keypoints[i] = res->keypoint[i];
+        }
+        box.score = static_cast<uint8_t>(std::min(std::max(res->score, 0.0f), 1.0f) * 100.0f + 0.5f);
+        box.track_id = *id;
+    }
+    stream_overlay_set_boxes(boxes, num_boxes, ctx.width, ctx.height, timestamp_us);
+}
+#endif
+
+// Returns the number of faces
+int process_frame(FaceDetectContext &ctx, void *frame, int64_t timestamp_us)
+{
+    dl::image::img_t img;
+    img.data = frame;
+    img.width = ctx.width;
+    img.height = ctx.height;
+    // The detector reads the luma of a YUV420 frame in place, the chroma is never touched.
+    if (ctx.pixformat == V4L2_PIX_FMT_RGB565) {
+        img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565;
+    } else if (ctx.pixformat == V4L2_PIX_FMT_YUV420) {
+        img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_YUV420;
+    } else {
+        img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_GRAY;
+    }
+
+    auto &det_results = ctx.detector->run(img);
+    std::vector<uint16_t> track_ids = update_tracks(ctx, det_results);
+#if CONFIG_APP_STREAM_OVERLAY
+    update_overlay(ctx, det_results, track_ids, timestamp_us);
+#endif
+    publish_results(ctx, det_results, timestamp_us);
+    return static_cast<int>(det_results.size());
+}
 
+void camera_detection_loop(FaceDetectContext *ctx)
+{
+    do {
         if (configure_camera_device(*ctx) != ESP_OK) {
             break;
         }
@@ -232,22 +413,15 @@ void detection_task(void *arg)
                 break;
             }
 
-            auto &mapped = ctx->buffers.at(buf.index);
-            dl::image::img_t img;
-            img.data = reinterpret_cast<uint16_t *>(mapped.addr);
-            img.width = ctx->width;
-            img.height = ctx->height;
-            img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565;
+            void *frame = ctx->buffers.at(buf.index).addr;
 
-            auto &det_results = ctx->detector->run(img);
             int64_t ts = static_cast<int64_t>(buf.timestamp.tv_sec) * 1000000LL + buf.timestamp.tv_usec;
             if (ts == 0) {
                 ts = esp_timer_get_time();
             }
-            if (det_results.size() > 0) face_count++;
-            //publish_results(*ctx, det_results, ts);
+            if (process_frame(*ctx, frame, ts) > 0) face_count++;
             //ESP_LOGI(TAG, "Detections: %d faces", num_faces);
-           
+
             if (ioctl(ctx->camera_fd, VIDIOC_QBUF, &buf) < 0) {
                 ESP_LOGE(TAG, "Failed to requeue buffer: errno=%d", errno);
                 break;
@@ -274,6 +448,60 @@ void detection_task(void *arg)
         ctx->stream_started = false;
     }
     release_buffers(*ctx);
+}
+
+void stream_detection_loop(FaceDetectContext *ctx)
+{
+    const TickType_t interval =
+        CONFIG_FACE_DET_MIN_INTERVAL_MS > 0 ? pdMS_TO_TICKS(CONFIG_FACE_DET_MIN_INTERVAL_MS) : 0;
+    TickType_t last_wake = xTaskGetTickCount();
+    int frame_count = 0;
+    int face_count = 0;
+    int64_t last_fps_log = esp_timer_get_time();
+
+    ctx->accepting_frame = true;
+    while (!ctx->should_stop) {
+        // Wake up now and then to see should_stop when no client is streaming.
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100)) == 0) {
+            continue;
+        }
+
+        if (process_frame(*ctx, ctx->frame_buf, ctx->fed_timestamp_us) > 0) face_count++;
+
+        ++frame_count;
+        int64_t now = esp_timer_get_time();
+        if (now - last_fps_log >= 1000000) {
+            ESP_LOGI(TAG, "Face detection FPS: %d, Faces detected: %d", frame_count, face_count);
+            frame_count = 0;
+            face_count = 0;
+            last_fps_log = now;
+        }
+
+        if (interval > 0) {
+            vTaskDelayUntil(&last_wake, interval);
+        }
+        ctx->accepting_frame = true;
+    }
+    ctx->accepting_frame = false;
+}
+
+void detection_task(void *arg)
+{
+    auto *ctx = static_cast<FaceDetectContext *>(arg);
+    if (!ctx->detector) {
+        ESP_LOGE(TAG, "Detector not initialized");
+    } else if (ctx->stream_fed) {
+        stream_detection_loop(ctx);
+    } else {
+        camera_detection_loop(ctx);
+    }
+
+    if (ctx->frame_buf) {
+        heap_caps_free(ctx->frame_buf);
+        ctx->frame_buf = nullptr;
+        ctx->frame_buf_size = 0;
+    }
+    ctx->tracks.clear();
     if (ctx->detector) {
         delete ctx->detector;
         ctx->detector = nullptr;
@@ -283,23 +511,14 @@ void detection_task(void *arg)
     vTaskDelete(nullptr);
 }
 
-} // namespace
-
-esp_err_t face_detect_start(int camera_fd, esp_mqtt_client_handle_t mqtt_client)
+esp_err_t start_detection_task(int camera_fd, esp_mqtt_client_handle_t mqtt_client)
 {
-#if !CONFIG_APP_ENABLE_FACE_DETECTION
-    (void)camera_fd;
-    (void)mqtt_client;
-    return ESP_ERR_NOT_SUPPORTED;
-#else
-    if (camera_fd < 0) {
-        return ESP_ERR_INVALID_ARG;
-    }
     if (s_ctx.running) {
         return ESP_ERR_INVALID_STATE;
     }
 
     s_ctx.camera_fd = camera_fd;
+    s_ctx.stream_fed = camera_fd < 0;
     s_ctx.mqtt_client = mqtt_client;
     s_ctx.should_stop = false;
     s_ctx.detector = new HumanFaceDetect();
@@ -324,8 +543,110 @@ esp_err_t face_detect_start(int camera_fd, esp_mqtt_client_handle_t mqtt_client)
     }
 
     s_ctx.running = true;
-    ESP_LOGI(TAG, "Face detection task started");
+    ESP_LOGI(TAG, "Face detection task started%s", s_ctx.stream_fed ? " on the HTTP stream" : "");
     return ESP_OK;
+}
+
+} // namespace
+
+esp_err_t face_detect_start(int camera_fd, esp_mqtt_client_handle_t mqtt_client)
+{
+#if !CONFIG_APP_ENABLE_FACE_DETECTION
+    (void)camera_fd;
+    (void)mqtt_client;
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    if (camera_fd < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return start_detection_task(camera_fd, mqtt_client);
+#endif
+}
+
+esp_err_t face_detect_start_on_stream(esp_mqtt_client_handle_t mqtt_client)
+{
+#if !CONFIG_APP_ENABLE_FACE_DETECTION
+    (void)mqtt_client;
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    return start_detection_task(-1, mqtt_client);
+#endif
+}
+
+bool face_detect_submit_frame(
+    const uint8_t *frame, uint32_t pixformat, uint32_t width, uint32_t height, int64_t timestamp_us)
+{
+#if !CONFIG_APP_ENABLE_FACE_DETECTION
+    (void)frame;
+    (void)pixformat;
+    (void)width;
+    (void)height;
+    (void)timestamp_us;
+    return false;
+#else
+    if (pixformat != V4L2_PIX_FMT_RGB565 && pixformat != V4L2_PIX_FMT_YUV420 && pixformat != V4L2_PIX_FMT_GREY) {
+        return false;
+    }
+    // The task owns the frame until it accepts the next one.
+    bool accepting = true;
+    if (!s_ctx.stream_fed || !frame || !s_ctx.accepting_frame.compare_exchange_strong(accepting, false)) {
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(width) * height;
+#if !CONFIG_FACE_DET_LUMA_ONLY
+    if (pixformat == V4L2_PIX_FMT_RGB565) {
+        size *= 2;
+    }
+#endif
+    if (!reserve_frame_buf(s_ctx, size)) {
+        s_ctx.accepting_frame = true;
+        return false;
+    }
+
+    if (pixformat == V4L2_PIX_FMT_YUV420) {
+        // The frame is copied anyway, keep only its luma.
+        dl::image::img_t src;
+        src.data = const_cast<uint8_t *>(frame);
+        src.width = width;
+        src.height = height;
+        src.pix_type = dl::image::DL_IMAGE_PIX_TYPE_YUV420;
+        dl::image::img_t dst;
+        dst.data = s_ctx.frame_buf;
+        dst.width = width;
+        dst.height = height;
+        dst.pix_type = dl::image::DL_IMAGE_PIX_TYPE_GRAY;
+        dl::image::convert_img(src, dst);
+        s_ctx.pixformat = V4L2_PIX_FMT_GREY;
+    } else if (pixformat == V4L2_PIX_FMT_GREY) {
+        memcpy(s_ctx.frame_buf, frame, size);
+        s_ctx.pixformat = V4L2_PIX_FMT_GREY;
+    } else {
+#if CONFIG_FACE_DET_LUMA_ONLY
+        // Keep the luma only, which halves the copy and the reads of the detector.
+        dl::image::img_t src;
+        src.data = const_cast<uint8_t *>(frame);
+        src.width = width;
+        src.height = height;
+        src.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB565;
+        dl::image::img_t dst;
+        dst.data = s_ctx.frame_buf;
+        dst.width = width;
+        dst.height = height;
+        dst.pix_type = dl::image::DL_IMAGE_PIX_TYPE_GRAY;
+        // Same byte order as the ISP frames drawn by the stream overlay.
+        dl::image::convert_img(src, dst, DL_IMAGE_CAP_RGB565_BIG_ENDIAN);
+        s_ctx.pixformat = V4L2_PIX_FMT_GREY;
+#else
+        memcpy(s_ctx.frame_buf, frame, size);
+        s_ctx.pixformat = V4L2_PIX_FMT_RGB565;
+#endif
+    }
+    s_ctx.width = width;
+    s_ctx.height = height;
+    s_ctx.fed_timestamp_us = timestamp_us;
+    xTaskNotifyGive(s_ctx.task_handle);
+    return true;
 #endif
 }
 
@@ -335,6 +656,15 @@ void face_detect_stop(void)
     if (!s_ctx.running) {
         return;
     }
+    if (s_ctx.stream_fed) {
+        // Take the frame before stopping, so that no submit is still copying into the buffer the task frees. A
+        // submit in flight notifies the task, which accepts frames again once it has detected on it.
+        bool accepting = true;
+        while (s_ctx.running && !s_ctx.accepting_frame.compare_exchange_strong(accepting, false)) {
+            accepting = true;
+            vTaskDelay(pdMS_TO_TICKS(1));
+        }
+    }
     s_ctx.should_stop = true;
     if (s_ctx.task_handle) {
         // Wait for task to clean up
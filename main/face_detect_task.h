@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "esp_err.h"
 #include "mqtt_client.h"
 
@@ -8,6 +10,25 @@ extern "C" {
 #endif
 
 esp_err_t face_detect_start(int camera_fd, esp_mqtt_client_handle_t mqtt_client);
+
+/**
+ * @brief Start the detection on the frames of the HTTP stream, given by face_detect_submit_frame(), instead of its
+ * own V4L2 buffers. For when the stream owns the camera.
+ */
+esp_err_t face_detect_start_on_stream(esp_mqtt_client_handle_t mqtt_client);
+
+/**
+ * @brief Copy a frame for the detection, if the detection task is waiting for one. Only the luma of a YUV420 frame is
+ * kept, and of a RGB565 one when CONFIG_FACE_DET_LUMA_ONLY is set.
+ *
+ * @param pixformat  V4L2_PIX_FMT_RGB565, V4L2_PIX_FMT_YUV420 or V4L2_PIX_FMT_GREY
+ *
+ * @return true if the frame was taken, false if the task is busy, not started on the stream or the format is not
+ * supported
+ */
+bool face_detect_submit_frame(
+    const uint8_t *frame, uint32_t pixformat, uint32_t width, uint32_t height, int64_t timestamp_us);
+
 void face_detect_stop(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,236 @@
+#include "stream_overlay.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_video_ioctl.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "dl_image_draw.hpp"
+#if CONFIG_APP_STREAM_OVERLAY_PPA
+#include "driver/ppa.h"
+#endif
+
+namespace {
+
+constexpr char TAG[] = "stream_overlay";
+
+// The ISP writes RGB565 with red in the high bits of each native 16-bit pixel, which dl::image calls big endian.
+constexpr uint32_t FRAME_CAPS = DL_IMAGE_CAP_RGB565_BIG_ENDIAN;
+constexpr int64_t BOX_TTL_US = CONFIG_APP_STREAM_OVERLAY_BOX_TTL_MS * 1000LL;
+constexpr uint8_t LINE_WIDTH = 2;
+constexpr uint8_t KEYPOINT_RADIUS = 2;
+constexpr uint8_t TEXT_SCALE = 2;
+constexpr int TEXT_PAD = 2;
+constexpr int LABEL_HEIGHT = DL_IMAGE_FONT_HEIGHT * TEXT_SCALE + 2 * TEXT_PAD;
+constexpr uint8_t LABEL_ALPHA = 160;
+constexpr int STATS_FRAMES = 300;
+
+const std::vector<uint8_t> TRACK_COLORS[] = {
+    {0, 255, 0}, {255, 200, 0}, {0, 200, 255}, {255, 64, 255}, {255, 96, 32}, {160, 255, 64},
+};
+const std::vector<uint8_t> TEXT_COLOR = {255, 255, 255};
+const std::vector<uint8_t> LABEL_COLOR = {0, 0, 0};
+const std::vector<uint8_t> KEYPOINT_COLOR = {255, 0, 0};
+
+struct OverlayState {
+    SemaphoreHandle_t lock = nullptr;
+    stream_overlay_box_t boxes[STREAM_OVERLAY_MAX_BOXES];
+    int num_boxes = 0;
+    uint32_t src_width = 0;
+    uint32_t src_height = 0;
+    int64_t timestamp_us = 0;
+#if CONFIG_APP_STREAM_OVERLAY_PPA
+    ppa_client_handle_t ppa_fill = nullptr;
+#endif
+    int stat_frames = 0;
+    int64_t stat_total_us = 0;
+    int64_t stat_max_us = 0;
+};
+
+OverlayState s_state;
+
+// Boxes are detected on the detection frame, scale them when the stream frame has another size.
+inline int scale_coord(int v, uint32_t dst, uint32_t src)
+{
+    return (src == 0 || src == dst) ? v : static_cast<int>(static_cast<int64_t>(v) * dst / src);
+}
+
+void draw_label(const dl::image::img_t &img, int x, int y, const char *text, const std::vector<uint8_t> &color)
+{
+    int w = dl::image::get_text_width(text, TEXT_SCALE) + 2 * TEXT_PAD;
+    dl::image::draw_blended_rectangle(img, x, y, x + w - 1, y + LABEL_HEIGHT - 1, LABEL_COLOR, LABEL_ALPHA, FRAME_CAPS);
+    dl::image::draw_text(img, x + TEXT_PAD, y + TEXT_PAD, text, color, TEXT_SCALE, FRAME_CAPS);
+}
+
+void draw_banner(const dl::image::img_t &img, int64_t timestamp_us, int num_boxes)
+{
+    int64_t ms = timestamp_us / 1000;
+    char text[48];
+    snprintf(text,
+             sizeof(text),
+             "%02d:%02d:%02d.%03d  faces %d",
+             static_cast<int>(ms / 3600000 % 24),
+             static_cast<int>(ms / 60000 % 60),
+             static_cast<int>(ms / 1000 % 60),
+             static_cast<int>(ms % 1000),
+             num_boxes);
+
+#if CONFIG_APP_STREAM_OVERLAY_PPA
+    if (s_state.ppa_fill &&
+        dl::image::draw_filled_rectangle(
+            img, 0, 0, img.width - 1, LABEL_HEIGHT - 1, LABEL_COLOR, s_state.ppa_fill, FRAME_CAPS) == ESP_OK) {
+        dl::image::draw_text(img, TEXT_PAD, TEXT_PAD, text, TEXT_COLOR, TEXT_SCALE, FRAME_CAPS);
+        return;
+    }
+#endif
+    draw_label(img, 0, 0, text, TEXT_COLOR);
+}
+
+void draw_box(const dl::image::img_t &img, const stream_overlay_box_t &box, uint32_t src_width, uint32_t src_height)
+{
+    const auto &color = TRACK_COLORS[box.track_id % (sizeof(TRACK_COLORS) / sizeof(TRACK_COLORS[0]))];
+    int x1 = scale_coord(box.x1, img.width, src_width);
+    int y1 = scale_coord(box.y1, img.height, src_height);
+    int x2 = scale_coord(box.x2, img.width, src_width);
+    int y2 = scale_coord(box.y2, img.height, src_height);
+    dl::image::draw_hollow_rectangle(img, x1, y1, x2, y2, color, LINE_WIDTH, FRAME_CAPS);
+
+    for (int i = 0; i < box.num_keypoints; i++) {
+        dl::image::draw_point(img,
+                              scale_coord(box.keypoints[2 * i], img.width, src_width),
+                              scale_coord(box.keypoints[2 * i + 1], img.height, src_height),
+                              KEYPOINT_COLOR,
+                              KEYPOINT_RADIUS,
+                              FRAME_CAPS);
+    }
+
+    char text[16];
+    snprintf(text, sizeof(text), "#%u %u%%", box.track_id, box.score);
+    // Above the box, or inside it when there is no room between the box and the banner.
+    int label_y = y1 - LINE_WIDTH / 2 - LABEL_HEIGHT;
+    if (label_y < LABEL_HEIGHT) {
+        label_y = y1 + LINE_WIDTH;
+    }
+    draw_label(img, x1 - LINE_WIDTH / 2, label_y, text, color);
+}
+
+} // namespace
+
+esp_err_t stream_overlay_init(void)
+{
+    // Created once and never deleted, the detection task may set boxes at any time.
+    if (!s_state.lock) {
+        s_state.lock = xSemaphoreCreateMutex();
+        if (!s_state.lock) {
+            ESP_LOGE(TAG, "Failed to create overlay lock");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+#if CONFIG_APP_STREAM_OVERLAY_PPA
+    if (s_state.ppa_fill) {
+        return ESP_OK;
+    }
+    ppa_client_config_t ppa_cfg = {};
+    ppa_cfg.oper_type = PPA_OPERATION_FILL;
+    ppa_cfg.max_pending_trans_num = 1;
+    esp_err_t err = ppa_register_client(&ppa_cfg, &s_state.ppa_fill);
+    if (err != ESP_OK) {
+        // Not fatal, the banner is blended by the CPU instead.
+        ESP_LOGW(TAG, "Failed to register PPA fill client (%s)", esp_err_to_name(err));
+        s_state.ppa_fill = nullptr;
+    }
+#endif
+    return ESP_OK;
+}
+
+void stream_overlay_deinit(void)
+{
+#if CONFIG_APP_STREAM_OVERLAY_PPA
+    if (s_state.ppa_fill) {
+        ppa_unregister_client(s_state.ppa_fill);
+        s_state.ppa_fill = nullptr;
+    }
+#endif
+    if (s_state.lock) {
+        xSemaphoreTake(s_state.lock, portMAX_DELAY);
+        s_state.num_boxes = 0;
+        xSemaphoreGive(s_state.lock);
+    }
+}
+
+void stream_overlay_set_boxes(const stream_overlay_box_t *boxes,
+                              int num_boxes,
+                              uint32_t src_width,
+                              uint32_t src_height,
+                              int64_t timestamp_us)
+{
+    if (!s_state.lock || (num_boxes > 0 && !boxes)) {
+        return;
+    }
+    num_boxes = std::min(std::max(num_boxes, 0), STREAM_OVERLAY_MAX_BOXES);
+    xSemaphoreTake(s_state.lock, portMAX_DELAY);
+    if (num_boxes > 0) {
+        memcpy(s_state.boxes, boxes, num_boxes * sizeof(stream_overlay_box_t));
+    }
+    s_state.num_boxes = num_boxes;
+    s_state.src_width = src_width;
+    s_state.src_height = src_height;
+    s_state.timestamp_us = timestamp_us;
+    xSemaphoreGive(s_state.lock);
+}
+
+void stream_overlay_draw(uint8_t *frame, uint32_t pixformat, uint32_t width, uint32_t height, int64_t timestamp_us)
+{
+    if (!s_state.lock || !frame || (pixformat != V4L2_PIX_FMT_RGB565 && pixformat != V4L2_PIX_FMT_YUV420)) {
+        return;
+    }
+    int64_t start = esp_timer_get_time();
+
+    // Copy the boxes, so that the detection task is never blocked by the drawing.
+    stream_overlay_box_t boxes[STREAM_OVERLAY_MAX_BOXES];
+    xSemaphoreTake(s_state.lock, portMAX_DELAY);
+    int num_boxes = s_state.num_boxes;
+    uint32_t src_width = s_state.src_width;
+    uint32_t src_height = s_state.src_height;
+    if (timestamp_us - s_state.timestamp_us > BOX_TTL_US) {
+        num_boxes = 0;
+    }
+    memcpy(boxes, s_state.boxes, num_boxes * sizeof(stream_overlay_box_t));
+    xSemaphoreGive(s_state.lock);
+
+    dl::image::img_t img;
+    img.data = frame;
+    img.width = width;
+    img.height = height;
+    img.pix_type = pixformat == V4L2_PIX_FMT_YUV420 ? dl::image::DL_IMAGE_PIX_TYPE_YUV420
+                                                    : dl::image::DL_IMAGE_PIX_TYPE_RGB565;
+
+    for (int i = 0; i < num_boxes; i++) {
+        draw_box(img, boxes[i], src_width, src_height);
+    }
+    // Last, so that the timestamp stays readable under the boxes at the top of the frame.
+    draw_banner(img, timestamp_us, num_boxes);
+
+    int64_t elapsed = esp_timer_get_time() - start;
+    s_state.stat_total_us += elapsed;
+    s_state.stat_max_us = std::max(s_state.stat_max_us, elapsed);
+    if (++s_state.stat_frames == STATS_FRAMES) {
+        ESP_LOGI(TAG,
+                 "Overlay %ux%u: avg %d us, max %d us",
+                 (unsigned)width,
+                 (unsigned)height,
+                 (int)(s_state.stat_total_us / STATS_FRAMES),
+                 (int)s_state.stat_max_us);
+        s_state.stat_frames = 0;
+        s_state.stat_total_us = 0;
+        s_state.stat_max_us = 0;
+    }
+}
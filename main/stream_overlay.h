@@ -0,0 +1,70 @@
+/*
+ * Stream Overlay Header
+ * Burns the latest detections and the frame timestamp into the streamed frames
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STREAM_OVERLAY_MAX_BOXES     16
+#define STREAM_OVERLAY_MAX_KEYPOINTS 5
+
+typedef struct {
+    int16_t x1;         // Box in pixels of the detection frame, (x2, y2) is included
+    int16_t y1;
+    int16_t x2;
+    int16_t y2;
+    int16_t keypoints[STREAM_OVERLAY_MAX_KEYPOINTS * 2];  // [x, y, ...], same frame as the box
+    uint8_t num_keypoints;
+    uint8_t score;      // Percent
+    uint16_t track_id;
+} stream_overlay_box_t;
+
+/**
+ * @brief Create the lock of the overlay, and the PPA client if CONFIG_APP_STREAM_OVERLAY_PPA is set
+ */
+esp_err_t stream_overlay_init(void);
+
+/**
+ * @brief Free the PPA client of stream_overlay_init() and drop the boxes
+ *
+ * The lock is kept, so that the detection task can still call stream_overlay_set_boxes().
+ */
+void stream_overlay_deinit(void);
+
+/**
+ * @brief Replace the boxes drawn on the next frames. Thread safe, the boxes are copied.
+ *
+ * @param boxes         Detections, at most STREAM_OVERLAY_MAX_BOXES are kept
+ * @param num_boxes     Number of boxes
+ * @param src_width     Width of the frame the boxes were detected on
+ * @param src_height    Height of the frame the boxes were detected on
+ * @param timestamp_us  Timestamp of that frame, the boxes are dropped when they get too old
+ */
+void stream_overlay_set_boxes(const stream_overlay_box_t *boxes,
+                              int num_boxes,
+                              uint32_t src_width,
+                              uint32_t src_height,
+                              int64_t timestamp_us);
+
+/**
+ * @brief Draw the boxes, their track IDs and the timestamp on a frame, right before it is encoded
+ *
+ * A YUV420 frame gets the overlay on its luma only, the boxes keep the chroma of the image under them.
+ *
+ * @param frame         Frame in the layout of the ISP
+ * @param pixformat     V4L2_PIX_FMT_RGB565 or V4L2_PIX_FMT_YUV420, other frames are left as they are
+ * @param width         Width of the frame
+ * @param height        Height of the frame
+ * @param timestamp_us  Capture time of the frame
+ */
+void stream_overlay_draw(uint8_t *frame, uint32_t pixformat, uint32_t width, uint32_t height, int64_t timestamp_us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -91,6 +91,7 @@ struct ArgsType {
     int input_height;
     void *debug_value; /*<! 60 It will malloc 16 bytes memory if malloc_debug_memory = true */
     bool auto_split;
+    void *im2col_buffer; /*<! patches of conv2d_im2col(), a slice of the buffer of the module, or NULL */
 };
 
 typedef void (*i_impl_func_s16_t)(int16_t *, int16_t *, void *);
@@ -158,6 +159,7 @@ std::vector<ArgsType<feature_t>> get_conv_operation_args(Tensor<feature_t> &outp
     args.input_height = input.shape[0];
     args.input_width = input.shape[1];
     args.auto_split = auto_split;
+    args.im2col_buffer = nullptr;
     // printf("input: %d, %d, %d, output: %d, %d, %d\n", input.shape[0], input.shape[1], input.shape[2],
     // output.shape[0], output.shape[1], output.shape[2]);
 
@@ -334,6 +336,7 @@ std::vector<ArgsType<feature_t>> get_conv_operation_args(TensorBase *output,
     args.input_height = input->shape[1];
     args.input_width = input->shape[2];
     args.auto_split = true;
+    args.im2col_buffer = nullptr;
     // printf("input: %d, %d, %d, output: %d, %d, %d\n", input->shape[1], input->shape[2], input->shape[3],
     // output->shape[1], output->shape[2], output->shape[3]);
 
@@ -2,6 +2,7 @@
 
 #include "dl_base_activate_buffer.hpp"
 #include "dl_base_activate_output.hpp"
+#include "dl_base_gemm.hpp"
 #include "dl_base_isa.hpp"
 
 namespace dl {
@@ -1339,5 +1340,171 @@ void conv2d<int8_t, int32_t, int32_t>(void *args_ptr)
 
     conv_operation_shell<int8_t, int32_t>(args, i_impl_func, i_impl_func_sp, c_impl_func, c_impl_func_sp, n_wise_func);
 }
+
+template <typename feature_t>
+bool conv2d_im2col_supported(const ArgsType<feature_t> &args)
+{
+#if CONFIG_ESP32P4_BOOST
+    int u = 16 / sizeof(feature_t);
+    return args.filter_height == 3 && args.filter_width == 3 && args.stride_y == 1 && args.stride_x == 1 &&
+        args.dilation_h == 1 && args.dilation_w == 1 && args.input_channel % u == 0 && args.output_channel % u == 0 &&
+        (args.activation_type == Linear || args.activation_type == ReLU) && args.mac_shift != INT_MIN;
+#else
+    return false;
+#endif
+}
+
+template bool conv2d_im2col_supported<int8_t>(const ArgsType<int8_t> &args);
+template bool conv2d_im2col_supported<int16_t>(const ArgsType<int16_t> &args);
+
+/**
+ * @brief Output pixels of a tile, its patches stay in cache while the filter panels pass over them, as gemm blocks its
+ * rows.
+ */
+template <typename feature_t>
+inline int conv2d_im2col_tile(const ArgsType<feature_t> &args)
+{
+    int k = 9 * args.input_channel;
+    int pixels = args.output_height * args.output_width;
+    return DL_MIN(DL_MAX(1, pixels), DL_MAX(1, 16384 / (k * (int)sizeof(feature_t))));
+}
+
+template <typename feature_t>
+bool conv2d_im2col_set_buffer(std::vector<ArgsType<feature_t>> &m_args, conv2dIm2colBuffer &im2col)
+{
+    size_t task_size = 0;
+    for (int i = 0; i < m_args.size(); i++) {
+        // Rounded to keep the slices 16-byte aligned.
+        size_t size = (size_t)conv2d_im2col_tile(m_args[i]) * 9 * m_args[i].input_channel * sizeof(feature_t);
+        task_size = DL_MAX(task_size, (size + 15) & ~(size_t)15);
+    }
+    if (task_size * m_args.size() > im2col.buffer_size) {
+        if (im2col.buffer) {
+            heap_caps_free(im2col.buffer);
+        }
+        im2col.buffer = tool::malloc_aligned(task_size * m_args.size(), 1, 16, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        im2col.buffer_size = im2col.buffer ? task_size * m_args.size() : 0;
+    }
+
+    for (int i = 0; i < m_args.size(); i++) {
+        m_args[i].im2col_buffer = im2col.buffer ? (char *)im2col.buffer + i * task_size : nullptr;
+    }
+    return im2col.buffer != nullptr;
+}
+
+template bool conv2d_im2col_set_buffer<int8_t>(std::vector<ArgsType<int8_t>> &, conv2dIm2colBuffer &);
+template bool conv2d_im2col_set_buffer<int16_t>(std::vector<ArgsType<int16_t>> &, conv2dIm2colBuffer &);
+
+template <typename feature_t>
+void conv2d_im2col(void *args_ptr)
+{
+    const ArgsType<feature_t> &args = *(ArgsType<feature_t> *)args_ptr;
+    feature_t *patches = (feature_t *)args.im2col_buffer;
+    if (!patches) {
+        // Out of internal RAM, the direct conv2d needs no buffer.
+        if constexpr (sizeof(feature_t) == 1) {
+            conv2d<int8_t, int32_t, int32_t>(args_ptr);
+        } else {
+            conv2d<int16_t, int32_t, int64_t>(args_ptr);
+        }
+        return;
+    }
+    int c = args.input_channel;
+    int k = 9 * c;
+    int pixels = args.output_height * args.output_width;
+    int tile = conv2d_im2col_tile(args);
+
+    gemmArgsType<feature_t> gemm_args;
+    gemm_args.input_element = patches;
+    gemm_args.filter_element = (const feature_t *)args.filter_element;
+    gemm_args.bias_element = args.bias_element;
+    gemm_args.n = args.output_channel;
+    gemm_args.k = k;
+    gemm_args.mac_shift = args.mac_shift;
+    gemm_args.activation_type = args.activation_type;
+    for (int begin = 0; begin < pixels; begin += tile) {
+        int rows = DL_MIN(tile, pixels - begin);
+        for (int i = 0; i < rows; i++) {
+            int y = (begin + i) / args.output_width - args.padding_h_head;
+            int x = (begin + i) % args.output_width - args.padding_w_head;
+            feature_t *row_ptr = patches + i * k;
+            for (int fy = 0; fy < 3; fy++) {
+                for (int fx = 0; fx < 3; fx++) {
+                    feature_t *patch_ptr = row_ptr + (fy * 3 + fx) * c;
+                    if (y + fy < 0 || y + fy >= args.input_height || x + fx < 0 || x + fx >= args.input_width) {
+                        memset(patch_ptr, 0, c * sizeof(feature_t));
+                    } else {
+                        tool::copy_memory(patch_ptr,
+                                          args.input_element + ((y + fy) * args.input_width + x + fx) * c,
+                                          c * sizeof(feature_t));
+                    }
+                }
+            }
+        }
+        gemm_args.output_element = args.output_element + begin * args.output_channel;
+        gemm_args.m = rows;
+        gemm<feature_t>(&gemm_args);
+    }
+}
+
+template void conv2d_im2col<int8_t>(void *args_ptr);
+template void conv2d_im2col<int16_t>(void *args_ptr);
+
+template <typename feature_t>
+void conv2d_pad_filter(
+    feature_t *padded_ptr, const feature_t *filter_ptr, int hw, int c, int n, int padded_c, int padded_n)
+{
+    int u = 16 / sizeof(feature_t);
+    int panels = n / u * u;
+    int padded_panels = padded_n / u * u;
+    for (int j = 0; j < n; j++) {
+        // Element (k, i) of output channel j, in a panel of u channels or in the [N % u, H, W, C] tail.
+        const feature_t *src = j < panels ? filter_ptr + (j / u) * hw * c * u + j % u : filter_ptr + j * hw * c;
+        int src_step = j < panels ? u : 1;
+        feature_t *dst = j < padded_panels ? padded_ptr + (j / u) * hw * padded_c * u + j % u
+                                           : padded_ptr + j * hw * padded_c;
+        int dst_step = j < padded_panels ? u : 1;
+        for (int k = 0; k < hw; k++) {
+            for (int i = 0; i < c; i++) {
+                dst[(k * padded_c + i) * dst_step] = src[(k * c + i) * src_step];
+            }
+        }
+    }
+}
+
+template void conv2d_pad_filter<int8_t>(int8_t *, const int8_t *, int, int, int, int, int);
+template void conv2d_pad_filter<int16_t>(int16_t *, const int16_t *, int, int, int, int, int);
+
+TensorBase *conv2d_pad_filter(TensorBase *filter, int input_channel, int output_channel)
+{
+    std::vector<int> shape = {filter->shape[0], filter->shape[1], input_channel, output_channel};
+    TensorBase *padded = new TensorBase(shape, nullptr, filter->exponent, filter->dtype, true, filter->caps);
+    int hw = filter->shape[0] * filter->shape[1];
+    if (filter->dtype == DATA_TYPE_INT8) {
+        conv2d_pad_filter((int8_t *)padded->get_element_ptr(),
+                          (const int8_t *)filter->get_element_ptr(),
+                          hw,
+                          filter->shape[2],
+                          filter->shape[3],
+                          input_channel,
+                          output_channel);
+    } else {
+        conv2d_pad_filter((int16_t *)padded->get_element_ptr(),
+                          (const int16_t *)filter->get_element_ptr(),
+                          hw,
+                          filter->shape[2],
+                          filter->shape[3],
+                          input_channel,
+                          output_channel);
+    }
+    return padded;
+}
+
+TensorBase *conv2d_pad_bias(TensorBase *bias, int output_channel)
+{
+    TensorBase *padded = new TensorBase({output_channel}, nullptr, bias->exponent, bias->dtype, true, bias->caps);
+    tool::copy_memory(padded->get_element_ptr(), bias->get_element_ptr(), bias->get_bytes());
+    return padded;
+}
 } // namespace base
 } // namespace dl
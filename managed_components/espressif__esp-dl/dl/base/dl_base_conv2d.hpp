@@ -14,5 +14,88 @@ namespace base {
  */
 template <typename feature_t, typename bias_t, typename buffer_t>
 void conv2d(void *const args_ptr);
+
+/**
+ * @brief The algorithms of conv2d, chosen per layer by Model::build() with autotune.
+ */
+typedef enum {
+    CONV2D_ALGORITHM_DIRECT = 0, /*<! conv2d() */
+    CONV2D_ALGORITHM_IM2COL = 1, /*<! conv2d_im2col() */
+} conv2d_algorithm_t;
+
+/**
+ * @brief Whether conv2d_im2col() can run the conv2d: a stride 1, dilation 1 3x3 filter in the aligned esp32p4 layout.
+ */
+template <typename feature_t>
+bool conv2d_im2col_supported(const ArgsType<feature_t> &args);
+
+/**
+ * @brief The patches of conv2d_im2col(), kept by the module and sliced per task by conv2d_im2col_set_buffer(). The
+ * buffer only grows.
+ */
+struct conv2dIm2colBuffer {
+    void *buffer;       /*<! patches of all the tasks */
+    size_t buffer_size; /*<! bytes of buffer */
+
+    conv2dIm2colBuffer() : buffer(nullptr), buffer_size(0) {}
+
+    ~conv2dIm2colBuffer()
+    {
+        if (buffer) {
+            heap_caps_free(buffer);
+        }
+    }
+
+    conv2dIm2colBuffer(const conv2dIm2colBuffer &) = delete;
+    conv2dIm2colBuffer &operator=(const conv2dIm2colBuffer &) = delete;
+};
+
+/**
+ * @brief Give each task of conv2d_im2col() its slice of the buffer, grown in internal RAM if the tasks need more.
+ *
+ * @param m_args the tasks from get_conv_operation_args()
+ * @param im2col the buffer kept by the module
+ *
+ * @return false if out of memory, the tasks then run conv2d()
+ */
+template <typename feature_t>
+bool conv2d_im2col_set_buffer(std::vector<ArgsType<feature_t>> &m_args, conv2dIm2colBuffer &im2col);
+
+/**
+ * @brief conv2d as im2col and gemm. The 3x3xC patches of a tile of output pixels are gathered into the rows of
+ * im2col_buffer, then the gemm kernel multiplies them by the filter: the aligned filter layout [N / u, 3, 3, C, u] is
+ * the gemm panel layout of k = 9C. It is bit-exact with conv2d(), which it runs when im2col_buffer is NULL.
+ *
+ * @param args_ptr ArgsType<feature_t>, as for conv2d(), with im2col_buffer set by conv2d_im2col_set_buffer()
+ */
+template <typename feature_t>
+void conv2d_im2col(void *args_ptr);
+
+/**
+ * @brief Zero-pad the input and output channels of a conv2d filter in the layout of the boosted esp32p4 kernels:
+ * [N / u, H, W, C, u] for the whole panels of u = 16 / sizeof(feature_t) output channels, then [N % u, H, W, C] for
+ * the remaining ones. The padded output channels compute zero, the padded input channels are ignored.
+ *
+ * @param filter         filter of shape [H, W, C, N]
+ * @param input_channel  padded C
+ * @param output_channel padded N, either N or a multiple of u
+ *
+ * @return The padded filter, owned by the caller
+ */
+TensorBase *conv2d_pad_filter(TensorBase *filter, int input_channel, int output_channel);
+
+/**
+ * @brief conv2d_pad_filter() on raw buffers. padded_ptr holds hw * padded_c * padded_n zeroed elements.
+ */
+template <typename feature_t>
+void conv2d_pad_filter(
+    feature_t *padded_ptr, const feature_t *filter_ptr, int hw, int c, int n, int padded_c, int padded_n);
+
+/**
+ * @brief Zero-pad a bias to more output channels.
+ *
+ * @return The padded bias, owned by the caller
+ */
+TensorBase *conv2d_pad_bias(TensorBase *bias, int output_channel);
 } // namespace base
 } // namespace dl
@@ -0,0 +1,38 @@
+#include "dl_base_dotprod.hpp"
+
+#include "dl_base_isa.hpp"
+#include "dl_define.hpp"
+
+namespace dl {
+namespace base {
+template <typename feature_t>
+int64_t dotprod_c(const feature_t *input0_ptr, const feature_t *input1_ptr, const int length)
+{
+    int64_t sum = 0;
+    for (int i = 0; i < length; i++) {
+        sum += (int32_t)input0_ptr[i] * (int32_t)input1_ptr[i];
+    }
+    return sum;
+}
+
+int64_t dotprod(const int8_t *input0_ptr, const int8_t *input1_ptr, const int length)
+{
+#if CONFIG_ESP32P4_BOOST
+    if (length % 16 == 0 && !((unsigned)input0_ptr & 15) && !((unsigned)input1_ptr & 15)) {
+        return dl_esp32p4_s8_dotprod(input0_ptr, input1_ptr, length >> 4);
+    }
+#endif
+    return dotprod_c<int8_t>(input0_ptr, input1_ptr, length);
+}
+
+int64_t dotprod(const int16_t *input0_ptr, const int16_t *input1_ptr, const int length)
+{
+#if CONFIG_ESP32P4_BOOST
+    if (length % 8 == 0 && !((unsigned)input0_ptr & 15) && !((unsigned)input1_ptr & 15)) {
+        return dl_esp32p4_s16_dotprod(input0_ptr, input1_ptr, length >> 3);
+    }
+#endif
+    return dotprod_c<int16_t>(input0_ptr, input1_ptr, length);
+}
+} // namespace base
+} // namespace dl
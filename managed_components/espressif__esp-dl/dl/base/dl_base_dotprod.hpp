@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace dl {
+namespace base {
+/**
+ * @brief int8 dot product, sum(input0[i] * input1[i]) accumulated in 64 bit.
+ *
+ * @param input0_ptr first vector, 16-byte aligned for the boosted path
+ * @param input1_ptr second vector, 16-byte aligned for the boosted path
+ * @param length     element number, a multiple of 16 for the boosted path
+ * @return int64_t
+ */
+int64_t dotprod(const int8_t *input0_ptr, const int8_t *input1_ptr, const int length);
+
+/**
+ * @brief int16 dot product, sum(input0[i] * input1[i]) accumulated in 64 bit.
+ * @note On esp32p4 the accumulator is 40 bit wide, keep |input| < 2^14 when length is up to 2048.
+ *
+ * @param input0_ptr first vector, 16-byte aligned for the boosted path
+ * @param input1_ptr second vector, 16-byte aligned for the boosted path
+ * @param length     element number, a multiple of 8 for the boosted path
+ * @return int64_t
+ */
+int64_t dotprod(const int16_t *input0_ptr, const int16_t *input1_ptr, const int length);
+} // namespace base
+} // namespace dl
@@ -0,0 +1,206 @@
+#include "dl_base_gemm.hpp"
+
+#include "dl_base_isa.hpp"
+
+namespace dl {
+namespace base {
+template <typename feature_t>
+void gemm_pack_filter(feature_t *packed_ptr, const feature_t *filter_ptr, int k, int n)
+{
+    int u = 16 / sizeof(feature_t);
+    for (int j = 0; j < n; j += u) {
+        int width = DL_MIN(u, n - j);
+        for (int c = 0; c < k; c++) {
+            const feature_t *row_ptr = filter_ptr + c * n + j;
+            for (int i = 0; i < width; i++) {
+                packed_ptr[i] = row_ptr[i];
+            }
+            for (int i = width; i < u; i++) {
+                packed_ptr[i] = 0;
+            }
+            packed_ptr += u;
+        }
+    }
+}
+
+template void gemm_pack_filter<int8_t>(int8_t *packed_ptr, const int8_t *filter_ptr, int k, int n);
+template void gemm_pack_filter<int16_t>(int16_t *packed_ptr, const int16_t *filter_ptr, int k, int n);
+
+template <typename buffer_t>
+inline buffer_t gemm_shift_half_even(buffer_t value, int shift)
+{
+    if (shift <= 0) {
+        return value * ((buffer_t)1 << -shift);
+    }
+    buffer_t quotient = value >> shift;
+    buffer_t remainder = value - quotient * ((buffer_t)1 << shift);
+    buffer_t half = (buffer_t)1 << (shift - 1);
+    if (remainder > half || (remainder == half && (quotient & 1))) {
+        quotient++;
+    }
+    return quotient;
+}
+
+template <typename feature_t, typename buffer_t>
+void gemm_c(const gemmArgsType<feature_t> &args)
+{
+    int u = 16 / sizeof(feature_t);
+    const buffer_t *bias_ptr = (const buffer_t *)args.bias_element;
+    for (int i = 0; i < args.m; i++) {
+        const feature_t *input_ptr = args.input_element + i * args.k;
+        feature_t *output_ptr = args.output_element + i * args.n;
+        for (int j = 0; j < args.n; j++) {
+            const feature_t *filter_ptr = args.filter_element + (j / u) * args.k * u + j % u;
+            buffer_t acc = bias_ptr ? bias_ptr[j] : 0;
+            for (int c = 0; c < args.k; c++) {
+                acc += (buffer_t)input_ptr[c] * filter_ptr[c * u];
+            }
+            acc = gemm_shift_half_even(acc, args.channel_shift ? args.channel_shift[j] : args.mac_shift);
+            if (args.activation_type == ReLU && acc < 0) {
+                acc = 0;
+            }
+            tool::truncate(output_ptr[j], acc);
+        }
+    }
+}
+
+template <>
+void gemm_c<int8_t>(void *args_ptr)
+{
+    gemm_c<int8_t, int32_t>(*(gemmArgsType<int8_t> *)args_ptr);
+}
+
+template <>
+void gemm_c<int16_t>(void *args_ptr)
+{
+    gemm_c<int16_t, int64_t>(*(gemmArgsType<int16_t> *)args_ptr);
+}
+
+#if CONFIG_ESP32P4_BOOST
+/**
+ * @brief Rows of input kept hot in cache while all the filter panels pass over them.
+ */
+template <typename feature_t>
+inline int gemm_row_block(int k)
+{
+    return DL_MAX(1, 16384 / (k * (int)sizeof(feature_t)));
+}
+
+/**
+ * @brief Rows of accumulators requantized at a time by gemm_channel_shift(), 64 bytes each.
+ */
+#define GEMM_ACC_ROWS 8
+
+/**
+ * @brief The per-channel gemm: the kernel leaves the accumulators of GEMM_ACC_ROWS rows of a panel, then each is
+ * shifted by the mac_shift of its channel like gemm_c() does.
+ */
+template <typename feature_t, typename buffer_t>
+void gemm_channel_shift(const gemmArgsType<feature_t> &args,
+                        void (*kernel)(buffer_t *, const feature_t *, const feature_t *, const buffer_t *, int, int))
+{
+    int u = 16 / sizeof(feature_t);
+    buffer_t acc[GEMM_ACC_ROWS * 16 / sizeof(feature_t)] __attribute__((aligned(16)));
+    const buffer_t *bias_ptr = (const buffer_t *)args.bias_element;
+    int row_block = gemm_row_block<feature_t>(args.k);
+    for (int i = 0; i < args.m; i += row_block) {
+        int rows = DL_MIN(row_block, args.m - i);
+        for (int j = 0; j < args.n; j += u) {
+            const int8_t *shift_ptr = args.channel_shift + j;
+            for (int r = 0; r < rows; r += GEMM_ACC_ROWS) {
+                int acc_rows = DL_MIN(GEMM_ACC_ROWS, rows - r);
+                kernel(acc,
+                       args.input_element + (i + r) * args.k,
+                       args.filter_element + j * args.k,
+                       bias_ptr ? bias_ptr + j : nullptr,
+                       acc_rows,
+                       args.k / u - 1);
+                for (int y = 0; y < acc_rows; y++) {
+                    feature_t *output_ptr = args.output_element + (i + r + y) * args.n + j;
+                    for (int x = 0; x < u; x++) {
+                        buffer_t value = gemm_shift_half_even(acc[y * u + x], shift_ptr[x]);
+                        if (args.activation_type == ReLU && value < 0) {
+                            value = 0;
+                        }
+                        tool::truncate(output_ptr[x], value);
+                    }
+                }
+            }
+        }
+    }
+}
+#endif
+
+template <>
+void gemm<int8_t>(void *args_ptr)
+{
+    gemmArgsType<int8_t> &args = *(gemmArgsType<int8_t> *)args_ptr;
+#if CONFIG_ESP32P4_BOOST
+    if (args.k % 16 == 0 && args.n % 16 == 0 && (args.channel_shift || args.mac_shift >= 0) &&
+        !((unsigned)args.input_element & 15) && !((unsigned)args.output_element & 15) &&
+        !((unsigned)args.filter_element & 15) && !((unsigned)args.bias_element & 15)) {
+        if (args.channel_shift) {
+            gemm_channel_shift<int8_t, int32_t>(args, dl_esp32p4_s8_gemm_n16_acc);
+            return;
+        }
+        dl_esp32p4_cfg_round(ROUND_MODE_HALF_EVEN);
+        void (*kernel)(int8_t *, const int8_t *, const int8_t *, const int32_t *, int, int, int, int) =
+            args.activation_type == ReLU ? dl_esp32p4_s8_gemm_n16_relu : dl_esp32p4_s8_gemm_n16;
+        const int32_t *bias_ptr = (const int32_t *)args.bias_element;
+        int row_block = gemm_row_block<int8_t>(args.k);
+        for (int i = 0; i < args.m; i += row_block) {
+            int rows = DL_MIN(row_block, args.m - i);
+            for (int j = 0; j < args.n; j += 16) {
+                kernel(args.output_element + i * args.n + j,
+                       args.input_element + i * args.k,
+                       args.filter_element + j * args.k,
+                       bias_ptr ? bias_ptr + j : nullptr,
+                       rows,
+                       args.k / 16 - 1,
+                       args.n,
+                       args.mac_shift);
+            }
+        }
+        return;
+    }
+#endif
+    gemm_c<int8_t, int32_t>(args);
+}
+
+template <>
+void gemm<int16_t>(void *args_ptr)
+{
+    gemmArgsType<int16_t> &args = *(gemmArgsType<int16_t> *)args_ptr;
+#if CONFIG_ESP32P4_BOOST
+    if (args.k % 8 == 0 && args.n % 8 == 0 && (args.channel_shift || args.mac_shift >= 0) &&
+        !((unsigned)args.input_element & 15) && !((unsigned)args.output_element & 15) &&
+        !((unsigned)args.filter_element & 15) && !((unsigned)args.bias_element & 15)) {
+        if (args.channel_shift) {
+            gemm_channel_shift<int16_t, int64_t>(args, dl_esp32p4_s16_gemm_n8_acc);
+            return;
+        }
+        dl_esp32p4_cfg_round(ROUND_MODE_HALF_EVEN);
+        void (*kernel)(int16_t *, const int16_t *, const int16_t *, const int64_t *, int, int, int, int) =
+            args.activation_type == ReLU ? dl_esp32p4_s16_gemm_n8_relu : dl_esp32p4_s16_gemm_n8;
+        const int64_t *bias_ptr = (const int64_t *)args.bias_element;
+        int row_block = gemm_row_block<int16_t>(args.k);
+        for (int i = 0; i < args.m; i += row_block) {
+            int rows = DL_MIN(row_block, args.m - i);
+            for (int j = 0; j < args.n; j += 8) {
+                kernel(args.output_element + i * args.n + j,
+                       args.input_element + i * args.k,
+                       args.filter_element + j * args.k,
+                       bias_ptr ? bias_ptr + j : nullptr,
+                       rows,
+                       args.k / 8 - 1,
+                       args.n,
+                       args.mac_shift);
+            }
+        }
+        return;
+    }
+#endif
+    gemm_c<int16_t, int64_t>(args);
+}
+} // namespace base
+} // namespace dl
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "dl_base.hpp"
+
+namespace dl {
+namespace base {
+/**
+ * @brief Arguments of gemm(), output[m, n] = activation((input[m, k] * filter[k, n] + bias) >> mac_shift).
+ *
+ * The filter is stored in panels of u = 16 / sizeof(feature_t) output channels, [ceil(n / u), k, u], which is also
+ * the layout of the aligned esp32p4 conv2d 1x1 filter. Use gemm_pack_filter() to get it from a row-major filter.
+ */
+template <typename feature_t>
+struct gemmArgsType {
+    feature_t *output_element;         /*<! 0 [m, n] */
+    const feature_t *input_element;    /*<! 1 [m, k] */
+    const feature_t *filter_element;   /*<! 2 [ceil(n / u), k, u] */
+    const void *bias_element;          /*<! 3 int32_t for int8, int64_t for int16, in accumulator scale, or NULL */
+    int m;                             /*<! 4 */
+    int n;                             /*<! 5 */
+    int k;                             /*<! 6 */
+    int mac_shift;                     /*<! 7 output.exponent - filter.exponent - input.exponent */
+    activation_type_t activation_type; /*<! 8 Linear or ReLU */
+    const int8_t *channel_shift;       /*<! 9 mac_shift of each output channel of a per-channel quantized filter, n
+                                          elements, or NULL to use mac_shift */
+};
+
+/**
+ * @brief Element number of a packed filter.
+ */
+template <typename feature_t>
+int gemm_packed_filter_size(int k, int n)
+{
+    int u = 16 / sizeof(feature_t);
+    return (n + u - 1) / u * u * k;
+}
+
+/**
+ * @brief Pack a row-major [k, n] filter into gemm panels, the last panel is padded with zero.
+ *
+ * @param packed_ptr gemm_packed_filter_size() elements, 16-byte aligned
+ * @param filter_ptr row-major [k, n] filter
+ */
+template <typename feature_t>
+void gemm_pack_filter(feature_t *packed_ptr, const feature_t *filter_ptr, int k, int n);
+
+/**
+ * @brief Split the rows into two tasks when the gemm is large enough or RUNTIME_MODE_MULTI_CORE is set.
+ */
+template <typename feature_t>
+std::vector<gemmArgsType<feature_t>> get_gemm_operation_args(feature_t *output_ptr,
+                                                             const feature_t *input_ptr,
+                                                             const feature_t *packed_filter_ptr,
+                                                             const void *bias_ptr,
+                                                             int m,
+                                                             int n,
+                                                             int k,
+                                                             int mac_shift,
+                                                             activation_type_t activation_type,
+                                                             const runtime_mode_t runtime_mode = RUNTIME_MODE_AUTO)
+{
+    gemmArgsType<feature_t> args;
+    args.output_element = output_ptr;
+    args.input_element = input_ptr;
+    args.filter_element = packed_filter_ptr;
+    args.bias_element = bias_ptr;
+    args.m = m;
+    args.n = n;
+    args.k = k;
+    args.mac_shift = mac_shift;
+    args.activation_type = activation_type;
+    args.channel_shift = nullptr;
+
+    std::vector<gemmArgsType<feature_t>> m_args(1, args);
+    if (m >= 2 &&
+        (runtime_mode == RUNTIME_MODE_MULTI_CORE ||
+         (runtime_mode == RUNTIME_MODE_AUTO && (int64_t)m * n * k >= (1 << 18)))) {
+        // Divide the rows into two tasks, the task creation costs about as much as 2^17 MACs.
+        m_args.push_back(args);
+        int half = m / 2;
+        m_args[0].m = half;
+        m_args[1].m = m - half;
+        m_args[1].input_element += half * k;
+        m_args[1].output_element += half * n;
+    }
+    return m_args;
+}
+
+/**
+ * @brief The portable gemm, the boosted kernels are bit-exact with it: the bias is added before the shift, the shift
+ * rounds half to even and the result saturates.
+ *
+ * @param args_ptr gemmArgsType<feature_t>
+ */
+template <typename feature_t>
+void gemm_c(void *args_ptr);
+
+/**
+ * @brief gemm. On esp32p4 the boosted path needs k and n to be multiples of u, mac_shift >= 0 and 16-byte aligned
+ * pointers. Like conv2d, the int8 kernel accumulates in 20-bit lanes, keep |sum| < 2^19 for bit-exact results.
+ *
+ * With channel_shift the kernels leave the accumulators of a few rows in a buffer and the requantization of each
+ * channel is done on them, so a negative shift is fine too.
+ *
+ * @param args_ptr gemmArgsType<feature_t>
+ */
+template <typename feature_t>
+void gemm(void *args_ptr);
+} // namespace base
+} // namespace dl
@@ -0,0 +1,47 @@
+#include "dl_base_lut.hpp"
+
+#include "dl_define.hpp"
+
+namespace dl {
+namespace base {
+void lut(int8_t *output_ptr, const int8_t *input_ptr, const int size, const int8_t *table)
+{
+    // Four independent loads per iteration keep the load pipeline busy, there is no gather instruction to use.
+    const int8_t *table_ptr = table + 128;
+    int i = 0;
+    for (; i + 4 <= size; i += 4) {
+        int8_t y0 = table_ptr[input_ptr[i]];
+        int8_t y1 = table_ptr[input_ptr[i + 1]];
+        int8_t y2 = table_ptr[input_ptr[i + 2]];
+        int8_t y3 = table_ptr[input_ptr[i + 3]];
+        output_ptr[i] = y0;
+        output_ptr[i + 1] = y1;
+        output_ptr[i + 2] = y2;
+        output_ptr[i + 3] = y3;
+    }
+    for (; i < size; i++) {
+        output_ptr[i] = table_ptr[input_ptr[i]];
+    }
+}
+
+void lut(int16_t *output_ptr, const int16_t *input_ptr, const int size, const int16_t *table)
+{
+    const int16_t *table_ptr = table + 32768;
+    for (int i = 0; i < size; i++) {
+        output_ptr[i] = table_ptr[input_ptr[i]];
+    }
+}
+
+void lut(int16_t *output_ptr, const int16_t *input_ptr, const int size, const int32_t *table, const int step_shift)
+{
+    const int mask = (1 << step_shift) - 1;
+    const int half = 1 << (step_shift - 1);
+    for (int i = 0; i < size; i++) {
+        int u = input_ptr[i] + 32768;
+        const int32_t *t = table + (u >> step_shift);
+        int y = t[0] + ((((u & mask) * (t[1] - t[0])) + half) >> step_shift);
+        output_ptr[i] = (DL_CLIP(y, INT16_MIN, INT16_MAX));
+    }
+}
+} // namespace base
+} // namespace dl
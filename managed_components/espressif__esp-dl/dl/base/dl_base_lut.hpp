@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace dl {
+namespace base {
+/**
+ * @brief int8 table lookup, output[i] = table[input[i] + 128]. Input and output may be the same buffer.
+ *
+ * @param output_ptr output elements
+ * @param input_ptr  input elements
+ * @param size       element number
+ * @param table      256 entries
+ */
+void lut(int8_t *output_ptr, const int8_t *input_ptr, const int size, const int8_t *table);
+
+/**
+ * @brief int16 table lookup, output[i] = table[input[i] + 32768]. Input and output may be the same buffer.
+ *
+ * @param output_ptr output elements
+ * @param input_ptr  input elements
+ * @param size       element number
+ * @param table      65536 entries
+ */
+void lut(int16_t *output_ptr, const int16_t *input_ptr, const int size, const int16_t *table);
+
+/**
+ * @brief int16 table lookup with linear interpolation. Entry k holds the output of input (k << step_shift) - 32768,
+ * the inputs between two entries are interpolated with rounding. The entries are not saturated to int16, only the
+ * interpolated output is, so the segments where the function crosses the int16 range are interpolated correctly.
+ * Input and output may be the same buffer.
+ *
+ * @param output_ptr output elements
+ * @param input_ptr  input elements
+ * @param size       element number
+ * @param table      (65536 >> step_shift) + 1 entries, |entry| <= 2^23
+ * @param step_shift 1 ~ 7
+ */
+void lut(int16_t *output_ptr, const int16_t *input_ptr, const int size, const int32_t *table, const int step_shift);
+} // namespace base
+} // namespace dl
@@ -0,0 +1,298 @@
+#include "dl_base_mixed_conv2d.hpp"
+
+#include "dl_base_gemm.hpp"
+#include <string.h>
+
+namespace dl {
+namespace base {
+inline int64_t mixed_shift_half_even(int64_t value, int shift)
+{
+    if (shift <= 0) {
+        return value * ((int64_t)1 << -shift);
+    }
+    int64_t quotient = value >> shift;
+    int64_t remainder = value - quotient * ((int64_t)1 << shift);
+    int64_t half = (int64_t)1 << (shift - 1);
+    if (remainder > half || (remainder == half && (quotient & 1))) {
+        quotient++;
+    }
+    return quotient;
+}
+
+template <typename feature_t, typename filter_t>
+void mixed_conv2d_c(void *args_ptr)
+{
+    const mixedConvArgsType<feature_t, filter_t> &args = *(mixedConvArgsType<feature_t, filter_t> *)args_ptr;
+    int filter_n_offset = args.depthwise ? 1 : args.filter_height * args.filter_width * args.input_channel;
+#if CONFIG_ESP32P4_BOOST
+    int u = args.depthwise ? 1 : 16 / sizeof(filter_t);
+#else
+    int u = 1;
+#endif
+    int panels = args.output_channel / u * u;
+
+    for (int pixel = args.pixel_begin; pixel < args.pixel_end; pixel++) {
+        int input_y = pixel / args.output_width * args.stride_y - args.padding_top;
+        int input_x = pixel % args.output_width * args.stride_x - args.padding_left;
+        feature_t *output_ptr = args.output_element + pixel * args.output_channel;
+
+        for (int n = 0; n < args.output_channel; n++) {
+            // Element (tap, c) of output channel n, in a panel of u channels or in the [N % u, H, W, C] tail.
+            const filter_t *filter_ptr = n < panels ? args.filter_element + (n / u) * filter_n_offset * u + n % u
+                                                    : args.filter_element + n * filter_n_offset;
+            int filter_step = n < panels ? u : 1;
+            int64_t acc = args.bias_element ? args.bias_element[n] : 0;
+            for (int fy = 0; fy < args.filter_height; fy++) {
+                int y = input_y + fy * args.dilation_y;
+                if (y < 0 || y >= args.input_height) {
+                    continue;
+                }
+                for (int fx = 0; fx < args.filter_width; fx++) {
+                    int x = input_x + fx * args.dilation_x;
+                    if (x < 0 || x >= args.input_width) {
+                        continue;
+                    }
+                    const feature_t *input_ptr = args.input_element + (y * args.input_width + x) * args.input_channel;
+                    const filter_t *tap_ptr =
+                        filter_ptr + (fy * args.filter_width + fx) * args.input_channel * filter_step;
+                    if (args.depthwise) {
+                        acc += (int32_t)input_ptr[n] * tap_ptr[0];
+                    } else {
+                        for (int c = 0; c < args.input_channel; c++) {
+                            acc += (int32_t)input_ptr[c] * tap_ptr[c * filter_step];
+                        }
+                    }
+                }
+            }
+            acc = mixed_shift_half_even(acc, args.mac_shift[n]);
+            if (args.activation_type == ReLU && acc < 0) {
+                acc = 0;
+            }
+            tool::truncate(output_ptr[n], acc);
+        }
+    }
+}
+
+template void mixed_conv2d_c<int8_t, int8_t>(void *args_ptr);
+template void mixed_conv2d_c<int8_t, int16_t>(void *args_ptr);
+template void mixed_conv2d_c<int16_t, int8_t>(void *args_ptr);
+template void mixed_conv2d_c<int16_t, int16_t>(void *args_ptr);
+
+/**
+ * @brief Whether the task reads the input as the patches: a 1x1 stride 1 conv2d without padding of the gemm element.
+ */
+template <typename feature_t, typename filter_t>
+inline bool mixed_conv2d_gemm_direct(const mixedConvArgsType<feature_t, filter_t> &args)
+{
+    return std::is_same<feature_t, mixed_gemm_t<feature_t, filter_t>>::value && args.filter_height == 1 &&
+        args.filter_width == 1 && args.stride_y == 1 && args.stride_x == 1 && args.padding_top == 0 &&
+        args.padding_left == 0 && args.output_width == args.input_width &&
+        args.pixel_end <= args.input_height * args.input_width;
+}
+
+/**
+ * @brief Output pixels of a tile, its patches stay in cache while the filter panels pass over them.
+ */
+template <typename feature_t, typename filter_t>
+inline int mixed_conv2d_gemm_tile(const mixedConvArgsType<feature_t, filter_t> &args)
+{
+    int k = args.filter_height * args.filter_width * args.input_channel;
+    int tile = DL_MAX(1, 16384 / (k * (int)sizeof(mixed_gemm_t<feature_t, filter_t>)));
+    return DL_MIN(tile, DL_MAX(1, args.pixel_end - args.pixel_begin));
+}
+
+/**
+ * @brief Bytes of gemm_buffer: the patches of a tile unless the input is read directly, and the gemm outputs of a
+ * tile when the feature is narrower than the gemm element.
+ */
+template <typename feature_t, typename filter_t>
+inline size_t mixed_conv2d_gemm_buffer_size(const mixedConvArgsType<feature_t, filter_t> &args)
+{
+    typedef mixed_gemm_t<feature_t, filter_t> gemm_t;
+    int k = args.filter_height * args.filter_width * args.input_channel;
+    int tile = mixed_conv2d_gemm_tile(args);
+    size_t size = mixed_conv2d_gemm_direct(args) ? 0 : (size_t)tile * k * sizeof(gemm_t);
+    if (sizeof(feature_t) < sizeof(gemm_t)) {
+        size += (size_t)tile * args.output_channel * sizeof(gemm_t);
+    }
+    return size;
+}
+
+template <typename feature_t, typename filter_t>
+bool mixed_conv2d_set_gemm(std::vector<mixedConvArgsType<feature_t, filter_t>> &m_args, mixedConvGemmBuffer &gemm)
+{
+    typedef mixed_gemm_t<feature_t, filter_t> gemm_t;
+    typedef typename std::conditional<sizeof(gemm_t) == 1, int32_t, int64_t>::type bias_t;
+    const mixedConvArgsType<feature_t, filter_t> &args = m_args[0];
+    int u = 16 / sizeof(gemm_t);
+    int k = args.filter_height * args.filter_width * args.input_channel;
+    int n = args.output_channel;
+    if (args.depthwise || k % u || n % u) {
+        return false;
+    }
+
+    if (!gemm.filter) {
+#if CONFIG_ESP32P4_BOOST
+        if (std::is_same<filter_t, gemm_t>::value) {
+            // The whole panels of the boosted layout are the gemm panels.
+            gemm.filter = (void *)args.filter_element;
+        }
+#endif
+        if (!gemm.filter) {
+            gemm_t *packed_ptr = (gemm_t *)tool::malloc_aligned(
+                gemm_packed_filter_size<gemm_t>(k, n), sizeof(gemm_t), 16, MALLOC_CAP_DEFAULT);
+            if (!packed_ptr) {
+                return false;
+            }
+#if CONFIG_ESP32P4_BOOST
+            int filter_u = 16 / sizeof(filter_t);
+#else
+            int filter_u = 1;
+#endif
+            int panels = n / filter_u * filter_u;
+            for (int j = 0; j < n; j++) {
+                // As mixed_conv2d_c() reads channel j, in a panel of filter_u channels or in the tail.
+                const filter_t *src = j < panels ? args.filter_element + (j / filter_u) * k * filter_u + j % filter_u
+                                                 : args.filter_element + j * k;
+                int src_step = j < panels ? filter_u : 1;
+                gemm_t *dst = packed_ptr + (j / u) * k * u + j % u;
+                for (int i = 0; i < k; i++) {
+                    dst[i * u] = src[i * src_step];
+                }
+            }
+            gemm.filter = packed_ptr;
+            gemm.filter_owned = true;
+        }
+    }
+
+    if (args.bias_element && !gemm.bias) {
+        if (sizeof(bias_t) == sizeof(int32_t)) {
+            gemm.bias = (void *)args.bias_element;
+        } else {
+            bias_t *bias_ptr = (bias_t *)tool::malloc_aligned(n, sizeof(bias_t), 16, MALLOC_CAP_DEFAULT);
+            if (!bias_ptr) {
+                return false;
+            }
+            for (int j = 0; j < n; j++) {
+                bias_ptr[j] = args.bias_element[j];
+            }
+            gemm.bias = bias_ptr;
+            gemm.bias_owned = true;
+        }
+    }
+
+    size_t task_size = 0;
+    for (int i = 0; i < m_args.size(); i++) {
+        task_size = DL_MAX(task_size, mixed_conv2d_gemm_buffer_size(m_args[i]));
+    }
+    if (task_size * m_args.size() > gemm.buffer_size) {
+        if (gemm.buffer) {
+            heap_caps_free(gemm.buffer);
+        }
+        gemm.buffer = tool::malloc_aligned(task_size * m_args.size(), 1, 16, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        gemm.buffer_size = gemm.buffer ? task_size * m_args.size() : 0;
+        if (!gemm.buffer) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < m_args.size(); i++) {
+        m_args[i].gemm_filter = gemm.filter;
+        m_args[i].gemm_bias = args.bias_element ? gemm.bias : nullptr;
+        m_args[i].gemm_buffer = (char *)gemm.buffer + i * task_size;
+    }
+    return true;
+}
+
+template bool mixed_conv2d_set_gemm<int8_t, int8_t>(std::vector<mixedConvArgsType<int8_t, int8_t>> &,
+                                                    mixedConvGemmBuffer &);
+template bool mixed_conv2d_set_gemm<int8_t, int16_t>(std::vector<mixedConvArgsType<int8_t, int16_t>> &,
+                                                     mixedConvGemmBuffer &);
+template bool mixed_conv2d_set_gemm<int16_t, int8_t>(std::vector<mixedConvArgsType<int16_t, int8_t>> &,
+                                                     mixedConvGemmBuffer &);
+template bool mixed_conv2d_set_gemm<int16_t, int16_t>(std::vector<mixedConvArgsType<int16_t, int16_t>> &,
+                                                      mixedConvGemmBuffer &);
+
+template <typename feature_t, typename filter_t>
+void mixed_conv2d_gemm(const mixedConvArgsType<feature_t, filter_t> &args)
+{
+    typedef mixed_gemm_t<feature_t, filter_t> gemm_t;
+    int c = args.input_channel;
+    int k = args.filter_height * args.filter_width * c;
+    int n = args.output_channel;
+    int tile = mixed_conv2d_gemm_tile(args);
+    bool direct = mixed_conv2d_gemm_direct(args);
+    gemm_t *patches = (gemm_t *)args.gemm_buffer;
+    gemm_t *outputs = direct ? patches : patches + tile * k;
+
+    gemmArgsType<gemm_t> gemm_args;
+    gemm_args.filter_element = (const gemm_t *)args.gemm_filter;
+    gemm_args.bias_element = args.gemm_bias;
+    gemm_args.n = n;
+    gemm_args.k = k;
+    gemm_args.mac_shift = 0;
+    gemm_args.activation_type = args.activation_type;
+    gemm_args.channel_shift = args.mac_shift;
+    for (int begin = args.pixel_begin; begin < args.pixel_end; begin += tile) {
+        int rows = DL_MIN(tile, args.pixel_end - begin);
+        if (direct) {
+            gemm_args.input_element = (const gemm_t *)args.input_element + begin * c;
+        } else {
+            for (int i = 0; i < rows; i++) {
+                int y = (begin + i) / args.output_width * args.stride_y - args.padding_top;
+                int x = (begin + i) % args.output_width * args.stride_x - args.padding_left;
+                gemm_t *patch_ptr = patches + i * k;
+                for (int fy = 0; fy < args.filter_height; fy++) {
+                    int iy = y + fy * args.dilation_y;
+                    for (int fx = 0; fx < args.filter_width; fx++, patch_ptr += c) {
+                        int ix = x + fx * args.dilation_x;
+                        if (iy < 0 || iy >= args.input_height || ix < 0 || ix >= args.input_width) {
+                            memset(patch_ptr, 0, c * sizeof(gemm_t));
+                            continue;
+                        }
+                        const feature_t *input_ptr = args.input_element + (iy * args.input_width + ix) * c;
+                        if constexpr (std::is_same<feature_t, gemm_t>::value) {
+                            tool::copy_memory(patch_ptr, (void *)input_ptr, c * sizeof(gemm_t));
+                        } else {
+                            for (int j = 0; j < c; j++) {
+                                patch_ptr[j] = input_ptr[j];
+                            }
+                        }
+                    }
+                }
+            }
+            gemm_args.input_element = patches;
+        }
+        gemm_args.m = rows;
+        if constexpr (std::is_same<feature_t, gemm_t>::value) {
+            gemm_args.output_element = args.output_element + begin * n;
+            gemm<gemm_t>(&gemm_args);
+        } else {
+            // Saturating the int16_t result again to int8_t is the same as saturating the accumulator to int8_t.
+            gemm_args.output_element = outputs;
+            gemm<gemm_t>(&gemm_args);
+            feature_t *output_ptr = args.output_element + begin * n;
+            for (int i = 0; i < rows * n; i++) {
+                tool::truncate(output_ptr[i], outputs[i]);
+            }
+        }
+    }
+}
+
+template <typename feature_t, typename filter_t>
+void mixed_conv2d(void *args_ptr)
+{
+    const mixedConvArgsType<feature_t, filter_t> &args = *(mixedConvArgsType<feature_t, filter_t> *)args_ptr;
+    if (args.gemm_filter) {
+        mixed_conv2d_gemm(args);
+    } else {
+        mixed_conv2d_c<feature_t, filter_t>(args_ptr);
+    }
+}
+
+template void mixed_conv2d<int8_t, int8_t>(void *args_ptr);
+template void mixed_conv2d<int8_t, int16_t>(void *args_ptr);
+template void mixed_conv2d<int16_t, int8_t>(void *args_ptr);
+template void mixed_conv2d<int16_t, int16_t>(void *args_ptr);
+} // namespace base
+} // namespace dl
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "dl_base.hpp"
+#include <type_traits>
+
+namespace dl {
+namespace base {
+/**
+ * @brief Arguments of mixed_conv2d(), a conv2d or depthwise conv2d whose filter is quantized per output channel and
+ * whose element may be wider or narrower than the feature: int8 feature with int16 filter keeps the sensitive weights
+ * precise at the cost of an int8 feature map, int16 feature with int8 filter does the reverse.
+ *
+ * The filter is in [N, H, W, C] order like the C reference of conv2d, [H, W, C] for depthwise. With
+ * CONFIG_ESP32P4_BOOST it is in the layout of the boosted kernels instead: [N / u, H, W, C, u] for the whole panels of
+ * u = 16 / sizeof(filter_t) output channels, then [N % u, H, W, C], see conv2d_pad_filter(). The bias is in the
+ * accumulator scale of each channel, i.e. input.exponent + the filter exponent of the channel.
+ *
+ * gemm_filter, gemm_bias and gemm_buffer are set by mixed_conv2d_set_gemm(), mixed_conv2d() then runs as im2col and
+ * gemm with the shift of each channel in the epilogue.
+ */
+template <typename feature_t, typename filter_t>
+struct mixedConvArgsType {
+    feature_t *output_element;         /*<! 0 [output_height, output_width, output_channel] */
+    const feature_t *input_element;    /*<! 1 [input_height, input_width, input_channel] */
+    const filter_t *filter_element;    /*<! 2 */
+    const int32_t *bias_element;       /*<! 3 or NULL */
+    const int8_t *mac_shift;           /*<! 4 output.exponent - filter.exponent[n] - input.exponent of each channel */
+    int input_height;                  /*<! 5 */
+    int input_width;                   /*<! 6 */
+    int input_channel;                 /*<! 7 */
+    int output_width;                  /*<! 8 */
+    int output_channel;                /*<! 9 */
+    int pixel_begin;                   /*<! 10 first output pixel of this task, y * output_width + x */
+    int pixel_end;                     /*<! 11 */
+    int filter_height;                 /*<! 12 */
+    int filter_width;                  /*<! 13 */
+    int stride_y;                      /*<! 14 */
+    int stride_x;                      /*<! 15 */
+    int dilation_y;                    /*<! 16 */
+    int dilation_x;                    /*<! 17 */
+    int padding_top;                   /*<! 18 */
+    int padding_left;                  /*<! 19 */
+    bool depthwise;                    /*<! 20 */
+    activation_type_t activation_type; /*<! 21 Linear or ReLU */
+    const void *gemm_filter;           /*<! 22 the filter in gemm panels of mixed_gemm_t, or NULL */
+    const void *gemm_bias;             /*<! 23 the bias in the accumulator type of the gemm, or NULL */
+    void *gemm_buffer;                 /*<! 24 patches and outputs of a tile of this task */
+};
+
+/**
+ * @brief Element of the gemm that runs a mixed conv2d: int8_t when the feature and the filter are both int8_t, else
+ * int16_t and the narrower one is widened, which is exact.
+ */
+template <typename feature_t, typename filter_t>
+using mixed_gemm_t = typename std::conditional<sizeof(feature_t) == 1 && sizeof(filter_t) == 1, int8_t, int16_t>::type;
+
+/**
+ * @brief The operands of the gemm path of mixed_conv2d(), kept by the module and built by mixed_conv2d_set_gemm() on
+ * the first forward. The buffer only grows.
+ */
+struct mixedConvGemmBuffer {
+    void *filter;       /*<! the filter in gemm panels, may be the filter of the module itself */
+    bool filter_owned;  /*<! whether filter was allocated here */
+    void *bias;         /*<! the bias in the accumulator type of the gemm, may be the bias of the module itself */
+    bool bias_owned;    /*<! whether bias was allocated here */
+    void *buffer;       /*<! scratch of all the tasks */
+    size_t buffer_size; /*<! bytes of buffer */
+
+    mixedConvGemmBuffer() :
+        filter(nullptr), filter_owned(false), bias(nullptr), bias_owned(false), buffer(nullptr), buffer_size(0)
+    {
+    }
+
+    ~mixedConvGemmBuffer()
+    {
+        if (filter_owned) {
+            heap_caps_free(filter);
+        }
+        if (bias_owned) {
+            heap_caps_free(bias);
+        }
+        if (buffer) {
+            heap_caps_free(buffer);
+        }
+    }
+
+    mixedConvGemmBuffer(const mixedConvGemmBuffer &) = delete;
+    mixedConvGemmBuffer &operator=(const mixedConvGemmBuffer &) = delete;
+};
+
+/**
+ * @brief Split the output pixels into two tasks when the conv2d is large enough or RUNTIME_MODE_MULTI_CORE is set.
+ *
+ * @param output_shape [1, H, W, N]
+ * @param input_shape  [1, H, W, C]
+ * @param filter_shape [H, W, C, N], [H, W, 1, C] for depthwise
+ * @param padding      [top, bottom, left, right]
+ */
+template <typename feature_t, typename filter_t>
+std::vector<mixedConvArgsType<feature_t, filter_t>> get_mixed_conv_operation_args(
+    feature_t *output_ptr,
+    const feature_t *input_ptr,
+    const filter_t *filter_ptr,
+    const int32_t *bias_ptr,
+    const int8_t *mac_shift,
+    const std::vector<int> &output_shape,
+    const std::vector<int> &input_shape,
+    const std::vector<int> &filter_shape,
+    const std::vector<int> &padding,
+    const int stride_y,
+    const int stride_x,
+    const int dilation_y,
+    const int dilation_x,
+    const bool depthwise,
+    activation_type_t activation_type,
+    const runtime_mode_t runtime_mode = RUNTIME_MODE_AUTO)
+{
+    mixedConvArgsType<feature_t, filter_t> args;
+    args.output_element = output_ptr;
+    args.input_element = input_ptr;
+    args.filter_element = filter_ptr;
+    args.bias_element = bias_ptr;
+    args.mac_shift = mac_shift;
+    args.input_height = input_shape[1];
+    args.input_width = input_shape[2];
+    args.input_channel = input_shape[3];
+    args.output_width = output_shape[2];
+    args.output_channel = output_shape[3];
+    args.pixel_begin = 0;
+    args.pixel_end = output_shape[1] * output_shape[2];
+    args.filter_height = filter_shape[0];
+    args.filter_width = filter_shape[1];
+    args.stride_y = stride_y;
+    args.stride_x = stride_x;
+    args.dilation_y = dilation_y;
+    args.dilation_x = dilation_x;
+    args.padding_top = padding[0];
+    args.padding_left = padding[2];
+    args.depthwise = depthwise;
+    args.activation_type = activation_type;
+    args.gemm_filter = nullptr;
+    args.gemm_bias = nullptr;
+    args.gemm_buffer = nullptr;
+
+    std::vector<mixedConvArgsType<feature_t, filter_t>> m_args(1, args);
+    int64_t macs = (int64_t)args.pixel_end * args.output_channel * args.filter_height * args.filter_width *
+        (depthwise ? 1 : args.input_channel);
+    if (args.pixel_end >= 2 &&
+        (runtime_mode == RUNTIME_MODE_MULTI_CORE || (runtime_mode == RUNTIME_MODE_AUTO && macs >= (1 << 18)))) {
+        m_args.push_back(args);
+        m_args[0].pixel_end = args.pixel_end / 2;
+        m_args[1].pixel_begin = m_args[0].pixel_end;
+    }
+    return m_args;
+}
+
+/**
+ * @brief Let the tasks of a mixed conv2d run as im2col and gemm, which uses the SIMD kernels on esp32p4. It needs a
+ * conv2d, not a depthwise one, with H * W * C and N multiples of u = 16 / sizeof(mixed_gemm_t).
+ *
+ * @param m_args the tasks from get_mixed_conv_operation_args()
+ * @param gemm   the operands kept by the module
+ *
+ * @return false if the conv2d is not supported or out of memory, the tasks then run the portable kernel
+ */
+template <typename feature_t, typename filter_t>
+bool mixed_conv2d_set_gemm(std::vector<mixedConvArgsType<feature_t, filter_t>> &m_args, mixedConvGemmBuffer &gemm);
+
+/**
+ * @brief The portable mixed precision conv2d, the reference of the gemm path. Products are accumulated in int64_t,
+ * the shift of each channel rounds half to even and the result saturates, as the boosted per-tensor kernels do.
+ *
+ * @param args_ptr mixedConvArgsType<feature_t, filter_t>
+ */
+template <typename feature_t, typename filter_t>
+void mixed_conv2d_c(void *args_ptr);
+
+/**
+ * @brief The mixed precision conv2d, as im2col and gemm once mixed_conv2d_set_gemm() has set the tasks up, else
+ * mixed_conv2d_c(). Both give the same result.
+ *
+ * @param args_ptr mixedConvArgsType<feature_t, filter_t>
+ */
+template <typename feature_t, typename filter_t>
+void mixed_conv2d(void *args_ptr);
+} // namespace base
+} // namespace dl
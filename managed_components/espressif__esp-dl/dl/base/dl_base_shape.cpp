@@ -65,6 +65,11 @@ std::vector<int> get_unidirectional_broadcasting_shape(const std::vector<int> &s
     return std::vector<int>(shape1);
 }
 
+int get_slice_index(int index, int dim)
+{
+    return index < 0 ? index + dim : index % (dim + 1);
+}
+
 std::vector<int> get_slice_shape(const std::vector<int> &shape,
                                  std::vector<int> start,
                                  std::vector<int> end,
@@ -79,8 +84,8 @@ std::vector<int> get_slice_shape(const std::vector<int> &shape,
         if (!axes.empty()) {
             axis = (axes[i] + dim) % dim;
         }
-        int start_i = start[i] < 0 ? start[i] + shape[axis] : start[i] % (shape[axis] + 1);
-        int end_i = end[i] < 0 ? end[i] + shape[axis] : end[i] % (shape[axis] + 1);
+        int start_i = get_slice_index(start[i], shape[axis]);
+        int end_i = get_slice_index(end[i], shape[axis]);
         if (start_i >= end_i) {
             assert(false);
             return {};
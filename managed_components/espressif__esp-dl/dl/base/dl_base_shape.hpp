@@ -27,6 +27,16 @@ std::vector<int> get_multidirectional_broadcasting_shape(const std::vector<int>
  */
 std::vector<int> get_unidirectional_broadcasting_shape(const std::vector<int> &shape1, const std::vector<int> &shape2);
 
+/**
+ * @brief Get the index of a slice start or end on an axis, a negative index counts from the back.
+ *
+ * @param index Starting or ending index of the slice
+ * @param dim   Size of the axis
+ *
+ * @return Index in the axis
+ */
+int get_slice_index(int index, int dim);
+
 /**
  * @brief Get shape after slice
  *        refer to https://onnx.ai/onnx/operators/onnx__Slice.html
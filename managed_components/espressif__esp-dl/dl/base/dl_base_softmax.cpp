@@ -0,0 +1,89 @@
+#include "dl_base_softmax.hpp"
+
+#include "dl_base_isa.hpp"
+#include "dl_define.hpp"
+#include <math.h>
+
+namespace dl {
+namespace base {
+template <>
+void softmax_exp_table<int8_t>(float *table, const int exponent)
+{
+    float scale = DL_SCALE(exponent);
+    for (int d = 0; d < 256; d++) {
+        table[d] = expf(-d * scale);
+    }
+}
+
+template <>
+void softmax_exp_table<int16_t>(float *table, const int exponent)
+{
+    float scale = DL_SCALE(exponent);
+    for (int d = 0; d < 256; d++) {
+        table[d] = expf(-d * scale);
+        table[256 + d] = expf(-(d << 8) * scale);
+    }
+}
+
+template <typename feature_t>
+feature_t reduce_max(const feature_t *input_ptr, const int len, const int stride)
+{
+    feature_t max = input_ptr[0];
+    int i = 1;
+#if CONFIG_ESP32P4_BOOST
+    const int lanes = 16 / sizeof(feature_t);
+    if (stride == 1 && len >= lanes && !((uintptr_t)input_ptr & 15)) {
+        alignas(16) feature_t lane_max[16 / sizeof(feature_t)];
+        if constexpr (sizeof(feature_t) == 1) {
+            dl_esp32p4_s8_reduce_max(lane_max, input_ptr, len / lanes);
+        } else {
+            dl_esp32p4_s16_reduce_max(lane_max, input_ptr, len / lanes);
+        }
+        for (int j = 0; j < lanes; j++) {
+            max = DL_MAX(max, lane_max[j]);
+        }
+        i = len / lanes * lanes;
+    }
+#endif
+    for (; i < len; i++) {
+        max = DL_MAX(max, input_ptr[i * stride]);
+    }
+    return max;
+}
+
+static void normalize(float *output_ptr, const int len, const int stride, const float sum)
+{
+    float reciprocal = 1.f / sum;
+    for (int i = 0; i < len; i++) {
+        output_ptr[i * stride] *= reciprocal;
+    }
+}
+
+void softmax(float *output_ptr, const int8_t *input_ptr, const int len, const int stride, const float *table)
+{
+    int max = reduce_max(input_ptr, len, stride);
+    const float *table_ptr = table + max;
+    float sum = 0.f;
+    for (int i = 0; i < len; i++) {
+        float e = table_ptr[-input_ptr[i * stride]];
+        output_ptr[i * stride] = e;
+        sum += e;
+    }
+    normalize(output_ptr, len, stride, sum);
+}
+
+void softmax(float *output_ptr, const int16_t *input_ptr, const int len, const int stride, const float *table)
+{
+    int max = reduce_max(input_ptr, len, stride);
+    const float *table_hi = table + 256;
+    float sum = 0.f;
+    for (int i = 0; i < len; i++) {
+        int d = max - input_ptr[i * stride];
+        float e = table[d & 255] * table_hi[d >> 8];
+        output_ptr[i * stride] = e;
+        sum += e;
+    }
+    normalize(output_ptr, len, stride, sum);
+}
+} // namespace base
+} // namespace dl
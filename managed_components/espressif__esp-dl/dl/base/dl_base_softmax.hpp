@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace dl {
+namespace base {
+/**
+ * @brief Table of exp(-d * 2^exponent), d = max - input is the distance of an element to the maximum of its vector.
+ *        - int8_t: 256 entries, exp = table[d]
+ *        - int16_t: 512 entries, exp = table[d & 255] * table[256 + (d >> 8)]
+ *
+ * @tparam feature_t int8_t or int16_t
+ * @param table    softmax_exp_table_size<feature_t>() entries
+ * @param exponent exponent of the input
+ */
+template <typename feature_t>
+void softmax_exp_table(float *table, const int exponent);
+
+template <typename feature_t>
+constexpr int softmax_exp_table_size()
+{
+    return sizeof(feature_t) == 1 ? 256 : 512;
+}
+
+/**
+ * @brief Float softmax of len quantized elements placed stride elements apart. The dequantization is fused into the
+ * exp, so the input is read twice, once for the maximum and once for the exp, and the output is written twice.
+ *
+ * @param output_ptr output, same layout as the input
+ * @param input_ptr  input
+ * @param len        element number
+ * @param stride     distance between two elements, 1 is the fast path
+ * @param table      table built by softmax_exp_table() with the exponent of the input
+ */
+void softmax(float *output_ptr, const int8_t *input_ptr, const int len, const int stride, const float *table);
+void softmax(float *output_ptr, const int16_t *input_ptr, const int len, const int stride, const float *table);
+} // namespace base
+} // namespace dl
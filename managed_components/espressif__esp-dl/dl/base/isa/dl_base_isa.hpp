@@ -448,6 +448,55 @@ void dl_esp32p4_s8_unaligned_resize2d_nearest_2x2_c1(int8_t *output_ptr, int8_t
 void dl_esp32p4_s8_prelu_11c(int8_t *output_ptr, int8_t *input_ptr, void *args_ptr);
 void dl_esp32p4_s8_unaligned_prelu_11c(int8_t *output_ptr, int8_t *input_ptr, void *args_ptr);
 
+int64_t dl_esp32p4_s8_dotprod(const int8_t *input0_ptr, const int8_t *input1_ptr, int length_div_16);
+int64_t dl_esp32p4_s16_dotprod(const int16_t *input0_ptr, const int16_t *input1_ptr, int length_div_8);
+void dl_esp32p4_s8_reduce_max(int8_t *output_ptr, const int8_t *input_ptr, int length_div_16);
+void dl_esp32p4_s16_reduce_max(int16_t *output_ptr, const int16_t *input_ptr, int length_div_8);
+void dl_esp32p4_s8_gemm_n16(int8_t *output_ptr,
+                            const int8_t *input_ptr,
+                            const int8_t *filter_ptr,
+                            const int32_t *bias_ptr,
+                            int rows,
+                            int k_div_16_1,
+                            int n,
+                            int mac_shift);
+void dl_esp32p4_s8_gemm_n16_relu(int8_t *output_ptr,
+                                 const int8_t *input_ptr,
+                                 const int8_t *filter_ptr,
+                                 const int32_t *bias_ptr,
+                                 int rows,
+                                 int k_div_16_1,
+                                 int n,
+                                 int mac_shift);
+void dl_esp32p4_s16_gemm_n8(int16_t *output_ptr,
+                            const int16_t *input_ptr,
+                            const int16_t *filter_ptr,
+                            const int64_t *bias_ptr,
+                            int rows,
+                            int k_div_8_1,
+                            int n,
+                            int mac_shift);
+void dl_esp32p4_s16_gemm_n8_relu(int16_t *output_ptr,
+                                 const int16_t *input_ptr,
+                                 const int16_t *filter_ptr,
+                                 const int64_t *bias_ptr,
+                                 int rows,
+                                 int k_div_8_1,
+                                 int n,
+                                 int mac_shift);
+void dl_esp32p4_s8_gemm_n16_acc(int32_t *acc_ptr,
+                                const int8_t *input_ptr,
+                                const int8_t *filter_ptr,
+                                const int32_t *bias_ptr,
+                                int rows,
+                                int k_div_16_1);
+void dl_esp32p4_s16_gemm_n8_acc(int64_t *acc_ptr,
+                                const int16_t *input_ptr,
+                                const int16_t *filter_ptr,
+                                const int64_t *bias_ptr,
+                                int rows,
+                                int k_div_8_1);
+
 void dl_esp32p4_s8_add4d_bchw_w1_16_w2_16_simdadd(int8_t *output_ptr,
                                                   int8_t *input0_ptr,
                                                   int8_t *input1_ptr,
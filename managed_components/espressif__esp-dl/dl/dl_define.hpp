@@ -43,6 +43,10 @@
     }
 #endif
 
+#ifndef CONFIG_DL_STAGE_WORKER_STACK_SIZE
+#define CONFIG_DL_STAGE_WORKER_STACK_SIZE 8192
+#endif
+
 #ifndef DL_EQUAL
 #define DL_EQUAL(x, y) (((x) == (y)) ? (1) : (0))
 #endif
@@ -23,6 +23,14 @@ public:
     std::map<std::string, int> name2index; // Tensor name to index map
     size_t internal_size;                  // The bytes of internal ram
     size_t psram_size;                     // The bytes of psram
+    size_t view_saved_bytes;               // The bytes of memory traffic per run removed by tensor views
+    std::vector<std::string> sorted_nodes; // The node of each module, FbsModel::topological_sort() if empty
+    std::map<std::string, std::vector<int>> input_shapes; // The shapes of graph inputs replacing the ones of model
+    std::vector<int> stages; // The stage of each module, the modules of a stage may run at the same time. Every
+                             // module is a stage if empty
+    bool tensor_views;       // Whether tensors may be placed in the buffer of others, only right for the planned shapes
+    std::vector<int> planned_sizes; // The elements each tensor is planned for, its shape may shrink within them
+    void *shared_internal_root;     // Internal ram used instead of allocating one, it isn't freed by this manager
 
     /**
      * @brief Construct a new MemoryManager object.
@@ -33,7 +41,10 @@ public:
         tensors({}),
         alignment(alignment),
         internal_size(internal_size),
-        psram_size(0)
+        psram_size(0),
+        view_saved_bytes(0),
+        tensor_views(true),
+        shared_internal_root(nullptr)
     {
     }
 
@@ -156,6 +167,7 @@ private:
     uint32_t internal_offset; // Internal ram offset, used to allocate tensor on both PSRAM and internal ram
     bool is_internal;
     TensorInfo *m_leader_tensor;
+    uint32_t m_view_offset; // Offset, in bytes, in the buffer of leader tensor
     TensorInfo
         *m_follower_dirty_tensor; // Only reference the follower tensor which will modify the data of leader tensor.
 
@@ -174,6 +186,14 @@ public:
 
     void set_inplace_follower_tensor(TensorInfo *tensor) { m_follower_dirty_tensor = tensor; }
 
+    /**
+     * @brief Place this tensor at offset bytes in the buffer of the leader tensor, so that the module producing this
+     * tensor writes its part of the leader in place. The leader is allocated from the time this tensor begins.
+     */
+    void set_view_leader_tensor(TensorInfo *tensor, uint32_t offset);
+
+    TensorInfo *get_inplace_leader_tensor() { return m_leader_tensor; }
+
     TensorInfo *get_inplace_follower_tensor() { return m_follower_dirty_tensor; }
 
     void update_time(int new_time);
@@ -185,7 +205,7 @@ public:
     uint32_t get_offset()
     {
         if (m_leader_tensor) {
-            return m_leader_tensor->get_offset();
+            return m_leader_tensor->get_offset() + m_view_offset;
         }
         return this->offset;
     }
@@ -201,7 +221,7 @@ public:
     uint32_t get_internal_offset()
     {
         if (m_leader_tensor) {
-            return m_leader_tensor->get_internal_offset();
+            return m_leader_tensor->get_internal_offset() + m_view_offset;
         }
         return this->internal_offset;
     }
@@ -254,6 +274,8 @@ public:
 
     std::vector<int> get_shape() { return this->shape; }
 
+    dtype_t get_dtype() { return this->dtype; }
+
     void print()
     {
         printf("name:%s, from %d to %d, size:%d, offset:(%ld, %ld)\n",
@@ -20,6 +20,18 @@ private:
                                   std::vector<dl::module::Module *> execution_plan,
                                   std::vector<TensorInfo *> &tensor_info);
 
+    void set_input_views(dl::module::Module *module,
+                         std::vector<TensorInfo *> &tensor_info,
+                         std::vector<std::string> &graph_inputs,
+                         std::vector<std::string> &graph_outputs,
+                         std::map<std::string, int> &consumer_nums);
+
+    void set_output_views(dl::module::Module *module,
+                          std::vector<TensorInfo *> &tensor_info,
+                          std::vector<std::string> &graph_inputs,
+                          std::vector<std::string> &graph_outputs,
+                          std::map<std::string, int> &consumer_nums);
+
     int simulate(std::vector<TensorInfo *> &tensor_info, int node_num);
 
     int simulate_with_internal_memory(std::vector<TensorInfo *> &tensor_info, int node_num);
@@ -7,7 +7,9 @@
 #include "esp_log.h"
 #include "fbs_loader.hpp"
 #include "fbs_model.hpp"
+#include <list>
 namespace dl {
+struct stage_worker_t;
 
 // currently only support MEMORY_MANAGER_GREEDY
 typedef enum { MEMORY_MANAGER_GREEDY = 0, LINEAR_MEMORY_MANAGER = 1 } memory_manager_t;
@@ -22,11 +24,93 @@ private:
     std::vector<dl::module::Module *>
         execution_plan; /*<! This represents a valid topological sort (dependency ordered) execution plan. >*/
     dl::memory::MemoryManagerBase *memory_manager = nullptr; /*<! The pointer of memory manager >*/
+    std::list<std::pair<std::string, dl::memory::MemoryManagerBase *>>
+        memory_plans;                                 /*<! The memory manager of each input shapes, current first >*/
+    int max_memory_plans = 4;                         /*<! The most memory plans kept >*/
+    int memory_plan_bucket = 32;                      /*<! The input dims but batch and channel are rounded up to it >*/
+    size_t internal_size = 0;                         /*<! Internal ram size of the memory plans, in bytes >*/
+    void *internal_root = nullptr;                    /*<! Internal ram shared by the memory plans >*/
+    memory_manager_t mm_type = MEMORY_MANAGER_GREEDY; /*<! Type of memory manager >*/
     std::map<std::string, TensorBase *> inputs;              /*  The map of model input's name and TensorBase* */
     std::map<std::string, TensorBase *> outputs;             /*  The map of model output's name and TensorBase* */
     std::string name;                                        /*  The name of model */
     int64_t version;                                         /*  The version of model */
     std::string doc_string;                                  /*  doc string of model*/
+    std::vector<std::string> plan_nodes; /*  The node of each module in execution_plan */
+    std::vector<int> stages; /*  The stage of each module, the modules of a stage are independent. Empty if every
+                                 module is a stage */
+    stage_worker_t *stage_worker = nullptr; /*  The task running the stages on the other core, created by the first
+                                                run of a model with stages */
+    size_t fused_traffic = 0; /*  The bytes of memory traffic per run removed by fusing modules */
+    size_t saved_traffic = 0; /*  fused_traffic and the bytes removed by tensor views of memory manager */
+    int packed_layers = 0;    /*  The modules moved from the unaligned kernels to the aligned ones by pack_modules() */
+    bool autotune = false;    /*  Whether the algorithm of each module is tuned for the shapes of the memory plan */
+    std::map<std::string, int> tuned_algorithms; /*  The algorithm chosen for each module type and shapes */
+
+    /**
+     * @brief Fold modules into the module producing their input: Relu into the activation of Conv, Gemm and MatMul,
+     * RequantizeLinear into Conv, Gemm, MatMul, Add, Sub and Mul when it keeps the exponent, so that the output is
+     * bit-exact. A folded module is replaced by an Identity sharing the buffer of its input, so the execution plan
+     * keeps its order.
+     *
+     * @param sorted_nodes  The topological sorted nodes of the execution plan
+     */
+    void fuse_modules(std::vector<std::string> &sorted_nodes);
+
+    /**
+     * @brief Zero-pad the channels of the tensors between Conv and Gemm modules to the alignment of the aligned
+     * kernels, so that the modules don't fall back to the unaligned ones. A tensor is padded when it is produced by
+     * such a module and only read by such modules, directly or through elementwise ones. Graph inputs and outputs keep
+     * their shapes.
+     *
+     * @param sorted_nodes  The topological sorted nodes of the execution plan
+     */
+    void pack_modules(std::vector<std::string> &sorted_nodes);
+
+    /**
+     * @brief Choose the fastest algorithm of each module having more than one for its shapes, by timing them on the
+     * tensors of the memory plan. The choice of each module type and shapes is kept in the "dl_autotune" NVS
+     * namespace when NVS is initialized, so that it is timed once per device and firmware.
+     */
+    void autotune_modules();
+
+    /**
+     * @brief Group the modules into stages: a module is one stage after the latest module producing its inputs, so
+     * the modules of a stage don't depend on each other. The execution plan is reordered by stage.
+     */
+    void schedule_stages();
+
+    /**
+     * @brief Run the execution plan. The modules of a stage are shared between both cores unless mode is
+     * RUNTIME_MODE_SINGLE_CORE.
+     *
+     * @param mode  Runtime mode.
+     */
+    void forward_modules(runtime_mode_t mode);
+
+    /**
+     * @brief Plan the memory of the execution plan for the input shapes.
+     *
+     * @param input_shapes  The shapes of graph inputs, the shapes of model for the others
+     * @param tensor_views  Whether tensors may be placed in the buffer of others, only for plans taking their exact
+     *                      shapes
+     */
+    dl::memory::MemoryManagerBase *create_memory_plan(std::map<std::string, std::vector<int>> &input_shapes,
+                                                      bool tensor_views = true);
+
+    /**
+     * @brief Get the key of a memory plan, the shapes of all graph inputs.
+     */
+    std::string get_input_shapes_key(std::map<std::string, std::vector<int>> &input_shapes);
+
+    /**
+     * @brief Propagate the shapes of graph inputs through the modules to the tensors of the current memory plan.
+     *
+     * @param input_shapes  The shapes of graph inputs, the current shapes for the others
+     *
+     * @return ESP_OK if every tensor fits in the memory planned for it, ESP_FAIL otherwise
+     */
+    esp_err_t update_shapes(std::map<std::string, std::vector<int>> &input_shapes);
 
 public:
     Model() {}
@@ -198,8 +282,18 @@ public:
      * @param internal_size  Internal ram size, in bytes
      * @param mm_type        Type of memory manager
      * @param preload        Whether to preload the model's parameters to internal ram (not implemented yet)
+     * @param parallel       Whether to run independent modules on both cores. run() does so unless the mode is
+     *                       RUNTIME_MODE_SINGLE_CORE. The tensors of modules running at the same time can't share
+     *                       memory, so this can take more memory.
+     * @param autotune       Whether to time the algorithms of the modules having more than one, e.g. direct and
+     *                       im2col 3x3 Conv, and use the fastest. The choice is cached in NVS if nvs_flash_init() was
+     *                       called, otherwise the first build of each boot times them.
      */
-    virtual void build(size_t internal_size, memory_manager_t mm_type = MEMORY_MANAGER_GREEDY, bool preload = false);
+    virtual void build(size_t internal_size,
+                       memory_manager_t mm_type = MEMORY_MANAGER_GREEDY,
+                       bool preload = false,
+                       bool parallel = false,
+                       bool autotune = false);
 
     /**
      * @brief Run the model module by module.
@@ -216,6 +310,34 @@ public:
      */
     virtual void run(TensorBase *input, runtime_mode_t mode = RUNTIME_MODE_SINGLE_CORE);
 
+    /**
+     * @brief Change the shapes of graph inputs without loading the model again. The memory of the modules is planned
+     * for the new shapes rounded up to the bucket of set_memory_plan_bucket(), so that the shapes of a bucket share a
+     * plan. The latest max_memory_plans plans are kept so that switching back costs nothing, and share the internal
+     * ram of build(). run() with inputs of other shapes calls it.
+     *
+     * @note The shapes must be valid for every module, e.g. a Reshape to constant shape only accepts one input size.
+     *       The TensorBase pointers got from get_inputs(), get_outputs() and get_intermediate() change with the plan,
+     *       get them again after calling it or run() with inputs of other shapes.
+     *
+     * @param input_shapes  The new shapes of graph inputs, the other inputs keep their shapes
+     *
+     * @return ESP_OK if the memory of the shapes is planned, ESP_FAIL if a name isn't a graph input or the shapes don't
+     *         fit in the plan of their bucket
+     */
+    virtual esp_err_t set_input_shapes(std::map<std::string, std::vector<int>> &input_shapes);
+
+    /**
+     * @brief Set the most memory plans kept by set_input_shapes(), each plan holds its own psram.
+     */
+    void set_max_memory_plans(int num) { max_memory_plans = num > 1 ? num : 1; }
+
+    /**
+     * @brief Set the bucket of set_input_shapes(), 32 by default. The input dims but batch and channel of a plan are
+     * rounded up to a multiple of it, 1 plans each shape on its own.
+     */
+    void set_memory_plan_bucket(int bucket) { memory_plan_bucket = bucket > 1 ? bucket : 1; }
+
     /**
      * @brief Run the model module by module.
      *
@@ -263,6 +385,16 @@ public:
      * @return fbs::FbsModel *
      */
     virtual fbs::FbsModel *get_fbs_model() { return fbs_model; }
+
+    /**
+     * @brief Get the bytes of memory traffic per run removed by module fusion and tensor views, valid after build.
+     */
+    size_t get_saved_traffic() { return saved_traffic; }
+
+    /**
+     * @brief Get the number of Conv and Gemm modules moved from the unaligned kernels to the aligned ones at load.
+     */
+    int get_packed_layers() { return packed_layers; }
 };
 
 } // namespace dl
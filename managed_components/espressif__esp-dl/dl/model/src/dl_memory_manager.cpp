@@ -15,6 +15,7 @@ void MemoryManagerBase::reset()
     }
     this->root_free();
     this->name2index.clear();
+    this->view_saved_bytes = 0;
 }
 
 TensorBase *MemoryManagerBase::get_tensor(int index)
@@ -80,7 +81,9 @@ void *MemoryManagerBase::psram_root_calloc(size_t psram_size)
 
 void *MemoryManagerBase::internal_root_calloc(size_t internal_size)
 {
-    if (internal_size > 0) {
+    if (this->shared_internal_root) {
+        this->internal_root = this->shared_internal_root;
+    } else if (internal_size > 0) {
         this->internal_root = tool::calloc_aligned(internal_size, 1, alignment, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
         if (this->internal_root)
             this->internal_size = internal_size;
@@ -92,7 +95,9 @@ void MemoryManagerBase::root_free()
 {
     // In IDF, free(p) is equivalent to heap_caps_free(p).
     if (this->internal_root) {
-        ::free(this->internal_root);
+        if (this->internal_root != this->shared_internal_root) {
+            ::free(this->internal_root);
+        }
         this->internal_root = nullptr;
     }
     if (this->psram_root) {
@@ -117,6 +122,7 @@ TensorInfo::TensorInfo(std::string &name,
     exponent(exponent),
     is_internal(is_internal),
     m_leader_tensor(nullptr),
+    m_view_offset(0),
     m_follower_dirty_tensor(nullptr)
 {
     if (shape.size() > 0) {
@@ -146,6 +152,7 @@ TensorInfo::TensorInfo(std::string &name,
 void TensorInfo::set_inplace_leader_tensor(TensorInfo *tensor)
 {
     this->m_leader_tensor = tensor;
+    this->m_view_offset = 0;
     if (tensor) {
         if (tensor->time_end < this->time_end || this->time_end == -1) {
             tensor->update_time(this->time_end);
@@ -153,6 +160,15 @@ void TensorInfo::set_inplace_leader_tensor(TensorInfo *tensor)
     }
 }
 
+void TensorInfo::set_view_leader_tensor(TensorInfo *tensor, uint32_t offset)
+{
+    if (this->time_begin < tensor->time_begin) {
+        tensor->time_begin = this->time_begin;
+    }
+    this->set_inplace_leader_tensor(tensor);
+    this->m_view_offset = offset;
+}
+
 void TensorInfo::update_time(int new_time)
 {
     if (m_leader_tensor) { // if inplace tensor is not null, update end time of inplace tensor
@@ -176,7 +192,7 @@ TensorBase *TensorInfo::create_tensor(void *internal_root, void *psram_root)
     TensorBase *tensor = nullptr;
     uint8_t *element = nullptr;
 
-    if (this->is_internal) {
+    if (this->get_internal_state()) {
         element = (uint8_t *)internal_root + this->get_internal_offset();
     } else {
         element = (uint8_t *)psram_root + this->get_offset();
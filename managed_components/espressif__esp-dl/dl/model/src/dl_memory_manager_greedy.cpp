@@ -41,7 +41,8 @@ std::vector<TensorBase *> MemoryManagerGreedy::alloc(fbs::FbsModel *fbs_model,
     this->get_tensor_info_from_fbs(fbs_model, execution_plan, tensor_info);
 
     // simulate the memory allocation
-    this->simulate_with_internal_memory(tensor_info, execution_plan.size());
+    int step_num = this->stages.empty() ? execution_plan.size() : this->stages.back() + 1;
+    this->simulate_with_internal_memory(tensor_info, step_num);
     void *psram_root = nullptr;
     if (!memory_list.empty()) {
         int psram_size = memory_list.back()->offset + memory_list.back()->size;
@@ -92,10 +93,12 @@ void MemoryManagerGreedy::get_tensor_info_from_fbs(fbs::FbsModel *fbs_model,
 
     for (int i = 0; i < graph_inputs.size(); i++) {
         std::string name = graph_inputs[i];
+        auto shape_iter = this->input_shapes.find(name);
         TensorInfo *info = new TensorInfo(name,
                                           0,
                                           -1,
-                                          fbs_model->get_value_info_shape(name),
+                                          shape_iter == this->input_shapes.end() ? fbs_model->get_value_info_shape(name)
+                                                                                 : shape_iter->second,
                                           fbs_model->get_value_info_dtype(name),
                                           fbs_model->get_value_info_exponent(name));
         tensor_info.push_back(info);
@@ -104,23 +107,56 @@ void MemoryManagerGreedy::get_tensor_info_from_fbs(fbs::FbsModel *fbs_model,
 
     // 2. add tensor outputs and update time line of tensors
     std::vector<std::string> graph_outputs = fbs_model->get_graph_outputs();
-    std::vector<std::string> sorted_nodes = fbs_model->topological_sort();
+    std::vector<std::string> sorted_nodes =
+        this->sorted_nodes.empty() ? fbs_model->topological_sort() : this->sorted_nodes;
     std::vector<std::string> op_inputs;
     std::vector<std::string> op_outputs;
+    std::map<std::string, int> consumer_nums;
+    for (int i = 0; i < sorted_nodes.size(); i++) {
+        fbs_model->get_operation_inputs_and_outputs(sorted_nodes[i], op_inputs, op_outputs);
+        for (int j = 0; j < op_inputs.size(); j++) {
+            consumer_nums[op_inputs[j]]++;
+        }
+    }
+
+    // The modules of a stage run at the same time, so a tensor lives from the stage producing it to the stage after
+    // its last read.
+    std::map<std::string, int> read_times;
+    std::vector<std::string> shared_inputs; // read by another module of the same stage
     for (int i = 0; i < execution_plan.size(); i++) {
         dl::module::Module *module = execution_plan[i];
         if (!module) {
             ESP_LOGE(__FUNCTION__, "module %d is nullptr\n", i);
             break;
         }
+        int step = this->stages.empty() ? i : this->stages[i];
 
         // update the time of tensor by node's inputs
         std::vector<std::vector<int>> input_shapes;
         fbs_model->get_operation_inputs_and_outputs(sorted_nodes[i], op_inputs, op_outputs);
 
+        // The inputs sharing a buffer with a tensor read by another module of this stage can't be changed inplace.
+        shared_inputs.clear();
+        for (int j = 0; j < op_inputs.size(); j++) {
+            auto iter = this->name2index.find(op_inputs[j]);
+            TensorInfo *tensor = iter == this->name2index.end() ? nullptr : tensor_info[iter->second];
+            for (; tensor; tensor = tensor->get_inplace_leader_tensor()) {
+                auto read_iter = read_times.find(tensor->get_name());
+                if (read_iter != read_times.end() && read_iter->second == step) {
+                    shared_inputs.push_back(op_inputs[j]);
+                    break;
+                }
+            }
+        }
+
         for (int j = 0; j < op_inputs.size(); j++) {
             auto iter = this->name2index.find(op_inputs[j]);
             if (iter != this->name2index.end()) {
+                TensorInfo *tensor = tensor_info[iter->second];
+                for (; tensor; tensor = tensor->get_inplace_leader_tensor()) {
+                    read_times[tensor->get_name()] = step;
+                }
+
                 // The previously existing tensor will dirty the input. Must disconnect the inplace link.
                 TensorInfo *follower_tensor = tensor_info[iter->second]->get_inplace_follower_tensor();
                 if (follower_tensor) {
@@ -130,7 +166,7 @@ void MemoryManagerGreedy::get_tensor_info_from_fbs(fbs::FbsModel *fbs_model,
 
                 auto out_iter = std::find(graph_outputs.begin(), graph_outputs.end(), iter->first);
                 if (out_iter == graph_outputs.end())
-                    tensor_info[iter->second]->update_time(i + 1); // free this tensor next step
+                    tensor_info[iter->second]->update_time(step + 1); // free this tensor next step
                 input_shapes.push_back(tensor_info[iter->second]->get_shape());
                 module->m_inputs_index.push_back(iter->second); // assign input index of module
             }
@@ -143,7 +179,7 @@ void MemoryManagerGreedy::get_tensor_info_from_fbs(fbs::FbsModel *fbs_model,
             std::string name = op_outputs[0];
             TensorInfo *inplace_tensor = nullptr;
             TensorInfo *info = new TensorInfo(name,
-                                              i,
+                                              step,
                                               -1,
                                               output_shapes[0],
                                               fbs_model->get_value_info_dtype(name),
@@ -154,7 +190,11 @@ void MemoryManagerGreedy::get_tensor_info_from_fbs(fbs::FbsModel *fbs_model,
                 auto iter = name2index.find(op_inputs[index]);
                 if (iter != name2index.end()) {
                     inplace_tensor = tensor_info[iter->second];
-                    if (inplace_tensor->get_size() >= info->get_size()) {
+                    if (module->inplace == MODULE_INPLACE_CHANGED_BUFFER &&
+                        std::find(shared_inputs.begin(), shared_inputs.end(), iter->first) != shared_inputs.end()) {
+                        // Another module of this stage may still be reading it.
+                        inplace_tensor = nullptr;
+                    } else if (inplace_tensor->get_size() >= info->get_size()) {
                         auto out_iter = std::find(graph_outputs.begin(), graph_outputs.end(), iter->first);
                         if (out_iter == graph_outputs.end()) {
                             break;
@@ -189,7 +229,7 @@ void MemoryManagerGreedy::get_tensor_info_from_fbs(fbs::FbsModel *fbs_model,
             for (int j = 0; j < op_outputs.size(); j++) {
                 std::string name = op_outputs[j];
                 TensorInfo *info = new TensorInfo(name,
-                                                  i,
+                                                  step,
                                                   -1,
                                                   output_shapes[j],
                                                   fbs_model->get_value_info_dtype(name),
@@ -198,7 +238,91 @@ void MemoryManagerGreedy::get_tensor_info_from_fbs(fbs::FbsModel *fbs_model,
                 this->name2index.emplace(name, tensor_info.size() - 1);
                 module->m_outputs_index.push_back(tensor_info.size() - 1); // assign output index of module
             }
+            if (!this->tensor_views) {
+                // The offset of a view only holds for the planned shapes.
+                continue;
+            }
+            this->set_input_views(module, tensor_info, graph_inputs, graph_outputs, consumer_nums);
+            this->set_output_views(module, tensor_info, graph_inputs, graph_outputs, consumer_nums);
+        }
+    }
+}
+
+void MemoryManagerGreedy::set_input_views(dl::module::Module *module,
+                                          std::vector<TensorInfo *> &tensor_info,
+                                          std::vector<std::string> &graph_inputs,
+                                          std::vector<std::string> &graph_outputs,
+                                          std::map<std::string, int> &consumer_nums)
+{
+    if (module->m_outputs_index.empty()) {
+        return;
+    }
+    TensorInfo *output = tensor_info[module->m_outputs_index[0]];
+    std::vector<std::vector<int>> input_shapes;
+    for (int i = 0; i < module->m_inputs_index.size(); i++) {
+        input_shapes.push_back(tensor_info[module->m_inputs_index[i]]->get_shape());
+    }
+
+    // The producers write the output directly, then the module finds nothing to copy.
+    size_t element_size = dtype_sizeof(output->get_dtype());
+    for (int i = 0; i < module->m_inputs_index.size(); i++) {
+        TensorInfo *input = tensor_info[module->m_inputs_index[i]];
+        TensorInfo *root = input;
+        int offset = module->get_input_view_offset(i, input_shapes);
+        bool is_view =
+            offset >= 0 && (offset * element_size) % this->alignment == 0 && input->get_dtype() == output->get_dtype();
+        while (is_view) {
+            // Every tensor sharing the buffer is only read by the next one, and finally by the module.
+            std::string name = root->get_name();
+            is_view = consumer_nums[name] == 1 && root->get_size() == input->get_size() &&
+                std::find(graph_inputs.begin(), graph_inputs.end(), name) == graph_inputs.end() &&
+                std::find(graph_outputs.begin(), graph_outputs.end(), name) == graph_outputs.end();
+            if (!root->is_inplaced()) {
+                break;
+            }
+            root = root->get_inplace_leader_tensor();
+        }
+        if (is_view) {
+            root->set_view_leader_tensor(output, offset * element_size);
+            this->view_saved_bytes += 2 * input->get_size();
+        }
+    }
+}
+
+void MemoryManagerGreedy::set_output_views(dl::module::Module *module,
+                                           std::vector<TensorInfo *> &tensor_info,
+                                           std::vector<std::string> &graph_inputs,
+                                           std::vector<std::string> &graph_outputs,
+                                           std::map<std::string, int> &consumer_nums)
+{
+    if (module->m_inputs_index.empty()) {
+        return;
+    }
+
+    // The outputs may only share the buffer of the input if nothing else reads it, otherwise a module changing an
+    // output inplace would dirty the input of others. The graph inputs are refilled by the caller on every run.
+    TensorInfo *input = tensor_info[module->m_inputs_index[0]];
+    TensorInfo *root = input;
+    while (root) {
+        std::string name = root->get_name();
+        if (consumer_nums[name] != 1 ||
+            std::find(graph_inputs.begin(), graph_inputs.end(), name) != graph_inputs.end() ||
+            std::find(graph_outputs.begin(), graph_outputs.end(), name) != graph_outputs.end()) {
+            return;
+        }
+        root = root->get_inplace_leader_tensor();
+    }
+
+    std::vector<int> input_shape = input->get_shape();
+    size_t element_size = dtype_sizeof(input->get_dtype());
+    for (int i = 0; i < module->m_outputs_index.size(); i++) {
+        TensorInfo *output = tensor_info[module->m_outputs_index[i]];
+        int offset = module->get_output_view_offset(i, input_shape);
+        if (offset < 0 || (offset * element_size) % this->alignment != 0 || output->get_dtype() != input->get_dtype()) {
+            continue;
         }
+        output->set_view_leader_tensor(input, offset * element_size);
+        this->view_saved_bytes += 2 * output->get_size();
     }
 }
 
@@ -1,13 +1,103 @@
+#include <atomic>
+#include <numeric>
 #include <stdint.h>
 
 #include "dl_memory_manager_greedy.hpp"
 #include "dl_model_base.hpp"
 #include "dl_module_creator.hpp"
+#include "esp_app_desc.h"
+#include "esp_timer.h"
 #include "fbs_model.hpp"
+#include "nvs.h"
 
 static const char *TAG = "dl::Model";
 
 namespace dl {
+/**
+ * @brief The modules of a stage shared by the tasks running it.
+ */
+typedef struct {
+    std::vector<dl::module::Module *> *modules; ///< The execution plan
+    std::vector<TensorBase *> *tensors;         ///< The tensors of memory manager
+    std::atomic<int> *next;                     ///< The next module to run
+    int end;                                    ///< The end of stage
+} stage_task_data_t;
+
+/**
+ * @brief The task running the stages of a model on the other core, created once and kept by the model.
+ */
+struct stage_worker_t {
+    TaskHandle_t task;                ///< The task
+    BaseType_t core_id;               ///< The core of task
+    SemaphoreHandle_t start;          ///< Given to run data, or to exit if data is NULL
+    SemaphoreHandle_t done;           ///< Given when the task finishes data, or exits
+    stage_task_data_t *volatile data; ///< The stage to run
+};
+
+static void forward_stage(stage_task_data_t *data)
+{
+    for (int i = data->next->fetch_add(1); i < data->end; i = data->next->fetch_add(1)) {
+        (*data->modules)[i]->forward(*data->tensors, RUNTIME_MODE_SINGLE_CORE);
+    }
+}
+
+static void stage_worker_task(void *args)
+{
+    stage_worker_t *worker = (stage_worker_t *)args;
+    while (true) {
+        xSemaphoreTake(worker->start, portMAX_DELAY);
+        if (!worker->data) {
+            break;
+        }
+        forward_stage(worker->data);
+        xSemaphoreGive(worker->done);
+    }
+    xSemaphoreGive(worker->done);
+    vTaskDelete(NULL);
+}
+
+static void delete_stage_worker(stage_worker_t *worker)
+{
+    if (worker->task) {
+        worker->data = nullptr;
+        xSemaphoreGive(worker->start);
+        xSemaphoreTake(worker->done, portMAX_DELAY);
+    }
+    if (worker->start) {
+        vSemaphoreDelete(worker->start);
+    }
+    if (worker->done) {
+        vSemaphoreDelete(worker->done);
+    }
+    delete worker;
+}
+
+/**
+ * @brief Create the worker on the core other than the current one, at the priority of the current task.
+ *
+ * @return The worker, nullptr if the task or its semaphores can not be created
+ */
+static stage_worker_t *create_stage_worker()
+{
+    stage_worker_t *worker = new stage_worker_t();
+    worker->core_id = (xPortGetCoreID() + 1) % 2;
+    worker->start = xSemaphoreCreateBinary();
+    worker->done = xSemaphoreCreateBinary();
+    UBaseType_t current_priority = uxTaskPriorityGet(xTaskGetCurrentTaskHandle());
+    if (!worker->start || !worker->done ||
+        xTaskCreatePinnedToCore(stage_worker_task,
+                                "dl_stage",
+                                CONFIG_DL_STAGE_WORKER_STACK_SIZE,
+                                worker,
+                                current_priority,
+                                &worker->task,
+                                worker->core_id) != pdPASS) {
+        worker->task = nullptr;
+        delete_stage_worker(worker);
+        return nullptr;
+    }
+    return worker;
+}
 
 Model::Model(const char *name,
              fbs::model_location_type_t location,
@@ -58,15 +148,22 @@ Model::~Model()
 {
     // If fbs_loader is NULL, this means fbs_model is created outside this class. So don't delete it.
     if (fbs_loader) {
-        delete fbs_loader;
-
+        // The model data may be owned by the loader, so the model is destroyed first.
         if (fbs_model) {
-            delete fbs_model;
+            fbs_loader->unload(fbs_model);
         }
+
+        delete fbs_loader;
     }
 
-    if (memory_manager) {
-        delete memory_manager;
+    for (auto iter = memory_plans.begin(); iter != memory_plans.end(); iter++) {
+        delete iter->second;
+    }
+    if (internal_root) {
+        heap_caps_free(internal_root);
+    }
+    if (stage_worker) {
+        delete_stage_worker(stage_worker);
     }
     if (!execution_plan.empty()) {
         for (int i = 0; i < execution_plan.size(); i++) {
@@ -140,23 +237,232 @@ esp_err_t Model::load(fbs::FbsModel *fbs_model)
         }
         execution_plan.push_back(module);
     }
+    if (ret == ESP_OK) {
+        this->fuse_modules(sorted_nodes);
+        this->pack_modules(sorted_nodes);
+        this->plan_nodes = sorted_nodes;
+    }
+    this->stages.clear();
 
     this->memory_manager = nullptr;
     return ret;
 }
 
-void Model::build(size_t internal_size, memory_manager_t mm_type, bool preload)
+void Model::fuse_modules(std::vector<std::string> &sorted_nodes)
+{
+    std::vector<std::string> graph_outputs = fbs_model->get_graph_outputs();
+    std::vector<std::string> op_inputs;
+    std::vector<std::string> op_outputs;
+    std::map<std::string, int> consumer_nums;
+    std::map<std::string, int> producer_index;
+    for (int i = 0; i < sorted_nodes.size(); i++) {
+        fbs_model->get_operation_inputs_and_outputs(sorted_nodes[i], op_inputs, op_outputs);
+        for (int j = 0; j < op_inputs.size(); j++) {
+            consumer_nums[op_inputs[j]]++;
+        }
+        for (int j = 0; j < op_outputs.size(); j++) {
+            producer_index[op_outputs[j]] = i;
+        }
+    }
+
+    // The output of a fused module -> the output of the module really computing it.
+    std::map<std::string, std::string> fused_roots;
+    this->fused_traffic = 0;
+    for (int i = 0; i < sorted_nodes.size(); i++) {
+        std::string op_type = fbs_model->get_operation_type(sorted_nodes[i]);
+        if (op_type != "Relu" && op_type != "RequantizeLinear") {
+            continue;
+        }
+        fbs_model->get_operation_inputs_and_outputs(sorted_nodes[i], op_inputs, op_outputs);
+        if (op_inputs.empty() || op_outputs.size() != 1) {
+            continue;
+        }
+        std::string input = op_inputs[0];
+        std::string output = op_outputs[0];
+        if (consumer_nums[input] != 1 ||
+            std::find(graph_outputs.begin(), graph_outputs.end(), input) != graph_outputs.end() ||
+            fbs_model->get_value_info_dtype(input) != fbs_model->get_value_info_dtype(output)) {
+            continue;
+        }
+
+        auto root_iter = fused_roots.find(input);
+        std::string root = root_iter == fused_roots.end() ? input : root_iter->second;
+        auto producer_iter = producer_index.find(root);
+        if (producer_iter == producer_index.end()) {
+            continue; // graph input
+        }
+        int producer = producer_iter->second;
+        std::string producer_type = fbs_model->get_operation_type(sorted_nodes[producer]);
+        // A producer shifting to a larger exponent rounds once where the graph rounds twice, and doesn't saturate at
+        // the exponent in between, so only the modules keeping the exponent are folded.
+        if (fbs_model->get_value_info_exponent(input) != fbs_model->get_value_info_exponent(output)) {
+            continue;
+        }
+        if (op_type == "Relu") {
+            if (!execution_plan[producer]->fuse_activation(ReLU)) {
+                continue;
+            }
+        } else if (producer_type != "Conv" && producer_type != "Gemm" && producer_type != "MatMul" &&
+                   producer_type != "Add" && producer_type != "Sub" && producer_type != "Mul") {
+            continue;
+        }
+
+        quant_type_t quant_type = execution_plan[i]->quant_type;
+        delete execution_plan[i];
+        execution_plan[i] =
+            new dl::module::Identity(sorted_nodes[i].c_str(), MODULE_INPLACE_UNCHANGED_BUFFER, quant_type);
+        fused_roots[output] = root;
+
+        // The fused module read and wrote the whole tensor.
+        std::vector<int> shape = fbs_model->get_value_info_shape(output);
+        size_t size = dtype_sizeof(fbs_model->get_value_info_dtype(output));
+        for (int j = 0; j < shape.size(); j++) {
+            size *= shape[j];
+        }
+        this->fused_traffic += 2 * size;
+        ESP_LOGI(TAG, "Fuse %s into %s", sorted_nodes[i].c_str(), sorted_nodes[producer].c_str());
+    }
+}
+
+void Model::pack_modules(std::vector<std::string> &sorted_nodes)
+{
+    std::vector<std::string> graph_outputs = fbs_model->get_graph_outputs();
+    std::vector<std::string> op_inputs;
+    std::vector<std::string> op_outputs;
+    std::map<std::string, std::vector<int>> consumers;
+    std::vector<int> input_channels(sorted_nodes.size(), 0);
+    std::vector<int> output_channels(sorted_nodes.size(), 0);
+    for (int i = 0; i < sorted_nodes.size(); i++) {
+        fbs_model->get_operation_inputs_and_outputs(sorted_nodes[i], op_inputs, op_outputs);
+        for (int j = 0; j < op_inputs.size(); j++) {
+            consumers[op_inputs[j]].push_back(i);
+        }
+        if (execution_plan[i]->get_channel_align() > 0) {
+            input_channels[i] = fbs_model->get_value_info_shape(op_inputs[0]).back();
+            output_channels[i] = fbs_model->get_value_info_shape(op_outputs[0]).back();
+        }
+    }
+
+    this->packed_layers = 0;
+    std::vector<int> padded_inputs(input_channels);
+    std::vector<int> padded_outputs(output_channels);
+    for (int i = 0; i < sorted_nodes.size(); i++) {
+        int align = execution_plan[i]->get_channel_align();
+        if (align == 0 || output_channels[i] % align == 0) {
+            continue;
+        }
+
+        // Elementwise modules pass the padded channels on, whatever they compute there is ignored by the readers.
+        fbs_model->get_operation_inputs_and_outputs(sorted_nodes[i], op_inputs, op_outputs);
+        std::vector<std::string> tensors(1, op_outputs[0]);
+        std::vector<int> readers;
+        bool paddable = true;
+        for (int t = 0; t < tensors.size() && paddable; t++) {
+            if (std::find(graph_outputs.begin(), graph_outputs.end(), tensors[t]) != graph_outputs.end()) {
+                paddable = false;
+                break;
+            }
+            std::vector<int> &tensor_consumers = consumers[tensors[t]];
+            for (int j = 0; j < tensor_consumers.size() && paddable; j++) {
+                int consumer = tensor_consumers[j];
+                std::string op_type = fbs_model->get_operation_type(sorted_nodes[consumer]);
+                fbs_model->get_operation_inputs_and_outputs(sorted_nodes[consumer], op_inputs, op_outputs);
+                if (op_inputs[0] != tensors[t]) {
+                    paddable = false;
+                } else if (op_type == "Identity" || op_type == "Relu" || op_type == "RequantizeLinear") {
+                    tensors.push_back(op_outputs[0]);
+                } else if (execution_plan[consumer]->get_channel_align() == align) {
+                    readers.push_back(consumer);
+                } else {
+                    paddable = false;
+                }
+            }
+        }
+        if (!paddable) {
+            continue;
+        }
+        padded_outputs[i] = (output_channels[i] + align - 1) / align * align;
+        for (int j = 0; j < readers.size(); j++) {
+            padded_inputs[readers[j]] = padded_outputs[i];
+        }
+    }
+
+    int unaligned_layers = 0;
+    for (int i = 0; i < sorted_nodes.size(); i++) {
+        int align = execution_plan[i]->get_channel_align();
+        if (align == 0 || (input_channels[i] % align == 0 && output_channels[i] % align == 0)) {
+            continue;
+        }
+        if (padded_inputs[i] != input_channels[i] || padded_outputs[i] != output_channels[i]) {
+            execution_plan[i]->pad_channels(padded_inputs[i], padded_outputs[i]);
+        }
+        if (padded_inputs[i] % align == 0 && padded_outputs[i] % align == 0) {
+            this->packed_layers++;
+        } else {
+            unaligned_layers++;
+        }
+    }
+    if (this->packed_layers + unaligned_layers > 0) {
+        ESP_LOGI(TAG,
+                 "Pad %d unaligned Conv/Gemm layers to the aligned kernels, %d stay unaligned",
+                 this->packed_layers,
+                 unaligned_layers);
+    }
+}
+
+void Model::schedule_stages()
+{
+    std::map<std::string, int> tensor_stages;
+    std::vector<int> module_stages(execution_plan.size(), 0);
+    std::vector<std::string> op_inputs;
+    std::vector<std::string> op_outputs;
+    for (int i = 0; i < execution_plan.size(); i++) {
+        fbs_model->get_operation_inputs_and_outputs(plan_nodes[i], op_inputs, op_outputs);
+        for (int j = 0; j < op_inputs.size(); j++) {
+            auto iter = tensor_stages.find(op_inputs[j]);
+            if (iter != tensor_stages.end() && iter->second >= module_stages[i]) {
+                module_stages[i] = iter->second + 1;
+            }
+        }
+        for (int j = 0; j < op_outputs.size(); j++) {
+            tensor_stages[op_outputs[j]] = module_stages[i];
+        }
+    }
+
+    // The plan is topologically sorted, so is any order by stage.
+    std::vector<int> order(execution_plan.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return module_stages[a] < module_stages[b]; });
+    std::vector<dl::module::Module *> modules(execution_plan);
+    std::vector<std::string> nodes(plan_nodes);
+    this->stages.resize(order.size());
+    for (int i = 0; i < order.size(); i++) {
+        execution_plan[i] = modules[order[i]];
+        plan_nodes[i] = nodes[order[i]];
+        this->stages[i] = module_stages[order[i]];
+    }
+    if (!this->stages.empty()) {
+        ESP_LOGI(TAG, "Schedule %d modules in %d stages", this->stages.size(), this->stages.back() + 1);
+    }
+}
+
+void Model::build(size_t internal_size, memory_manager_t mm_type, bool preload, bool parallel, bool autotune)
 {
     int max_available_internal_size = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL) * 0.8;
     if (internal_size > max_available_internal_size) {
         ESP_LOGW(TAG, "The maximum available internal memory is %d", max_available_internal_size);
         internal_size = max_available_internal_size;
     }
+    this->mm_type = mm_type;
+    this->autotune = autotune;
 
     // If memory manager has been created, delete it and reset all modules
     this->fbs_model->load_map();
     if (this->memory_manager) {
-        delete this->memory_manager;
+        for (auto iter = this->memory_plans.begin(); iter != this->memory_plans.end(); iter++) {
+            delete iter->second;
+        }
+        this->memory_plans.clear();
         for (int i = 0; i < execution_plan.size(); i++) {
             dl::module::Module *module = execution_plan[i];
             if (module) {
@@ -165,10 +471,32 @@ void Model::build(size_t internal_size, memory_manager_t mm_type, bool preload)
         }
     }
 
-    if (mm_type == MEMORY_MANAGER_GREEDY) {
-        this->memory_manager = new dl::memory::MemoryManagerGreedy(internal_size);
+    // Only the current memory plan runs, so all of them share the internal ram.
+    if (this->internal_root) {
+        heap_caps_free(this->internal_root);
+        this->internal_root = nullptr;
+    }
+    if (internal_size > 16) {
+        this->internal_root = tool::calloc_aligned(internal_size, 1, 16, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+        if (!this->internal_root) {
+            ESP_LOGW(TAG, "Failed to alloc %d bytes of internal ram, the tensors are placed in psram", internal_size);
+            internal_size = 0;
+        }
+    }
+    this->internal_size = internal_size;
+
+    if (parallel) {
+        this->schedule_stages();
+    } else {
+        this->stages.clear();
+    }
+
+    std::map<std::string, std::vector<int>> input_shapes;
+    this->memory_manager = this->create_memory_plan(input_shapes);
+    this->saved_traffic = this->fused_traffic + this->memory_manager->view_saved_bytes;
+    if (this->saved_traffic > 0) {
+        ESP_LOGI(TAG, "Fusion saves %d bytes of memory traffic per run", this->saved_traffic);
     }
-    this->memory_manager->alloc(this->fbs_model, this->execution_plan);
 
     // get the TensorBase* of inputs and outputs
     std::vector<std::string> inputs_tmp = fbs_model->get_graph_inputs();
@@ -183,23 +511,310 @@ void Model::build(size_t internal_size, memory_manager_t mm_type, bool preload)
         TensorBase *output_tensor = this->get_intermediate(outputs_tmp[i]);
         this->outputs.emplace(outputs_tmp[i], output_tensor);
     }
+    // The plan of build() has tensor views, it only takes the shapes of the model.
+    this->memory_plans.emplace_front("=" + this->get_input_shapes_key(input_shapes), this->memory_manager);
+    if (this->autotune) {
+        this->autotune_modules();
+    }
 
     this->fbs_model->clear_map();
 }
 
-void Model::run(runtime_mode_t mode)
+void Model::autotune_modules()
 {
-    // execute each module.
+    nvs_handle_t handle;
+    bool nvs_ready = nvs_open("dl_autotune", NVS_READWRITE, &handle) == ESP_OK;
+    bool nvs_dirty = false;
+    if (nvs_ready) {
+        // The choices hold for the kernels of the firmware timing them, another firmware times them again.
+        char elf_sha256[65] = {0};
+        char tuned_sha256[65] = {0};
+        size_t length = sizeof(tuned_sha256);
+        esp_app_get_elf_sha256(elf_sha256, sizeof(elf_sha256));
+        if (nvs_get_str(handle, "elf_sha256", tuned_sha256, &length) != ESP_OK ||
+            strcmp(tuned_sha256, elf_sha256) != 0) {
+            nvs_erase_all(handle);
+            nvs_set_str(handle, "elf_sha256", elf_sha256);
+            nvs_dirty = true;
+        }
+    }
+    std::vector<TensorBase *> &tensors = this->memory_manager->tensors;
     for (int i = 0; i < execution_plan.size(); i++) {
         dl::module::Module *module = execution_plan[i];
-        if (module) {
-            module->forward(this->memory_manager->tensors, mode);
+        int algorithm_num = module->get_algorithm_num(tensors);
+        if (algorithm_num <= 1) {
+            continue;
+        }
+
+        // Only the modules of a type have more than one algorithm, so the shapes tell them apart.
+        std::string key = quant_type_to_string(module->quant_type);
+        for (int j = 0; j < module->m_inputs_index.size(); j++) {
+            key += shape_to_string(tensors[module->m_inputs_index[j]]->get_shape());
+        }
+        for (int j = 0; j < module->m_outputs_index.size(); j++) {
+            key += shape_to_string(tensors[module->m_outputs_index[j]]->get_shape());
+        }
+        auto iter = this->tuned_algorithms.find(key);
+        if (iter != this->tuned_algorithms.end()) {
+            module->set_algorithm(iter->second);
+            continue;
+        }
+
+        // NVS keys are up to 15 characters, the key is hashed by FNV-1a.
+        uint32_t hash = 2166136261u;
+        for (int j = 0; j < key.size(); j++) {
+            hash = (hash ^ (uint8_t)key[j]) * 16777619u;
+        }
+        char nvs_key[16];
+        snprintf(nvs_key, sizeof(nvs_key), "a%08lx", (unsigned long)hash);
+        uint8_t value = 0;
+        int algorithm = 0;
+        if (nvs_ready && nvs_get_u8(handle, nvs_key, &value) == ESP_OK && value < algorithm_num) {
+            algorithm = value;
         } else {
-            break;
+            int64_t best_time = INT64_MAX;
+            for (int j = 0; j < algorithm_num; j++) {
+                module->set_algorithm(j);
+                module->forward(tensors, RUNTIME_MODE_SINGLE_CORE); // warm up the cache
+                int64_t start = esp_timer_get_time();
+                module->forward(tensors, RUNTIME_MODE_SINGLE_CORE);
+                int64_t time = esp_timer_get_time() - start;
+                if (time < best_time) {
+                    best_time = time;
+                    algorithm = j;
+                }
+            }
+            ESP_LOGI(TAG, "Autotune %s: algorithm %d, %lld us", module->name, algorithm, best_time);
+            if (nvs_ready && nvs_set_u8(handle, nvs_key, algorithm) == ESP_OK) {
+                nvs_dirty = true;
+            }
+        }
+        this->tuned_algorithms[key] = algorithm;
+        module->set_algorithm(algorithm);
+    }
+    if (nvs_ready) {
+        if (nvs_dirty) {
+            nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+}
+
+dl::memory::MemoryManagerBase *Model::create_memory_plan(std::map<std::string, std::vector<int>> &input_shapes,
+                                                         bool tensor_views)
+{
+    dl::memory::MemoryManagerBase *memory_manager = nullptr;
+    if (this->mm_type == MEMORY_MANAGER_GREEDY) {
+        memory_manager = new dl::memory::MemoryManagerGreedy(this->internal_size);
+    }
+    memory_manager->sorted_nodes = this->plan_nodes;
+    memory_manager->stages = this->stages;
+    memory_manager->input_shapes = input_shapes;
+    memory_manager->tensor_views = tensor_views;
+    memory_manager->shared_internal_root = this->internal_root;
+    memory_manager->alloc(this->fbs_model, this->execution_plan);
+    for (int i = 0; i < memory_manager->tensors.size(); i++) {
+        memory_manager->planned_sizes.push_back(memory_manager->tensors[i]->get_size());
+    }
+    return memory_manager;
+}
+
+std::string Model::get_input_shapes_key(std::map<std::string, std::vector<int>> &input_shapes)
+{
+    std::string key;
+    for (auto iter = this->inputs.begin(); iter != this->inputs.end(); iter++) {
+        auto shape_iter = input_shapes.find(iter->first);
+        key += iter->first + ":" +
+            shape_to_string(shape_iter == input_shapes.end() ? iter->second->get_shape() : shape_iter->second) + ";";
+    }
+    return key;
+}
+
+esp_err_t Model::update_shapes(std::map<std::string, std::vector<int>> &input_shapes)
+{
+    std::vector<TensorBase *> &tensors = this->memory_manager->tensors;
+    std::vector<std::vector<int>> shapes(tensors.size());
+    for (int i = 0; i < tensors.size(); i++) {
+        shapes[i] = tensors[i]->get_shape();
+    }
+    for (auto iter = input_shapes.begin(); iter != input_shapes.end(); iter++) {
+        int index = this->memory_manager->get_tensor_index(const_cast<std::string &>(iter->first));
+        if (index >= 0) {
+            shapes[index] = iter->second;
+        }
+    }
+    // The shapes kept by modules such as Concat and Slice are refreshed too.
+    for (int i = 0; i < execution_plan.size(); i++) {
+        dl::module::Module *module = execution_plan[i];
+        std::vector<std::vector<int>> module_input_shapes;
+        for (int j = 0; j < module->m_inputs_index.size(); j++) {
+            module_input_shapes.push_back(shapes[module->m_inputs_index[j]]);
+        }
+        std::vector<std::vector<int>> module_output_shapes = module->get_output_shape(module_input_shapes);
+        for (int j = 0; j < module->m_outputs_index.size() && j < module_output_shapes.size(); j++) {
+            shapes[module->m_outputs_index[j]] = module_output_shapes[j];
+        }
+    }
+
+    for (int i = 0; i < tensors.size(); i++) {
+        int size = std::accumulate(shapes[i].begin(), shapes[i].end(), 1, std::multiplies<int>());
+        if (size > this->memory_manager->planned_sizes[i]) {
+            ESP_LOGE(TAG,
+                     "Tensor %d of %s takes %d elements, %d are planned.",
+                     i,
+                     shape_to_string(shapes[i]).c_str(),
+                     size,
+                     this->memory_manager->planned_sizes[i]);
+            return ESP_FAIL;
+        }
+    }
+    for (int i = 0; i < tensors.size(); i++) {
+        if (tensors[i]->get_shape() != shapes[i]) {
+            tensors[i]->set_shape(shapes[i]);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Model::set_input_shapes(std::map<std::string, std::vector<int>> &input_shapes)
+{
+    for (auto iter = input_shapes.begin(); iter != input_shapes.end(); iter++) {
+        auto input_iter = this->inputs.find(iter->first);
+        if (input_iter == this->inputs.end() || input_iter->second->get_shape().size() != iter->second.size()) {
+            ESP_LOGE(TAG, "%s isn't a graph input of shape size %d.", iter->first.c_str(), iter->second.size());
+            return ESP_FAIL;
+        }
+    }
+
+    // A plan is shared by the shapes of a bucket, planned for the largest of them, whereas the plan of build() keeps
+    // its exact shapes.
+    std::map<std::string, std::vector<int>> plan_input_shapes;
+    std::map<std::string, std::vector<int>> bucket_input_shapes;
+    bool changed = false;
+    for (auto iter = this->inputs.begin(); iter != this->inputs.end(); iter++) {
+        auto shape_iter = input_shapes.find(iter->first);
+        std::vector<int> shape = shape_iter == input_shapes.end() ? iter->second->get_shape() : shape_iter->second;
+        changed |= shape != iter->second->get_shape();
+        plan_input_shapes[iter->first] = shape;
+        for (int i = 1; i + 1 < shape.size(); i++) {
+            shape[i] = (shape[i] + this->memory_plan_bucket - 1) / this->memory_plan_bucket * this->memory_plan_bucket;
+        }
+        bucket_input_shapes[iter->first] = shape;
+    }
+    if (!changed) {
+        return ESP_OK;
+    }
+
+    std::string exact_key = "=" + this->get_input_shapes_key(plan_input_shapes);
+    std::string key = this->get_input_shapes_key(bucket_input_shapes);
+    auto plan_iter = this->memory_plans.begin();
+    while (plan_iter != this->memory_plans.end() && plan_iter->first != exact_key) {
+        plan_iter++;
+    }
+    if (plan_iter == this->memory_plans.end()) {
+        plan_iter = this->memory_plans.begin();
+        while (plan_iter != this->memory_plans.end() && plan_iter->first != key) {
+            plan_iter++;
+        }
+    }
+
+    if (plan_iter != this->memory_plans.end()) {
+        // The tensors of every memory plan are indexed the same, only their shapes and offsets differ.
+        this->memory_plans.splice(this->memory_plans.begin(), this->memory_plans, plan_iter);
+        this->memory_manager = plan_iter->second;
+    } else {
+        this->fbs_model->load_map();
+        for (int i = 0; i < execution_plan.size(); i++) {
+            execution_plan[i]->reset();
+        }
+        this->memory_manager = this->create_memory_plan(bucket_input_shapes, false);
+        this->fbs_model->clear_map();
+        this->memory_plans.emplace_front(key, this->memory_manager);
+        while (this->memory_plans.size() > this->max_memory_plans) {
+            delete this->memory_plans.back().second;
+            this->memory_plans.pop_back();
+        }
+        ESP_LOGI(TAG, "Plan memory for input shapes %s", key.c_str());
+    }
+    esp_err_t ret = this->update_shapes(plan_input_shapes);
+    if (ret != ESP_OK) {
+        // The planned shapes always fit.
+        this->update_shapes(this->memory_manager->input_shapes);
+    }
+    if (this->autotune) {
+        this->autotune_modules();
+    }
+
+    for (auto iter = this->inputs.begin(); iter != this->inputs.end(); iter++) {
+        iter->second = this->memory_manager->get_tensor(const_cast<std::string &>(iter->first));
+    }
+    for (auto iter = this->outputs.begin(); iter != this->outputs.end(); iter++) {
+        iter->second = this->memory_manager->get_tensor(const_cast<std::string &>(iter->first));
+    }
+    return ret;
+}
+
+void Model::forward_modules(runtime_mode_t mode)
+{
+    if (this->stages.empty() || mode == RUNTIME_MODE_SINGLE_CORE) {
+        // execute each module.
+        for (int i = 0; i < execution_plan.size(); i++) {
+            dl::module::Module *module = execution_plan[i];
+            if (module) {
+                module->forward(this->memory_manager->tensors, mode);
+            } else {
+                break;
+            }
+        }
+        return;
+    }
+
+    int begin = 0;
+    while (begin < execution_plan.size()) {
+        int end = begin + 1;
+        while (end < execution_plan.size() && this->stages[end] == this->stages[begin]) {
+            end++;
+        }
+        if (end - begin == 1) {
+            execution_plan[begin]->forward(this->memory_manager->tensors, mode);
+        } else {
+            // Both cores take the next module of the stage until none is left, the current task takes them all
+            // without the worker. The worker moves when the current task runs on its core.
+            if (this->stage_worker && this->stage_worker->core_id == xPortGetCoreID()) {
+                delete_stage_worker(this->stage_worker);
+                this->stage_worker = nullptr;
+            }
+            if (!this->stage_worker) {
+                this->stage_worker = create_stage_worker();
+                if (!this->stage_worker) {
+                    ESP_LOGW(TAG, "Failed to create the stage task, run the stages on one core.");
+                }
+            }
+            std::atomic<int> next(begin);
+            stage_task_data_t data = {
+                .modules = &execution_plan,
+                .tensors = &this->memory_manager->tensors,
+                .next = &next,
+                .end = end,
+            };
+            if (this->stage_worker) {
+                this->stage_worker->data = &data;
+                xSemaphoreGive(this->stage_worker->start);
+            }
+            forward_stage(&data);
+            if (this->stage_worker) {
+                xSemaphoreTake(this->stage_worker->done, portMAX_DELAY);
+            }
         }
+        begin = end;
     }
 }
 
+void Model::run(runtime_mode_t mode)
+{
+    this->forward_modules(mode);
+}
+
 void Model::run(TensorBase *input, runtime_mode_t mode)
 {
     if (this->inputs.size() != 1) {
@@ -207,21 +822,19 @@ void Model::run(TensorBase *input, runtime_mode_t mode)
     }
 
     TensorBase *model_input = this->inputs.begin()->second;
+    if (input->get_shape() != model_input->get_shape()) {
+        std::map<std::string, std::vector<int>> input_shapes = {{this->inputs.begin()->first, input->get_shape()}};
+        if (this->set_input_shapes(input_shapes) != ESP_OK) {
+            return;
+        }
+        model_input = this->inputs.begin()->second;
+    }
     if (!model_input->assign(input)) {
         ESP_LOGE(TAG, "Assign input failed");
         return;
     }
 
-    // execute each module.
-    for (int i = 0; i < execution_plan.size(); i++) {
-        dl::module::Module *module = execution_plan[i];
-        if (module) {
-            // ESP_LOGI(TAG, "module: %d\n", i);
-            module->forward(this->memory_manager->tensors, mode);
-        } else {
-            break;
-        }
-    }
+    this->forward_modules(mode);
 }
 
 void Model::run(std::map<std::string, TensorBase *> &user_inputs,
@@ -236,6 +849,14 @@ void Model::run(std::map<std::string, TensorBase *> &user_inputs,
         return;
     }
 
+    std::map<std::string, std::vector<int>> input_shapes;
+    for (auto user_inputs_iter = user_inputs.begin(); user_inputs_iter != user_inputs.end(); user_inputs_iter++) {
+        input_shapes[user_inputs_iter->first] = user_inputs_iter->second->get_shape();
+    }
+    if (this->set_input_shapes(input_shapes) != ESP_OK) {
+        return;
+    }
+
     for (auto user_inputs_iter = user_inputs.begin(); user_inputs_iter != user_inputs.end(); user_inputs_iter++) {
         std::string user_input_name = user_inputs_iter->first;
         TensorBase *user_input_tensor = user_inputs_iter->second;
@@ -251,6 +872,11 @@ void Model::run(std::map<std::string, TensorBase *> &user_inputs,
         }
     }
 
+    if (user_outputs.empty()) {
+        this->forward_modules(mode);
+        return;
+    }
+
     // execute each module.
     for (int i = 0; i < execution_plan.size(); i++) {
         dl::module::Module *module = execution_plan[i];
@@ -104,6 +104,70 @@ public:
      */
     virtual void forward_args(void *args) {};
 
+    /**
+     * @brief Apply an activation in the epilogue of this module, used to fold the following activation module.
+     *
+     * @param activation  Activation type
+     *
+     * @return true if this module applies the activation from now on
+     */
+    virtual bool fuse_activation(activation_type_t activation) { return false; }
+
+    /**
+     * @brief Get where an output lies in the first input when it is a contiguous part of it, so that the memory
+     * manager can place the output there. forward() must skip the copy when the output is placed so.
+     *
+     * @param output_index  Index of the output
+     * @param input_shape   Shape of the first input
+     *
+     * @return The offset of the output, in elements, or -1 if the output is not contiguous in the input
+     */
+    virtual int get_output_view_offset(int output_index, std::vector<int> &input_shape) { return -1; }
+
+    /**
+     * @brief Get where an input lies in the first output when it is a contiguous part of it, so that the memory
+     * manager can let the producer of the input write it there. forward() must skip the copy when the input is placed
+     * so.
+     *
+     * @param input_index   Index of the input
+     * @param input_shapes  Shapes of all inputs
+     *
+     * @return The offset of the input, in elements, or -1 if the input is not contiguous in the output
+     */
+    virtual int get_input_view_offset(int input_index, std::vector<std::vector<int>> &input_shapes) { return -1; }
+
+    /**
+     * @brief Get the channel alignment of the aligned boosted kernel, if pad_channels() can zero-pad the parameters of
+     * the module to it.
+     *
+     * @return The alignment in channels, 0 if the module can't be padded
+     */
+    virtual int get_channel_align() { return 0; }
+
+    /**
+     * @brief Zero-pad the parameters of the module to more input and output channels. The padded output channels
+     * compute zero and the padded input channels are ignored, so the result is unchanged.
+     *
+     * @param input_channel  The padded number of input channels
+     * @param output_channel The padded number of output channels
+     */
+    virtual void pad_channels(int input_channel, int output_channel) {}
+
+    /**
+     * @brief Get the number of algorithms forward() can choose from for the shapes of the tensors, see
+     * Model::build() with autotune.
+     *
+     * @param tensors  All inputs and outputs from MemoryManager
+     *
+     * @return The number of algorithms, algorithm 0 is the default one
+     */
+    virtual int get_algorithm_num(std::vector<dl::TensorBase *> &tensors) { return 1; }
+
+    /**
+     * @brief Set the algorithm of forward(), one of get_algorithm_num()
+     */
+    virtual void set_algorithm(int algorithm) {}
+
     /**
      * @brief create module instance by node serialization information
      *
@@ -114,6 +178,30 @@ public:
      */
     static Module *deserialize(fbs::FbsModel *fbs_model, std::string node_name) { return nullptr; }
 
+    /**
+     * @brief Get the exponent of each output channel of a parameter quantized per channel
+     *
+     * @param fbs_model  Flatbuffer's model
+     * @param node_name  The node name in model's graph
+     * @param index      The input index of the parameter
+     *
+     * @return The exponents, empty if the parameter is quantized per tensor
+     */
+    static std::vector<int> get_channel_exponents(fbs::FbsModel *fbs_model, std::string node_name, int index = 1)
+    {
+        std::vector<std::string> inputs;
+        std::vector<std::string> outputs;
+        if (fbs_model->get_operation_inputs_and_outputs(node_name, inputs, outputs) != ESP_OK ||
+            index >= inputs.size()) {
+            return {};
+        }
+        std::vector<int> exponents = fbs_model->get_tensor_exponents(inputs[index]);
+        if (exponents.size() <= 1) {
+            return {};
+        }
+        return exponents;
+    }
+
     /**
      * @brief print module information
      */
@@ -177,6 +265,7 @@ typedef struct {
     Module *op;                   ///< Module instance pointer
     void *args;                   ///< ArgsType, arithArgsType, resizeArgsType and so on
     SemaphoreHandle_t &semaphore; ///< recommend xSemaphoreCreateCounting
+    void (*func)(void *);         ///< Kernel of args, op->forward_args() if nullptr
 } module_task_data_t;
 
 /**
@@ -186,7 +275,11 @@ typedef struct {
 static void module_forward_task(void *args)
 {
     module_task_data_t *task = (module_task_data_t *)args;
-    task->op->forward_args(task->args);
+    if (task->func) {
+        task->func(task->args);
+    } else {
+        task->op->forward_args(task->args);
+    }
     xSemaphoreGive(task->semaphore);
     vTaskSuspend(NULL);
 }
@@ -198,8 +291,9 @@ static void module_forward_task(void *args)
  * @param op            Module instance
  * @param args1         Task1 args: ArgsType, arithArgsType, resizeArgsType and so on
  * @param args2         Task2 args: ArgsType, arithArgsType, resizeArgsType and so on
+ * @param func          Kernel of the args, e.g. for a module with args of several types. op->forward_args() if nullptr
  */
-static void module_forward_dual_core(Module *op, void *args1, void *args2)
+static void module_forward_dual_core(Module *op, void *args1, void *args2, void (*func)(void *) = nullptr)
 {
     BaseType_t current_core_id = xPortGetCoreID();
     UBaseType_t current_priority = uxTaskPriorityGet(xTaskGetCurrentTaskHandle());
@@ -210,6 +304,7 @@ static void module_forward_dual_core(Module *op, void *args1, void *args2)
         .op = op,
         .args = args1,
         .semaphore = semaphore,
+        .func = func,
     };
     xTaskCreatePinnedToCore(
         module_forward_task, NULL, 2048, &task_data1, current_priority, &xHandleTask1, (current_core_id + 1) % 2);
@@ -218,6 +313,7 @@ static void module_forward_dual_core(Module *op, void *args1, void *args2)
         .op = op,
         .args = args2,
         .semaphore = semaphore,
+        .func = func,
     };
     xTaskCreatePinnedToCore(
         module_forward_task, NULL, 2048, &task_data2, current_priority, &xHandleTask2, current_core_id);
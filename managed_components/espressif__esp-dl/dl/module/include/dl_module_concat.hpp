@@ -71,6 +71,27 @@ public:
         return output_shapes;
     }
 
+    int get_input_view_offset(int input_index, std::vector<std::vector<int>> &input_shapes)
+    {
+        int dims = input_shapes[0].size();
+        int positive_axis = this->axis < 0 ? this->axis + dims : this->axis;
+        // The inputs are interleaved in the output unless the axes before the concat axis are 1.
+        for (int i = 0; i < positive_axis; i++) {
+            if (input_shapes[0][i] != 1) {
+                return -1;
+            }
+        }
+        int offset = 0;
+        for (int i = 0; i < input_index; i++) {
+            int size = 1;
+            for (int j = 0; j < dims; j++) {
+                size *= input_shapes[i][j];
+            }
+            offset += size;
+        }
+        return offset;
+    }
+
     void forward(std::vector<dl::TensorBase *> &tensors, runtime_mode_t mode)
     {
         DL_LOG_LAYER_LATENCY_INIT();
@@ -99,7 +120,10 @@ public:
 
         for (size_t i = 0; i < this->loop_times; i++) {
             for (size_t j = 0; j < this->n_inputs; j++) {
-                tool::copy_memory(output_ptr, inputs_ptr[j], sizeof(T) * this->copy_nums[j]);
+                // The memory manager may have placed the input in the output already.
+                if (output_ptr != inputs_ptr[j]) {
+                    tool::copy_memory(output_ptr, inputs_ptr[j], sizeof(T) * this->copy_nums[j]);
+                }
                 output_ptr += copy_nums[j];
                 inputs_ptr[j] += copy_nums[j];
             }
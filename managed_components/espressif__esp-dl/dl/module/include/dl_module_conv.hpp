@@ -2,6 +2,7 @@
 
 #include "dl_base_conv2d.hpp"
 #include "dl_base_depthwise_conv2d.hpp"
+#include "dl_base_mixed_conv2d.hpp"
 #include "dl_module_base.hpp"
 #include <typeinfo>
 #include "freertos/FreeRTOS.h"
@@ -28,6 +29,13 @@ private:
     const int group;
     activation_type_t activation; /*<! activation of Conv2D, if you don't specify anything, no activation is applied >*/
     std::vector<int> padding;     /*<! padding size needed in [top, bottom, left, right] of this operation >*/
+    std::vector<int> filter_exponents; /*<! exponent of each output channel, empty if the filter is per tensor and
+                                          as wide as the feature >*/
+    std::vector<int8_t> mac_shift;     /*<! mac shift of each output channel, used with filter_exponents >*/
+    base::mixedConvGemmBuffer mixed_gemm; /*<! operands of the gemm path of mixed_conv2d(), built by the first
+                                             forward >*/
+    base::conv2d_algorithm_t algorithm; /*<! algorithm of the aligned 3x3 conv2d, set by autotune >*/
+    base::conv2dIm2colBuffer im2col;    /*<! patches of conv2d_im2col(), grown by forward >*/
 
 public:
     /**
@@ -40,8 +48,10 @@ public:
      * left, padding right]
      * @param stride_y        stride in height
      * @param stride_x        stride in width
-     * @param group           group of Conv
      * @param name            name of module
+     * @param group           group of Conv
+     * @param quant_type      quant type of the feature
+     * @param filter_exponents exponent of each output channel of a per-channel quantized filter
      */
     Conv2D(TensorBase *filter,
            TensorBase *bias = NULL,
@@ -53,7 +63,8 @@ public:
            const int dilation_x = 1,
            const char *name = NULL,
            const int group = 1,
-           quant_type_t quant_type = QUANT_TYPE_NONE) :
+           quant_type_t quant_type = QUANT_TYPE_NONE,
+           std::vector<int> filter_exponents = {}) :
         Module(name, MODULE_NON_INPLACE, quant_type),
         filter(filter),
         bias(bias),
@@ -63,8 +74,15 @@ public:
         dilation_x(dilation_x),
         group(group),
         activation(activation),
-        padding(padding)
+        padding(padding),
+        filter_exponents(filter_exponents),
+        algorithm(base::CONV2D_ALGORITHM_DIRECT)
     {
+        dtype_t feature_dtype = quant_type == QUANT_TYPE_SYMM_8BIT ? DATA_TYPE_INT8 : DATA_TYPE_INT16;
+        if (this->filter_exponents.empty() && filter->dtype != feature_dtype) {
+            // A filter of another width has no boosted kernel either, it runs on the mixed precision path.
+            this->filter_exponents.assign(filter->shape[3], filter->exponent);
+        }
     }
 
     /**
@@ -111,13 +129,73 @@ public:
         return output_shapes;
     }
 
+    bool fuse_activation(activation_type_t activation_type)
+    {
+        if (activation != Linear || activation_type != ReLU) {
+            return false;
+        }
+        activation = activation_type;
+        return true;
+    }
+
+    /**
+     * @brief Whether the filter is quantized per channel or is not as wide as the feature.
+     */
+    bool is_mixed() { return !filter_exponents.empty(); }
+
+    int get_channel_align()
+    {
+#if CONFIG_ESP32P4_BOOST
+        if (group == 1 && !is_mixed() && (activation == Linear || activation == ReLU)) {
+            return quant_type == QUANT_TYPE_SYMM_8BIT ? 16 : 8;
+        }
+#endif
+        return 0;
+    }
+
+    void pad_channels(int input_channel, int output_channel)
+    {
+        TensorBase *padded_filter = base::conv2d_pad_filter(filter, input_channel, output_channel);
+        delete filter;
+        filter = padded_filter;
+        if (bias) {
+            TensorBase *padded_bias = base::conv2d_pad_bias(bias, output_channel);
+            delete bias;
+            bias = padded_bias;
+        }
+    }
+
     void forward_args(void *args)
     {
-        if (group == 1) {
+        if (is_mixed()) {
             if (quant_type == QUANT_TYPE_SYMM_8BIT) {
-                base::conv2d<int8_t, int32_t, int32_t>(args);
+                if (filter->dtype == DATA_TYPE_INT16) {
+                    base::mixed_conv2d<int8_t, int16_t>(args);
+                } else {
+                    base::mixed_conv2d<int8_t, int8_t>(args);
+                }
             } else if (quant_type == QUANT_TYPE_SYMM_16BIT) {
-                base::conv2d<int16_t, int32_t, int64_t>(args);
+                if (filter->dtype == DATA_TYPE_INT8) {
+                    base::mixed_conv2d<int16_t, int8_t>(args);
+                } else {
+                    base::mixed_conv2d<int16_t, int16_t>(args);
+                }
+            }
+        } else if (group == 1) {
+            if (quant_type == QUANT_TYPE_SYMM_8BIT) {
+                if (algorithm == base::CONV2D_ALGORITHM_IM2COL &&
+                    base::conv2d_im2col_supported(*(base::ArgsType<int8_t> *)args)) {
+                    base::conv2d_im2col<int8_t>(args);
+                } else {
+                    base::conv2d<int8_t, int32_t, int32_t>(args);
+                }
+            } else if (quant_type == QUANT_TYPE_SYMM_16BIT) {
+                if (algorithm == base::CONV2D_ALGORITHM_IM2COL &&
+                    base::conv2d_im2col_supported(*(base::ArgsType<int16_t> *)args)) {
+                    base::conv2d_im2col<int16_t>(args);
+                } else {
+                    base::conv2d<int16_t, int32_t, int64_t>(args);
+                }
             }
         } else {
             if (quant_type == QUANT_TYPE_SYMM_8BIT) {
@@ -132,7 +210,21 @@ public:
     {
         DL_LOG_LAYER_LATENCY_INIT();
         DL_LOG_LAYER_LATENCY_START();
-        if (quant_type == QUANT_TYPE_SYMM_8BIT) {
+        if (is_mixed()) {
+            if (quant_type == QUANT_TYPE_SYMM_8BIT) {
+                if (filter->dtype == DATA_TYPE_INT16) {
+                    forward_mixed<int8_t, int16_t>(tensors, mode);
+                } else {
+                    forward_mixed<int8_t, int8_t>(tensors, mode);
+                }
+            } else if (quant_type == QUANT_TYPE_SYMM_16BIT) {
+                if (filter->dtype == DATA_TYPE_INT8) {
+                    forward_mixed<int16_t, int8_t>(tensors, mode);
+                } else {
+                    forward_mixed<int16_t, int16_t>(tensors, mode);
+                }
+            }
+        } else if (quant_type == QUANT_TYPE_SYMM_8BIT) {
             forward_template<int8_t>(tensors, mode);
         } else if (quant_type == QUANT_TYPE_SYMM_16BIT) {
             forward_template<int16_t>(tensors, mode);
@@ -140,26 +232,50 @@ public:
         DL_LOG_LAYER_LATENCY_END(this->name, "Conv2d");
     }
 
+    int get_algorithm_num(std::vector<TensorBase *> &tensors)
+    {
+        if (group != 1 || is_mixed()) {
+            return 1;
+        }
+        bool supported = false;
+        if (quant_type == QUANT_TYPE_SYMM_8BIT) {
+            supported = base::conv2d_im2col_supported(get_operation_args<int8_t>(tensors)[0]);
+        } else if (quant_type == QUANT_TYPE_SYMM_16BIT) {
+            supported = base::conv2d_im2col_supported(get_operation_args<int16_t>(tensors)[0]);
+        }
+        return supported ? 2 : 1;
+    }
+
+    void set_algorithm(int algorithm) { this->algorithm = (base::conv2d_algorithm_t)algorithm; }
+
     template <typename T>
-    void forward_template(std::vector<TensorBase *> &tensors, runtime_mode_t mode)
+    std::vector<base::ArgsType<T>> get_operation_args(std::vector<TensorBase *> &tensors,
+                                                      runtime_mode_t mode = RUNTIME_MODE_SINGLE_CORE)
     {
         TensorBase *input = tensors[m_inputs_index[0]];
         TensorBase *output = tensors[m_outputs_index[0]];
+        return base::get_conv_operation_args<T>(output,
+                                                input,
+                                                this->padding,
+                                                this->filter,
+                                                this->stride_y,
+                                                this->stride_x,
+                                                this->dilation_y,
+                                                this->dilation_x,
+                                                this->group,
+                                                this->bias,
+                                                this->activation,
+                                                nullptr,
+                                                mode); // do not support RReLU and Leaky RelU
+    }
 
-        std::vector<base::ArgsType<T>> m_args =
-            base::get_conv_operation_args<T>(output,
-                                             input,
-                                             this->padding,
-                                             this->filter,
-                                             this->stride_y,
-                                             this->stride_x,
-                                             this->dilation_y,
-                                             this->dilation_x,
-                                             this->group,
-                                             this->bias,
-                                             this->activation,
-                                             nullptr,
-                                             mode); // do not support RReLU and Leaky RelU
+    template <typename T>
+    void forward_template(std::vector<TensorBase *> &tensors, runtime_mode_t mode)
+    {
+        std::vector<base::ArgsType<T>> m_args = get_operation_args<T>(tensors, mode);
+        if (algorithm == base::CONV2D_ALGORITHM_IM2COL && base::conv2d_im2col_supported(m_args[0])) {
+            base::conv2d_im2col_set_buffer<T>(m_args, im2col);
+        }
         int task_size = m_args.size();
         if (task_size == 1) { // single task
             forward_args((void *)&m_args[0]);
@@ -170,6 +286,43 @@ public:
         }
     }
 
+    template <typename T, typename F>
+    void forward_mixed(std::vector<TensorBase *> &tensors, runtime_mode_t mode)
+    {
+        TensorBase *input = tensors[m_inputs_index[0]];
+        TensorBase *output = tensors[m_outputs_index[0]];
+
+        mac_shift.resize(filter_exponents.size());
+        for (int i = 0; i < filter_exponents.size(); i++) {
+            mac_shift[i] = output->exponent - filter_exponents[i] - input->exponent;
+        }
+        std::vector<base::mixedConvArgsType<T, F>> m_args =
+            base::get_mixed_conv_operation_args<T, F>((T *)output->get_element_ptr(),
+                                                      (T *)input->get_element_ptr(),
+                                                      (F *)filter->get_element_ptr(),
+                                                      bias ? (int32_t *)bias->get_element_ptr() : nullptr,
+                                                      mac_shift.data(),
+                                                      output->shape,
+                                                      input->shape,
+                                                      filter->shape,
+                                                      padding,
+                                                      stride_y,
+                                                      stride_x,
+                                                      dilation_y,
+                                                      dilation_x,
+                                                      group != 1,
+                                                      activation,
+                                                      mode);
+#if CONFIG_ESP32P4_BOOST
+        base::mixed_conv2d_set_gemm<T, F>(m_args, mixed_gemm);
+#endif
+        if (m_args.size() == 1) {
+            forward_args((void *)&m_args[0]);
+        } else {
+            module_forward_dual_core(this, (void *)&m_args[0], (void *)&m_args[1]);
+        }
+    }
+
     /**
      * @brief deserialize Conv2d module instance by node serialization information
      */
@@ -194,7 +347,10 @@ public:
         if (quant_type == QUANT_TYPE_SYMM_8BIT || quant_type == QUANT_TYPE_SYMM_16BIT) {
             TensorBase *filter = fbs_model->get_operation_parameter(node_name, 1);
             TensorBase *bias = fbs_model->get_operation_parameter(node_name, 2);
-            if (bias) {
+            std::vector<int> filter_exponents = get_channel_exponents(fbs_model, node_name);
+            dtype_t feature_dtype = quant_type == QUANT_TYPE_SYMM_8BIT ? DATA_TYPE_INT8 : DATA_TYPE_INT16;
+            // The mixed precision path reads the int32 bias as it is stored.
+            if (bias && filter_exponents.empty() && filter->dtype == feature_dtype) {
                 bias->reset_bias_layout(quant_type, group != 1);
             }
 
@@ -208,7 +364,8 @@ public:
                                    dilations[1],
                                    node_name.c_str(),
                                    group,
-                                   quant_type);
+                                   quant_type,
+                                   filter_exponents);
         }
 
         return conv2d_op;
@@ -218,7 +375,7 @@ public:
     {
         ESP_LOGI("Conv2d",
                  "filter:%s, bias:%s, pads: %s, strides: [%d,%d], dilations: [%d,%d], group: %d, activation: %s, "
-                 "quant_type: %s.",
+                 "quant_type: %s, filter: %s%s.",
                  shape_to_string(filter->shape).c_str(),
                  bias == nullptr ? "false" : "true",
                  shape_to_string(padding).c_str(),
@@ -228,7 +385,9 @@ public:
                  dilation_x,
                  group,
                  activation_type_to_string(activation),
-                 quant_type_to_string(quant_type));
+                 quant_type_to_string(quant_type),
+                 dtype_to_string(filter->dtype),
+                 filter_exponents.size() > 1 ? " per-channel" : "");
     }
 
     // void set_preload_addr(void *addr, size_t size)
@@ -12,6 +12,7 @@
 #include "dl_module_global_average_pool.hpp"
 #include "dl_module_hard_sigmoid.hpp"
 #include "dl_module_hard_swish.hpp"
+#include "dl_module_identity.hpp"
 #include "dl_module_leaky_relu.hpp"
 #include "dl_module_log.hpp"
 #include "dl_module_lut.hpp"
@@ -133,6 +134,7 @@ public:
             this->register_module("MatMul", MatMul::deserialize);
             this->register_module("Split", Split::deserialize);
             this->register_module("Gather", Gather::deserialize);
+            this->register_module("Identity", Identity::deserialize);
         }
     }
 
@@ -12,6 +12,9 @@ namespace module {
  *         Supports float, int16_t and int8_t
  */
 class Exp : public Module {
+private:
+    PointwiseLUT m_lut; /*<! table of the quantized function, built at load time */
+
 public:
     /**
      * @brief Construct a new Exp object.
@@ -22,7 +25,7 @@ public:
     Exp(const char *name = NULL,
         module_inplace_t inplace = MODULE_NON_INPLACE,
         quant_type_t quant_type = QUANT_TYPE_NONE) :
-        Module(name, inplace, quant_type)
+        Module(name, inplace, quant_type), m_lut([](float x) { return expf(x); })
     {
     }
 
@@ -63,16 +66,7 @@ public:
     {
         TensorBase *input = tensors[m_inputs_index[0]];
         TensorBase *output = tensors[m_outputs_index[0]];
-        T *input_ptr = (T *)input->get_element_ptr();
-        T *output_ptr = (T *)output->get_element_ptr();
-
-        float input_scale = DL_SCALE(input->exponent);
-        float output_scale = DL_RESCALE(output->exponent);
-        for (size_t i = 0; i < input->size; i++) {
-            float temp = input_ptr[i] * input_scale;
-            temp = expf(temp);
-            tool::truncate(output_ptr[i], tool::round(temp * output_scale));
-        }
+        m_lut.run<T>(input, output);
     }
 
     void forward_args(void *args) {}
@@ -87,15 +81,13 @@ public:
         fbs_model->get_operation_attribute(node_name, "quant_type", quant_type);
 
         // Create module
-        if (quant_type == QUANT_TYPE_SYMM_8BIT) {
-            TensorBase *table = fbs_model->get_operation_lut(node_name);
-            if (table) {
-                op = new LUT(node_name.c_str(), table, MODULE_INPLACE_CHANGED_BUFFER, quant_type);
-            } else {
-                op = new Exp(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
-            }
+        TensorBase *table = quant_type == QUANT_TYPE_SYMM_8BIT ? fbs_model->get_operation_lut(node_name) : nullptr;
+        if (table) {
+            op = new LUT(node_name.c_str(), table, MODULE_INPLACE_CHANGED_BUFFER, quant_type);
         } else {
-            op = new Exp(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
+            Exp *layer = new Exp(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
+            layer->m_lut.build(fbs_model, node_name, quant_type);
+            op = layer;
         }
 
         return op;
@@ -2,6 +2,8 @@
 
 #include "dl_base_conv2d.hpp"
 #include "dl_base_depthwise_conv2d.hpp"
+#include "dl_base_gemm.hpp"
+#include "dl_base_mixed_conv2d.hpp"
 #include "dl_module_base.hpp"
 #include <typeinfo>
 #include "freertos/FreeRTOS.h"
@@ -19,6 +21,11 @@ private:
     TensorBase *filter;           /*<! filter of Gemm. It's shape is [1, 1, in_features, out_features] >*/
     TensorBase *bias;             /*<! bias of Gemm, if you don't specify anything, no bias is added >*/
     activation_type_t activation; /*<! activation of Gemm, if you don't specify anything, no activation is applied >*/
+    std::vector<int> filter_exponents; /*<! exponent of each output feature, empty if the filter is per tensor and
+                                          as wide as the feature >*/
+    std::vector<int8_t> mac_shift;     /*<! mac shift of each output feature, used with filter_exponents >*/
+    base::mixedConvGemmBuffer mixed_gemm; /*<! operands of the gemm path of mixed_conv2d(), built by the first
+                                             forward >*/
 
 public:
     /**
@@ -28,14 +35,25 @@ public:
      * @param bias            bias of Gemm, if you don't specify anything, no bias is added
      * @param activation      activation of Gemm, if you don't specify anything, no activation is applied
      * @param name            name of module
+     * @param quant_type      quant type of the feature
+     * @param filter_exponents exponent of each output feature of a per-channel quantized filter
      */
     Gemm(TensorBase *filter,
          TensorBase *bias = nullptr,
          activation_type_t activation = Linear,
          const char *name = nullptr,
-         quant_type_t quant_type = QUANT_TYPE_NONE) :
-        Module(name, MODULE_NON_INPLACE, quant_type), filter(filter), bias(bias), activation(activation)
+         quant_type_t quant_type = QUANT_TYPE_NONE,
+         std::vector<int> filter_exponents = {}) :
+        Module(name, MODULE_NON_INPLACE, quant_type),
+        filter(filter),
+        bias(bias),
+        activation(activation),
+        filter_exponents(filter_exponents)
     {
+        dtype_t feature_dtype = quant_type == QUANT_TYPE_SYMM_8BIT ? DATA_TYPE_INT8 : DATA_TYPE_INT16;
+        if (this->filter_exponents.empty() && filter->dtype != feature_dtype) {
+            this->filter_exponents.assign(filter->shape[3], filter->exponent);
+        }
     }
 
     /**
@@ -77,15 +95,82 @@ public:
         return output_shapes;
     }
 
+    bool fuse_activation(activation_type_t activation_type)
+    {
+        if (activation != Linear || activation_type != ReLU) {
+            return false;
+        }
+        activation = activation_type;
+        return true;
+    }
+
+    /**
+     * @brief Whether the filter is quantized per channel or is not as wide as the feature.
+     */
+    bool is_mixed() { return !filter_exponents.empty(); }
+
+    int get_channel_align()
+    {
+#if CONFIG_ESP32P4_BOOST
+        if (!is_mixed() && (activation == Linear || activation == ReLU)) {
+            return quant_type == QUANT_TYPE_SYMM_8BIT ? 16 : 8;
+        }
+#endif
+        return 0;
+    }
+
+    void pad_channels(int input_channel, int output_channel)
+    {
+        TensorBase *padded_filter = base::conv2d_pad_filter(filter, input_channel, output_channel);
+        delete filter;
+        filter = padded_filter;
+        if (bias) {
+            TensorBase *padded_bias = base::conv2d_pad_bias(bias, output_channel);
+            delete bias;
+            bias = padded_bias;
+        }
+    }
+
     void forward_args(void *args)
     {
-        if (quant_type == QUANT_TYPE_SYMM_8BIT) {
+        if (is_mixed()) {
+            if (quant_type == QUANT_TYPE_SYMM_8BIT) {
+                if (filter->dtype == DATA_TYPE_INT16) {
+                    base::mixed_conv2d<int8_t, int16_t>(args);
+                } else {
+                    base::mixed_conv2d<int8_t, int8_t>(args);
+                }
+            } else if (quant_type == QUANT_TYPE_SYMM_16BIT) {
+                if (filter->dtype == DATA_TYPE_INT8) {
+                    base::mixed_conv2d<int16_t, int8_t>(args);
+                } else {
+                    base::mixed_conv2d<int16_t, int16_t>(args);
+                }
+            }
+        } else if (quant_type == QUANT_TYPE_SYMM_8BIT) {
             base::conv2d<int8_t, int32_t, int32_t>(args);
         } else if (quant_type == QUANT_TYPE_SYMM_16BIT) {
             base::conv2d<int16_t, int32_t, int64_t>(args);
         }
     }
 
+    /**
+     * @brief Whether the filter is in gemm panel layout. On esp32p4 the aligned conv2d 1x1 filter is, so the rows can
+     * be split between the two cores, which conv2d can not do with an output height of 1.
+     */
+    bool is_gemm_filter()
+    {
+#if CONFIG_ESP32P4_BOOST
+        if (is_mixed()) {
+            return false;
+        }
+        int u = quant_type == QUANT_TYPE_SYMM_8BIT ? 16 : 8;
+        return filter->shape[2] % u == 0 && filter->shape[3] % u == 0 && (activation == Linear || activation == ReLU);
+#else
+        return false;
+#endif
+    }
+
     template <typename T>
     void forward_template(std::vector<TensorBase *> &tensors, runtime_mode_t mode)
     {
@@ -97,6 +182,35 @@ public:
         input->set_shape({1, 1, input->get_size() / origin_input_shape.back(), origin_input_shape.back()});
         output->set_shape({1, 1, output->get_size() / origin_output_shape.back(), origin_output_shape.back()});
 
+        if (is_mixed()) {
+            forward_mixed<T>(input, output, mode);
+            input->set_shape(origin_input_shape);
+            output->set_shape(origin_output_shape);
+            return;
+        }
+
+        if (is_gemm_filter()) {
+            std::vector<base::gemmArgsType<T>> m_args =
+                base::get_gemm_operation_args<T>((T *)output->get_element_ptr(),
+                                                 (T *)input->get_element_ptr(),
+                                                 (T *)filter->get_element_ptr(),
+                                                 bias ? bias->get_element_ptr() : nullptr,
+                                                 input->shape[2],
+                                                 filter->shape[3],
+                                                 filter->shape[2],
+                                                 output->exponent - filter->exponent - input->exponent,
+                                                 activation,
+                                                 mode);
+            if (m_args.size() == 1) {
+                base::gemm<T>((void *)&m_args[0]);
+            } else {
+                module_forward_dual_core(this, (void *)&m_args[0], (void *)&m_args[1], base::gemm<T>);
+            }
+            input->set_shape(origin_input_shape);
+            output->set_shape(origin_output_shape);
+            return;
+        }
+
         std::vector<base::ArgsType<T>> m_args =
             base::get_conv_operation_args<T>(output,
                                              input,
@@ -124,6 +238,54 @@ public:
         output->set_shape(origin_output_shape);
     }
 
+    /**
+     * @brief Gemm as a 1x1 conv2d over [1, 1, rows, in_features], the filter is in [out_features, in_features] order.
+     */
+    template <typename T>
+    void forward_mixed(TensorBase *input, TensorBase *output, runtime_mode_t mode)
+    {
+        std::vector<int> padding(4, 0);
+        mac_shift.resize(filter_exponents.size());
+        for (int i = 0; i < filter_exponents.size(); i++) {
+            mac_shift[i] = output->exponent - filter_exponents[i] - input->exponent;
+        }
+        if (filter->dtype == DATA_TYPE_INT8) {
+            forward_mixed_args<T, int8_t>(input, output, padding, mode);
+        } else {
+            forward_mixed_args<T, int16_t>(input, output, padding, mode);
+        }
+    }
+
+    template <typename T, typename F>
+    void forward_mixed_args(TensorBase *input, TensorBase *output, std::vector<int> &padding, runtime_mode_t mode)
+    {
+        std::vector<base::mixedConvArgsType<T, F>> m_args =
+            base::get_mixed_conv_operation_args<T, F>((T *)output->get_element_ptr(),
+                                                      (T *)input->get_element_ptr(),
+                                                      (F *)filter->get_element_ptr(),
+                                                      bias ? (int32_t *)bias->get_element_ptr() : nullptr,
+                                                      mac_shift.data(),
+                                                      output->shape,
+                                                      input->shape,
+                                                      filter->shape,
+                                                      padding,
+                                                      1 /*stride_y*/,
+                                                      1 /*stride_x*/,
+                                                      1 /*dilation_y*/,
+                                                      1 /*dilation_x*/,
+                                                      false,
+                                                      activation,
+                                                      mode);
+#if CONFIG_ESP32P4_BOOST
+        base::mixed_conv2d_set_gemm<T, F>(m_args, mixed_gemm);
+#endif
+        if (m_args.size() == 1) {
+            forward_args((void *)&m_args[0]);
+        } else {
+            module_forward_dual_core(this, (void *)&m_args[0], (void *)&m_args[1]);
+        }
+    }
+
     void forward(std::vector<TensorBase *> &tensors, runtime_mode_t mode = RUNTIME_MODE_AUTO)
     {
         DL_LOG_LAYER_LATENCY_INIT();
@@ -157,11 +319,14 @@ public:
         if (quant_type == QUANT_TYPE_SYMM_8BIT || quant_type == QUANT_TYPE_SYMM_16BIT) {
             TensorBase *filter = fbs_model->get_operation_parameter(node_name, 1);
             TensorBase *bias = fbs_model->get_operation_parameter(node_name, 2);
-            if (bias) {
+            std::vector<int> filter_exponents = get_channel_exponents(fbs_model, node_name);
+            dtype_t feature_dtype = quant_type == QUANT_TYPE_SYMM_8BIT ? DATA_TYPE_INT8 : DATA_TYPE_INT16;
+            // The mixed precision path reads the int32 bias as it is stored.
+            if (bias && filter_exponents.empty() && filter->dtype == feature_dtype) {
                 bias->reset_bias_layout(quant_type, false);
             }
 
-            gemm_op = new Gemm(filter, bias, activation_type, node_name.c_str(), quant_type);
+            gemm_op = new Gemm(filter, bias, activation_type, node_name.c_str(), quant_type, filter_exponents);
         }
 
         return gemm_op;
@@ -171,11 +336,13 @@ public:
     {
         ESP_LOGI("Gemm",
                  "filter:%s, bias:%s, activation: %s, "
-                 "quant_type: %s.",
+                 "quant_type: %s, filter: %s%s.",
                  shape_to_string(filter->shape).c_str(),
                  bias == nullptr ? "false" : "true",
                  activation_type_to_string(activation),
-                 quant_type_to_string(quant_type));
+                 quant_type_to_string(quant_type),
+                 dtype_to_string(filter->dtype),
+                 filter_exponents.size() > 1 ? " per-channel" : "");
     }
 };
 } // namespace module
@@ -14,6 +14,9 @@ namespace module {
  *         y = x * max(0, min(1, 0.166667 * x + 0.5)), refer to https://onnx.ai/onnx/operators/onnx__HardSwish.html
  */
 class HardSwish : public Module {
+private:
+    PointwiseLUT m_lut; /*<! table of the quantized function, built at load time */
+
 public:
     /**
      * @brief Construct a new HardSwish object.
@@ -24,7 +27,8 @@ public:
     HardSwish(const char *name = NULL,
               module_inplace_t inplace = MODULE_NON_INPLACE,
               quant_type_t quant_type = QUANT_TYPE_NONE) :
-        Module(name, inplace, quant_type)
+        Module(name, inplace, quant_type),
+        m_lut([](float x) -> float { return DL_MAX(0, DL_MIN(1, 0.166667 * x + 0.5)) * x; })
     {
     }
 
@@ -56,16 +60,7 @@ public:
     {
         TensorBase *input = tensors[m_inputs_index[0]];
         TensorBase *output = tensors[m_outputs_index[0]];
-        T *input_ptr = (T *)input->get_element_ptr();
-        T *output_ptr = (T *)output->get_element_ptr();
-
-        float input_scale = DL_SCALE(input->exponent);
-        float output_scale = DL_RESCALE(output->exponent);
-        for (size_t i = 0; i < input->size; i++) {
-            float temp = input_ptr[i] * input_scale;
-            temp = DL_MAX(0, DL_MIN(1, 0.166667 * temp + 0.5)) * temp;
-            tool::truncate(output_ptr[i], tool::round(temp * output_scale));
-        }
+        m_lut.run<T>(input, output);
     }
 
     void forward_args(void *args) {}
@@ -80,15 +75,13 @@ public:
         fbs_model->get_operation_attribute(node_name, "quant_type", quant_type);
 
         // Create module
-        if (quant_type == QUANT_TYPE_SYMM_8BIT) {
-            TensorBase *table = fbs_model->get_operation_lut(node_name);
-            if (table) {
-                op = new LUT(node_name.c_str(), table, MODULE_INPLACE_CHANGED_BUFFER, quant_type);
-            } else {
-                op = new HardSwish(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
-            }
+        TensorBase *table = quant_type == QUANT_TYPE_SYMM_8BIT ? fbs_model->get_operation_lut(node_name) : nullptr;
+        if (table) {
+            op = new LUT(node_name.c_str(), table, MODULE_INPLACE_CHANGED_BUFFER, quant_type);
         } else {
-            op = new HardSwish(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
+            HardSwish *layer = new HardSwish(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
+            layer->m_lut.build(fbs_model, node_name, quant_type);
+            op = layer;
         }
 
         return op;
@@ -11,6 +11,9 @@ namespace module {
  *         Supports float, int16_t and int8_t.
  */
 class Log : public Module {
+private:
+    PointwiseLUT m_lut; /*<! table of the quantized function, built at load time */
+
 public:
     /**
      * @brief Construct a new Log object.
@@ -21,7 +24,7 @@ public:
     Log(const char *name = NULL,
         module_inplace_t inplace = MODULE_NON_INPLACE,
         quant_type_t quant_type = QUANT_TYPE_NONE) :
-        Module(name, inplace, quant_type)
+        Module(name, inplace, quant_type), m_lut([](float x) { return logf(x); })
     {
     }
 
@@ -62,6 +65,12 @@ public:
     {
         TensorBase *input = tensors[m_inputs_index[0]];
         TensorBase *output = tensors[m_outputs_index[0]];
+        if constexpr (sizeof(T) == 1) {
+            m_lut.run<T>(input, output);
+            return;
+        }
+
+        // log is too steep near 0 for an interpolated table.
         T *input_ptr = (T *)input->get_element_ptr();
         T *output_ptr = (T *)output->get_element_ptr();
 
@@ -86,15 +95,15 @@ public:
         fbs_model->get_operation_attribute(node_name, "quant_type", quant_type);
 
         // Create module
-        if (quant_type == QUANT_TYPE_SYMM_8BIT) {
-            TensorBase *table = fbs_model->get_operation_lut(node_name);
-            if (table) {
-                op = new LUT(node_name.c_str(), table, MODULE_INPLACE_CHANGED_BUFFER, quant_type);
-            } else {
-                op = new Log(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
-            }
+        TensorBase *table = quant_type == QUANT_TYPE_SYMM_8BIT ? fbs_model->get_operation_lut(node_name) : nullptr;
+        if (table) {
+            op = new LUT(node_name.c_str(), table, MODULE_INPLACE_CHANGED_BUFFER, quant_type);
         } else {
-            op = new Log(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
+            Log *layer = new Log(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
+            if (quant_type == QUANT_TYPE_SYMM_8BIT) {
+                layer->m_lut.build(fbs_model, node_name, quant_type);
+            }
+            op = layer;
         }
         op->print();
 
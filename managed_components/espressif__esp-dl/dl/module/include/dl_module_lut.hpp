@@ -1,9 +1,186 @@
 #pragma once
 
+#include "dl_base_lut.hpp"
 #include "dl_module_base.hpp"
 
 namespace dl {
 namespace module {
+/**
+ * @brief Table of a pointwise function over quantized elements. The table is generated by build() when the module is
+ * deserialized, from the input and output exponents of the model, so it costs nothing at run time.
+ *
+ * int8 tables have one entry per input value and match the float path exactly. int16 tables have one entry every
+ * 2^step_shift input values and are linearly interpolated. build() takes the coarsest step whose interpolation stays
+ * within S16_MAX_ERROR of the float path over all the 65536 inputs, so that a steep function or fine exponents get a
+ * finer table, and keeps the float path when even the finest step is off. The entries are saturated after
+ * interpolation, which keeps the segments crossing the int16 range exact.
+ */
+class PointwiseLUT {
+public:
+    static const int S16_MIN_STEP_SHIFT = 3; /*<! 8193 entries, 32 KB per int16 table */
+    static const int S16_MAX_STEP_SHIFT = 7; /*<! 513 entries, 2 KB per int16 table */
+    static const int S16_MAX_ERROR = 1;      /*<! The most an int16 output may differ from the float path */
+
+    /**
+     * @brief Construct a new PointwiseLUT object.
+     *
+     * @param func the float function, applied to the dequantized input
+     */
+    PointwiseLUT(float (*func)(float)) :
+        m_func(func),
+        m_table(nullptr),
+        m_step_shift(0),
+        m_quant_type(QUANT_TYPE_NONE),
+        m_input_exponent(0),
+        m_output_exponent(0)
+    {
+    }
+
+    ~PointwiseLUT()
+    {
+        if (m_table) {
+            heap_caps_free(m_table);
+        }
+    }
+
+    /**
+     * @brief Generate the table for the exponents of the input and output of a node.
+     */
+    void build(fbs::FbsModel *fbs_model, std::string &node_name, quant_type_t quant_type)
+    {
+        std::vector<std::string> inputs;
+        std::vector<std::string> outputs;
+        fbs_model->get_operation_inputs_and_outputs(node_name, inputs, outputs);
+        if (inputs.empty() || outputs.empty()) {
+            return;
+        }
+        build(quant_type, fbs_model->get_value_info_exponent(inputs[0]), fbs_model->get_value_info_exponent(outputs[0]));
+    }
+
+    /**
+     * @brief Generate the table for a pair of input and output exponents. Without memory for the table, the float
+     * path is taken.
+     */
+    void build(quant_type_t quant_type, int input_exponent, int output_exponent)
+    {
+        if (m_table) {
+            heap_caps_free(m_table);
+            m_table = nullptr;
+        }
+        m_quant_type = quant_type;
+        m_input_exponent = input_exponent;
+        m_output_exponent = output_exponent;
+        if (quant_type == QUANT_TYPE_SYMM_8BIT) {
+            generate_s8();
+        } else if (quant_type == QUANT_TYPE_SYMM_16BIT) {
+            generate_s16();
+        }
+    }
+
+    /**
+     * @brief output = func(input), input and output are int8_t or int16_t tensors.
+     */
+    template <typename T>
+    void run(TensorBase *input, TensorBase *output)
+    {
+        // The exponents of the tensors are the ones of the model, unless the module is run on its own.
+        quant_type_t quant_type = sizeof(T) == 1 ? QUANT_TYPE_SYMM_8BIT : QUANT_TYPE_SYMM_16BIT;
+        if (m_quant_type != quant_type || m_input_exponent != input->exponent ||
+            m_output_exponent != output->exponent) {
+            this->build(quant_type, input->exponent, output->exponent);
+        }
+
+        T *input_ptr = (T *)input->get_element_ptr();
+        T *output_ptr = (T *)output->get_element_ptr();
+        if (!m_table) {
+            for (int i = 0; i < input->size; i++) {
+                tool::truncate(output_ptr[i], quantize(input_ptr[i]));
+            }
+        } else if constexpr (sizeof(T) == 1) {
+            base::lut(output_ptr, input_ptr, input->size, (const int8_t *)m_table);
+        } else {
+            base::lut(output_ptr, input_ptr, input->size, (const int32_t *)m_table, m_step_shift);
+        }
+    }
+
+    /**
+     * @brief Get the input distance between two entries of the int16 table, log2. 0 if the float path is taken.
+     */
+    int get_step_shift() { return m_step_shift; }
+
+private:
+    float (*m_func)(float);
+    void *m_table;
+    int m_step_shift;
+    quant_type_t m_quant_type;
+    int m_input_exponent;
+    int m_output_exponent;
+
+    // Same expression as the float path, clipped so that the steep ends stay representable.
+    int32_t quantize(int input)
+    {
+        float temp = m_func((float)input * DL_SCALE(m_input_exponent));
+        return tool::round(DL_CLIP(temp * DL_RESCALE(m_output_exponent), -(1 << 23), 1 << 23));
+    }
+
+    void generate_s8()
+    {
+        int8_t *table = (int8_t *)tool::malloc_aligned(256, sizeof(int8_t), 16, MALLOC_CAP_8BIT);
+        if (!table) {
+            return;
+        }
+        for (int i = 0; i < 256; i++) {
+            tool::truncate(table[i], quantize(INT8_MIN + i));
+        }
+        m_table = table;
+    }
+
+    void generate_s16()
+    {
+        // The interpolation of every step is checked against the float path in a single pass over the inputs, a
+        // segment of the coarsest step at a time. The last entry is only used for interpolation.
+        const int segment = 1 << S16_MAX_STEP_SHIFT;
+        int32_t values[segment + 1];
+        int max_error[S16_MAX_STEP_SHIFT + 1] = {0};
+        values[segment] = quantize(INT16_MIN);
+        for (int begin = 0; begin < 65536; begin += segment) {
+            values[0] = values[segment];
+            for (int j = 1; j <= segment; j++) {
+                values[j] = quantize(INT16_MIN + begin + j);
+            }
+            for (int shift = S16_MIN_STEP_SHIFT; shift <= S16_MAX_STEP_SHIFT; shift++) {
+                int step = 1 << shift;
+                for (int j = 0; j < segment; j++) {
+                    int k = j & ~(step - 1);
+                    int y = values[k] + ((((j - k) * (values[k + step] - values[k])) + (step >> 1)) >> shift);
+                    int error = abs((DL_CLIP(y, INT16_MIN, INT16_MAX)) - (DL_CLIP(values[j], INT16_MIN, INT16_MAX)));
+                    max_error[shift] = DL_MAX(max_error[shift], error);
+                }
+            }
+        }
+
+        m_step_shift = 0;
+        for (int shift = S16_MAX_STEP_SHIFT; shift >= S16_MIN_STEP_SHIFT && !m_step_shift; shift--) {
+            if (max_error[shift] <= S16_MAX_ERROR) {
+                m_step_shift = shift;
+            }
+        }
+        if (!m_step_shift) {
+            return;
+        }
+        int table_size = (65536 >> m_step_shift) + 1;
+        int32_t *table = (int32_t *)tool::malloc_aligned(table_size, sizeof(int32_t), 16, MALLOC_CAP_8BIT);
+        if (!table) {
+            m_step_shift = 0;
+            return;
+        }
+        for (int i = 0; i < table_size; i++) {
+            table[i] = quantize(INT16_MIN + (i << m_step_shift));
+        }
+        m_table = table;
+    }
+};
+
 /**
  * NOTE:int16 using linear interpolation + lookup table.
  *
@@ -64,18 +241,14 @@ public:
             int8_t *input_ptr = (int8_t *)input->get_element_ptr();
             int8_t *output_ptr = (int8_t *)output->get_element_ptr();
             int8_t *table_ptr = (int8_t *)(this->table->get_element_ptr());
-            for (size_t i = 0; i < input->size; i++) {
-                output_ptr[i] = table_ptr[input_ptr[i] + 128];
-            }
+            base::lut(output_ptr, input_ptr, input->size, table_ptr);
         } else if (quant_type == QUANT_TYPE_SYMM_16BIT) {
             int16_t *input_ptr = (int16_t *)input->get_element_ptr();
             int16_t *output_ptr = (int16_t *)output->get_element_ptr();
             int16_t *table_ptr = (int16_t *)(this->table->get_element_ptr());
 
             if (this->step == 1) {
-                for (size_t i = 0; i < input->size; i++) {
-                    output_ptr[i] = table_ptr[input_ptr[i] + 32768];
-                }
+                base::lut(output_ptr, input_ptr, input->size, table_ptr);
             } else {
                 for (size_t i = 0; i < input->size; i++) {
                     int idx = input_ptr[i] + 32768;
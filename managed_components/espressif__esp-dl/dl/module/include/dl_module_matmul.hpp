@@ -2,6 +2,7 @@
 
 #include "dl_base_conv2d.hpp"
 #include "dl_base_depthwise_conv2d.hpp"
+#include "dl_base_gemm.hpp"
 #include "dl_module_base.hpp"
 #include <typeinfo>
 #include "freertos/FreeRTOS.h"
@@ -19,7 +20,10 @@ private:
     TensorBase *m_filter; /*<! filter of MatMul. If matmul has a constant input, the value is not NULL; otherwise, it is
                              NULL >*/
     activation_type_t
-        m_activation; /*<! activation of MatMul, if you don't specify anything, no activation is applied >*/
+        m_activation;            /*<! activation of MatMul, if you don't specify anything, no activation is applied >*/
+    void *m_packed_filter;       /*<! m_filter packed by base::gemm_pack_filter(), created by the first forward >*/
+    void *m_packed_input1;       /*<! runtime input1 packed by base::gemm_pack_filter(), only grows >*/
+    size_t m_packed_input1_size; /*<! size of m_packed_input1 in bytes >*/
 
 public:
     /**
@@ -32,7 +36,12 @@ public:
            activation_type_t activation = Linear,
            const char *name = nullptr,
            quant_type_t quant_type = QUANT_TYPE_NONE) :
-        Module(name, MODULE_NON_INPLACE, quant_type), m_filter(filter), m_activation(activation)
+        Module(name, MODULE_NON_INPLACE, quant_type),
+        m_filter(filter),
+        m_activation(activation),
+        m_packed_filter(nullptr),
+        m_packed_input1(nullptr),
+        m_packed_input1_size(0)
     {
     }
 
@@ -45,6 +54,12 @@ public:
         if (m_filter) {
             delete m_filter;
         }
+        if (m_packed_filter) {
+            heap_caps_free(m_packed_filter);
+        }
+        if (m_packed_input1) {
+            heap_caps_free(m_packed_input1);
+        }
     }
 
     /**
@@ -130,6 +145,15 @@ public:
         return output_shapes;
     }
 
+    bool fuse_activation(activation_type_t activation_type)
+    {
+        if (m_activation != Linear || activation_type != ReLU) {
+            return false;
+        }
+        m_activation = activation_type;
+        return true;
+    }
+
     void forward_args(void *args)
     {
         if (quant_type == QUANT_TYPE_SYMM_8BIT) {
@@ -139,6 +163,66 @@ public:
         }
     }
 
+    /**
+     * @brief MatMul with a 2D input1, input0 of any rank is flattened into [m, k] rows.
+     *
+     * @return false if there is no memory to pack input1, the conv2d path is taken then
+     */
+    template <typename T>
+    bool forward_gemm(TensorBase *input0, TensorBase *input1, TensorBase *output, runtime_mode_t mode)
+    {
+        int k = input1->shape[0];
+        int n = input1->shape[1];
+        int m = input0->get_size() / k;
+
+        T *packed_filter = nullptr;
+        if (input1 == m_filter) {
+            if (!m_packed_filter) {
+                m_packed_filter = tool::malloc_aligned(
+                    base::gemm_packed_filter_size<T>(k, n), sizeof(T), 16, MALLOC_CAP_DEFAULT);
+                if (!m_packed_filter) {
+                    ESP_LOGW("MatMul", "No memory to pack the filter of %s, run it as conv2d.", this->name);
+                    return false;
+                }
+                base::gemm_pack_filter<T>((T *)m_packed_filter, (T *)m_filter->get_element_ptr(), k, n);
+            }
+            packed_filter = (T *)m_packed_filter;
+        } else {
+            // input1 changes on every forward, only its buffer is kept.
+            size_t packed_size = base::gemm_packed_filter_size<T>(k, n) * sizeof(T);
+            if (packed_size > m_packed_input1_size) {
+                if (m_packed_input1) {
+                    heap_caps_free(m_packed_input1);
+                }
+                m_packed_input1 = tool::malloc_aligned(packed_size, 1, 16, MALLOC_CAP_DEFAULT);
+                m_packed_input1_size = m_packed_input1 ? packed_size : 0;
+                if (!m_packed_input1) {
+                    return false;
+                }
+            }
+            packed_filter = (T *)m_packed_input1;
+            base::gemm_pack_filter<T>(packed_filter, (T *)input1->get_element_ptr(), k, n);
+        }
+
+        std::vector<base::gemmArgsType<T>> m_args =
+            base::get_gemm_operation_args<T>((T *)output->get_element_ptr(),
+                                             (T *)input0->get_element_ptr(),
+                                             packed_filter,
+                                             nullptr /*bias*/,
+                                             m,
+                                             n,
+                                             k,
+                                             output->exponent - input1->exponent - input0->exponent,
+                                             m_activation,
+                                             mode);
+        if (m_args.size() == 1) {
+            base::gemm<T>((void *)&m_args[0]);
+        } else {
+            module_forward_dual_core(this, (void *)&m_args[0], (void *)&m_args[1], base::gemm<T>);
+        }
+        return true;
+    }
+
     template <typename T>
     void forward_template(std::vector<TensorBase *> &tensors, runtime_mode_t mode)
     {
@@ -158,6 +242,11 @@ public:
             origin_input1_shape = input1->get_shape();
         }
 
+        if (origin_input1_shape.size() == 2 && (m_activation == Linear || m_activation == ReLU) &&
+            forward_gemm<T>(input0, input1, output, mode)) {
+            return;
+        }
+
         // input: MK -> NHWC; filter: KN -> HWIO; output: MN -> NHWC
         if (origin_input0_shape.size() <= 2 && origin_input1_shape.size() <= 2) {
             if (origin_input0_shape.size() == 1 && origin_input1_shape.size() == 1) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "dl_base_shape.hpp"
 #include "dl_module_base.hpp"
 
 namespace dl {
@@ -12,6 +13,7 @@ private:
     std::vector<int> m_end;   /*<! ending indices >*/
     std::vector<int> m_axes;  /*<! axes that starts and ends apply to >*/
     std::vector<int> m_step;  /*<! slice step >*/
+    int m_view_offset;        /*<! offset of the output in the input if it is contiguous, otherwise -1 >*/
 
 public:
     /**
@@ -27,7 +29,7 @@ public:
           const char *name = NULL,
           module_inplace_t inplace = MODULE_NON_INPLACE,
           quant_type_t quant_type = QUANT_TYPE_NONE) :
-        Module(name, inplace, quant_type), m_start(start), m_end(end), m_axes(axes), m_step(step)
+        Module(name, inplace, quant_type), m_start(start), m_end(end), m_axes(axes), m_step(step), m_view_offset(-1)
     {
     }
 
@@ -45,9 +47,45 @@ public:
             ESP_LOGE("Slice", "output shape is empty!");
             assert(false);
         }
+        m_view_offset = this->get_output_view_offset(0, input_shapes[0]);
         return std::vector<std::vector<int>>(1, output_shape);
     }
 
+    int get_output_view_offset(int output_index, std::vector<int> &input_shape)
+    {
+        std::vector<int> output_shape = base::get_slice_shape(input_shape, m_start, m_end, m_axes, m_step);
+        int dims = input_shape.size();
+        std::vector<int> start(dims, 0);
+        for (int i = 0; i < m_start.size(); i++) {
+            int axis = m_axes.empty() ? i : (m_axes[i] + dims) % dims;
+            start[axis] = base::get_slice_index(m_start[i], input_shape[axis]);
+            if (!m_step.empty() && m_step[i] != 1 && output_shape[axis] > 1) {
+                return -1;
+            }
+        }
+
+        // The output is contiguous if only one axis is cut, the axes before it are 1 and the axes after it are whole.
+        int axis = 0;
+        while (axis < dims && output_shape[axis] == input_shape[axis]) {
+            axis++;
+        }
+        if (axis == dims) {
+            return 0;
+        }
+        int offset = start[axis];
+        for (int i = 0; i < dims; i++) {
+            if (i < axis && input_shape[i] != 1) {
+                return -1;
+            } else if (i > axis) {
+                if (output_shape[i] != input_shape[i]) {
+                    return -1;
+                }
+                offset *= input_shape[i];
+            }
+        }
+        return offset;
+    }
+
     void forward(std::vector<dl::TensorBase *> &tensors, runtime_mode_t mode)
     {
         DL_LOG_LAYER_LATENCY_INIT();
@@ -55,7 +93,11 @@ public:
         TensorBase *input = tensors[m_inputs_index[0]];
         TensorBase *output = tensors[m_outputs_index[0]];
 
-        output->slice(input, m_start, m_end, m_axes, m_step);
+        // The memory manager may have placed the output in the input already.
+        int8_t *view_ptr = (int8_t *)input->get_element_ptr() + m_view_offset * input->get_dtype_bytes();
+        if (m_view_offset < 0 || output->get_element_ptr() != view_ptr) {
+            output->slice(input, m_start, m_end, m_axes, m_step);
+        }
         DL_LOG_LAYER_LATENCY_END(this->name, "Slice");
     }
 
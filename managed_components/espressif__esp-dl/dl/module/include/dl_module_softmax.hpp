@@ -1,5 +1,6 @@
 #pragma once
 
+#include "dl_base_softmax.hpp"
 #include "dl_module_base.hpp"
 
 namespace dl {
@@ -14,7 +15,8 @@ namespace module {
 class Softmax : public Module {
 private:
     int axis;
-    float *exp_table;
+    float *exp_table;       /*<! exp of the distance to the maximum, see base::softmax_exp_table() */
+    int exp_table_exponent; /*<! input exponent the table is built for */
 
 public:
     /**
@@ -31,6 +33,7 @@ public:
         Module(name, inplace, quant_type), axis(axis)
     {
         this->exp_table = nullptr;
+        this->exp_table_exponent = 0;
     }
 
     /**
@@ -39,7 +42,7 @@ public:
     ~Softmax()
     {
         if (this->exp_table != nullptr) {
-            free(this->exp_table);
+            heap_caps_free(this->exp_table);
         }
     }
 
@@ -59,16 +62,9 @@ public:
         TensorBase *output = tensors[m_outputs_index[0]];
 
         if (quant_type == QUANT_TYPE_SYMM_8BIT) {
-            forward_lut(input, output);
+            forward_quant<int8_t>(input, output);
         } else if (quant_type == QUANT_TYPE_SYMM_16BIT) {
-            int16_t *input_element = (int16_t *)input->get_element_ptr();
-            float *output_element = (float *)output->get_element_ptr();
-
-            float scale = DL_SCALE(input->exponent);
-            for (int i = 0; i < input->get_size(); i++) {
-                output_element[i] = scale * input_element[i];
-            }
-            forward_float(output_element, output->get_size(), output->get_shape(), this->axis);
+            forward_quant<int16_t>(input, output);
         } else if (quant_type == QUANT_TYPE_FLOAT32) {
             float *input_element = (float *)input->get_element_ptr();
             float *output_element = (float *)output->get_element_ptr();
@@ -145,68 +141,53 @@ public:
         }
     }
 
-    void forward_lut(TensorBase *input, TensorBase *output)
+    template <typename T>
+    void forward_quant(TensorBase *input, TensorBase *output)
     {
-        if (this->exp_table == nullptr) {
-            this->exp_table = (float *)tool::calloc_aligned(256, sizeof(float), 16, MALLOC_CAP_8BIT);
-            tool::gen_lut_8bit(this->exp_table, input->exponent, expf);
-        }
-
-        int dims = input->get_shape().size();
-        int positive_axis = axis < 0 ? dims + axis : axis;
-        int len = input->get_shape()[positive_axis]; // the size of positive_axis
-        int8_t *input_element = (int8_t *)input->get_element_ptr();
+        T *input_element = (T *)input->get_element_ptr();
         assert(output->get_dtype() == DATA_TYPE_FLOAT);
         float *output_element = (float *)output->get_element_ptr();
 
-        if (positive_axis == dims - 1) { // positive_axis == dims - 1
-            int outer_loop = 1;
-            if (dims > 1) {
-                outer_loop = input->get_size() / len;
+        if (this->exp_table == nullptr || this->exp_table_exponent != input->exponent) {
+            if (this->exp_table == nullptr) {
+                this->exp_table = (float *)tool::malloc_aligned(
+                    base::softmax_exp_table_size<T>(), sizeof(float), 16, MALLOC_CAP_8BIT);
             }
-
-            for (int o = 0; o < outer_loop; o++) {
-                float sum = 0.f;
-                for (int i = 0; i < len; i++) {
-                    output_element[i] = this->exp_table[input_element[i] + 128];
-                    sum += output_element[i];
-                }
-
-                for (int i = 0; i < len; i++) {
-                    output_element[i] = output_element[i] / sum;
-                }
-                input_element += len;
-                output_element += len;
-            }
-        } else {
-            // convert input tensor to [outer_loop, len, inner_loop]
-            int outer_loop = 1;
-            int inner_loop = 1;
-            for (int i = 0; i < dims; i++) {
-                if (i < positive_axis) {
-                    outer_loop *= input->get_shape()[i];
-                } else if (i > positive_axis) {
-                    inner_loop *= input->get_shape()[i];
+            if (this->exp_table == nullptr) {
+                // Dequantize and take the float path, the allocation is tried again by the next forward.
+                ESP_LOGW("Softmax", "No memory for the exp table of %s, run it in float.", this->name);
+                float scale = DL_SCALE(input->exponent);
+                for (int i = 0; i < input->get_size(); i++) {
+                    output_element[i] = input_element[i] * scale;
                 }
+                forward_float(output_element, output->get_size(), output->get_shape(), this->axis);
+                return;
             }
+            base::softmax_exp_table<T>(this->exp_table, input->exponent);
+            this->exp_table_exponent = input->exponent;
+        }
 
-            for (int o = 0; o < outer_loop; o++) {
-                for (int k = 0; k < inner_loop; k++) {
-                    float sum = 0.f;
-                    for (int i = 0; i < len; i++) {
-                        output_element[i * inner_loop] = this->exp_table[input_element[i * inner_loop] + 128];
-                        sum += output_element[i * inner_loop];
-                    }
+        int dims = input->get_shape().size();
+        int positive_axis = axis < 0 ? dims + axis : axis;
+        int len = input->get_shape()[positive_axis]; // the size of positive_axis
 
-                    for (int i = 0; i < len; i++) {
-                        output_element[i * inner_loop] = output_element[i * inner_loop] / sum;
-                    }
-                    input_element += 1;
-                    output_element += 1;
-                }
-                input_element += inner_loop * (len - 1);
-                output_element += inner_loop * (len - 1);
+        // convert input tensor to [outer_loop, len, inner_loop]
+        int outer_loop = 1;
+        int inner_loop = 1;
+        for (int i = 0; i < dims; i++) {
+            if (i < positive_axis) {
+                outer_loop *= input->get_shape()[i];
+            } else if (i > positive_axis) {
+                inner_loop *= input->get_shape()[i];
+            }
+        }
+
+        for (int o = 0; o < outer_loop; o++) {
+            for (int k = 0; k < inner_loop; k++) {
+                base::softmax(output_element + k, input_element + k, len, inner_loop, this->exp_table);
             }
+            input_element += inner_loop * len;
+            output_element += inner_loop * len;
         }
     }
 
@@ -77,10 +77,32 @@ public:
         for (int n = 0; n < num_slices; n++) {
             int in_offset = (n * in_axis_slice + slice_index) * slice_size;
             int out_offset = n * out_axis_slice * slice_size;
+            if (output + out_offset == input + in_offset) {
+                continue; // placed in the input by the memory manager
+            }
             tool::copy_memory(output + out_offset, input + in_offset, (size_t)slice_size * out_axis_slice * sizeof(T));
         }
     }
 
+    int get_output_view_offset(int output_index, std::vector<int> &input_shape)
+    {
+        std::vector<std::vector<int>> input_shapes(1, input_shape);
+        std::vector<std::vector<int>> output_shapes = this->get_output_shape(input_shapes);
+        for (int i = 0; i < m_axis; i++) {
+            if (input_shape[i] != 1) {
+                return -1;
+            }
+        }
+        int offset = 0;
+        for (int i = 0; i < output_index; i++) {
+            offset += output_shapes[i][m_axis];
+        }
+        for (int i = m_axis + 1; i < input_shape.size(); i++) {
+            offset *= input_shape[i];
+        }
+        return offset;
+    }
+
     void forward(std::vector<dl::TensorBase *> &tensors, runtime_mode_t mode)
     {
         DL_LOG_LAYER_LATENCY_INIT();
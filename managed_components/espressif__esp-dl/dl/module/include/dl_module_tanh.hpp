@@ -14,6 +14,9 @@ namespace module {
  *         - int8_t: stands for operation in int16_t, implemented by LUT
  */
 class Tanh : public Module {
+private:
+    PointwiseLUT m_lut; /*<! table of the quantized function, built at load time */
+
 public:
     /**
      * @brief Construct a new Tanh object.
@@ -24,7 +27,7 @@ public:
     Tanh(const char *name = NULL,
          module_inplace_t inplace = MODULE_NON_INPLACE,
          quant_type_t quant_type = QUANT_TYPE_NONE) :
-        Module(name, inplace, quant_type)
+        Module(name, inplace, quant_type), m_lut([](float x) { return math::tanh(x); })
     {
     }
 
@@ -47,25 +50,9 @@ public:
         TensorBase *output = tensors[m_outputs_index[0]];
 
         if (quant_type == QUANT_TYPE_SYMM_8BIT) {
-            int8_t *input_ptr = (int8_t *)input->get_element_ptr();
-            int8_t *output_ptr = (int8_t *)output->get_element_ptr();
-
-            float input_scale = DL_SCALE(input->exponent);
-            float output_scale = DL_RESCALE(output->exponent);
-            for (size_t i = 0; i < input->size; i++) {
-                float temp = math::tanh((float)input_ptr[i] * input_scale);
-                tool::truncate(output_ptr[i], tool::round(temp * output_scale));
-            }
+            m_lut.run<int8_t>(input, output);
         } else if (quant_type == QUANT_TYPE_SYMM_16BIT) {
-            int16_t *input_ptr = (int16_t *)input->get_element_ptr();
-            int16_t *output_ptr = (int16_t *)output->get_element_ptr();
-
-            float input_scale = DL_SCALE(input->exponent);
-            float output_scale = DL_RESCALE(output->exponent);
-            for (size_t i = 0; i < input->size; i++) {
-                float temp = math::tanh((float)input_ptr[i] * input_scale);
-                tool::truncate(output_ptr[i], tool::round(temp * output_scale));
-            }
+            m_lut.run<int16_t>(input, output);
         } else if (quant_type == QUANT_TYPE_FLOAT32) {
             float *input_ptr = (float *)input->get_element_ptr();
             float *output_ptr = (float *)output->get_element_ptr();
@@ -89,15 +76,13 @@ public:
         fbs_model->get_operation_attribute(node_name, "quant_type", quant_type);
 
         // Create module
-        if (quant_type == QUANT_TYPE_SYMM_8BIT) {
-            TensorBase *table = fbs_model->get_operation_lut(node_name);
-            if (table) {
-                op = new LUT(node_name.c_str(), table, MODULE_INPLACE_CHANGED_BUFFER, quant_type);
-            } else {
-                op = new Tanh(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
-            }
+        TensorBase *table = quant_type == QUANT_TYPE_SYMM_8BIT ? fbs_model->get_operation_lut(node_name) : nullptr;
+        if (table) {
+            op = new LUT(node_name.c_str(), table, MODULE_INPLACE_CHANGED_BUFFER, quant_type);
         } else {
-            op = new Tanh(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
+            Tanh *layer = new Tanh(node_name.c_str(), MODULE_INPLACE_CHANGED_BUFFER, quant_type);
+            layer->m_lut.build(fbs_model, node_name, quant_type);
+            op = layer;
         }
 
         return op;
@@ -1,5 +1,6 @@
 #include "dl_tensor_base.hpp"
 #include "dl_base_pad.hpp"
+#include "dl_base_shape.hpp"
 #include <iostream>
 namespace dl {
 
@@ -852,8 +853,8 @@ TensorBase *TensorBase::slice(T *output_element,
         if (!step.empty()) {
             step_i = step[i];
         }
-        loop_start[axis] = start[i] < 0 ? (start[i] + input_shape[axis]) : (start[i] % (input_shape[axis] + 1));
-        loop_end[axis] = end[i] < 0 ? (end[i] + input_shape[axis]) : (end[i] % (input_shape[axis] + 1));
+        loop_start[axis] = base::get_slice_index(start[i], input_shape[axis]);
+        loop_end[axis] = base::get_slice_index(end[i], input_shape[axis]);
         loop_step[axis] = step_i;
         assert(loop_start[axis] < loop_end[axis]);
     }
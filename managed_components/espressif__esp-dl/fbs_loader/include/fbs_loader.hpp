@@ -7,6 +7,7 @@
 #include "spi_flash_mmap.h"
 #endif
 #include "fbs_model.hpp"
+#include <stdio.h>
 
 namespace fbs {
 
@@ -36,10 +37,19 @@ public:
               model_location_type_t location = MODEL_LOCATION_IN_FLASH_RODATA);
 
     /**
-     * @brief Destroy the FbsLoader object.
+     * @brief Destroy the FbsLoader object. It releases the data of the models read from SD card that were not
+     * unloaded, so like the other locations the FbsModels must not outlive it.
      */
     ~FbsLoader();
 
+    /**
+     * @brief Delete an FbsModel returned by load(). A model read from SD card releases its reference on the shared
+     * model data, which is freed with the last model using it, whatever the loader.
+     *
+     * @param fbs_model    the model, deleted here
+     */
+    void unload(FbsModel *fbs_model);
+
     /**
      * @brief Load the model. If there are multiple sub-models, the first sub-model will be loaded.
      *
@@ -87,6 +97,37 @@ public:
      */
     FbsModel *load(const char *model_name, const uint8_t *key = nullptr, bool param_copy = true);
 
+    /**
+     * @brief Decrypt encrypted models once into a flash partition and load them from there afterwards.
+     *
+     * Without a cache an encrypted model is decrypted into PSRAM on every boot and always costs its full size in RAM.
+     * With a cache the first load streams the decrypted model into the partition, later loads only map it, so an
+     * encrypted model loads like a plain one in MODEL_LOCATION_IN_FLASH_PARTITION and param_copy behaves the same.
+     * The cache is refilled when the model or the key changes. A load only hashes the first and the last 4 KB of the
+     * model, 16 samples in between and the ELF SHA-256 of the app for a model in rodata. Only one model of this loader
+     * can use the cache.
+     *
+     * Pass the loaded FbsModel to dl::Model(fbs::FbsModel *) and keep this loader alive while the model is in use.
+     *
+     * @param partition_label   label of a data partition. It must be encrypted by flash encryption, because it holds
+     *                          the decrypted model, and larger than the model by at least a flash sector.
+     *
+     * @return ESP_OK if the partition can be used as the cache.
+     */
+    esp_err_t set_decrypt_cache(const char *partition_label);
+
+    /**
+     * @brief Set how much PSRAM the models read from SD card may keep after they are released.
+     *
+     * A model read from SD card stays in PSRAM until every FbsModel loaded from it is unloaded, and loading the same
+     * model again shares it instead of reading the file. Released models are kept, least recently used first out, as
+     * long as they fit in the budget, so switching between the models of a pack only reads each file region once.
+     * The budget is shared by all loaders and defaults to 0, which frees a model as soon as it is released.
+     *
+     * @param budget    bytes of released models to keep.
+     */
+    static void set_sdcard_cache_budget(size_t budget);
+
     /**
      * @brief Get the number of models.
      *
@@ -103,6 +144,20 @@ private:
     void *m_mmap_handle;
     model_location_type_t m_location;
     const void *m_fbs_buf;
+    const esp_partition_t *m_cache_partition;        /*<! partition holding the decrypted model */
+    esp_partition_mmap_handle_t m_cache_mmap_handle; /*<! valid while m_cache_mapped is true */
+    bool m_cache_mapped;
+    std::vector<char> m_sdcard_index; /*<! magic, model table and model names of the file in SD card */
+    std::vector<std::pair<FbsModel *, void *>>
+        m_sdcard_models; /*<! the models read from SD card and the shared data each holds a reference on */
+
+    const char *get_index()
+    {
+        return m_location == MODEL_LOCATION_IN_SDCARD ? m_sdcard_index.data() : (const char *)m_fbs_buf;
+    }
+
+    FbsModel *create_fbs_model(uint32_t offset, const uint8_t *key, bool param_copy);
+    FbsModel *load_decrypt_cache(const uint8_t *src, FILE *f, uint32_t size, const uint8_t *key, bool param_copy);
 };
 
 } // namespace fbs
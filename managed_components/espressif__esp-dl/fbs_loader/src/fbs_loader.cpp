@@ -1,5 +1,10 @@
 #include "fbs_loader.hpp"
+#include "esp_app_desc.h"
 #include "mbedtls/aes.h"
+#include "mbedtls/sha256.h"
+#include <condition_variable>
+#include <list>
+#include <mutex>
 
 static const char *TAG = "FbsLoader";
 
@@ -95,22 +100,11 @@ typedef enum {
     FBS_FILE_FORMAT_PDL2 = 4
 } fbs_file_format_t;
 
-fbs_file_format_t get_model_format(const char *fbs_buf, model_location_type_t model_location)
+fbs_file_format_t get_model_format(const char *fbs_buf)
 {
     char str[5];
-    if (model_location != MODEL_LOCATION_IN_SDCARD) {
-        memcpy(str, fbs_buf, 4);
-        str[4] = '\0';
-    } else {
-        FILE *f = fopen(fbs_buf, "rb");
-        if (!f) {
-            ESP_LOGE(TAG, "Failed to open %s.", fbs_buf);
-            return FBS_FILE_FORMAT_UNK;
-        }
-        fread(str, 4, 1, f);
-        str[4] = '\0';
-        fclose(f);
-    }
+    memcpy(str, fbs_buf, 4);
+    str[4] = '\0';
 
     if (strcmp(str, "EDL1") == 0) {
         return FBS_FILE_FORMAT_EDL1;
@@ -125,149 +119,291 @@ fbs_file_format_t get_model_format(const char *fbs_buf, model_location_type_t mo
     }
 }
 
-esp_err_t get_model_offset_by_index(const char *fbs_buf,
-                                    model_location_type_t model_location,
-                                    uint32_t index,
-                                    uint32_t &offset)
+esp_err_t get_model_offset_by_index(const char *fbs_buf, uint32_t index, uint32_t &offset)
 {
-    if (model_location != MODEL_LOCATION_IN_SDCARD) {
-        const uint32_t *header = (const uint32_t *)fbs_buf;
-        uint32_t model_num = header[1];
-        if (index >= model_num) {
-            ESP_LOGE(TAG, "The model index is out of range.");
+    const uint32_t *header = (const uint32_t *)fbs_buf;
+    uint32_t model_num = header[1];
+    if (index >= model_num) {
+        ESP_LOGE(TAG, "The model index is out of range.");
+        return ESP_FAIL;
+    }
+    offset = header[2 + index * 3];
+    return ESP_OK;
+}
+
+esp_err_t get_model_offset_by_name(const char *fbs_buf, const char *name, uint32_t &offset)
+{
+    const uint32_t *header = (const uint32_t *)fbs_buf;
+    uint32_t model_num = header[1];
+    uint32_t name_offset, name_length;
+    for (int i = 0; i < model_num; i++) {
+        name_offset = header[2 + 3 * i + 1];
+        name_length = header[2 + 3 * i + 2];
+        std::string model_name(fbs_buf + name_offset, name_length);
+        if (model_name == std::string(name)) {
+            offset = header[2 + 3 * i];
+            return ESP_OK;
+        }
+    }
+    ESP_LOGE(TAG, "Model %s is not found.", name);
+    return ESP_FAIL;
+}
+
+// Every size read from the file is checked against the file size before it is used.
+static esp_err_t read_sdcard_index(FILE *f, std::vector<char> &index)
+{
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    index.resize(8);
+    if (file_size < 8 || fread(index.data(), 8, 1, f) != 1) {
+        return ESP_FAIL;
+    }
+    fbs_file_format_t format = get_model_format(index.data());
+    if (format == FBS_FILE_FORMAT_PDL1 || format == FBS_FILE_FORMAT_PDL2) {
+        uint32_t model_num = ((const uint32_t *)index.data())[1];
+        if (model_num == 0 || model_num > (file_size - 8) / 12) {
             return ESP_FAIL;
         }
-        offset = header[2 + index * 3];
-        return ESP_OK;
-    } else {
-        FILE *f = fopen(fbs_buf, "rb");
-        if (!f) {
-            ESP_LOGE(TAG, "Failed to open %s.", fbs_buf);
+        index.resize(8 + 12 * model_num);
+        if (fread(index.data() + 8, 12 * model_num, 1, f) != 1) {
             return ESP_FAIL;
         }
-        fseek(f, 4, SEEK_SET);
-        uint32_t model_num;
-        fread(&model_num, 4, 1, f);
-        if (index >= model_num) {
-            ESP_LOGE(TAG, "The model index is out of range.");
-            fclose(f);
+        // Model names are placed between the model table and the first model data.
+        uint64_t index_size = index.size();
+        for (int i = 0; i < model_num; i++) {
+            const uint32_t *entry = (const uint32_t *)index.data() + 2 + 3 * i;
+            index_size = DL_MAX(index_size, (uint64_t)entry[1] + entry[2]);
+        }
+        if (index_size > (uint64_t)file_size) {
+            return ESP_FAIL;
+        }
+        uint32_t table_size = index.size();
+        index.resize(index_size);
+        if (index_size > table_size && fread(index.data() + table_size, index_size - table_size, 1, f) != 1) {
             return ESP_FAIL;
         }
-        fseek(f, 4 * (2 + index * 3), SEEK_SET);
-        fread(&offset, 4, 1, f);
-        fclose(f);
-        return ESP_OK;
     }
+    return ESP_OK;
 }
 
-esp_err_t get_model_offset_by_name(const char *fbs_buf,
-                                   model_location_type_t model_location,
-                                   const char *name,
-                                   uint32_t &offset)
+/**
+ * @brief Read the part of a model file in front of the first model data: the magic, the model table and the model
+ * names of a packed file. It is all get_model_num(), list_models() and load() need to locate a model.
+ */
+static esp_err_t read_sdcard_index(const char *path, std::vector<char> &index)
 {
-    if (model_location != MODEL_LOCATION_IN_SDCARD) {
-        const uint32_t *header = (const uint32_t *)fbs_buf;
-        uint32_t model_num = header[1];
-        uint32_t name_offset, name_length;
-        for (int i = 0; i < model_num; i++) {
-            name_offset = header[2 + 3 * i + 1];
-            name_length = header[2 + 3 * i + 2];
-            std::string model_name(fbs_buf + name_offset, name_length);
-            if (model_name == std::string(name)) {
-                offset = header[2 + 3 * i];
-                return ESP_OK;
-            }
-        }
-        ESP_LOGE(TAG, "Model %s is not found.", name);
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        ESP_LOGE(TAG, "Failed to open %s.", path);
         return ESP_FAIL;
-    } else {
-        FILE *f = fopen(fbs_buf, "rb");
-        if (!f) {
-            ESP_LOGE(TAG, "Failed to open %s.", fbs_buf);
-            return ESP_FAIL;
+    }
+    esp_err_t ret = read_sdcard_index(f, index);
+    fclose(f);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read the model table of %s, the file is corrupted.", path);
+        index.clear();
+    }
+    return ret;
+}
+
+/**
+ * @brief Plain models read from SD card. An entry stays in PSRAM after its last FbsModel is unloaded, and is only
+ * freed once the entries nobody uses exceed the budget, least recently used first.
+ */
+typedef struct {
+    std::string path;
+    uint32_t offset;
+    void *data;
+    uint32_t size;
+    int refs;
+    bool loading; /*<! reserved, the file is being read without the lock */
+} sdcard_cache_entry_t;
+
+static std::list<sdcard_cache_entry_t> s_sdcard_cache; // most recently used first
+static size_t s_sdcard_cache_budget = 0;
+static std::mutex s_sdcard_cache_mutex;
+static std::condition_variable s_sdcard_cache_loaded;
+
+static void sdcard_cache_evict()
+{
+    size_t idle_size = 0;
+    for (auto &entry : s_sdcard_cache) {
+        if (entry.refs == 0) {
+            idle_size += entry.size;
         }
-        fseek(f, 4, SEEK_SET);
-        uint32_t model_num;
-        fread(&model_num, 4, 1, f);
-        uint32_t name_offset, name_length;
-        for (int i = 0; i < model_num; i++) {
-            fseek(f, 4 * (2 + 3 * i + 1), SEEK_SET);
-            fread(&name_offset, 4, 1, f);
-            fread(&name_length, 4, 1, f);
-            std::string model_name(name_length, '\0');
-            fseek(f, name_offset, SEEK_SET);
-            fread(model_name.data(), name_length, 1, f);
-            if (model_name == std::string(name)) {
-                fseek(f, 4 * (2 + 3 * i), SEEK_SET);
-                fread(&offset, 4, 1, f);
-                fclose(f);
-                return ESP_OK;
-            }
+    }
+    for (auto it = s_sdcard_cache.end(); it != s_sdcard_cache.begin() && idle_size > s_sdcard_cache_budget;) {
+        --it;
+        if (it->refs == 0) {
+            idle_size -= it->size;
+            heap_caps_free(it->data);
+            it = s_sdcard_cache.erase(it);
         }
-        ESP_LOGE(TAG, "Model %s is not found.", name);
-        fclose(f);
-        return ESP_FAIL;
     }
 }
 
-FbsModel *create_fbs_model(const char *fbs_buf,
-                           fbs_file_format_t format,
-                           model_location_type_t model_location,
-                           uint32_t offset,
-                           const uint8_t *key,
-                           bool param_copy)
+static void *sdcard_cache_get(const char *path, uint32_t offset, FILE *f, uint32_t size)
 {
-    if (fbs_buf == nullptr) {
-        ESP_LOGE(TAG, "Model's flatbuffers is empty.");
-        return nullptr;
+    std::unique_lock<std::mutex> lock(s_sdcard_cache_mutex);
+    for (auto it = s_sdcard_cache.begin(); it != s_sdcard_cache.end();) {
+        if (it->offset != offset || it->path != path) {
+            ++it;
+        } else if (it->loading) {
+            // Another loader reads the same model, look again once it is done as its read may fail.
+            s_sdcard_cache_loaded.wait(lock);
+            it = s_sdcard_cache.begin();
+        } else {
+            it->refs++;
+            s_sdcard_cache.splice(s_sdcard_cache.begin(), s_sdcard_cache, it);
+            return it->data;
+        }
+    }
+    // The entry is reserved under the lock and the file is read without it. It holds a reference, so it is not
+    // evicted meanwhile.
+    s_sdcard_cache.push_front({path, offset, nullptr, size, 1, true});
+    auto entry = s_sdcard_cache.begin();
+    lock.unlock();
+
+    void *data = dl::tool::malloc_aligned(size, 1, 16, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+    if (!data) {
+        ESP_LOGE(TAG, "Failed to alloc %ld KB for the model.", size / 1024);
+    } else if (fread(data, size, 1, f) != 1) {
+        ESP_LOGE(TAG, "Failed to read the model from %s.", path);
+        heap_caps_free(data);
+        data = nullptr;
+    }
+
+    lock.lock();
+    if (data) {
+        entry->data = data;
+        entry->loading = false;
+    } else {
+        s_sdcard_cache.erase(entry);
+    }
+    s_sdcard_cache_loaded.notify_all();
+    return data;
+}
+
+static void sdcard_cache_release(void *data)
+{
+    std::lock_guard<std::mutex> lock(s_sdcard_cache_mutex);
+    for (auto &entry : s_sdcard_cache) {
+        if (entry.data == data) {
+            entry.refs--;
+            break;
+        }
+    }
+    sdcard_cache_evict();
+}
+
+void FbsLoader::unload(FbsModel *fbs_model)
+{
+    for (auto it = m_sdcard_models.begin(); it != m_sdcard_models.end(); ++it) {
+        if (it->first == fbs_model) {
+            // The model is destroyed first, it may still read the data.
+            delete fbs_model;
+            sdcard_cache_release(it->second);
+            m_sdcard_models.erase(it);
+            return;
+        }
     }
+    delete fbs_model;
+}
+
+void FbsLoader::set_sdcard_cache_budget(size_t budget)
+{
+    std::lock_guard<std::mutex> lock(s_sdcard_cache_mutex);
+    s_sdcard_cache_budget = budget;
+    sdcard_cache_evict();
+}
 
-    char *model_buf;
+FbsModel *FbsLoader::create_fbs_model(uint32_t offset, const uint8_t *key, bool param_copy)
+{
+    const char *fbs_buf = (const char *)m_fbs_buf;
+    fbs_file_format_t format = get_model_format(this->get_index());
+    model_location_type_t model_location = m_location;
+    bool edl1 = format == FBS_FILE_FORMAT_EDL1 || format == FBS_FILE_FORMAT_PDL1;
+
+    char *model_buf = nullptr;
+    FILE *f = nullptr;
     uint32_t mode, size;
     if (model_location != MODEL_LOCATION_IN_SDCARD) {
         model_buf = const_cast<char *>(fbs_buf + offset);
         uint32_t *header = (uint32_t *)model_buf;
         mode = header[1]; // cryptographic mode, 0: without encryption, 1: aes encryption
         size = header[2];
-        if (format == FBS_FILE_FORMAT_EDL1 || format == FBS_FILE_FORMAT_PDL1) {
+        if (edl1) {
             model_buf += 12;
         } else {
             model_buf += 16;
         }
     } else {
-        FILE *f = fopen(fbs_buf, "rb");
+        f = fopen(fbs_buf, "rb");
         if (!f) {
             ESP_LOGE(TAG, "Failed to open %s.", fbs_buf);
             return nullptr;
         }
         fseek(f, offset + 4, SEEK_SET);
-        fread(&mode, 4, 1, f);
-        fread(&size, 4, 1, f);
-        model_buf = (char *)dl::tool::malloc_aligned(size, 1, 16, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-        if (format == FBS_FILE_FORMAT_EDL2 || format == FBS_FILE_FORMAT_PDL2) {
+        if (fread(&mode, 4, 1, f) != 1 || fread(&size, 4, 1, f) != 1) {
+            ESP_LOGE(TAG, "Failed to read the model header from %s.", fbs_buf);
+            fclose(f);
+            return nullptr;
+        }
+        if (!edl1) {
             fseek(f, 4, SEEK_CUR);
         }
-        fread(model_buf, size, 1, f);
     }
 
     if (mode != 0 && key == NULL) {
         ESP_LOGE(TAG, "This is a cryptographic model, please enter the secret key!");
+        if (f) {
+            fclose(f);
+        }
         return nullptr;
     }
 
+    if (mode == 1 && m_cache_partition) {
+        // The decrypted model is mapped from flash like a plain model in partition.
+        FbsModel *fbs_model = load_decrypt_cache((const uint8_t *)model_buf, f, size, key, edl1 ? true : param_copy);
+        if (fbs_model) {
+            if (f) {
+                fclose(f);
+            }
+            return fbs_model;
+        }
+        ESP_LOGW(TAG, "Decrypt the model into PSRAM instead.");
+        if (f) {
+            fseek(f, offset + (edl1 ? 12 : 16), SEEK_SET);
+        }
+    }
+
+    if (model_location == MODEL_LOCATION_IN_SDCARD) {
+        if (mode == 0) {
+            // Only the requested model is read, and it is shared with the other loaders of the same model.
+            model_buf = (char *)sdcard_cache_get(fbs_buf, offset, f, size);
+        } else {
+            model_buf = (char *)dl::tool::malloc_aligned(size, 1, 16, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+            if (model_buf && fread(model_buf, size, 1, f) != 1) {
+                ESP_LOGE(TAG, "Failed to read the model from %s.", fbs_buf);
+                heap_caps_free(model_buf);
+                model_buf = nullptr;
+            }
+        }
+        fclose(f);
+        if (!model_buf) {
+            return nullptr;
+        }
+    }
+
     if (mode == 0) { // without encryption
         bool auto_free, real_param_copy;
-        if (format == FBS_FILE_FORMAT_EDL1 || format == FBS_FILE_FORMAT_PDL1) {
-            if (model_location == MODEL_LOCATION_IN_SDCARD) {
-                auto_free = true;
-                real_param_copy = true;
-            } else {
-                auto_free = false;
-                real_param_copy = true;
-            }
+        if (edl1) {
+            auto_free = false;
+            real_param_copy = true;
         } else {
             if (model_location == MODEL_LOCATION_IN_SDCARD) {
-                auto_free = true;
+                auto_free = false;
                 real_param_copy = false;
             } else {
                 auto_free = false;
@@ -286,32 +422,256 @@ FbsModel *create_fbs_model(const char *fbs_buf,
 #endif
             }
         }
-        return new FbsModel(model_buf, auto_free, real_param_copy);
+        FbsModel *fbs_model = new FbsModel(model_buf, auto_free, real_param_copy);
+        if (model_location == MODEL_LOCATION_IN_SDCARD) {
+            // The reference taken by sdcard_cache_get() is released by unload().
+            m_sdcard_models.push_back({fbs_model, model_buf});
+        }
+        return fbs_model;
     } else if (mode == 1) { // 128-bit AES encryption
-        uint8_t *m_data = (uint8_t *)dl::tool::malloc_aligned(size, 1, 16, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-        fbs_aes_crypt_ctr((const uint8_t *)model_buf, m_data, size, key);
+        uint8_t *m_data;
         if (model_location == MODEL_LOCATION_IN_SDCARD) {
-            heap_caps_free(model_buf);
+            // CTR mode can decrypt in place, the file is only held in RAM once.
+            m_data = (uint8_t *)model_buf;
+        } else {
+            m_data = (uint8_t *)dl::tool::malloc_aligned(size, 1, 16, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
         }
-        if (format == FBS_FILE_FORMAT_EDL1 || format == FBS_FILE_FORMAT_PDL1) {
+        fbs_aes_crypt_ctr((const uint8_t *)model_buf, m_data, size, key);
+        if (edl1) {
             return new FbsModel(m_data, true, true);
         } else {
             return new FbsModel(m_data, true, false);
         }
     }
 
+    if (model_location == MODEL_LOCATION_IN_SDCARD) {
+        heap_caps_free(model_buf);
+    }
     return nullptr;
 }
 
+/**
+    Decrypt cache partition:
+    {
+        char[4]:    "EDC2", written last, it commits the cache
+        uint32:     the length of data
+        uint8[32]:  the quick digest, SHA-256 of the key, the length, the first and the last block of the ciphertext,
+                    samples spread over the rest and for a model in rodata the ELF SHA-256 of the app
+        uint8[32]:  SHA-256 of the key, the length and the whole ciphertext
+        uint8[8]:   zero padding, writes into an encrypted partition are 16 bytes aligned
+        zero padding to the flash sector
+        uint8[]:    the decrypted data, zero padded to 16 bytes
+    }
+*/
+#define DECRYPT_CACHE_HEADER_SIZE (80)
+#define DECRYPT_CACHE_DATA_OFFSET (SPI_FLASH_SEC_SIZE)
+#define DECRYPT_CACHE_CHUNK_SIZE (4096)
+#define DECRYPT_CACHE_SAMPLE_NUM (16)
+#define DECRYPT_CACHE_SAMPLE_SIZE (64)
+
+static bool read_ciphertext(const uint8_t *src, FILE *f, long data_pos, uint32_t pos, uint8_t *dst, uint32_t n)
+{
+    if (src) {
+        memcpy(dst, src + pos, n);
+        return true;
+    }
+    fseek(f, data_pos + pos, SEEK_SET);
+    return fread(dst, n, 1, f) == 1;
+}
+
+static void decrypt_cache_digest_start(mbedtls_sha256_context *sha_ctx, const uint8_t *key, uint32_t size)
+{
+    mbedtls_sha256_init(sha_ctx);
+    mbedtls_sha256_starts(sha_ctx, 0);
+    mbedtls_sha256_update(sha_ctx, key, 16);
+    mbedtls_sha256_update(sha_ctx, (const uint8_t *)&size, 4);
+}
+
+/**
+ * @brief The digest checked on every load, it reads about two blocks whatever the model size. Outside rodata, where
+ * the ELF SHA-256 covers the model, a change between the samples only is not told apart.
+ */
+static bool decrypt_cache_quick_digest(const uint8_t *src,
+                                       FILE *f,
+                                       long data_pos,
+                                       uint32_t size,
+                                       const uint8_t *key,
+                                       bool rodata,
+                                       uint8_t *chunk,
+                                       uint8_t *digest)
+{
+    mbedtls_sha256_context sha_ctx;
+    decrypt_cache_digest_start(&sha_ctx, key, size);
+    uint32_t n = DL_MIN(size, (uint32_t)DECRYPT_CACHE_CHUNK_SIZE);
+    bool read_ok = read_ciphertext(src, f, data_pos, 0, chunk, n);
+    mbedtls_sha256_update(&sha_ctx, chunk, n);
+    if (read_ok && size > n) {
+        read_ok = read_ciphertext(src, f, data_pos, size - n, chunk, n);
+        mbedtls_sha256_update(&sha_ctx, chunk, n);
+    }
+    // Retrained weights of the same size change the middle of the model only.
+    for (uint32_t i = 1; i <= DECRYPT_CACHE_SAMPLE_NUM && read_ok && size > 2 * n; i++) {
+        uint32_t pos = (uint64_t)size * i / (DECRYPT_CACHE_SAMPLE_NUM + 1);
+        uint32_t sample_size = DL_MIN(size - pos, (uint32_t)DECRYPT_CACHE_SAMPLE_SIZE);
+        read_ok = read_ciphertext(src, f, data_pos, pos, chunk, sample_size);
+        mbedtls_sha256_update(&sha_ctx, chunk, sample_size);
+    }
+    if (rodata) {
+        char elf_sha256[65] = {0};
+        esp_app_get_elf_sha256(elf_sha256, sizeof(elf_sha256));
+        mbedtls_sha256_update(&sha_ctx, (const uint8_t *)elf_sha256, 64);
+    }
+    mbedtls_sha256_finish(&sha_ctx, digest);
+    mbedtls_sha256_free(&sha_ctx);
+    return read_ok;
+}
+
+static bool decrypt_cache_full_digest(
+    const uint8_t *src, FILE *f, long data_pos, uint32_t size, const uint8_t *key, uint8_t *chunk, uint8_t *digest)
+{
+    mbedtls_sha256_context sha_ctx;
+    decrypt_cache_digest_start(&sha_ctx, key, size);
+    bool read_ok = true;
+    for (uint32_t pos = 0; pos < size && read_ok; pos += DECRYPT_CACHE_CHUNK_SIZE) {
+        uint32_t n = DL_MIN(size - pos, (uint32_t)DECRYPT_CACHE_CHUNK_SIZE);
+        read_ok = read_ciphertext(src, f, data_pos, pos, chunk, n);
+        mbedtls_sha256_update(&sha_ctx, chunk, n);
+    }
+    mbedtls_sha256_finish(&sha_ctx, digest);
+    mbedtls_sha256_free(&sha_ctx);
+    return read_ok;
+}
+
+FbsModel *FbsLoader::load_decrypt_cache(const uint8_t *src, FILE *f, uint32_t size, const uint8_t *key, bool param_copy)
+{
+    if (m_cache_mapped) {
+        ESP_LOGW(TAG, "The decrypt cache is used by another model of this loader.");
+        return nullptr;
+    }
+    // The last chunk is written 16 bytes aligned.
+    uint32_t cache_size = DECRYPT_CACHE_DATA_OFFSET + ((size + 15) & ~15);
+    if (cache_size > m_cache_partition->size) {
+        ESP_LOGE(TAG,
+                 "The model needs %ld KB, the decrypt cache partition %s only has %ld KB.",
+                 cache_size / 1024,
+                 m_cache_partition->label,
+                 m_cache_partition->size / 1024);
+        return nullptr;
+    }
+
+    uint8_t *chunk = (uint8_t *)heap_caps_malloc(DECRYPT_CACHE_CHUNK_SIZE, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+    if (!chunk) {
+        ESP_LOGE(TAG, "Failed to alloc the decrypt buffer.");
+        return nullptr;
+    }
+    long data_pos = f ? ftell(f) : 0;
+
+    uint8_t header[DECRYPT_CACHE_HEADER_SIZE] = {0};
+    memcpy(header, "EDC2", 4);
+    memcpy(header + 4, &size, 4);
+    if (!decrypt_cache_quick_digest(
+            src, f, data_pos, size, key, m_location == MODEL_LOCATION_IN_FLASH_RODATA, chunk, header + 8)) {
+        ESP_LOGE(TAG, "Failed to read the encrypted model.");
+        heap_caps_free(chunk);
+        return nullptr;
+    }
+
+    const void *cache_buf = nullptr;
+    esp_err_t ret = esp_partition_mmap(
+        m_cache_partition, 0, cache_size, ESP_PARTITION_MMAP_DATA, &cache_buf, &m_cache_mmap_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map the decrypt cache partition %s.", m_cache_partition->label);
+        heap_caps_free(chunk);
+        return nullptr;
+    }
+
+    if (memcmp(cache_buf, header, 40) != 0) {
+        // The whole ciphertext is only hashed when the quick digest misses, e.g. after an update of the app that did
+        // not change the model. Then only the header sector is written again.
+        bool read_ok = decrypt_cache_full_digest(src, f, data_pos, size, key, chunk, header + 40);
+        const uint8_t *cache_header = (const uint8_t *)cache_buf;
+        bool data_valid =
+            read_ok && memcmp(cache_header, header, 8) == 0 && memcmp(cache_header + 40, header + 40, 32) == 0;
+        if (!read_ok) {
+            ret = ESP_FAIL;
+        } else if (data_valid) {
+            ret = esp_partition_erase_range(m_cache_partition, 0, DECRYPT_CACHE_DATA_OFFSET);
+        } else {
+            ESP_LOGI(TAG, "Fill the decrypt cache partition %s.", m_cache_partition->label);
+            uint32_t erase_size = (cache_size + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+            erase_size = DL_MIN(erase_size, (uint32_t)m_cache_partition->size);
+            ret = esp_partition_erase_range(m_cache_partition, 0, erase_size);
+
+            mbedtls_aes_context aes_ctx;
+            size_t nc_off = 0;
+            uint8_t nonce[16] = {
+                0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F};
+            uint8_t stream_block[16];
+            mbedtls_aes_init(&aes_ctx);
+            mbedtls_aes_setkey_enc(&aes_ctx, key, 128);
+            for (uint32_t pos = 0; pos < size && ret == ESP_OK; pos += DECRYPT_CACHE_CHUNK_SIZE) {
+                uint32_t n = DL_MIN(size - pos, (uint32_t)DECRYPT_CACHE_CHUNK_SIZE);
+                if (!read_ciphertext(src, f, data_pos, pos, chunk, n)) {
+                    ret = ESP_FAIL;
+                    break;
+                }
+                mbedtls_aes_crypt_ctr(&aes_ctx, n, &nc_off, nonce, stream_block, chunk, chunk);
+                // Writes into an encrypted partition have to be 16 bytes aligned.
+                uint32_t n_align = (n + 15) & ~15;
+                memset(chunk + n, 0, n_align - n);
+                ret = esp_partition_write(m_cache_partition, DECRYPT_CACHE_DATA_OFFSET + pos, chunk, n_align);
+            }
+            mbedtls_aes_free(&aes_ctx);
+        }
+        if (ret == ESP_OK) {
+            ret = esp_partition_write(m_cache_partition, 0, header, DECRYPT_CACHE_HEADER_SIZE);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to write the decrypt cache partition %s.", m_cache_partition->label);
+            esp_partition_munmap(m_cache_mmap_handle);
+            heap_caps_free(chunk);
+            return nullptr;
+        }
+    }
+    heap_caps_free(chunk);
+
+    m_cache_mapped = true;
+    return new FbsModel((const uint8_t *)cache_buf + DECRYPT_CACHE_DATA_OFFSET, false, param_copy);
+}
+
+esp_err_t FbsLoader::set_decrypt_cache(const char *partition_label)
+{
+    const esp_partition_t *partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition_label);
+    if (!partition) {
+        ESP_LOGE(TAG, "Can not find %s in partition table", partition_label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (!partition->encrypted) {
+        ESP_LOGE(TAG, "The decrypt cache partition %s must be encrypted.", partition_label);
+        return ESP_ERR_INVALID_ARG;
+    }
+    m_cache_partition = partition;
+    return ESP_OK;
+}
+
 FbsLoader::FbsLoader(const char *name, model_location_type_t location) :
-    m_mmap_handle(nullptr), m_location(location), m_fbs_buf(nullptr)
+    m_mmap_handle(nullptr),
+    m_location(location),
+    m_fbs_buf(nullptr),
+    m_cache_partition(nullptr),
+    m_cache_mapped(false)
 {
     if (name == nullptr) {
         return;
     }
 
-    if (m_location == MODEL_LOCATION_IN_FLASH_RODATA || m_location == MODEL_LOCATION_IN_SDCARD) {
+    if (m_location == MODEL_LOCATION_IN_FLASH_RODATA) {
         m_fbs_buf = (const void *)name;
+    } else if (m_location == MODEL_LOCATION_IN_SDCARD) {
+        if (read_sdcard_index(name, m_sdcard_index) == ESP_OK) {
+            m_fbs_buf = (const void *)name;
+        }
     } else if (m_location == MODEL_LOCATION_IN_FLASH_PARTITION) {
         const esp_partition_t *partition =
             esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, name);
@@ -347,6 +707,13 @@ FbsLoader::~FbsLoader()
             this->m_mmap_handle = nullptr;
         }
     }
+    if (m_cache_mapped) {
+        esp_partition_munmap(m_cache_mmap_handle);
+        m_cache_mapped = false;
+    }
+    for (auto &model : m_sdcard_models) {
+        sdcard_cache_release(model.second);
+    }
 }
 
 FbsModel *FbsLoader::load(const int model_index, const uint8_t *key, bool param_copy)
@@ -357,10 +724,10 @@ FbsModel *FbsLoader::load(const int model_index, const uint8_t *key, bool param_
     }
 
     uint32_t offset = 0;
-    fbs_file_format_t format = get_model_format((const char *)m_fbs_buf, m_location);
+    fbs_file_format_t format = get_model_format(this->get_index());
     if (format == FBS_FILE_FORMAT_PDL1 || format == FBS_FILE_FORMAT_PDL2) {
         // packed multiple espdl models
-        if (get_model_offset_by_index((const char *)m_fbs_buf, m_location, model_index, offset) != ESP_OK) {
+        if (get_model_offset_by_index(this->get_index(), model_index, offset) != ESP_OK) {
             return nullptr;
         }
     } else if (format == FBS_FILE_FORMAT_EDL1 || format == FBS_FILE_FORMAT_EDL2) {
@@ -373,7 +740,7 @@ FbsModel *FbsLoader::load(const int model_index, const uint8_t *key, bool param_
         ESP_LOGE(TAG, "Unsupported format, or the model file is corrupted!");
         return nullptr;
     }
-    return create_fbs_model((const char *)m_fbs_buf, format, m_location, offset, key, param_copy);
+    return this->create_fbs_model(offset, key, param_copy);
 }
 
 FbsModel *FbsLoader::load(const uint8_t *key, bool param_copy)
@@ -389,10 +756,10 @@ FbsModel *FbsLoader::load(const char *model_name, const uint8_t *key, bool param
     }
 
     uint32_t offset = 0;
-    fbs_file_format_t format = get_model_format((const char *)m_fbs_buf, m_location);
+    fbs_file_format_t format = get_model_format(this->get_index());
     if (format == FBS_FILE_FORMAT_PDL1 || format == FBS_FILE_FORMAT_PDL2) {
         // packed multiple espdl models
-        if (get_model_offset_by_name((const char *)m_fbs_buf, m_location, model_name, offset) != ESP_OK) {
+        if (get_model_offset_by_name(this->get_index(), model_name, offset) != ESP_OK) {
             return nullptr;
         }
     } else if (format == FBS_FILE_FORMAT_EDL1 || format == FBS_FILE_FORMAT_EDL2) {
@@ -405,7 +772,7 @@ FbsModel *FbsLoader::load(const char *model_name, const uint8_t *key, bool param
         ESP_LOGE(TAG, "Unsupported format, or the model file is corrupted!");
         return nullptr;
     }
-    return create_fbs_model((const char *)m_fbs_buf, format, m_location, offset, key, param_copy);
+    return this->create_fbs_model(offset, key, param_copy);
 }
 
 int FbsLoader::get_model_num()
@@ -414,23 +781,11 @@ int FbsLoader::get_model_num()
         return 0;
     }
 
-    fbs_file_format_t format = get_model_format((const char *)m_fbs_buf, m_location);
+    fbs_file_format_t format = get_model_format(this->get_index());
     if (format == FBS_FILE_FORMAT_PDL1 || format == FBS_FILE_FORMAT_PDL2) {
         // packed multiple espdl models
-        uint32_t model_num;
-        if (m_location != MODEL_LOCATION_IN_SDCARD) {
-            uint32_t *header = (uint32_t *)m_fbs_buf;
-            model_num = header[1];
-        } else {
-            FILE *f = fopen((const char *)m_fbs_buf, "rb");
-            if (!f) {
-                ESP_LOGE(TAG, "Failed to open %s.", (const char *)m_fbs_buf);
-                return 0;
-            }
-            fseek(f, 4, SEEK_SET);
-            fread(&model_num, 4, 1, f);
-            fclose(f);
-        }
+        uint32_t *header = (uint32_t *)this->get_index();
+        uint32_t model_num = header[1];
         return model_num;
     } else if (format == FBS_FILE_FORMAT_EDL1 || format == FBS_FILE_FORMAT_EDL2) {
         // single espdl model
@@ -450,38 +805,17 @@ void FbsLoader::list_models()
         return;
     }
 
-    fbs_file_format_t format = get_model_format((const char *)m_fbs_buf, m_location);
+    fbs_file_format_t format = get_model_format(this->get_index());
     if (format == FBS_FILE_FORMAT_PDL1 || format == FBS_FILE_FORMAT_PDL2) {
         // packed multiple espdl models
-        if (m_location != MODEL_LOCATION_IN_SDCARD) {
-            uint32_t *header = (uint32_t *)m_fbs_buf;
-            uint32_t model_num = header[1];
-            for (int i = 0; i < model_num; i++) {
-                uint32_t name_offset = header[2 + 3 * i + 1];
-                uint32_t name_length = header[2 + 3 * i + 2];
-                std::string name((const char *)m_fbs_buf + name_offset, name_length);
-                ESP_LOGI(TAG, "model name: %s, index:%d", name.c_str(), i);
-            }
-        } else {
-            FILE *f = fopen((const char *)m_fbs_buf, "rb");
-            if (!f) {
-                ESP_LOGE(TAG, "Failed to open %s.", (const char *)m_fbs_buf);
-                return;
-            }
-            fseek(f, 4, SEEK_SET);
-            uint32_t model_num;
-            fread(&model_num, 4, 1, f);
-            uint32_t name_offset, name_length;
-            for (int i = 0; i < model_num; i++) {
-                fseek(f, 4 * (2 + 3 * i + 1), SEEK_SET);
-                fread(&name_offset, 4, 1, f);
-                fread(&name_length, 4, 1, f);
-                std::string name(name_length, '\0');
-                fseek(f, name_offset, SEEK_SET);
-                fread(name.data(), name_length, 1, f);
-                ESP_LOGI(TAG, "model name: %s, index:%d", name.c_str(), i);
-            }
-            fclose(f);
+        const char *index = this->get_index();
+        const uint32_t *header = (const uint32_t *)index;
+        uint32_t model_num = header[1];
+        for (int i = 0; i < model_num; i++) {
+            uint32_t name_offset = header[2 + 3 * i + 1];
+            uint32_t name_length = header[2 + 3 * i + 2];
+            std::string name(index + name_offset, name_length);
+            ESP_LOGI(TAG, "model name: %s, index:%d", name.c_str(), i);
         }
     } else if (format == FBS_FILE_FORMAT_EDL1 || format == FBS_FILE_FORMAT_EDL2) {
         ESP_LOGI(TAG, "There is only one model in the flatbuffers without model name.");
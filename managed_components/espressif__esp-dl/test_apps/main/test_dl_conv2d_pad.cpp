@@ -0,0 +1,107 @@
+#include "dl_base_conv2d.hpp"
+#include "unity.h"
+#include <vector>
+
+namespace {
+constexpr uint8_t GUARD = 0x5a;
+constexpr int GUARD_ELEMENTS = 64;
+
+// Element (k, i) of output channel j in the boosted layout, [N / u, H, W, C, u] then [N % u, H, W, C].
+template <typename T>
+T packed_at(const T *filter, int hw, int c, int n, int j, int k, int i)
+{
+    int u = 16 / sizeof(T);
+    int panels = n / u * u;
+    if (j < panels) {
+        return filter[(j / u) * hw * c * u + (k * c + i) * u + j % u];
+    }
+    return filter[j * hw * c + k * c + i];
+}
+
+template <typename T>
+void pack(T *filter, const std::vector<T> &plain, int hw, int c, int n)
+{
+    int u = 16 / sizeof(T);
+    int panels = n / u * u;
+    for (int j = 0; j < n; j++) {
+        for (int k = 0; k < hw; k++) {
+            for (int i = 0; i < c; i++) {
+                T value = plain[(j * hw + k) * c + i];
+                if (j < panels) {
+                    filter[(j / u) * hw * c * u + (k * c + i) * u + j % u] = value;
+                } else {
+                    filter[j * hw * c + k * c + i] = value;
+                }
+            }
+        }
+    }
+}
+
+// One output pixel of the conv, the patch holds hw pixels of c channels.
+template <typename T>
+int64_t conv_at(const T *filter, const T *patch, int hw, int c, int n, int j)
+{
+    int64_t acc = 0;
+    for (int k = 0; k < hw; k++) {
+        for (int i = 0; i < c; i++) {
+            acc += (int64_t)patch[k * c + i] * packed_at(filter, hw, c, n, j, k, i);
+        }
+    }
+    return acc;
+}
+
+template <typename T>
+void test_pad_filter(int hw, int c, int n, int padded_c, int padded_n)
+{
+    std::vector<T> plain(hw * c * n);
+    for (auto &v : plain) {
+        v = (T)(rand() % 255 - 127);
+    }
+    std::vector<T> filter(hw * c * n);
+    pack(filter.data(), plain, hw, c, n);
+
+    size_t padded_size = hw * padded_c * padded_n;
+    std::vector<T> padded(padded_size + GUARD_ELEMENTS, 0);
+    memset(padded.data() + padded_size, GUARD, GUARD_ELEMENTS * sizeof(T));
+    dl::base::conv2d_pad_filter(padded.data(), filter.data(), hw, c, n, padded_c, padded_n);
+    for (size_t i = padded_size * sizeof(T); i < padded.size() * sizeof(T); i++) {
+        TEST_ASSERT_EQUAL_MESSAGE(GUARD, ((uint8_t *)padded.data())[i], "write past the padded filter");
+    }
+
+    // The padded input channels hold garbage, which the zero weights must ignore.
+    for (int t = 0; t < 8; t++) {
+        std::vector<T> patch(hw * c);
+        std::vector<T> padded_patch(hw * padded_c);
+        for (auto &v : padded_patch) {
+            v = (T)(rand() % 255 - 127);
+        }
+        for (int k = 0; k < hw; k++) {
+            for (int i = 0; i < c; i++) {
+                patch[k * c + i] = padded_patch[k * padded_c + i];
+            }
+        }
+        for (int j = 0; j < padded_n; j++) {
+            int64_t expected = j < n ? conv_at(filter.data(), patch.data(), hw, c, n, j) : 0;
+            int64_t actual = conv_at(padded.data(), padded_patch.data(), hw, padded_c, padded_n, j);
+            TEST_ASSERT_EQUAL_MESSAGE(expected, actual, "padded conv differs from the unpadded one");
+        }
+    }
+}
+} // namespace
+
+TEST_CASE("conv2d_pad_filter pads the input channels of unaligned output channels", "[dl_base]")
+{
+    // The output channels stay unaligned, the N % u tail keeps the [N % u, H, W, C] layout.
+    test_pad_filter<int8_t>(9, 5, 20, 16, 20);
+    test_pad_filter<int8_t>(1, 3, 7, 16, 7);
+    test_pad_filter<int16_t>(9, 5, 20, 8, 20);
+    test_pad_filter<int16_t>(9, 13, 3, 16, 3);
+}
+
+TEST_CASE("conv2d_pad_filter pads the output channels to whole panels", "[dl_base]")
+{
+    test_pad_filter<int8_t>(9, 5, 20, 16, 32);
+    test_pad_filter<int8_t>(9, 16, 20, 16, 32);
+    test_pad_filter<int16_t>(9, 5, 20, 8, 24);
+    test_pad_filter<int16_t>(1, 8, 3, 8, 8);
+}
@@ -0,0 +1,94 @@
+#include "dl_image_process.hpp"
+#include "unity.h"
+#include <vector>
+
+using namespace dl;
+using namespace dl::image;
+
+namespace {
+const int SRC_W = 320;
+const int SRC_H = 240;
+const int ALIGN_SIZE = 112;
+
+// The template of FeatImagePreprocessor for a 112x112 input.
+const float STD_LANDMARKS_112[10] = {
+    38.2946, 51.6963, 41.5493, 92.3655, 56.0252, 71.7366, 73.5318, 51.5014, 70.7299, 92.2041};
+
+// Landmarks of a face at (x, y) of the given size, rotated by roll degrees.
+std::vector<int> face_landmarks(float x, float y, float size, float roll)
+{
+    float c = cosf(roll * M_PI / 180), s = sinf(roll * M_PI / 180);
+    std::vector<int> landmarks(10);
+    for (int i = 0; i < 5; i++) {
+        float u = (STD_LANDMARKS_112[2 * i] - 56) * size / 112;
+        float v = (STD_LANDMARKS_112[2 * i + 1] - 56) * size / 112;
+        landmarks[2 * i] = (int)lroundf(x + c * u - s * v);
+        landmarks[2 * i + 1] = (int)lroundf(y + s * u + c * v);
+    }
+    return landmarks;
+}
+
+math::Matrix<float> get_M_inv(const std::vector<int> &landmarks)
+{
+    math::Matrix<float> source_coord(5, 2);
+    math::Matrix<float> dest_coord(5, 2);
+    dest_coord.set_value(landmarks);
+    for (int i = 0; i < 5; i++) {
+        source_coord.array[i][0] = STD_LANDMARKS_112[2 * i];
+        source_coord.array[i][1] = STD_LANDMARKS_112[2 * i + 1];
+    }
+    return math::get_similarity_transform(source_coord, dest_coord);
+}
+
+// All the faces aligned in one warp_affine_batch() must match the faces aligned one by one, whichever core and half of
+// the batch takes them.
+void test_align(pix_type_t src_type, pix_type_t dst_type, interpolate_type_t interpolate_type, int num_faces)
+{
+    img_t src = {nullptr, SRC_W, SRC_H, src_type};
+    size_t src_bytes = get_img_byte_size(src);
+    src.data = tool::malloc_aligned(src_bytes, 1, 16, MALLOC_CAP_DEFAULT);
+    for (int i = 0; i < src_bytes; i++) {
+        ((uint8_t *)src.data)[i] = (i * 7 + i / (SRC_W * 3) * 13) & 0xff;
+    }
+
+    std::vector<math::Matrix<float>> M_invs;
+    M_invs.reserve(num_faces);
+    std::vector<math::Matrix<float> *> M_inv_ptrs;
+    for (int i = 0; i < num_faces; i++) {
+        // faces partly out of the frame too, the border is clamped.
+        M_invs.push_back(get_M_inv(face_landmarks(20 + i * 300 / num_faces, 40 + i * 17, 60 + i * 9, i * 11 - 20)));
+        M_inv_ptrs.push_back(&M_invs.back());
+    }
+
+    img_t dst = {nullptr, ALIGN_SIZE, ALIGN_SIZE, dst_type};
+    size_t dst_bytes = get_img_byte_size(dst);
+    uint8_t *batch = (uint8_t *)tool::malloc_aligned(dst_bytes * num_faces, 1, 16, MALLOC_CAP_DEFAULT);
+    uint8_t *face = (uint8_t *)tool::malloc_aligned(dst_bytes, 1, 16, MALLOC_CAP_DEFAULT);
+    std::vector<img_t> dst_imgs(num_faces, dst);
+    for (int i = 0; i < num_faces; i++) {
+        dst_imgs[i].data = batch + i * dst_bytes;
+    }
+    warp_affine_batch(src, dst_imgs, interpolate_type, M_inv_ptrs, 0, nullptr, RUNTIME_MODE_MULTI_CORE);
+
+    for (int i = 0; i < num_faces; i++) {
+        img_t face_img = dst;
+        face_img.data = face;
+        warp_affine(src, face_img, interpolate_type, M_inv_ptrs[i], 0, nullptr, RUNTIME_MODE_SINGLE_CORE);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(face, batch + i * dst_bytes, dst_bytes, "batched face differs");
+    }
+    heap_caps_free(src.data);
+    heap_caps_free(batch);
+    heap_caps_free(face);
+}
+} // namespace
+
+TEST_CASE("Batched face alignment matches the faces aligned one by one", "[dl_image]")
+{
+    for (int num_faces : {1, 2, 5}) {
+        test_align(DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_INTERPOLATE_NEAREST, num_faces);
+        test_align(DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_INTERPOLATE_BILINEAR, num_faces);
+        test_align(DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_INTERPOLATE_NEAREST, num_faces);
+        test_align(DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_INTERPOLATE_BILINEAR, num_faces);
+        test_align(DL_IMAGE_PIX_TYPE_GRAY, DL_IMAGE_PIX_TYPE_GRAY, DL_IMAGE_INTERPOLATE_BILINEAR, num_faces);
+    }
+}
@@ -0,0 +1,254 @@
+#include "dl_module_add.hpp"
+#include "dl_module_concat.hpp"
+#include "dl_module_conv.hpp"
+#include "dl_module_gemm.hpp"
+#include "dl_module_identity.hpp"
+#include "dl_module_relu.hpp"
+#include "dl_module_requantize_linear.hpp"
+#include "unity.h"
+#include <vector>
+
+using namespace dl;
+
+namespace {
+template <typename T>
+TensorBase *random_tensor(const std::vector<int> &shape, int exponent, int limit)
+{
+    TensorBase *tensor =
+        new TensorBase(shape, nullptr, exponent, sizeof(T) == 1 ? DATA_TYPE_INT8 : DATA_TYPE_INT16, true);
+    T *ptr = (T *)tensor->get_element_ptr();
+    for (int i = 0; i < tensor->get_size(); i++) {
+        ptr[i] = rand() % (2 * limit + 1) - limit;
+    }
+    return tensor;
+}
+
+template <typename T>
+quant_type_t get_quant_type()
+{
+    return sizeof(T) == 1 ? QUANT_TYPE_SYMM_8BIT : QUANT_TYPE_SYMM_16BIT;
+}
+
+// Inputs small enough for the 20-bit lanes of the int8 kernels, see base::gemm().
+template <typename T>
+int get_limit()
+{
+    return sizeof(T) == 1 ? 15 : 1000;
+}
+
+template <typename T>
+module::Conv2D *new_conv(TensorBase *filter)
+{
+    return new module::Conv2D(new TensorBase(filter->shape, filter->data, filter->exponent, filter->dtype, true),
+                              nullptr,
+                              Linear,
+                              {0, 0, 0, 0},
+                              1,
+                              1,
+                              1,
+                              1,
+                              "conv",
+                              1,
+                              get_quant_type<T>());
+}
+
+template <typename T>
+module::Gemm *new_gemm(TensorBase *filter)
+{
+    return new module::Gemm(new TensorBase(filter->shape, filter->data, filter->exponent, filter->dtype, true),
+                            nullptr,
+                            Linear,
+                            "gemm",
+                            get_quant_type<T>());
+}
+
+// The producer followed by Relu, if relu, and by a RequantizeLinear keeping the exponent, each module writing a
+// tensor of its own as the graph runs them, must be bit-exact with the producer as Model::fuse_modules() leaves it:
+// applying the Relu itself, followed by the Identity modules replacing the folded ones in its output.
+template <typename T>
+void test_fuse(
+    module::Module *unfused, module::Module *fused, std::vector<TensorBase *> inputs, int exponent, bool relu)
+{
+    quant_type_t quant_type = get_quant_type<T>();
+    dtype_t dtype = sizeof(T) == 1 ? DATA_TYPE_INT8 : DATA_TYPE_INT16;
+    std::vector<std::vector<int>> input_shapes;
+    std::vector<int> inputs_index;
+    for (int i = 0; i < inputs.size(); i++) {
+        input_shapes.push_back(inputs[i]->shape);
+        inputs_index.push_back(i);
+    }
+    std::vector<int> output_shape = unfused->get_output_shape(input_shapes)[0];
+    fused->get_output_shape(input_shapes);
+    int n = inputs.size();
+
+    std::vector<TensorBase *> graph(inputs);
+    for (int i = 0; i < 3; i++) {
+        graph.push_back(new TensorBase(output_shape, nullptr, exponent, dtype, true));
+    }
+    module::Relu relu_module("relu", MODULE_NON_INPLACE, quant_type);
+    module::RequantizeLinear requantize("requantize", MODULE_NON_INPLACE, quant_type);
+    unfused->m_inputs_index = inputs_index;
+    unfused->m_outputs_index = {n};
+    relu_module.m_inputs_index = {n};
+    relu_module.m_outputs_index = {n + 1};
+    requantize.m_inputs_index = {relu ? n + 1 : n};
+    requantize.m_outputs_index = {n + 2};
+    unfused->forward(graph, RUNTIME_MODE_SINGLE_CORE);
+    if (relu) {
+        relu_module.forward(graph, RUNTIME_MODE_SINGLE_CORE);
+    }
+    requantize.forward(graph, RUNTIME_MODE_SINGLE_CORE);
+
+    if (relu) {
+        TEST_ASSERT_TRUE(fused->fuse_activation(ReLU));
+    }
+    TensorBase *output = new TensorBase(output_shape, nullptr, exponent, dtype, true);
+    std::vector<TensorBase *> plan(inputs);
+    plan.push_back(output);
+    module::Identity identity("identity", MODULE_INPLACE_UNCHANGED_BUFFER, quant_type);
+    identity.m_inputs_index = {n};
+    identity.m_outputs_index = {n};
+    fused->m_inputs_index = inputs_index;
+    fused->m_outputs_index = {n};
+    fused->forward(plan, RUNTIME_MODE_SINGLE_CORE);
+    for (int i = 0; i < (relu ? 2 : 1); i++) {
+        identity.forward(plan, RUNTIME_MODE_SINGLE_CORE);
+    }
+    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(
+        graph[n + 2]->get_element_ptr(), output->get_element_ptr(), output->get_bytes(), "fused output differs");
+
+    for (int i = n; i < graph.size(); i++) {
+        delete graph[i];
+    }
+    delete output;
+    delete unfused;
+    delete fused;
+}
+
+template <typename T>
+void test_fuse_conv(bool relu)
+{
+    TensorBase *input = random_tensor<T>({1, 8, 8, 16}, -5, get_limit<T>());
+    TensorBase *filter = random_tensor<T>({3, 3, 16, 32}, -6, get_limit<T>());
+    // Shifted by 4, some outputs saturate.
+    test_fuse<T>(new_conv<T>(filter), new_conv<T>(filter), {input}, -7, relu);
+    delete input;
+    delete filter;
+}
+
+template <typename T>
+void test_fuse_gemm(bool relu)
+{
+    TensorBase *input = random_tensor<T>({4, 64}, -5, get_limit<T>());
+    TensorBase *filter = random_tensor<T>({1, 1, 64, 32}, -6, get_limit<T>());
+    test_fuse<T>(new_gemm<T>(filter), new_gemm<T>(filter), {input}, -7, relu);
+    delete input;
+    delete filter;
+}
+
+// Add has no activation, only the RequantizeLinear is folded.
+template <typename T>
+void test_fuse_add()
+{
+    TensorBase *input0 = random_tensor<T>({1, 6, 6, 16}, -4, sizeof(T) == 1 ? 127 : 32767);
+    TensorBase *input1 = random_tensor<T>({1, 6, 6, 16}, -6, sizeof(T) == 1 ? 127 : 32767);
+    quant_type_t quant_type = get_quant_type<T>();
+    test_fuse<T>(new module::Add("add", MODULE_NON_INPLACE, quant_type),
+                 new module::Add("add", MODULE_NON_INPLACE, quant_type),
+                 {input0, input1},
+                 -4,
+                 false);
+    delete input0;
+    delete input1;
+}
+
+// Conv producers writing the output of Concat at the view offset of their input must leave the same output as
+// Concat copying them, and Concat must keep it as it is.
+template <typename T>
+void test_concat_view(const std::vector<int> &heights, int axis, bool is_view)
+{
+    quant_type_t quant_type = get_quant_type<T>();
+    dtype_t dtype = sizeof(T) == 1 ? DATA_TYPE_INT8 : DATA_TYPE_INT16;
+    TensorBase *filter = random_tensor<T>({3, 3, 16, 16}, -6, get_limit<T>());
+    module::Concat concat("concat", axis, quant_type);
+    std::vector<module::Conv2D *> convs;
+    std::vector<TensorBase *> conv_inputs;
+    std::vector<std::vector<int>> input_shapes;
+    for (int h : heights) {
+        convs.push_back(new_conv<T>(filter));
+        conv_inputs.push_back(random_tensor<T>({1, h, 4, 16}, -5, get_limit<T>()));
+        std::vector<std::vector<int>> conv_input_shapes(1, conv_inputs.back()->shape);
+        input_shapes.push_back(convs.back()->get_output_shape(conv_input_shapes)[0]);
+    }
+    std::vector<int> output_shape = concat.get_output_shape(input_shapes)[0];
+
+    // Every producer writes a tensor of its own, then Concat copies them.
+    TensorBase reference(output_shape, nullptr, -7, dtype, true);
+    std::vector<TensorBase *> tensors;
+    std::vector<TensorBase *> view_tensors;
+    TensorBase output(output_shape, nullptr, -7, dtype, true);
+    for (int i = 0; i < heights.size(); i++) {
+        tensors.push_back(new TensorBase(input_shapes[i], nullptr, -7, dtype, true));
+        int offset = concat.get_input_view_offset(i, input_shapes);
+        TEST_ASSERT_EQUAL(is_view, offset >= 0);
+        if (offset >= 0) {
+            view_tensors.push_back(
+                new TensorBase(input_shapes[i], (T *)output.get_element_ptr() + offset, -7, dtype, false));
+        }
+    }
+    tensors.push_back(&reference);
+    concat.m_outputs_index = {(int)heights.size()};
+    for (int i = 0; i < heights.size(); i++) {
+        std::vector<TensorBase *> conv_tensors = {conv_inputs[i], tensors[i]};
+        convs[i]->m_inputs_index = {0};
+        convs[i]->m_outputs_index = {1};
+        convs[i]->forward(conv_tensors, RUNTIME_MODE_SINGLE_CORE);
+        concat.m_inputs_index.push_back(i);
+    }
+    concat.forward(tensors, RUNTIME_MODE_SINGLE_CORE);
+
+    if (is_view) {
+        for (int i = 0; i < heights.size(); i++) {
+            std::vector<TensorBase *> conv_tensors = {conv_inputs[i], view_tensors[i]};
+            convs[i]->forward(conv_tensors, RUNTIME_MODE_SINGLE_CORE);
+        }
+        view_tensors.push_back(&output);
+        concat.forward(view_tensors, RUNTIME_MODE_SINGLE_CORE);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(reference.get_element_ptr(),
+                                         output.get_element_ptr(),
+                                         output.get_bytes(),
+                                         "written in place differs from the copied");
+        view_tensors.pop_back();
+    }
+    for (int i = 0; i < heights.size(); i++) {
+        delete convs[i];
+        delete conv_inputs[i];
+        delete tensors[i];
+    }
+    for (TensorBase *view : view_tensors) {
+        delete view;
+    }
+    delete filter;
+}
+} // namespace
+
+TEST_CASE("Relu and RequantizeLinear fused into Conv, Gemm and Add are bit-exact", "[dl_module]")
+{
+    for (bool relu : {false, true}) {
+        test_fuse_conv<int8_t>(relu);
+        test_fuse_conv<int16_t>(relu);
+        test_fuse_gemm<int8_t>(relu);
+        test_fuse_gemm<int16_t>(relu);
+    }
+    test_fuse_add<int8_t>();
+    test_fuse_add<int16_t>();
+}
+
+TEST_CASE("Concat inputs written at their view offset", "[dl_module]")
+{
+    test_concat_view<int8_t>({4, 5, 3}, 1, true);
+    test_concat_view<int8_t>({6, 6}, -3, true);
+    test_concat_view<int16_t>({4, 7}, 1, true);
+    // The inputs are interleaved along the last axis.
+    test_concat_view<int8_t>({4, 4}, 3, false);
+}
@@ -0,0 +1,228 @@
+#include "dl_base_gemm.hpp"
+#include "dl_module_matmul.hpp"
+#include "esp_timer.h"
+#include "unity.h"
+#include <cmath>
+#include <vector>
+
+using namespace dl;
+
+namespace {
+template <typename T>
+T *random_elements(int size, int limit)
+{
+    T *ptr = (T *)tool::malloc_aligned(size, sizeof(T), 16, MALLOC_CAP_DEFAULT);
+    for (int i = 0; i < size; i++) {
+        ptr[i] = rand() % (2 * limit + 1) - limit;
+    }
+    return ptr;
+}
+
+// activation((input * filter + bias) >> mac_shift), rounded half to even and saturated.
+template <typename T>
+int reference(const T *input,
+              const T *filter,
+              const void *bias,
+              int i,
+              int j,
+              int n,
+              int k,
+              int mac_shift,
+              activation_type_t activation)
+{
+    double acc = 0;
+    if (bias) {
+        acc = sizeof(T) == 1 ? ((const int32_t *)bias)[j] : ((const int64_t *)bias)[j];
+    }
+    for (int c = 0; c < k; c++) {
+        acc += (double)input[i * k + c] * filter[c * n + j];
+    }
+    double value = std::nearbyint(std::ldexp(acc, -mac_shift));
+    if (activation == ReLU && value < 0) {
+        value = 0;
+    }
+    double limit = sizeof(T) == 1 ? 127 : 32767;
+    return (int)std::fmax(-limit - 1, std::fmin(limit, value));
+}
+
+// Inputs small enough for the 20-bit lanes of the int8 kernel, see base::gemm(). Per channel, the shifts spread
+// around mac_shift.
+template <typename T>
+void test_gemm(
+    int m, int n, int k, int mac_shift, activation_type_t activation, bool with_bias, bool per_channel = false)
+{
+    int limit = sizeof(T) == 1 ? 15 : 1000;
+    T *input = random_elements<T>(m * k, limit);
+    T *filter = random_elements<T>(k * n, limit);
+    T *packed = (T *)tool::malloc_aligned(base::gemm_packed_filter_size<T>(k, n), sizeof(T), 16, MALLOC_CAP_DEFAULT);
+    base::gemm_pack_filter<T>(packed, filter, k, n);
+    std::vector<int64_t> bias(n);
+    for (int j = 0; j < n; j++) {
+        bias[j] = rand() % 20001 - 10000;
+    }
+    std::vector<int32_t> bias32(bias.begin(), bias.end());
+    const void *bias_ptr = nullptr;
+    if (with_bias) {
+        bias_ptr = sizeof(T) == 1 ? (const void *)bias32.data() : (const void *)bias.data();
+    }
+    std::vector<int8_t> channel_shift(n);
+    for (int j = 0; j < n; j++) {
+        channel_shift[j] = per_channel ? mac_shift + j % 5 - 2 : mac_shift;
+    }
+    T *output = (T *)tool::malloc_aligned(m * n, sizeof(T), 16, MALLOC_CAP_DEFAULT);
+    T *output_c = (T *)tool::malloc_aligned(m * n, sizeof(T), 16, MALLOC_CAP_DEFAULT);
+
+    for (runtime_mode_t mode : {RUNTIME_MODE_SINGLE_CORE, RUNTIME_MODE_MULTI_CORE}) {
+        std::vector<base::gemmArgsType<T>> args =
+            base::get_gemm_operation_args<T>(output, input, packed, bias_ptr, m, n, k, mac_shift, activation, mode);
+        for (auto &arg : args) {
+            arg.channel_shift = per_channel ? channel_shift.data() : nullptr;
+            base::gemm<T>(&arg);
+        }
+        args =
+            base::get_gemm_operation_args<T>(output_c, input, packed, bias_ptr, m, n, k, mac_shift, activation, mode);
+        for (auto &arg : args) {
+            arg.channel_shift = per_channel ? channel_shift.data() : nullptr;
+            base::gemm_c<T>(&arg);
+        }
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(output_c, output, m * n * sizeof(T), "gemm differs from gemm_c");
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++) {
+                TEST_ASSERT_EQUAL_MESSAGE(
+                    reference<T>(input, filter, bias_ptr, i, j, n, k, channel_shift[j], activation),
+                    (int)output[i * n + j],
+                    "gemm differs from the reference");
+            }
+        }
+    }
+    heap_caps_free(input);
+    heap_caps_free(filter);
+    heap_caps_free(packed);
+    heap_caps_free(output);
+    heap_caps_free(output_c);
+}
+
+// MatMul with a constant or a runtime 2D input1, input0 of rank 3.
+template <typename T>
+void test_matmul(int batch, int m, int n, int k, activation_type_t activation, bool constant)
+{
+    int limit = sizeof(T) == 1 ? 15 : 1000;
+    T *input0 = random_elements<T>(batch * m * k, limit);
+    T *input1 = random_elements<T>(k * n, limit);
+    T *output = (T *)tool::malloc_aligned(batch * m * n, sizeof(T), 16, MALLOC_CAP_DEFAULT);
+    dtype_t dtype = sizeof(T) == 1 ? DATA_TYPE_INT8 : DATA_TYPE_INT16;
+    quant_type_t quant_type = sizeof(T) == 1 ? QUANT_TYPE_SYMM_8BIT : QUANT_TYPE_SYMM_16BIT;
+    int input0_exponent = -3, input1_exponent = -4;
+    int output_exponent = sizeof(T) == 1 ? 1 : -2;
+    TensorBase input0_tensor({batch, m, k}, input0, input0_exponent, dtype, false);
+    TensorBase output_tensor({batch, m, n}, output, output_exponent, dtype, false);
+    // MatMul deletes its constant filter.
+    TensorBase *input1_tensor = new TensorBase({k, n}, input1, input1_exponent, dtype, false);
+    module::MatMul matmul(constant ? input1_tensor : nullptr, activation, "matmul", quant_type);
+    std::vector<TensorBase *> tensors = {&input0_tensor, input1_tensor, &output_tensor};
+    matmul.m_inputs_index = constant ? std::vector<int>{0} : std::vector<int>{0, 1};
+    matmul.m_outputs_index = {2};
+
+    // The second run of a constant input1 takes the filter packed by the first, a runtime input1 is packed again
+    // into the same buffer.
+    for (int run = 0; run < 2; run++) {
+        if (run > 0 && !constant) {
+            for (int i = 0; i < k * n; i++) {
+                input1[i] = rand() % (2 * limit + 1) - limit;
+            }
+        }
+        memset(output, 0, batch * m * n * sizeof(T));
+        matmul.forward(tensors, RUNTIME_MODE_MULTI_CORE);
+        for (int i = 0; i < batch * m; i++) {
+            for (int j = 0; j < n; j++) {
+                TEST_ASSERT_EQUAL_MESSAGE(reference<T>(input0,
+                                                       input1,
+                                                       nullptr,
+                                                       i,
+                                                       j,
+                                                       n,
+                                                       k,
+                                                       output_exponent - input0_exponent - input1_exponent,
+                                                       activation),
+                                          (int)output[i * n + j],
+                                          "MatMul differs from the reference");
+            }
+        }
+    }
+    if (!constant) {
+        delete input1_tensor;
+    }
+    heap_caps_free(input0);
+    heap_caps_free(input1);
+    heap_caps_free(output);
+}
+
+template <typename T>
+void benchmark_gemm(int m, int n, int k)
+{
+    T *input = random_elements<T>(m * k, 15);
+    T *packed = random_elements<T>(base::gemm_packed_filter_size<T>(k, n), 15);
+    T *output = (T *)tool::malloc_aligned(m * n, sizeof(T), 16, MALLOC_CAP_DEFAULT);
+    std::vector<base::gemmArgsType<T>> args =
+        base::get_gemm_operation_args<T>(output, input, packed, nullptr, m, n, k, 8, Linear, RUNTIME_MODE_SINGLE_CORE);
+    int64_t start = esp_timer_get_time();
+    base::gemm<T>(&args[0]);
+    int64_t gemm_latency = esp_timer_get_time() - start;
+    start = esp_timer_get_time();
+    base::gemm_c<T>(&args[0]);
+    int64_t gemm_c_latency = esp_timer_get_time() - start;
+    printf("%s m %4d n %4d k %4d: gemm %7lld us, gemm_c %7lld us\n",
+           sizeof(T) == 1 ? "int8 " : "int16",
+           m,
+           n,
+           k,
+           (long long)gemm_latency,
+           (long long)gemm_c_latency);
+    heap_caps_free(input);
+    heap_caps_free(packed);
+    heap_caps_free(output);
+}
+} // namespace
+
+TEST_CASE("gemm is bit-exact with gemm_c and the reference", "[dl_base]")
+{
+    // Aligned for the boosted kernels, unaligned n and k, a single row.
+    test_gemm<int8_t>(16, 32, 64, 6, Linear, true);
+    test_gemm<int8_t>(9, 48, 128, 4, ReLU, false);
+    test_gemm<int8_t>(7, 20, 9, 5, Linear, true);
+    test_gemm<int8_t>(1, 16, 512, 7, ReLU, true);
+    test_gemm<int16_t>(16, 16, 64, 8, Linear, true);
+    test_gemm<int16_t>(5, 24, 40, 3, ReLU, true);
+    test_gemm<int16_t>(3, 13, 7, 0, Linear, false);
+}
+
+TEST_CASE("gemm with a shift per channel is bit-exact with gemm_c and the reference", "[dl_base]")
+{
+    // More rows than the accumulators kept at a time, negative shifts, an unaligned n.
+    test_gemm<int8_t>(20, 32, 64, 6, Linear, true, true);
+    test_gemm<int8_t>(9, 16, 128, 1, ReLU, false, true);
+    test_gemm<int8_t>(5, 20, 16, 5, Linear, true, true);
+    test_gemm<int16_t>(19, 16, 64, 8, ReLU, true, true);
+    test_gemm<int16_t>(4, 24, 40, 1, Linear, true, true);
+    test_gemm<int16_t>(3, 13, 8, 3, Linear, false, true);
+}
+
+TEST_CASE("MatMul with a 2D input1 matches the reference", "[dl_module]")
+{
+    test_matmul<int8_t>(2, 8, 32, 64, Linear, true);
+    test_matmul<int8_t>(2, 5, 17, 33, ReLU, false);
+    test_matmul<int16_t>(3, 4, 16, 40, ReLU, true);
+    test_matmul<int16_t>(1, 6, 24, 64, Linear, false);
+}
+
+TEST_CASE("gemm latency over m, n and k", "[dl_base][benchmark]")
+{
+    for (int m : {1, 16, 64}) {
+        for (int n : {16, 128}) {
+            for (int k : {64, 512}) {
+                benchmark_gemm<int8_t>(m, n, k);
+                benchmark_gemm<int16_t>(m, n, k);
+            }
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#include "dl_image_color.hpp"
+#include "dl_image_process.hpp"
+#include "unity.h"
+#include <cstring>
+#include <vector>
+
+using namespace dl::image;
+
+namespace {
+// The per-pixel reference of a row kernel.
+void convert_row_ref(
+    const uint8_t *src, uint8_t *dst, int n, pix_type_t src_type, pix_type_t dst_type, uint32_t caps, void *norm_lut)
+{
+    int src_pix_size = get_pix_byte_size(src_type);
+    int dst_pix_size = get_pix_byte_size(dst_type);
+    for (int i = 0; i < n; i++) {
+        pix_t src_pix = {(void *)(src + i * src_pix_size), src_type};
+        pix_t dst_pix = {(void *)(dst + i * dst_pix_size), dst_type};
+        convert_pixel(src_pix, dst_pix, caps, norm_lut);
+    }
+}
+} // namespace
+
+TEST_CASE("convert row kernels match convert_pixel for all the pixel types and caps", "[dl_image]")
+{
+    const pix_type_t src_types[] = {DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_GRAY};
+    const pix_type_t dst_types[] = {DL_IMAGE_PIX_TYPE_RGB888,
+                                    DL_IMAGE_PIX_TYPE_RGB888_QINT8,
+                                    DL_IMAGE_PIX_TYPE_RGB888_QINT16,
+                                    DL_IMAGE_PIX_TYPE_GRAY,
+                                    DL_IMAGE_PIX_TYPE_GRAY_QINT8,
+                                    DL_IMAGE_PIX_TYPE_GRAY_QINT16,
+                                    DL_IMAGE_PIX_TYPE_RGB565};
+    const uint32_t all_caps = DL_IMAGE_CAP_RGB_SWAP | DL_IMAGE_CAP_RGB565_BYTE_SWAP | DL_IMAGE_CAP_RGB565_BIG_ENDIAN;
+    // Odd, so that the kernels unrolled over pixels run their tail.
+    const int n = 37;
+    std::vector<int16_t> norm_lut(768);
+    for (auto &v : norm_lut) {
+        v = rand();
+    }
+    std::vector<uint8_t> src(n * 3);
+    for (auto &v : src) {
+        v = rand();
+    }
+    std::vector<uint8_t> dst(n * 6);
+    std::vector<uint8_t> expected(n * 6);
+    int num_kernels = 0;
+    for (pix_type_t src_type : src_types) {
+        for (pix_type_t dst_type : dst_types) {
+            for (uint32_t caps = 0; caps <= all_caps; caps++) {
+                convert_row_func_t convert_row_func = get_convert_row_func(src_type, dst_type, caps);
+                if (!convert_row_func) {
+                    // Only gray to gray and gray to rgb565 are not implemented.
+                    TEST_ASSERT_EQUAL(DL_IMAGE_PIX_TYPE_GRAY, src_type);
+                    continue;
+                }
+                memset(dst.data(), 0, dst.size());
+                memset(expected.data(), 0, expected.size());
+                convert_row_func(src.data(), dst.data(), n, norm_lut.data());
+                convert_row_ref(src.data(), expected.data(), n, src_type, dst_type, caps, norm_lut.data());
+                std::string message = pix_type_to_str(src_type) + " to " + pix_type_to_str(dst_type);
+                TEST_ASSERT_EQUAL_MEMORY_MESSAGE(
+                    expected.data(), dst.data(), n * get_pix_byte_size(dst_type), message.c_str());
+                num_kernels++;
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL(3 * 7 * 8 - 2 * 8, num_kernels);
+}
+
+TEST_CASE("packed yuv420 images convert and resize as their luma", "[dl_image]")
+{
+    const int width = 38;
+    const int height = 21;
+    std::vector<uint8_t> yuv(width * height * 3 / 2);
+    for (auto &v : yuv) {
+        v = rand();
+    }
+    // "u y y" on even lines, "v y y" on odd ones.
+    std::vector<uint8_t> luma(width * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            luma[y * width + x] = yuv[y * width * 3 / 2 + x / 2 * 3 + 1 + x % 2];
+        }
+    }
+    img_t yuv_img = {yuv.data(), width, height, DL_IMAGE_PIX_TYPE_YUV420};
+    img_t gray_img = {luma.data(), width, height, DL_IMAGE_PIX_TYPE_GRAY};
+    TEST_ASSERT_EQUAL(yuv.size(), get_img_byte_size(yuv_img));
+
+    std::vector<int16_t> norm_lut(768);
+    for (auto &v : norm_lut) {
+        v = rand();
+    }
+    const pix_type_t dst_types[] = {DL_IMAGE_PIX_TYPE_GRAY,
+                                    DL_IMAGE_PIX_TYPE_GRAY_QINT8,
+                                    DL_IMAGE_PIX_TYPE_GRAY_QINT16,
+                                    DL_IMAGE_PIX_TYPE_RGB888,
+                                    DL_IMAGE_PIX_TYPE_RGB888_QINT8};
+    // An odd left edge starts the rows on the second luma of a "u y y".
+    const std::vector<std::vector<int>> crop_areas = {{}, {3, 2, 30, 19}, {0, 0, width, height}};
+    // Same size, down and up scaled.
+    const int dst_sizes[][2] = {{0, 0}, {17, 11}, {60, 40}};
+    std::vector<uint8_t> expected(60 * 40 * 6);
+    std::vector<uint8_t> dst(60 * 40 * 6);
+    for (pix_type_t dst_type : dst_types) {
+        for (const auto &crop_area : crop_areas) {
+            for (const auto &dst_size : dst_sizes) {
+                for (interpolate_type_t interpolate_type :
+                     {DL_IMAGE_INTERPOLATE_NEAREST, DL_IMAGE_INTERPOLATE_BILINEAR}) {
+                    int dst_w = dst_size[0];
+                    int dst_h = dst_size[1];
+                    if (dst_w == 0) {
+                        dst_w = crop_area.empty() ? width : crop_area[2] - crop_area[0];
+                        dst_h = crop_area.empty() ? height : crop_area[3] - crop_area[1];
+                    }
+                    img_t expected_img = {expected.data(), dst_w, dst_h, dst_type};
+                    img_t dst_img = {dst.data(), dst_w, dst_h, dst_type};
+                    memset(expected.data(), 0, expected.size());
+                    memset(dst.data(), 0, dst.size());
+                    if (dst_type == DL_IMAGE_PIX_TYPE_GRAY && dst_size[0] == 0) {
+                        // convert_img() does not copy gray to gray, the luma is the expected image.
+                        int x0 = crop_area.empty() ? 0 : crop_area[0];
+                        int y0 = crop_area.empty() ? 0 : crop_area[1];
+                        for (int y = 0; y < dst_h; y++) {
+                            memcpy(&expected[y * dst_w], &luma[(y0 + y) * width + x0], dst_w);
+                        }
+                    } else {
+                        resize(gray_img, expected_img, interpolate_type, 0, norm_lut.data(), crop_area);
+                    }
+                    resize(yuv_img, dst_img, interpolate_type, 0, norm_lut.data(), crop_area);
+                    std::string message = "yuv420 to " + pix_type_to_str(dst_type) + ", " + std::to_string(dst_w) +
+                        "x" + std::to_string(dst_h);
+                    TEST_ASSERT_EQUAL_MEMORY_MESSAGE(
+                        expected.data(), dst.data(), get_img_byte_size(dst_img), message.c_str());
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,240 @@
+#include "dl_image_draw.hpp"
+#include "unity.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace dl::image;
+
+namespace {
+const int GUARD = 64;
+const uint8_t GUARD_BYTE = 0xa5;
+
+// An image with guard bytes on both sides, a draw writing out of the image overwrites them.
+struct guarded_img_t {
+    std::vector<uint8_t> bytes;
+    img_t img;
+
+    guarded_img_t(int width, int height, pix_type_t pix_type)
+    {
+        img = {nullptr, width, height, pix_type};
+        size_t size = get_img_byte_size(img);
+        bytes.assign(size + 2 * GUARD, GUARD_BYTE);
+        img.data = bytes.data() + GUARD;
+        for (size_t i = 0; i < size; i++) {
+            ((uint8_t *)img.data)[i] = (i * 7 + i / 13) & 0xff;
+        }
+    }
+
+    void check_guards()
+    {
+        size_t size = get_img_byte_size(img);
+        for (int i = 0; i < GUARD; i++) {
+            TEST_ASSERT_EQUAL_HEX8_MESSAGE(GUARD_BYTE, bytes[i], "written before the image");
+            TEST_ASSERT_EQUAL_HEX8_MESSAGE(GUARD_BYTE, bytes[GUARD + size + i], "written after the image");
+        }
+    }
+};
+
+// The bytes of pixel (x, y), the luma only on a YUV420 image.
+std::vector<uint8_t> get_pixel(const img_t &img, int x, int y)
+{
+    if (img.pix_type == DL_IMAGE_PIX_TYPE_YUV420 || img.pix_type == DL_IMAGE_PIX_TYPE_GRAY) {
+        return {*get_luma_ptr(img, x, y)};
+    }
+    int size = get_pix_byte_size(img.pix_type);
+    const uint8_t *ptr = (const uint8_t *)img.data + (y * img.width + x) * size;
+    return std::vector<uint8_t>(ptr, ptr + size);
+}
+
+// The chroma samples of a YUV420 image, the first byte of each pair of pixels. Drawing never changes them.
+std::vector<uint8_t> get_chroma(const img_t &img)
+{
+    std::vector<uint8_t> chroma;
+    for (int y = 0; y < img.height; y++) {
+        for (int x = 0; x < img.width; x += 2) {
+            chroma.push_back(*(get_luma_ptr(img, x, y) - 1));
+        }
+    }
+    return chroma;
+}
+
+// The pixel color is drawn as, read from a filled image.
+std::vector<uint8_t> get_draw_pixel(pix_type_t pix_type, const std::vector<uint8_t> &color)
+{
+    guarded_img_t filled(2, 2, pix_type);
+    draw_filled_rectangle(filled.img, 0, 0, 1, 1, color);
+    return get_pixel(filled.img, 1, 1);
+}
+
+bool inside(int x, int y, int x1, int y1, int x2, int y2)
+{
+    return x >= x1 && x <= x2 && y >= y1 && y <= y2;
+}
+
+// Every pixel of the rectangle clipped to the image takes the color, no other byte changes.
+void test_filled(pix_type_t pix_type, const std::vector<uint8_t> &color, int x1, int y1, int x2, int y2)
+{
+    guarded_img_t image(30, 20, pix_type);
+    guarded_img_t background(30, 20, pix_type);
+    std::vector<uint8_t> pixel = get_draw_pixel(pix_type, color);
+    draw_filled_rectangle(image.img, x1, y1, x2, y2, color);
+    image.check_guards();
+    for (int y = 0; y < image.img.height; y++) {
+        for (int x = 0; x < image.img.width; x++) {
+            std::vector<uint8_t> expected =
+                inside(x, y, x1, y1, x2, y2) ? pixel : get_pixel(background.img, x, y);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), get_pixel(image.img, x, y).data(), expected.size());
+        }
+    }
+    if (pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
+        std::vector<uint8_t> chroma = get_chroma(background.img);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(chroma.data(), get_chroma(image.img).data(), chroma.size());
+    }
+}
+
+// A blend of alpha 0 keeps the image and of alpha 255 is the filled rectangle. In between, the pixels of the clipped
+// rectangle change toward the color and the others don't.
+void test_blended(pix_type_t pix_type, const std::vector<uint8_t> &color, int x1, int y1, int x2, int y2)
+{
+    guarded_img_t background(30, 20, pix_type);
+    size_t size = get_img_byte_size(background.img);
+
+    guarded_img_t image(30, 20, pix_type);
+    draw_blended_rectangle(image.img, x1, y1, x2, y2, color, 0);
+    image.check_guards();
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(background.img.data, image.img.data, size);
+
+    guarded_img_t filled(30, 20, pix_type);
+    draw_filled_rectangle(filled.img, x1, y1, x2, y2, color);
+    draw_blended_rectangle(image.img, x1, y1, x2, y2, color, 255);
+    image.check_guards();
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(filled.img.data, image.img.data, size);
+
+    guarded_img_t half(30, 20, pix_type);
+    draw_blended_rectangle(half.img, x1, y1, x2, y2, color, 128);
+    half.check_guards();
+    for (int y = 0; y < half.img.height; y++) {
+        for (int x = 0; x < half.img.width; x++) {
+            std::vector<uint8_t> before = get_pixel(background.img, x, y);
+            std::vector<uint8_t> after = get_pixel(half.img, x, y);
+            if (!inside(x, y, x1, y1, x2, y2)) {
+                TEST_ASSERT_EQUAL_UINT8_ARRAY(before.data(), after.data(), before.size());
+            } else if (pix_type != DL_IMAGE_PIX_TYPE_RGB565) {
+                // The fields of a RGB565 pixel are packed, only the luma is compared byte by byte.
+                int target = get_pixel(filled.img, x, y)[0];
+                TEST_ASSERT_TRUE(abs(target - after[0]) <= abs(target - before[0]));
+            }
+        }
+    }
+    if (pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
+        std::vector<uint8_t> chroma = get_chroma(background.img);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(chroma.data(), get_chroma(half.img).data(), chroma.size());
+    }
+}
+
+// Text clipped by the image edges must be drawn where the same text drawn whole, on a larger gray mask, sets pixels.
+// The mask has nothing set out of the get_text_width() by 7 * scale box of the text.
+void test_text(pix_type_t pix_type, const std::vector<uint8_t> &color, const char *text, int x, int y, int scale)
+{
+    const int margin = 128;
+    guarded_img_t mask(30 + 2 * margin, 20 + 2 * margin, DL_IMAGE_PIX_TYPE_GRAY);
+    memset(mask.img.data, 0, get_img_byte_size(mask.img));
+    draw_text(mask.img, x + margin, y + margin, text, {255}, scale);
+    mask.check_guards();
+    int width = get_text_width(text, scale);
+    for (int v = 0; v < mask.img.height; v++) {
+        for (int u = 0; u < mask.img.width; u++) {
+            if (!inside(u, v, x + margin, y + margin, x + margin + width - 1, y + margin + 7 * scale - 1)) {
+                TEST_ASSERT_EQUAL_UINT8(0, get_pixel(mask.img, u, v)[0]);
+            }
+        }
+    }
+
+    guarded_img_t image(30, 20, pix_type);
+    guarded_img_t background(30, 20, pix_type);
+    std::vector<uint8_t> pixel = get_draw_pixel(pix_type, color);
+    draw_text(image.img, x, y, text, color, scale);
+    image.check_guards();
+    for (int v = 0; v < image.img.height; v++) {
+        for (int u = 0; u < image.img.width; u++) {
+            std::vector<uint8_t> expected =
+                get_pixel(mask.img, u + margin, v + margin)[0] ? pixel : get_pixel(background.img, u, v);
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(expected.data(), get_pixel(image.img, u, v).data(), expected.size());
+        }
+    }
+    if (pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
+        std::vector<uint8_t> chroma = get_chroma(background.img);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(chroma.data(), get_chroma(image.img).data(), chroma.size());
+    }
+}
+
+std::vector<uint8_t> get_color(pix_type_t pix_type)
+{
+    if (pix_type == DL_IMAGE_PIX_TYPE_GRAY) {
+        return {200};
+    }
+    return {30, 220, 90};
+}
+} // namespace
+
+TEST_CASE("draw_filled_rectangle and draw_blended_rectangle spans are clipped to the image", "[dl_image]")
+{
+    const pix_type_t pix_types[] = {
+        DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_GRAY, DL_IMAGE_PIX_TYPE_YUV420};
+    const int rects[][4] = {
+        {3, 2, 17, 11},    // inside
+        {0, 0, 29, 19},    // the whole image
+        {-5, -3, 4, 6},    // over the top left corner
+        {25, 15, 40, 30},  // over the bottom right corner
+        {-10, 5, 50, 5},   // a row across the image
+        {7, -10, 7, 40},   // a column across the image, odd for the luma pairs of YUV420
+        {31, 2, 40, 10},   // right of the image
+        {3, -8, 10, -1},   // above the image
+        {10, 10, 5, 12},   // empty
+    };
+    for (pix_type_t pix_type : pix_types) {
+        for (const int *rect : rects) {
+            test_filled(pix_type, get_color(pix_type), rect[0], rect[1], rect[2], rect[3]);
+            if (pix_type != DL_IMAGE_PIX_TYPE_RGB888) {
+                test_blended(pix_type, get_color(pix_type), rect[0], rect[1], rect[2], rect[3]);
+            }
+        }
+    }
+    // A gray color drawn on the luma of a YUV420 image.
+    test_filled(DL_IMAGE_PIX_TYPE_YUV420, {77}, 5, 3, 20, 9);
+    test_blended(DL_IMAGE_PIX_TYPE_YUV420, {77}, -4, 3, 20, 25);
+}
+
+TEST_CASE("draw_text spans are clipped to the image", "[dl_image]")
+{
+    const pix_type_t pix_types[] = {
+        DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_GRAY, DL_IMAGE_PIX_TYPE_YUV420};
+    for (pix_type_t pix_type : pix_types) {
+        std::vector<uint8_t> color = get_color(pix_type);
+        test_text(pix_type, color, "ID 12", 2, 3, 1);
+        test_text(pix_type, color, "ID 12", -7, -4, 2);
+        test_text(pix_type, color, "#$@W", 21, 15, 2);
+        test_text(pix_type, color, "x", 27, -3, 3);
+        test_text(pix_type, color, "left", -100, 5, 1);
+        test_text(pix_type, color, "right", 30, 5, 1);
+    }
+
+    // '|' is the middle column of the glyph: one span of scale pixels per row.
+    guarded_img_t image(30, 20, DL_IMAGE_PIX_TYPE_GRAY);
+    guarded_img_t background(30, 20, DL_IMAGE_PIX_TYPE_GRAY);
+    draw_text(image.img, 3, 2, "|", {255}, 2);
+    for (int y = 0; y < image.img.height; y++) {
+        for (int x = 0; x < image.img.width; x++) {
+            uint8_t expected = inside(x, y, 3 + 4, 2, 3 + 5, 2 + 13) ? 255 : get_pixel(background.img, x, y)[0];
+            TEST_ASSERT_EQUAL_UINT8(expected, get_pixel(image.img, x, y)[0]);
+        }
+    }
+
+    // Out of the printable range is drawn as '?'.
+    guarded_img_t question(30, 20, DL_IMAGE_PIX_TYPE_GRAY);
+    guarded_img_t unprintable(30, 20, DL_IMAGE_PIX_TYPE_GRAY);
+    draw_text(question.img, 4, 4, "a?b", {255}, 1);
+    draw_text(unprintable.img, 4, 4, "a\001b", {255}, 1);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(question.img.data, unprintable.img.data, get_img_byte_size(question.img));
+}
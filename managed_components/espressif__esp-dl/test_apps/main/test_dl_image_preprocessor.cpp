@@ -0,0 +1,137 @@
+#include "dl_image_preprocessor.hpp"
+#include "unity.h"
+#include <vector>
+
+using namespace dl;
+using namespace dl::image;
+
+namespace {
+const int SRC_W = 320;
+const int SRC_H = 240;
+// The PPA scales by sixteenths, the crops of the tests are scaled exactly.
+const int INPUT_W = 160;
+const int INPUT_H = 120;
+
+// A model of its input only, enough for the preprocessor.
+class InputModel : public Model {
+public:
+    InputModel(int width, int height, int channel)
+    {
+        m_input = new TensorBase({1, height, width, channel}, nullptr, -7, DATA_TYPE_INT8, true, MALLOC_CAP_DEFAULT);
+        m_inputs["input"] = m_input;
+    }
+    ~InputModel() { delete m_input; }
+    std::map<std::string, TensorBase *> &get_inputs() override { return m_inputs; }
+    TensorBase *get_intermediate(std::string name) override { return m_input; }
+
+private:
+    TensorBase *m_input;
+    std::map<std::string, TensorBase *> m_inputs;
+};
+
+struct done_count_t {
+    volatile int count;
+};
+
+bool count_done(ImagePreprocessor *preprocessor, void *user_data)
+{
+    ((done_count_t *)user_data)->count++;
+    return false;
+}
+
+img_t make_src(pix_type_t pix_type)
+{
+    img_t src = {nullptr, SRC_W, SRC_H, pix_type};
+    size_t bytes = get_img_byte_size(src);
+    src.data = tool::malloc_aligned(bytes, 1, 64, MALLOC_CAP_DEFAULT);
+    for (int i = 0; i < bytes; i++) {
+        ((uint8_t *)src.data)[i] = (i * 7 + i / SRC_W * 13) & 0xff;
+    }
+    return src;
+}
+
+// The model input of preprocess_async() and preprocess_wait() must be the one of preprocess(), the callback must be
+// called once, before preprocess_async() returns when the frame is preprocessed by the CPU.
+void test_async(uint32_t caps, pix_type_t pix_type, const std::vector<int> &crop_area, bool by_cpu)
+{
+    img_t src = make_src(pix_type);
+    InputModel model(INPUT_W, INPUT_H, 3);
+    ImagePreprocessor preprocessor(&model, {0, 0, 0}, {255, 255, 255}, caps);
+    TensorBase *input = model.get_inputs().begin()->second;
+    size_t input_bytes = input->get_bytes();
+
+    preprocessor.preprocess(src, crop_area);
+    std::vector<int8_t> reference((int8_t *)input->data, (int8_t *)input->data + input_bytes);
+    float scale_x = preprocessor.get_resize_scale_x();
+    float scale_y = preprocessor.get_resize_scale_y();
+    memset(input->data, 0, input_bytes);
+
+    done_count_t done = {0};
+    TEST_ASSERT_EQUAL(ESP_OK, preprocessor.preprocess_async(src, crop_area, count_done, &done));
+    if (by_cpu) {
+        TEST_ASSERT_EQUAL(1, done.count);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, preprocessor.preprocess_wait());
+    TEST_ASSERT_EQUAL(1, done.count);
+    TEST_ASSERT_EQUAL_INT8_ARRAY(reference.data(), input->data, input_bytes);
+    TEST_ASSERT_EQUAL_FLOAT(scale_x, preprocessor.get_resize_scale_x());
+    TEST_ASSERT_EQUAL_FLOAT(scale_y, preprocessor.get_resize_scale_y());
+    // Nothing pending, waiting again returns right away.
+    TEST_ASSERT_EQUAL(ESP_OK, preprocessor.preprocess_wait(0));
+    heap_caps_free(src.data);
+}
+
+// A frame submitted before the previous one is waited for is refused while the PPA is busy with it, and the previous
+// frame is still written to the model input.
+void test_back_to_back(uint32_t caps, bool by_cpu)
+{
+    img_t src = make_src(DL_IMAGE_PIX_TYPE_RGB565);
+    InputModel model(INPUT_W, INPUT_H, 3);
+    ImagePreprocessor preprocessor(&model, {0, 0, 0}, {255, 255, 255}, caps);
+    TensorBase *input = model.get_inputs().begin()->second;
+    size_t input_bytes = input->get_bytes();
+    std::vector<int> crop_a = {0, 0, 256, 192};
+    std::vector<int> crop_b = {64, 48, 320, 240};
+
+    preprocessor.preprocess(src, crop_a);
+    std::vector<int8_t> reference_a((int8_t *)input->data, (int8_t *)input->data + input_bytes);
+    preprocessor.preprocess(src, crop_b);
+    std::vector<int8_t> reference_b((int8_t *)input->data, (int8_t *)input->data + input_bytes);
+
+    done_count_t done = {0};
+    TEST_ASSERT_EQUAL(ESP_OK, preprocessor.preprocess_async(src, crop_a, count_done, &done));
+    esp_err_t ret = preprocessor.preprocess_async(src, crop_b, count_done, &done);
+    TEST_ASSERT_EQUAL(by_cpu ? ESP_OK : ESP_ERR_INVALID_STATE, ret);
+    TEST_ASSERT_EQUAL(ESP_OK, preprocessor.preprocess_wait());
+    TEST_ASSERT_EQUAL(by_cpu ? 2 : 1, done.count);
+    TEST_ASSERT_EQUAL_INT8_ARRAY(by_cpu ? reference_b.data() : reference_a.data(), input->data, input_bytes);
+
+    // Once waited for, the next frame is taken.
+    TEST_ASSERT_EQUAL(ESP_OK, preprocessor.preprocess_async(src, crop_b, count_done, &done));
+    TEST_ASSERT_EQUAL(ESP_OK, preprocessor.preprocess_wait());
+    TEST_ASSERT_EQUAL(by_cpu ? 3 : 2, done.count);
+    TEST_ASSERT_EQUAL_INT8_ARRAY(reference_b.data(), input->data, input_bytes);
+    heap_caps_free(src.data);
+}
+} // namespace
+
+TEST_CASE("ImagePreprocessor preprocess_async on the CPU", "[dl_image]")
+{
+    test_async(0, DL_IMAGE_PIX_TYPE_RGB565, {}, true);
+    test_async(0, DL_IMAGE_PIX_TYPE_RGB565, {32, 24, 288, 216}, true);
+    test_async(0, DL_IMAGE_PIX_TYPE_GRAY, {32, 24, 288, 216}, true);
+    test_back_to_back(0, true);
+}
+
+#if CONFIG_IDF_TARGET_ESP32P4
+TEST_CASE("ImagePreprocessor preprocess_async on the PPA", "[dl_image]")
+{
+    test_async(DL_IMAGE_CAP_PPA, DL_IMAGE_PIX_TYPE_RGB565, {}, false);
+    test_async(DL_IMAGE_CAP_PPA, DL_IMAGE_PIX_TYPE_RGB565, {32, 24, 288, 216}, false);
+    // Not resized, the PPA has nothing to overlap and the CPU takes it.
+    test_async(DL_IMAGE_CAP_PPA, DL_IMAGE_PIX_TYPE_RGB565, {80, 60, 240, 180}, true);
+    // The PPA doesn't read gray images, they fall back to the CPU too.
+    test_async(DL_IMAGE_CAP_PPA, DL_IMAGE_PIX_TYPE_GRAY, {32, 24, 288, 216}, true);
+    test_back_to_back(DL_IMAGE_CAP_PPA, false);
+}
+#endif
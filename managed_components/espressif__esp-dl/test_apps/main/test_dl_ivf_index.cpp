@@ -0,0 +1,138 @@
+#include "dl_recognition_database.hpp"
+#include "esp_timer.h"
+#include "unity.h"
+#include <random>
+#include <vector>
+
+using namespace dl;
+using namespace dl::recognition;
+
+namespace {
+const int FEAT_LEN = 128;
+const int NUM_CLASSES = 40;
+const int NUM_ROWS = 2000;
+const int NUM_QUERIES = 200;
+const int NLIST = 45;
+const int TOP_K = 5;
+
+// A feature scattered around the center of its identity, l2 normalized.
+void make_feat(std::mt19937 &gen, const std::vector<float> &center, float spread, float *feat)
+{
+    std::normal_distribution<float> normal;
+    float norm = 0;
+    for (int j = 0; j < FEAT_LEN; j++) {
+        feat[j] = center[j] + spread * normal(gen);
+        norm += feat[j] * feat[j];
+    }
+    norm = sqrtf(norm);
+    for (int j = 0; j < FEAT_LEN; j++) {
+        feat[j] /= norm;
+    }
+}
+
+// Ids of the top_k rows of the highest similarity among the candidates.
+std::vector<uint16_t> search(const std::vector<int8_t> &rows,
+                             const std::vector<int8_t> &exponents,
+                             int feat_stride,
+                             const int8_t *query,
+                             int query_exponent,
+                             const std::vector<uint16_t> &candidates)
+{
+    std::vector<std::pair<float, uint16_t>> sims;
+    for (uint16_t id : candidates) {
+        const int8_t *row = rows.data() + id * feat_stride;
+        sims.push_back({cal_similarity(row, exponents[id], query, query_exponent, feat_stride, QUANT_TYPE_SYMM_8BIT),
+                        id});
+    }
+    int k = std::min(TOP_K, (int)sims.size());
+    std::partial_sort(sims.begin(), sims.begin() + k, sims.end(), std::greater<std::pair<float, uint16_t>>());
+    std::vector<uint16_t> ids;
+    for (int i = 0; i < k; i++) {
+        ids.push_back(sims[i].second);
+    }
+    return ids;
+}
+
+// recall@k and latency per query of each nprobe against the exact search, over features scattered by spread around
+// the centers of their identity. The portable code only, the same numbers come out of a host build.
+void test_recall(float spread)
+{
+    const int feat_stride = (FEAT_LEN + 15) / 16 * 16;
+    std::mt19937 gen(1);
+    std::normal_distribution<float> normal;
+    std::vector<std::vector<float>> centers(NUM_CLASSES, std::vector<float>(FEAT_LEN));
+    for (auto &center : centers) {
+        for (auto &v : center) {
+            v = normal(gen);
+        }
+    }
+    std::vector<float> feat(FEAT_LEN);
+    std::vector<int8_t> rows(NUM_ROWS * feat_stride);
+    std::vector<int8_t> exponents(NUM_ROWS);
+    std::vector<uint16_t> ids(NUM_ROWS);
+    for (int i = 0; i < NUM_ROWS; i++) {
+        make_feat(gen, centers[i % NUM_CLASSES], spread, feat.data());
+        exponents[i] = quantize_feat(feat.data(), FEAT_LEN, rows.data() + i * feat_stride, feat_stride, QUANT_TYPE_SYMM_8BIT);
+        ids[i] = i;
+    }
+    std::vector<int8_t> queries(NUM_QUERIES * feat_stride);
+    std::vector<int8_t> query_exponents(NUM_QUERIES);
+    for (int q = 0; q < NUM_QUERIES; q++) {
+        make_feat(gen, centers[q % NUM_CLASSES], spread, feat.data());
+        query_exponents[q] = quantize_feat(
+            feat.data(), FEAT_LEN, queries.data() + q * feat_stride, feat_stride, QUANT_TYPE_SYMM_8BIT);
+    }
+
+    IVFIndex index(FEAT_LEN, feat_stride, QUANT_TYPE_SYMM_8BIT, NLIST, 1);
+    TEST_ASSERT_EQUAL(ESP_OK, index.train(rows.data(), exponents.data(), ids.data(), NUM_ROWS, 10));
+
+    std::vector<std::vector<uint16_t>> exact(NUM_QUERIES);
+    int64_t start = esp_timer_get_time();
+    for (int q = 0; q < NUM_QUERIES; q++) {
+        exact[q] = search(rows, exponents, feat_stride, queries.data() + q * feat_stride, query_exponents[q], ids);
+    }
+    printf("spread %.1f, exact: %lld us per query\n",
+           spread,
+           (long long)(esp_timer_get_time() - start) / NUM_QUERIES);
+
+    // Every probe adds lists to the candidates, so the recall can only grow with nprobe and is exact at nlist.
+    float last_recall = 0;
+    std::vector<uint16_t> candidates;
+    for (int nprobe : {1, 2, 4, 8, NLIST}) {
+        index.set_nprobe(nprobe);
+        int hits = 0;
+        start = esp_timer_get_time();
+        for (int q = 0; q < NUM_QUERIES; q++) {
+            const int8_t *query = queries.data() + q * feat_stride;
+            index.probe(query, query_exponents[q], candidates);
+            std::vector<uint16_t> approx = search(rows, exponents, feat_stride, query, query_exponents[q], candidates);
+            for (uint16_t id : exact[q]) {
+                hits += std::find(approx.begin(), approx.end(), id) != approx.end();
+            }
+        }
+        int64_t latency = (esp_timer_get_time() - start) / NUM_QUERIES;
+        float recall = (float)hits / (NUM_QUERIES * TOP_K);
+        printf("nprobe %2d: recall@%d %.3f, %lld us per query\n", nprobe, TOP_K, recall, (long long)latency);
+        TEST_ASSERT_TRUE(recall >= last_recall);
+        last_recall = recall;
+    }
+    TEST_ASSERT_EQUAL(NUM_QUERIES * TOP_K, (int)(last_recall * NUM_QUERIES * TOP_K + 0.5f));
+
+    // Removed rows are no longer candidates.
+    for (int i = 0; i < NUM_ROWS; i += 3) {
+        index.remove(ids[i], rows.data() + i * feat_stride, exponents[i]);
+    }
+    index.probe(queries.data(), query_exponents[0], candidates);
+    TEST_ASSERT_EQUAL(NUM_ROWS - (NUM_ROWS + 2) / 3, (int)candidates.size());
+    for (uint16_t id : candidates) {
+        TEST_ASSERT_NOT_EQUAL(0, id % 3);
+    }
+}
+} // namespace
+
+TEST_CASE("IVFIndex recall@k and latency against the exact search", "[dl_recognition]")
+{
+    test_recall(1.2f);
+    // The identities overlap, the nearest rows of a query are spread over more lists.
+    test_recall(4.0f);
+}
@@ -0,0 +1,72 @@
+#include "dl_math.hpp"
+#include "dl_module_lut.hpp"
+#include "unity.h"
+#include <vector>
+
+using namespace dl;
+
+namespace {
+typedef float (*func_t)(float);
+
+float sigmoid(float x)
+{
+    return math::sigmoid(x);
+}
+
+float hard_swish(float x)
+{
+    return DL_MAX(0, DL_MIN(1, 0.166667 * x + 0.5)) * x;
+}
+
+// Run the table over every input value and return the largest difference to the float path.
+template <typename T>
+int lut_max_error(func_t func, int input_exponent, int output_exponent)
+{
+    int n = sizeof(T) == 1 ? 256 : 65536;
+    dtype_t dtype = sizeof(T) == 1 ? DATA_TYPE_INT8 : DATA_TYPE_INT16;
+    std::vector<T> input(n);
+    std::vector<T> output(n);
+    for (int i = 0; i < n; i++) {
+        input[i] = (sizeof(T) == 1 ? INT8_MIN : INT16_MIN) + i;
+    }
+    TensorBase input_tensor({n}, input.data(), input_exponent, dtype, false);
+    TensorBase output_tensor({n}, output.data(), output_exponent, dtype, false);
+    module::PointwiseLUT lut(func);
+    lut.build(sizeof(T) == 1 ? QUANT_TYPE_SYMM_8BIT : QUANT_TYPE_SYMM_16BIT, input_exponent, output_exponent);
+    lut.run<T>(&input_tensor, &output_tensor);
+
+    int max_error = 0;
+    for (int i = 0; i < n; i++) {
+        float temp = func(input[i] * DL_SCALE(input_exponent)) * DL_RESCALE(output_exponent);
+        T expected;
+        tool::truncate(expected, tool::round(DL_CLIP(temp, -(1 << 23), 1 << 23)));
+        max_error = DL_MAX(max_error, abs(expected - output[i]));
+    }
+    return max_error;
+}
+} // namespace
+
+TEST_CASE("PointwiseLUT stays within the error bound of the float path", "[dl_module]")
+{
+    struct {
+        func_t func;
+        int input_exponent;
+        int output_exponent;
+    } cases[] = {
+        {sigmoid, -12, -15},
+        {sigmoid, -8, -15},
+        {tanhf, -12, -15},
+        {tanhf, -9, -15},
+        {expf, -12, -10},
+        {expf, -10, -4},
+        {expf, -8, -12},
+        {hard_swish, -12, -12},
+        {hard_swish, -10, -14},
+    };
+    // The steeper cases take a finer int16 table or the float path.
+    for (auto &c : cases) {
+        TEST_ASSERT_EQUAL(0, lut_max_error<int8_t>(c.func, c.input_exponent + 8, c.output_exponent + 8));
+        TEST_ASSERT_LESS_OR_EQUAL(module::PointwiseLUT::S16_MAX_ERROR,
+                                  lut_max_error<int16_t>(c.func, c.input_exponent, c.output_exponent));
+    }
+}
@@ -0,0 +1,143 @@
+#include "dl_base_mixed_conv2d.hpp"
+#include "unity.h"
+#include <cmath>
+#include <vector>
+
+using namespace dl;
+
+namespace {
+// The filter layout read by mixed_conv2d(), see mixedConvArgsType.
+template <typename F>
+std::vector<F> pack(const std::vector<F> &plain, int hwc, int n)
+{
+#if CONFIG_ESP32P4_BOOST
+    int u = 16 / sizeof(F);
+#else
+    int u = 1;
+#endif
+    int panels = n / u * u;
+    std::vector<F> filter(plain.size());
+    for (int j = 0; j < n; j++) {
+        for (int k = 0; k < hwc; k++) {
+            if (j < panels) {
+                filter[(j / u) * hwc * u + k * u + j % u] = plain[j * hwc + k];
+            } else {
+                filter[j * hwc + k] = plain[j * hwc + k];
+            }
+        }
+    }
+    return filter;
+}
+
+template <typename T, typename F>
+void test_mixed_conv2d(int h, int w, int c, int n, int stride, activation_type_t activation, int fh = 3)
+{
+    const int fw = fh, pad = fh / 2;
+    int oh = (h + 2 * pad - fh) / stride + 1;
+    int ow = (w + 2 * pad - fw) / stride + 1;
+    int f_max = sizeof(F) == 1 ? 127 : 4000;
+    std::vector<T> input(h * w * c);
+    for (auto &v : input) {
+        v = (T)(rand() % 255 - 127);
+    }
+    std::vector<F> plain(n * fh * fw * c);
+    for (auto &v : plain) {
+        v = (F)(rand() % (2 * f_max + 1) - f_max);
+    }
+    std::vector<int32_t> bias(n);
+    std::vector<int8_t> mac_shift(n);
+    for (int j = 0; j < n; j++) {
+        bias[j] = rand() % 20001 - 10000;
+        mac_shift[j] = sizeof(T) == 1 ? 8 + rand() % 8 : rand() % 6;
+    }
+    std::vector<F> filter = pack(plain, fh * fw * c, n);
+    std::vector<T> output(oh * ow * n);
+    std::vector<base::mixedConvArgsType<T, F>> args =
+        base::get_mixed_conv_operation_args<T, F>(output.data(),
+                                                  input.data(),
+                                                  filter.data(),
+                                                  bias.data(),
+                                                  mac_shift.data(),
+                                                  {1, oh, ow, n},
+                                                  {1, h, w, c},
+                                                  {fh, fw, c, n},
+                                                  {pad, pad, pad, pad},
+                                                  stride,
+                                                  stride,
+                                                  1,
+                                                  1,
+                                                  false,
+                                                  activation,
+                                                  RUNTIME_MODE_MULTI_CORE);
+    for (int i = 0; i < args.size(); i++) {
+        base::mixed_conv2d_c<T, F>(&args[i]);
+    }
+
+    // The reference reads the plain [N, H, W, C] filter.
+    double t_max = sizeof(T) == 1 ? 127 : 32767;
+    for (int oy = 0; oy < oh; oy++) {
+        for (int ox = 0; ox < ow; ox++) {
+            for (int j = 0; j < n; j++) {
+                double acc = bias[j];
+                for (int fy = 0; fy < fh; fy++) {
+                    for (int fx = 0; fx < fw; fx++) {
+                        int y = oy * stride - pad + fy;
+                        int x = ox * stride - pad + fx;
+                        if (y < 0 || y >= h || x < 0 || x >= w) {
+                            continue;
+                        }
+                        for (int i = 0; i < c; i++) {
+                            acc += (double)input[(y * w + x) * c + i] * plain[((j * fh + fy) * fw + fx) * c + i];
+                        }
+                    }
+                }
+                double expected = std::nearbyint(acc / std::ldexp(1.0, mac_shift[j]));
+                if (activation == ReLU && expected < 0) {
+                    expected = 0;
+                }
+                expected = std::fmax(-t_max - 1, std::fmin(t_max, expected));
+                TEST_ASSERT_EQUAL_MESSAGE((int)expected, (int)output[(oy * ow + ox) * n + j], "mixed_conv2d differs");
+            }
+        }
+    }
+
+    // The gemm path is bit-exact with the portable kernel.
+    base::mixedConvGemmBuffer gemm;
+    int u = 16 / sizeof(base::mixed_gemm_t<T, F>);
+    bool supported = base::mixed_conv2d_set_gemm<T, F>(args, gemm);
+    TEST_ASSERT_EQUAL((fh * fw * c) % u == 0 && n % u == 0, supported);
+    if (supported) {
+        std::vector<T> gemm_output(output.size());
+        for (int i = 0; i < args.size(); i++) {
+            args[i].output_element = gemm_output.data();
+            base::mixed_conv2d<T, F>(&args[i]);
+        }
+        TEST_ASSERT_EQUAL_MEMORY(output.data(), gemm_output.data(), output.size() * sizeof(T));
+    }
+}
+} // namespace
+
+TEST_CASE("mixed_conv2d matches the reference conv2d with filters in the kernel layout", "[dl_base]")
+{
+    // Whole panels, a panel and a tail, a tail only.
+    test_mixed_conv2d<int8_t, int16_t>(7, 6, 5, 16, 1, Linear);
+    test_mixed_conv2d<int8_t, int16_t>(7, 6, 5, 20, 2, ReLU);
+    test_mixed_conv2d<int8_t, int16_t>(5, 5, 3, 3, 1, Linear);
+    test_mixed_conv2d<int16_t, int8_t>(7, 6, 5, 32, 1, ReLU);
+    test_mixed_conv2d<int16_t, int8_t>(7, 6, 5, 21, 2, Linear);
+    test_mixed_conv2d<int8_t, int8_t>(6, 6, 4, 19, 1, Linear);
+    test_mixed_conv2d<int16_t, int16_t>(6, 6, 4, 11, 1, ReLU);
+}
+
+TEST_CASE("mixed_conv2d as im2col and gemm matches the portable kernel", "[dl_base]")
+{
+    // Widened feature, widened filter, both int8 and both int16, 3x3 and the direct 1x1.
+    test_mixed_conv2d<int8_t, int16_t>(7, 6, 8, 16, 1, ReLU);
+    test_mixed_conv2d<int8_t, int16_t>(5, 5, 16, 8, 2, Linear, 1);
+    test_mixed_conv2d<int16_t, int8_t>(7, 6, 8, 24, 2, Linear);
+    test_mixed_conv2d<int16_t, int8_t>(6, 6, 16, 8, 1, ReLU, 1);
+    test_mixed_conv2d<int8_t, int8_t>(6, 7, 16, 32, 1, Linear);
+    test_mixed_conv2d<int8_t, int8_t>(9, 9, 32, 16, 1, ReLU, 1);
+    test_mixed_conv2d<int16_t, int16_t>(6, 6, 8, 16, 1, Linear);
+    test_mixed_conv2d<int16_t, int16_t>(8, 8, 8, 8, 1, ReLU, 1);
+}
@@ -0,0 +1,57 @@
+#include "dl_model_base.hpp"
+#include "unity.h"
+#include <vector>
+
+using namespace dl;
+
+extern const uint8_t human_face_detect_espdl[] asm("_binary_human_face_detect_espdl_start");
+
+namespace {
+// Its detection heads are branches independent of each other, scheduled in the same stages.
+const char *MODEL_NAME = "human_face_detect_msr_s8_v1.espdl";
+
+Model *load_model(bool parallel)
+{
+    Model *model = new Model((const char *)human_face_detect_espdl, MODEL_NAME, fbs::MODEL_LOCATION_IN_FLASH_RODATA);
+    if (parallel) {
+        model->build(0, MEMORY_MANAGER_GREEDY, false, true);
+    }
+    return model;
+}
+
+void fill_inputs(Model *model, int seed)
+{
+    for (auto &input : model->get_inputs()) {
+        uint8_t *ptr = (uint8_t *)input.second->get_element_ptr();
+        for (int i = 0; i < input.second->get_bytes(); i++) {
+            ptr[i] = (i * 7 + i / 97 * 13 + seed * 31) & 0xff;
+        }
+    }
+}
+} // namespace
+
+// The stages share the modules between both cores in any order, the outputs must be the ones of the sequential plan.
+TEST_CASE("Model staged plan matches the sequential one", "[dl_model]")
+{
+    Model *sequential = load_model(false);
+    Model *staged = load_model(true);
+    // The worker task is created by the first run and kept by the next ones.
+    for (int run = 0; run < 3; run++) {
+        fill_inputs(sequential, run);
+        fill_inputs(staged, run);
+        sequential->run(RUNTIME_MODE_SINGLE_CORE);
+        staged->run(RUNTIME_MODE_MULTI_CORE);
+        std::map<std::string, TensorBase *> &outputs = staged->get_outputs();
+        for (auto &output : sequential->get_outputs()) {
+            auto iter = outputs.find(output.first);
+            TEST_ASSERT_TRUE(iter != outputs.end());
+            TEST_ASSERT_EQUAL(output.second->get_bytes(), iter->second->get_bytes());
+            TEST_ASSERT_EQUAL_MEMORY_MESSAGE(output.second->get_element_ptr(),
+                                             iter->second->get_element_ptr(),
+                                             output.second->get_bytes(),
+                                             output.first.c_str());
+        }
+    }
+    delete sequential;
+    delete staged;
+}
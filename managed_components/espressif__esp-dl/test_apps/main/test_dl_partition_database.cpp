@@ -0,0 +1,173 @@
+#include "dl_recognition_partition_database.hpp"
+#include "spi_flash_mmap.h"
+#include "unity.h"
+#include <random>
+#include <vector>
+
+using namespace dl;
+using namespace dl::recognition;
+
+namespace {
+// data partition of partitions.csv, erased by every test case.
+const char *PARTITION_LABEL = "fdb";
+const int FEAT_LEN = 128;
+const int NUM_FEATS = 20;
+
+const esp_partition_t *erase_partition()
+{
+    const esp_partition_t *partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, PARTITION_LABEL);
+    TEST_ASSERT_NOT_NULL(partition);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_partition_erase_range(partition, 0, partition->size));
+    return partition;
+}
+
+std::vector<std::vector<float>> make_feats(int num)
+{
+    std::mt19937 gen(1);
+    std::normal_distribution<float> normal;
+    std::vector<std::vector<float>> feats(num, std::vector<float>(FEAT_LEN));
+    for (auto &feat : feats) {
+        float norm = 0;
+        for (float &v : feat) {
+            v = normal(gen);
+            norm += v * v;
+        }
+        norm = sqrtf(norm);
+        for (float &v : feat) {
+            v /= norm;
+        }
+    }
+    return feats;
+}
+
+void enroll(PartitionDataBase &db, std::vector<float> &feat)
+{
+    TensorBase tensor({FEAT_LEN}, feat.data(), 0, DATA_TYPE_FLOAT, false);
+    TEST_ASSERT_EQUAL(ESP_OK, db.enroll_feat(&tensor));
+}
+
+// Every enrolled feature must be found at its 1-based position among the valid ones, the deleted ones not at all.
+void check_query(PartitionDataBase &db, std::vector<std::vector<float>> &feats, const std::vector<bool> &deleted)
+{
+    int position = 0;
+    for (int i = 0; i < feats.size(); i++) {
+        TensorBase tensor({FEAT_LEN}, feats[i].data(), 0, DATA_TYPE_FLOAT, false);
+        std::vector<result_t> results = db.query_feat(&tensor, 0.9, 1);
+        if (deleted[i]) {
+            TEST_ASSERT_EQUAL(0, results.size());
+            continue;
+        }
+        position++;
+        TEST_ASSERT_EQUAL(1, results.size());
+        TEST_ASSERT_EQUAL(position, results[0].id);
+        TEST_ASSERT_FLOAT_WITHIN(0.02, 1.0, results[0].similarity);
+    }
+}
+
+bool has_magic(const esp_partition_t *partition, int bank)
+{
+    int bank_size = partition->size / 2 / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+    char magic[4];
+    TEST_ASSERT_EQUAL(ESP_OK, esp_partition_read(partition, bank * bank_size, magic, 4));
+    return memcmp(magic, "FDB1", 4) == 0;
+}
+} // namespace
+
+TEST_CASE("PartitionDataBase tombstones survive a reopen", "[dl_recognition]")
+{
+    const esp_partition_t *partition = erase_partition();
+    std::vector<std::vector<float>> feats = make_feats(NUM_FEATS);
+    std::vector<bool> deleted(NUM_FEATS, false);
+    {
+        PartitionDataBase db(PARTITION_LABEL, FEAT_LEN, QUANT_TYPE_SYMM_8BIT, false);
+        for (auto &feat : feats) {
+            enroll(db, feat);
+        }
+        TEST_ASSERT_EQUAL(NUM_FEATS, db.get_num_feats());
+        // neighbouring records share a tombstone byte, every delete must keep the bits cleared before.
+        for (int id : {1, 2, 3, 8, 9, 17}) {
+            TEST_ASSERT_EQUAL(ESP_OK, db.delete_feat(id));
+            deleted[id - 1] = true;
+        }
+        TEST_ASSERT_EQUAL(ESP_FAIL, db.delete_feat(2));
+        TEST_ASSERT_EQUAL(ESP_FAIL, db.delete_feat(NUM_FEATS + 1));
+        TEST_ASSERT_EQUAL(ESP_OK, db.delete_last_feat());
+        deleted[NUM_FEATS - 1] = true;
+        TEST_ASSERT_EQUAL(NUM_FEATS - 7, db.get_num_feats());
+        check_query(db, feats, deleted);
+    }
+    PartitionDataBase db(PARTITION_LABEL, FEAT_LEN, QUANT_TYPE_SYMM_8BIT, false);
+    TEST_ASSERT_EQUAL(NUM_FEATS - 7, db.get_num_feats());
+    check_query(db, feats, deleted);
+    TEST_ASSERT_TRUE(has_magic(partition, 0));
+    TEST_ASSERT_FALSE(has_magic(partition, 1));
+}
+
+TEST_CASE("PartitionDataBase compaction switches the bank", "[dl_recognition]")
+{
+    const esp_partition_t *partition = erase_partition();
+    std::vector<std::vector<float>> feats = make_feats(NUM_FEATS + 2);
+    std::vector<bool> deleted(NUM_FEATS + 2, false);
+    {
+        PartitionDataBase db(PARTITION_LABEL, FEAT_LEN, QUANT_TYPE_SYMM_8BIT, false);
+        for (int i = 0; i < NUM_FEATS; i++) {
+            enroll(db, feats[i]);
+        }
+        for (int id = 1; id <= NUM_FEATS; id += 3) {
+            TEST_ASSERT_EQUAL(ESP_OK, db.delete_feat(id));
+            deleted[id - 1] = true;
+        }
+        int num_valid = db.get_num_feats();
+        TEST_ASSERT_EQUAL(ESP_OK, db.compact());
+        TEST_ASSERT_EQUAL(num_valid, db.get_num_feats());
+        TEST_ASSERT_FALSE(has_magic(partition, 0));
+        TEST_ASSERT_TRUE(has_magic(partition, 1));
+        // ids keep increasing after the compaction, appends go to the new bank.
+        enroll(db, feats[NUM_FEATS]);
+        TEST_ASSERT_EQUAL(ESP_FAIL, db.delete_feat(1));
+        TEST_ASSERT_EQUAL(ESP_OK, db.delete_feat(NUM_FEATS + 1));
+        deleted[NUM_FEATS] = true;
+        enroll(db, feats[NUM_FEATS + 1]);
+        check_query(db, feats, deleted);
+    }
+    PartitionDataBase db(PARTITION_LABEL, FEAT_LEN, QUANT_TYPE_SYMM_8BIT, false);
+    check_query(db, feats, deleted);
+    TEST_ASSERT_EQUAL(ESP_OK, db.delete_feat(NUM_FEATS + 2));
+
+    // compacting twice goes back to the first bank.
+    TEST_ASSERT_EQUAL(ESP_OK, db.compact());
+    deleted[NUM_FEATS + 1] = true;
+    TEST_ASSERT_TRUE(has_magic(partition, 0));
+    TEST_ASSERT_FALSE(has_magic(partition, 1));
+    check_query(db, feats, deleted);
+
+    TEST_ASSERT_EQUAL(ESP_OK, db.clear_all_feats());
+    TEST_ASSERT_EQUAL(0, db.get_num_feats());
+    TEST_ASSERT_TRUE(has_magic(partition, 1));
+    TEST_ASSERT_FALSE(has_magic(partition, 0));
+}
+
+TEST_CASE("PartitionDataBase fills up and compacts on enroll", "[dl_recognition]")
+{
+    erase_partition();
+    std::vector<std::vector<float>> feats = make_feats(1);
+    PartitionDataBase db(PARTITION_LABEL, FEAT_LEN, QUANT_TYPE_SYMM_16BIT, false);
+    int capacity = 0;
+    while (true) {
+        TensorBase tensor({FEAT_LEN}, feats[0].data(), 0, DATA_TYPE_FLOAT, false);
+        esp_err_t ret = db.enroll_feat(&tensor);
+        if (ret != ESP_OK) {
+            TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, ret);
+            break;
+        }
+        capacity++;
+    }
+    TEST_ASSERT_GREATER_THAN(0, capacity);
+    TEST_ASSERT_EQUAL(capacity, db.get_num_feats());
+    // a full bank with deleted records is compacted by the next enroll.
+    TEST_ASSERT_EQUAL(ESP_OK, db.delete_feat(1));
+    TEST_ASSERT_EQUAL(ESP_OK, db.delete_feat(2));
+    enroll(db, feats[0]);
+    TEST_ASSERT_EQUAL(capacity - 1, db.get_num_feats());
+}
@@ -0,0 +1,140 @@
+#include "dl_module_slice.hpp"
+#include "dl_module_split.hpp"
+#include "unity.h"
+#include <vector>
+
+using namespace dl;
+
+namespace {
+int8_t *range_elements(int size)
+{
+    int8_t *ptr = (int8_t *)tool::malloc_aligned(size, sizeof(int8_t), 16, MALLOC_CAP_DEFAULT);
+    for (int i = 0; i < size; i++) {
+        ptr[i] = i % 251 - 125;
+    }
+    return ptr;
+}
+
+int get_size(const std::vector<int> &shape)
+{
+    int size = 1;
+    for (int dim : shape) {
+        size *= dim;
+    }
+    return size;
+}
+
+// The view offset of Slice must point at the elements TensorBase::slice copies, and forward() must leave an output
+// placed there as it is.
+void test_slice_view(std::vector<int> input_shape,
+                     std::vector<int> start,
+                     std::vector<int> end,
+                     std::vector<int> axes,
+                     std::vector<int> step,
+                     int expected_offset)
+{
+    int input_size = get_size(input_shape);
+    int8_t *input = range_elements(input_size);
+    TensorBase input_tensor(input_shape, input, 0, DATA_TYPE_INT8, false);
+    module::Slice slice(start, end, axes, step, "slice", MODULE_NON_INPLACE, QUANT_TYPE_SYMM_8BIT);
+    std::vector<std::vector<int>> input_shapes(1, input_shape);
+    std::vector<int> output_shape = slice.get_output_shape(input_shapes)[0];
+    int offset = slice.get_output_view_offset(0, input_shape);
+    TEST_ASSERT_EQUAL(expected_offset, offset);
+
+    int output_size = get_size(output_shape);
+    int8_t *reference = (int8_t *)tool::malloc_aligned(output_size, sizeof(int8_t), 16, MALLOC_CAP_DEFAULT);
+    TensorBase reference_tensor(output_shape, reference, 0, DATA_TYPE_INT8, false);
+    reference_tensor.slice(&input_tensor, start, end, axes, step);
+
+    int8_t *output = (int8_t *)tool::malloc_aligned(output_size, sizeof(int8_t), 16, MALLOC_CAP_DEFAULT);
+    TensorBase output_tensor(output_shape, output, 0, DATA_TYPE_INT8, false);
+    std::vector<TensorBase *> tensors = {&input_tensor, &output_tensor};
+    slice.m_inputs_index = {0};
+    slice.m_outputs_index = {1};
+    slice.forward(tensors, RUNTIME_MODE_SINGLE_CORE);
+    TEST_ASSERT_EQUAL_INT8_ARRAY(reference, output, output_size);
+
+    if (offset >= 0) {
+        TEST_ASSERT_EQUAL_INT8_ARRAY(reference, input + offset, output_size);
+        TensorBase view_tensor(output_shape, input + offset, 0, DATA_TYPE_INT8, false);
+        tensors[1] = &view_tensor;
+        slice.forward(tensors, RUNTIME_MODE_SINGLE_CORE);
+        TEST_ASSERT_EQUAL_INT8_ARRAY(reference, input + offset, output_size);
+    }
+    heap_caps_free(input);
+    heap_caps_free(reference);
+    heap_caps_free(output);
+}
+
+// Every output of Split placed at its view offset must hold the same elements as a copied output.
+void test_split_view(std::vector<int> input_shape, int axis, std::vector<int64_t> split, bool is_view)
+{
+    int input_size = get_size(input_shape);
+    int8_t *input = range_elements(input_size);
+    TensorBase input_tensor(input_shape, input, 0, DATA_TYPE_INT8, false);
+    TensorBase *split_tensor = new TensorBase({(int)split.size()}, split.data(), 0, DATA_TYPE_INT64);
+    module::Split module(split_tensor, axis, -1, "split", MODULE_NON_INPLACE, QUANT_TYPE_SYMM_8BIT);
+    std::vector<std::vector<int>> input_shapes(1, input_shape);
+    std::vector<std::vector<int>> output_shapes = module.get_output_shape(input_shapes);
+
+    std::vector<TensorBase *> tensors = {&input_tensor};
+    std::vector<TensorBase *> view_tensors = {&input_tensor};
+    module.m_inputs_index = {0};
+    for (int i = 0; i < output_shapes.size(); i++) {
+        int output_size = get_size(output_shapes[i]);
+        int8_t *output = (int8_t *)tool::malloc_aligned(output_size, sizeof(int8_t), 16, MALLOC_CAP_DEFAULT);
+        tensors.push_back(new TensorBase(output_shapes[i], output, 0, DATA_TYPE_INT8, false));
+        int offset = module.get_output_view_offset(i, input_shape);
+        TEST_ASSERT_EQUAL(is_view, offset >= 0);
+        if (offset >= 0) {
+            view_tensors.push_back(new TensorBase(output_shapes[i], input + offset, 0, DATA_TYPE_INT8, false));
+        }
+        module.m_outputs_index.push_back(i + 1);
+    }
+    module.forward(tensors, RUNTIME_MODE_SINGLE_CORE);
+
+    if (is_view) {
+        module.forward(view_tensors, RUNTIME_MODE_SINGLE_CORE);
+        for (int i = 1; i < tensors.size(); i++) {
+            TEST_ASSERT_EQUAL_INT8_ARRAY(
+                tensors[i]->get_element_ptr(), view_tensors[i]->get_element_ptr(), tensors[i]->get_size());
+        }
+    }
+    for (int i = 1; i < tensors.size(); i++) {
+        heap_caps_free(tensors[i]->get_element_ptr());
+        delete tensors[i];
+    }
+    for (int i = 1; i < view_tensors.size(); i++) {
+        delete view_tensors[i];
+    }
+    heap_caps_free(input);
+}
+} // namespace
+
+TEST_CASE("Slice output view offset", "[dl_module]")
+{
+    // one axis cut, the leading axes are 1.
+    test_slice_view({1, 6, 8}, {2}, {5}, {1}, {}, 2 * 8);
+    test_slice_view({1, 6, 8}, {-4}, {-1}, {-2}, {}, 2 * 8);
+    test_slice_view({6, 4, 4}, {1}, {6}, {}, {}, 1 * 16);
+    test_slice_view({1, 1, 64}, {16}, {48}, {2}, {}, 16);
+    // a start past the axis is wrapped as base::get_slice_shape does.
+    test_slice_view({1, 6, 8}, {8}, {6}, {1}, {}, 1 * 8);
+    // a single element along a stepped axis is still contiguous.
+    test_slice_view({1, 1, 64}, {5}, {6}, {2}, {3}, 5);
+    // not contiguous.
+    test_slice_view({2, 6, 8}, {2}, {5}, {1}, {}, -1);
+    test_slice_view({1, 6, 8}, {2, 1}, {5, 7}, {1, 2}, {}, -1);
+    test_slice_view({1, 6, 8}, {0}, {6}, {1}, {2}, -1);
+    // the whole input.
+    test_slice_view({1, 6, 8}, {0}, {6}, {1}, {}, 0);
+}
+
+TEST_CASE("Split output view offset", "[dl_module]")
+{
+    test_split_view({1, 48, 4}, 1, {16, 8, 24}, true);
+    test_split_view({1, 1, 96}, -1, {32, 64}, true);
+    test_split_view({96, 2}, 0, {48, 48}, true);
+    test_split_view({2, 48, 4}, 1, {16, 32}, false);
+}
@@ -0,0 +1,104 @@
+#include "dl_module_softmax.hpp"
+#include "unity.h"
+#include <vector>
+
+using namespace dl;
+
+namespace {
+int get_size(const std::vector<int> &shape)
+{
+    int size = 1;
+    for (int dim : shape) {
+        size *= dim;
+    }
+    return size;
+}
+
+// Softmax in double of the dequantized input along axis.
+std::vector<float> softmax_ref(const std::vector<float> &input, const std::vector<int> &shape, int axis)
+{
+    int dims = shape.size();
+    int positive_axis = axis < 0 ? dims + axis : axis;
+    int len = shape[positive_axis];
+    int outer_loop = 1;
+    int inner_loop = 1;
+    for (int i = 0; i < dims; i++) {
+        if (i < positive_axis) {
+            outer_loop *= shape[i];
+        } else if (i > positive_axis) {
+            inner_loop *= shape[i];
+        }
+    }
+    std::vector<float> output(input.size());
+    for (int o = 0; o < outer_loop; o++) {
+        for (int k = 0; k < inner_loop; k++) {
+            int base = o * len * inner_loop + k;
+            double max = input[base];
+            for (int i = 1; i < len; i++) {
+                max = std::max(max, (double)input[base + i * inner_loop]);
+            }
+            double sum = 0;
+            for (int i = 0; i < len; i++) {
+                sum += exp(input[base + i * inner_loop] - max);
+            }
+            for (int i = 0; i < len; i++) {
+                output[base + i * inner_loop] = exp(input[base + i * inner_loop] - max) / sum;
+            }
+        }
+    }
+    return output;
+}
+
+// The quantized Softmax and its float path must match the float reference, on the last axis, with a stride on the
+// other ones, and with the table rebuilt for another input exponent.
+template <typename T>
+void test_softmax(const std::vector<int> &shape, int axis, quant_type_t quant_type, std::vector<int> exponents)
+{
+    int size = get_size(shape);
+    T *input = (T *)tool::malloc_aligned(size, sizeof(T), 16, MALLOC_CAP_DEFAULT);
+    float *output = (float *)tool::malloc_aligned(size, sizeof(float), 16, MALLOC_CAP_DEFAULT);
+    module::Softmax softmax("softmax", axis, MODULE_NON_INPLACE, quant_type);
+    softmax.m_inputs_index = {0};
+    softmax.m_outputs_index = {1};
+
+    for (int exponent : exponents) {
+        std::vector<float> dequant(size);
+        for (int i = 0; i < size; i++) {
+            input[i] = (T)(rand() % (1 << (sizeof(T) * 8)) - (1 << (sizeof(T) * 8 - 1)));
+            dequant[i] = input[i] * DL_SCALE(exponent);
+        }
+        TensorBase input_tensor(shape, input, exponent, sizeof(T) == 1 ? DATA_TYPE_INT8 : DATA_TYPE_INT16, false);
+        TensorBase output_tensor(shape, output, 0, DATA_TYPE_FLOAT, false);
+        std::vector<TensorBase *> tensors = {&input_tensor, &output_tensor};
+        softmax.forward(tensors, RUNTIME_MODE_SINGLE_CORE);
+
+        std::vector<float> reference = softmax_ref(dequant, shape, axis);
+        for (int i = 0; i < size; i++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-5 + reference[i] * 1e-4, reference[i], output[i]);
+        }
+        // The float path, also taken when the table can't be allocated.
+        softmax.forward_float(dequant.data(), size, shape, axis);
+        for (int i = 0; i < size; i++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-5 + reference[i] * 1e-4, reference[i], dequant[i]);
+        }
+    }
+    heap_caps_free(input);
+    heap_caps_free(output);
+}
+} // namespace
+
+TEST_CASE("Softmax int8 matches the float reference", "[dl_module]")
+{
+    test_softmax<int8_t>({2, 3, 37}, -1, QUANT_TYPE_SYMM_8BIT, {-4, -6});
+    test_softmax<int8_t>({1, 64}, 1, QUANT_TYPE_SYMM_8BIT, {-3});
+    test_softmax<int8_t>({2, 5, 7}, 1, QUANT_TYPE_SYMM_8BIT, {-4, -2});
+    test_softmax<int8_t>({4, 3, 6}, 0, QUANT_TYPE_SYMM_8BIT, {-5});
+}
+
+TEST_CASE("Softmax int16 matches the float reference", "[dl_module]")
+{
+    test_softmax<int16_t>({2, 3, 37}, -1, QUANT_TYPE_SYMM_16BIT, {-12, -9});
+    test_softmax<int16_t>({1, 64}, 1, QUANT_TYPE_SYMM_16BIT, {-10});
+    test_softmax<int16_t>({2, 5, 7}, -2, QUANT_TYPE_SYMM_16BIT, {-12, -8});
+    test_softmax<int16_t>({4, 3, 6}, 0, QUANT_TYPE_SYMM_16BIT, {-11});
+}
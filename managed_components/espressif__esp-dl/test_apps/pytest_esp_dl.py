@@ -0,0 +1,7 @@
+import pytest
+
+
+@pytest.mark.esp32p4
+@pytest.mark.esp32s3
+def test_esp_dl(dut) -> None:
+    dut.run_all_single_board_cases()
@@ -4,16 +4,15 @@ namespace dl {
 namespace cls {
 ClsPostprocessor::ClsPostprocessor(
     Model *model, const int top_k, const float score_thr, bool need_softmax, const std::string &output_name) :
-    m_top_k(top_k), m_score_thr(score_thr), m_need_softmax(need_softmax)
+    m_model(model), m_output_name(output_name), m_top_k(top_k), m_score_thr(score_thr), m_need_softmax(need_softmax)
 {
     if (output_name.empty()) {
         std::map<std::string, dl::TensorBase *> model_outputs_map = model->get_outputs();
         assert(model_outputs_map.size() == 1);
-        m_model_output = model_outputs_map.begin()->second;
-    } else {
-        m_model_output = model->get_intermediate(output_name);
+        m_output_name = model_outputs_map.begin()->first;
     }
-    m_output = new dl::TensorBase(m_model_output->shape, nullptr, 0, dl::DATA_TYPE_FLOAT);
+    TensorBase *model_output = model->get_intermediate(m_output_name);
+    m_output = new dl::TensorBase(model_output->shape, nullptr, 0, dl::DATA_TYPE_FLOAT);
     if (need_softmax) {
         m_softmax_module = new dl::module::Softmax(nullptr, -1, dl::MODULE_NON_INPLACE, dl::QUANT_TYPE_SYMM_8BIT);
     }
@@ -33,10 +32,12 @@ ClsPostprocessor::~ClsPostprocessor()
 
 std::vector<dl::cls::result_t> &ClsPostprocessor::postprocess()
 {
+    // The tensor changes with the memory plan of the model.
+    TensorBase *model_output = m_model->get_intermediate(m_output_name);
     if (m_need_softmax) {
-        m_softmax_module->run(m_model_output, m_output);
+        m_softmax_module->run(model_output, m_output);
     } else {
-        m_output->assign(m_model_output);
+        m_output->assign(model_output);
     }
 
     m_cls_result.clear();
@@ -18,7 +18,8 @@ protected:
     const char **m_cat_names;
 
 private:
-    TensorBase *m_model_output;
+    Model *m_model;
+    std::string m_output_name;
     int m_top_k;
     float m_score_thr;
     bool m_need_softmax;
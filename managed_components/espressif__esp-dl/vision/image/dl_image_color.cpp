@@ -60,55 +60,332 @@ template void convert_img_loop<uint8_t, int8_t>(
 template void convert_img_loop<uint8_t, int16_t>(
     const img_t &src_img, img_t &dst_img, uint32_t caps, void *norm_lut, const std::vector<int> &crop_area);
 
+/**
+ * @brief Swap the bytes of rgb565 pixels, two pixels per 32-bit word when both rows are word aligned.
+ */
+inline void rgb565_row_byte_swap(const uint16_t *src_ptr, uint16_t *dst_ptr, int n)
+{
+    int i = 0;
+    if (!(((uintptr_t)src_ptr | (uintptr_t)dst_ptr) & 3)) {
+        for (; i + 2 <= n; i += 2) {
+            uint32_t word;
+            memcpy(&word, src_ptr + i, 4);
+            word = ((word & 0x00ff00ff) << 8) | ((word >> 8) & 0x00ff00ff);
+            memcpy(dst_ptr + i, &word, 4);
+        }
+    }
+    for (; i < n; i++) {
+        dst_ptr[i] = (uint16_t)((src_ptr[i] << 8) | (src_ptr[i] >> 8));
+    }
+}
+
+template <pix_type_t src_type, pix_type_t dst_type, uint32_t caps>
+void convert_row(const void *src_ptr, void *dst_ptr, int n, void *norm_lut)
+{
+    constexpr int step_src = DL_IMAGE_IS_PIX_TYPE_RGB888(src_type) ? 3 : 1;
+    constexpr int step_dst = DL_IMAGE_IS_PIX_TYPE_RGB888(dst_type) ? 3 : 1;
+    if constexpr (src_type == DL_IMAGE_PIX_TYPE_RGB565) {
+        uint16_t *src = (uint16_t *)src_ptr;
+        if constexpr (dst_type == DL_IMAGE_PIX_TYPE_RGB565) {
+            uint16_t *dst = (uint16_t *)dst_ptr;
+            if constexpr ((caps & (DL_IMAGE_CAP_RGB565_BYTE_SWAP | DL_IMAGE_CAP_RGB_SWAP)) == 0) {
+                if (src != dst) {
+                    memmove(dst, src, n * sizeof(uint16_t));
+                }
+            } else if constexpr ((caps & (DL_IMAGE_CAP_RGB565_BYTE_SWAP | DL_IMAGE_CAP_RGB_SWAP)) ==
+                                 DL_IMAGE_CAP_RGB565_BYTE_SWAP) {
+                rgb565_row_byte_swap(src, dst, n);
+            } else {
+                for (int i = 0; i < n; i++) {
+                    convert_pixel_from_rgb565_to_rgb565(src + i, dst + i, caps);
+                }
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_RGB888) {
+            uint8_t *dst = (uint8_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_rgb565_to_rgb888(src + i, dst + i * step_dst, caps);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_RGB888_QINT8) {
+            int8_t *dst = (int8_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_rgb565_to_rgb888_quant<int8_t>(src + i, dst + i * step_dst, caps, (int8_t *)norm_lut);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_RGB888_QINT16) {
+            int16_t *dst = (int16_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_rgb565_to_rgb888_quant<int16_t>(
+                    src + i, dst + i * step_dst, caps, (int16_t *)norm_lut);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_GRAY) {
+            uint8_t *dst = (uint8_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_rgb565_to_gray(src + i, dst + i, caps);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_GRAY_QINT8) {
+            int8_t *dst = (int8_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_rgb565_to_gray_quant<int8_t>(src + i, dst + i, caps, (int8_t *)norm_lut);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_GRAY_QINT16) {
+            int16_t *dst = (int16_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_rgb565_to_gray_quant<int16_t>(src + i, dst + i, caps, (int16_t *)norm_lut);
+            }
+        }
+    } else if constexpr (src_type == DL_IMAGE_PIX_TYPE_RGB888) {
+        uint8_t *src = (uint8_t *)src_ptr;
+        if constexpr (dst_type == DL_IMAGE_PIX_TYPE_RGB888) {
+            uint8_t *dst = (uint8_t *)dst_ptr;
+            if constexpr (!(caps & DL_IMAGE_CAP_RGB_SWAP)) {
+                if (src != dst) {
+                    memmove(dst, src, n * 3);
+                }
+            } else {
+                for (int i = 0; i < n * 3; i += 3) {
+                    convert_pixel_from_rgb888_to_rgb888(src + i, dst + i, caps);
+                }
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_RGB565) {
+            uint16_t *dst = (uint16_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_rgb888_to_rgb565(src + i * step_src, dst + i, caps);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_RGB888_QINT8) {
+            int8_t *dst = (int8_t *)dst_ptr;
+            for (int i = 0; i < n * 3; i += 3) {
+                convert_pixel_from_rgb888_to_rgb888_quant<int8_t>(src + i, dst + i, caps, (int8_t *)norm_lut);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_RGB888_QINT16) {
+            int16_t *dst = (int16_t *)dst_ptr;
+            for (int i = 0; i < n * 3; i += 3) {
+                convert_pixel_from_rgb888_to_rgb888_quant<int16_t>(src + i, dst + i, caps, (int16_t *)norm_lut);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_GRAY) {
+            uint8_t *dst = (uint8_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_rgb888_to_gray(src + i * step_src, dst + i, caps);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_GRAY_QINT8) {
+            int8_t *dst = (int8_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_rgb888_to_gray_quant<int8_t>(src + i * step_src, dst + i, caps, (int8_t *)norm_lut);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_GRAY_QINT16) {
+            int16_t *dst = (int16_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_rgb888_to_gray_quant<int16_t>(
+                    src + i * step_src, dst + i, caps, (int16_t *)norm_lut);
+            }
+        }
+    } else if constexpr (src_type == DL_IMAGE_PIX_TYPE_GRAY) {
+        uint8_t *src = (uint8_t *)src_ptr;
+        if constexpr (dst_type == DL_IMAGE_PIX_TYPE_GRAY_QINT8) {
+            int8_t *dst = (int8_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_gray_to_gray_quant<int8_t>(src + i, dst + i, (int8_t *)norm_lut);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_GRAY_QINT16) {
+            int16_t *dst = (int16_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_gray_to_gray_quant<int16_t>(src + i, dst + i, (int16_t *)norm_lut);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_RGB888) {
+            uint8_t *dst = (uint8_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_gray_to_rgb888(src + i, dst + i * step_dst);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_RGB888_QINT8) {
+            int8_t *dst = (int8_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_gray_to_rgb888_quant<int8_t>(src + i, dst + i * step_dst, (int8_t *)norm_lut);
+            }
+        } else if constexpr (dst_type == DL_IMAGE_PIX_TYPE_RGB888_QINT16) {
+            int16_t *dst = (int16_t *)dst_ptr;
+            for (int i = 0; i < n; i++) {
+                convert_pixel_from_gray_to_rgb888_quant<int16_t>(src + i, dst + i * step_dst, (int16_t *)norm_lut);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Pick the specialization of the caps, only the caps in mask make a difference to the conversion.
+ */
+template <pix_type_t src_type, pix_type_t dst_type, uint32_t mask>
+convert_row_func_t select_convert_row(uint32_t caps)
+{
+    switch (caps & mask) {
+    case 0:
+        return convert_row<src_type, dst_type, 0>;
+    case 1:
+        return convert_row<src_type, dst_type, 1 & mask>;
+    case 2:
+        return convert_row<src_type, dst_type, 2 & mask>;
+    case 3:
+        return convert_row<src_type, dst_type, 3 & mask>;
+    case 4:
+        return convert_row<src_type, dst_type, 4 & mask>;
+    case 5:
+        return convert_row<src_type, dst_type, 5 & mask>;
+    case 6:
+        return convert_row<src_type, dst_type, 6 & mask>;
+    default:
+        return convert_row<src_type, dst_type, 7 & mask>;
+    }
+}
+
+convert_row_func_t get_convert_row_func(pix_type_t src_type, pix_type_t dst_type, uint32_t caps)
+{
+    constexpr uint32_t rgb565_mask = DL_IMAGE_CAP_RGB_SWAP | DL_IMAGE_CAP_RGB565_BIG_ENDIAN;
+    constexpr uint32_t rgb888_mask = DL_IMAGE_CAP_RGB_SWAP;
+    if (src_type == DL_IMAGE_PIX_TYPE_RGB565) {
+        switch (dst_type) {
+        case DL_IMAGE_PIX_TYPE_RGB565:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB565,
+                                      DL_IMAGE_PIX_TYPE_RGB565,
+                                      rgb565_mask | DL_IMAGE_CAP_RGB565_BYTE_SWAP>(caps);
+        case DL_IMAGE_PIX_TYPE_RGB888:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_RGB888, rgb565_mask>(caps);
+        case DL_IMAGE_PIX_TYPE_RGB888_QINT8:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_RGB888_QINT8, rgb565_mask>(caps);
+        case DL_IMAGE_PIX_TYPE_RGB888_QINT16:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_RGB888_QINT16, rgb565_mask>(caps);
+        case DL_IMAGE_PIX_TYPE_GRAY:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_GRAY, rgb565_mask>(caps);
+        case DL_IMAGE_PIX_TYPE_GRAY_QINT8:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_GRAY_QINT8, rgb565_mask>(caps);
+        case DL_IMAGE_PIX_TYPE_GRAY_QINT16:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_GRAY_QINT16, rgb565_mask>(caps);
+        default:
+            return nullptr;
+        }
+    } else if (src_type == DL_IMAGE_PIX_TYPE_RGB888) {
+        switch (dst_type) {
+        case DL_IMAGE_PIX_TYPE_RGB565:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_RGB565, rgb565_mask>(caps);
+        case DL_IMAGE_PIX_TYPE_RGB888:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_RGB888, rgb888_mask>(caps);
+        case DL_IMAGE_PIX_TYPE_RGB888_QINT8:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_RGB888_QINT8, rgb888_mask>(caps);
+        case DL_IMAGE_PIX_TYPE_RGB888_QINT16:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_RGB888_QINT16, rgb888_mask>(caps);
+        case DL_IMAGE_PIX_TYPE_GRAY:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_GRAY, rgb888_mask>(caps);
+        case DL_IMAGE_PIX_TYPE_GRAY_QINT8:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_GRAY_QINT8, rgb888_mask>(caps);
+        case DL_IMAGE_PIX_TYPE_GRAY_QINT16:
+            return select_convert_row<DL_IMAGE_PIX_TYPE_RGB888, DL_IMAGE_PIX_TYPE_GRAY_QINT16, rgb888_mask>(caps);
+        default:
+            return nullptr;
+        }
+    } else if (src_type == DL_IMAGE_PIX_TYPE_GRAY) {
+        switch (dst_type) {
+        case DL_IMAGE_PIX_TYPE_GRAY_QINT8:
+            return convert_row<DL_IMAGE_PIX_TYPE_GRAY, DL_IMAGE_PIX_TYPE_GRAY_QINT8, 0>;
+        case DL_IMAGE_PIX_TYPE_GRAY_QINT16:
+            return convert_row<DL_IMAGE_PIX_TYPE_GRAY, DL_IMAGE_PIX_TYPE_GRAY_QINT16, 0>;
+        case DL_IMAGE_PIX_TYPE_RGB888:
+            return convert_row<DL_IMAGE_PIX_TYPE_GRAY, DL_IMAGE_PIX_TYPE_RGB888, 0>;
+        case DL_IMAGE_PIX_TYPE_RGB888_QINT8:
+            return convert_row<DL_IMAGE_PIX_TYPE_GRAY, DL_IMAGE_PIX_TYPE_RGB888_QINT8, 0>;
+        case DL_IMAGE_PIX_TYPE_RGB888_QINT16:
+            return convert_row<DL_IMAGE_PIX_TYPE_GRAY, DL_IMAGE_PIX_TYPE_RGB888_QINT16, 0>;
+        default:
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Convert the luma of a packed yuv420 image, gathered row by row as gray.
+ */
+static void convert_yuv420_img(const img_t &src_img, img_t &dst_img, void *norm_lut, int x, int y)
+{
+    convert_row_func_t convert_row_func = nullptr;
+    uint8_t *luma_row = nullptr;
+    if (dst_img.pix_type != DL_IMAGE_PIX_TYPE_GRAY) {
+        convert_row_func = get_convert_row_func(DL_IMAGE_PIX_TYPE_GRAY, dst_img.pix_type, 0);
+        if (!convert_row_func) {
+            ESP_LOGE("dl_image_color",
+                     "img conversion between fmt %s and %s is not implemented yet.",
+                     pix_type_to_str(src_img.pix_type).c_str(),
+                     pix_type_to_str(dst_img.pix_type).c_str());
+            return;
+        }
+        luma_row = (uint8_t *)tool::malloc_aligned(dst_img.width, sizeof(uint8_t), 16, MALLOC_CAP_INTERNAL);
+        if (!luma_row) {
+            ESP_LOGE("dl_image_color", "Failed to allocate the luma row.");
+            return;
+        }
+    }
+    int dst_row_bytes = dst_img.width * get_pix_byte_size(dst_img.pix_type);
+    for (int i = 0; i < dst_img.height; i++) {
+        uint8_t *dst_row = (uint8_t *)dst_img.data + i * dst_row_bytes;
+        uint8_t *row = luma_row ? luma_row : dst_row;
+        for (int j = 0; j < dst_img.width; j++) {
+            row[j] = *get_luma_ptr(src_img, x + j, y + i);
+        }
+        if (convert_row_func) {
+            convert_row_func(luma_row, dst_row, dst_img.width, norm_lut);
+        }
+    }
+    if (luma_row) {
+        heap_caps_free(luma_row);
+    }
+}
+
 void convert_img(const img_t &src_img, img_t &dst_img, uint32_t caps, void *norm_lut, const std::vector<int> &crop_area)
 {
     // TODO if do nothing ,just copy.
     assert(src_img.data);
     assert(dst_img.data);
     assert(src_img.height > 0 && src_img.width > 0);
-    if (crop_area.empty()) {
-        dst_img.height = src_img.height;
-        dst_img.width = src_img.width;
-    } else {
-        assert(crop_area.size() == 4);
-        assert(crop_area[2] > crop_area[0]);
-        assert(crop_area[3] > crop_area[1]);
-        assert(crop_area[0] < src_img.width && crop_area[0] >= 0);
-        assert(crop_area[1] < src_img.height && crop_area[1] >= 0);
-        assert(crop_area[2] <= src_img.width && crop_area[2] > 0);
-        assert(crop_area[3] <= src_img.height && crop_area[3] > 0);
-        dst_img.height = crop_area[3] - crop_area[1];
-        dst_img.width = crop_area[2] - crop_area[0];
+    if (src_img.pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
+        if (crop_area.empty()) {
+            dst_img.height = src_img.height;
+            dst_img.width = src_img.width;
+            convert_yuv420_img(src_img, dst_img, norm_lut, 0, 0);
+        } else {
+            assert(crop_area.size() == 4);
+            dst_img.height = crop_area[3] - crop_area[1];
+            dst_img.width = crop_area[2] - crop_area[0];
+            convert_yuv420_img(src_img, dst_img, norm_lut, crop_area[0], crop_area[1]);
+        }
+        return;
     }
-    if (src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565) {
-        convert_img_loop<uint16_t, uint16_t>(src_img, dst_img, caps, norm_lut, crop_area);
-    } else if ((src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888) ||
-               (src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY)) {
-        convert_img_loop<uint16_t, uint8_t>(src_img, dst_img, caps, norm_lut, crop_area);
-    } else if ((src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888_QINT8) ||
-               (src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY_QINT8)) {
-        convert_img_loop<uint16_t, int8_t>(src_img, dst_img, caps, norm_lut, crop_area);
-    } else if ((src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888_QINT16) ||
-               (src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY_QINT16)) {
-        convert_img_loop<uint16_t, int16_t>(src_img, dst_img, caps, norm_lut, crop_area);
-    } else if ((src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888) ||
-               (src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY)) {
-        convert_img_loop<uint8_t, uint8_t>(src_img, dst_img, caps, norm_lut, crop_area);
-    } else if (src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565) {
-        convert_img_loop<uint8_t, uint16_t>(src_img, dst_img, caps, norm_lut, crop_area);
-    } else if ((src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY_QINT8) ||
-               (src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888_QINT8) ||
-               (src_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY && dst_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY_QINT8)) {
-        convert_img_loop<uint8_t, int8_t>(src_img, dst_img, caps, norm_lut, crop_area);
-    } else if ((src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY_QINT16) ||
-               (src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888 && dst_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888_QINT16) ||
-               (src_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY && dst_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY_QINT16)) {
-        convert_img_loop<uint8_t, int16_t>(src_img, dst_img, caps, norm_lut, crop_area);
-    } else {
+    convert_row_func_t convert_row_func = get_convert_row_func(src_img.pix_type, dst_img.pix_type, caps);
+    if (!convert_row_func) {
         ESP_LOGE("dl_image_color",
                  "img conversion between fmt %s and %s is not implemented yet.",
                  pix_type_to_str(src_img.pix_type).c_str(),
                  pix_type_to_str(dst_img.pix_type).c_str());
+        return;
+    }
+    int src_pix_size = get_pix_byte_size(src_img.pix_type);
+    int dst_pix_size = get_pix_byte_size(dst_img.pix_type);
+    uint8_t *src_ptr = (uint8_t *)src_img.data;
+    uint8_t *dst_ptr = (uint8_t *)dst_img.data;
+    if (crop_area.empty()) {
+        dst_img.height = src_img.height;
+        dst_img.width = src_img.width;
+        convert_row_func(src_ptr, dst_ptr, dst_img.height * dst_img.width, norm_lut);
+        return;
+    }
+    assert(crop_area.size() == 4);
+    assert(crop_area[2] > crop_area[0]);
+    assert(crop_area[3] > crop_area[1]);
+    assert(crop_area[0] < src_img.width && crop_area[0] >= 0);
+    assert(crop_area[1] < src_img.height && crop_area[1] >= 0);
+    assert(crop_area[2] <= src_img.width && crop_area[2] > 0);
+    assert(crop_area[3] <= src_img.height && crop_area[3] > 0);
+    dst_img.height = crop_area[3] - crop_area[1];
+    dst_img.width = crop_area[2] - crop_area[0];
+    src_ptr += (crop_area[1] * src_img.width + crop_area[0]) * src_pix_size;
+    for (int i = 0; i < dst_img.height; i++) {
+        convert_row_func(src_ptr, dst_ptr, dst_img.width, norm_lut);
+        src_ptr += src_img.width * src_pix_size;
+        dst_ptr += dst_img.width * dst_pix_size;
     }
 }
 
@@ -103,12 +103,11 @@ template <typename T>
 inline void convert_pixel_from_rgb888_to_gray_quant(uint8_t *src_ptr, T *dst_ptr, uint32_t caps, T *norm_lut)
 {
     assert(norm_lut);
+    // The lut gives the quantized value, no clamp.
     if (caps & DL_IMAGE_CAP_RGB_SWAP) {
-        T tmp = norm_lut[(src_ptr[0] * 38 + src_ptr[1] * 75 + src_ptr[2] * 15) >> 7];
-        *dst_ptr = std::max(std::min(tmp, (T)255), (T)0);
+        *dst_ptr = norm_lut[(src_ptr[0] * 38 + src_ptr[1] * 75 + src_ptr[2] * 15) >> 7];
     } else {
-        T tmp = norm_lut[(src_ptr[2] * 38 + src_ptr[1] * 75 + src_ptr[1] * 15) >> 7];
-        *dst_ptr = std::max(std::min(tmp, (T)255), (T)0);
+        *dst_ptr = norm_lut[(src_ptr[2] * 38 + src_ptr[1] * 75 + src_ptr[0] * 15) >> 7];
     }
 }
 inline void convert_pixel_from_rgb565_to_gray(uint16_t *src_ptr, uint8_t *dst_ptr, uint32_t caps)
@@ -129,6 +128,19 @@ inline void convert_pixel_from_gray_to_gray_quant(uint8_t *src_ptr, T *dst_ptr,
 {
     *dst_ptr = norm_lut[*src_ptr];
 }
+// Luma into the three channels, so that a luma frame feeds a rgb model.
+inline void convert_pixel_from_gray_to_rgb888(uint8_t *src_ptr, uint8_t *dst_ptr)
+{
+    dst_ptr[0] = dst_ptr[1] = dst_ptr[2] = *src_ptr;
+}
+template <typename T>
+inline void convert_pixel_from_gray_to_rgb888_quant(uint8_t *src_ptr, T *dst_ptr, T *norm_lut)
+{
+    assert(norm_lut);
+    dst_ptr[0] = norm_lut[*src_ptr];
+    dst_ptr[1] = (norm_lut + 256)[*src_ptr];
+    dst_ptr[2] = (norm_lut + 512)[*src_ptr];
+}
 inline void convert_pixel_from_rgb888_to_rgb888(uint8_t *src_ptr, uint8_t *dst_ptr, uint32_t caps)
 {
     if (caps & DL_IMAGE_CAP_RGB_SWAP) {
@@ -231,6 +243,14 @@ inline void convert_pixel(const pix_t &src_pix, pix_t &dst_pix, uint32_t caps, v
     } else if (src_pix.type == DL_IMAGE_PIX_TYPE_GRAY && dst_pix.type == DL_IMAGE_PIX_TYPE_GRAY_QINT16) {
         convert_pixel_from_gray_to_gray_quant<int16_t>(
             (uint8_t *)src_pix.data, (int16_t *)dst_pix.data, (int16_t *)norm_lut);
+    } else if (src_pix.type == DL_IMAGE_PIX_TYPE_GRAY && dst_pix.type == DL_IMAGE_PIX_TYPE_RGB888) {
+        convert_pixel_from_gray_to_rgb888((uint8_t *)src_pix.data, (uint8_t *)dst_pix.data);
+    } else if (src_pix.type == DL_IMAGE_PIX_TYPE_GRAY && dst_pix.type == DL_IMAGE_PIX_TYPE_RGB888_QINT8) {
+        convert_pixel_from_gray_to_rgb888_quant<int8_t>(
+            (uint8_t *)src_pix.data, (int8_t *)dst_pix.data, (int8_t *)norm_lut);
+    } else if (src_pix.type == DL_IMAGE_PIX_TYPE_GRAY && dst_pix.type == DL_IMAGE_PIX_TYPE_RGB888_QINT16) {
+        convert_pixel_from_gray_to_rgb888_quant<int16_t>(
+            (uint8_t *)src_pix.data, (int16_t *)dst_pix.data, (int16_t *)norm_lut);
     } else {
         ESP_LOGE("dl_image_color",
                  "pixel conversion between fmt %s and %s is not implemented yet.",
@@ -239,6 +259,29 @@ inline void convert_pixel(const pix_t &src_pix, pix_t &dst_pix, uint32_t caps, v
     }
 }
 
+/**
+ * @brief Convert a row of pixels.
+ *
+ * @param src_ptr  The first source pixel
+ * @param dst_ptr  The first destination pixel
+ * @param n        The number of pixels
+ * @param norm_lut The normalization lut of the quantized destination types
+ */
+typedef void (*convert_row_func_t)(const void *src_ptr, void *dst_ptr, int n, void *norm_lut);
+
+/**
+ * @brief Get the row kernel of a conversion. Kernels are specialized at compile time for the pixel types and the caps
+ * that matter to them, so no branch is left in the pixel loop. convert_img() converts with them, convert_img_loop()
+ * is the per-pixel reference.
+ *
+ * @param src_type Source pixel type
+ * @param dst_type Destination pixel type
+ * @param caps     DL_IMAGE_CAP_RGB_SWAP, DL_IMAGE_CAP_RGB565_BYTE_SWAP and DL_IMAGE_CAP_RGB565_BIG_ENDIAN are used
+ *
+ * @return The kernel, nullptr if the conversion is not implemented
+ */
+convert_row_func_t get_convert_row_func(pix_type_t src_type, pix_type_t dst_type, uint32_t caps);
+
 template <typename T1, typename T2>
 void convert_img_loop(
     const img_t &src_img, img_t &dst_img, uint32_t caps, void *norm_lut, const std::vector<int> &crop_area);
@@ -22,8 +22,9 @@
 #define DL_IMAGE_BIG_ENDIAN_RGB565_BIT2(x) ((uint8_t)(((x) & 0x7E0) >> 3))
 #define DL_IMAGE_BIG_ENDIAN_RGB565_BIT3(x) ((uint8_t)(((x) & 0x1F) << 3))
 
-#define DL_IMAGE_IS_PIX_TYPE_QUANT(x) \
-    ((x) != DL_IMAGE_PIX_TYPE_RGB888 && (x) != DL_IMAGE_PIX_TYPE_RGB565 && (x) != DL_IMAGE_PIX_TYPE_GRAY)
+#define DL_IMAGE_IS_PIX_TYPE_QUANT(x)                                                                       \
+    ((x) != DL_IMAGE_PIX_TYPE_RGB888 && (x) != DL_IMAGE_PIX_TYPE_RGB565 && (x) != DL_IMAGE_PIX_TYPE_GRAY && \
+     (x) != DL_IMAGE_PIX_TYPE_YUV420)
 #define DL_IMAGE_IS_PIX_TYPE_RGB888(x) \
     ((x) == DL_IMAGE_PIX_TYPE_RGB888 || (x) == DL_IMAGE_PIX_TYPE_RGB888_QINT8 || (x) == DL_IMAGE_PIX_TYPE_RGB888_QINT16)
 
@@ -39,7 +40,10 @@ typedef enum {
     DL_IMAGE_PIX_TYPE_GRAY,
     DL_IMAGE_PIX_TYPE_GRAY_QINT8,
     DL_IMAGE_PIX_TYPE_GRAY_QINT16,
-    DL_IMAGE_PIX_TYPE_RGB565
+    DL_IMAGE_PIX_TYPE_RGB565,
+    // Packed as the ESP32-P4 ISP and encoders lay it out, "u y y" on even lines and "v y y" on odd ones, the width is
+    // even. Read as gray by its luma, which is also what the draw functions draw on.
+    DL_IMAGE_PIX_TYPE_YUV420
 } pix_type_t;
 
 inline std::string pix_type_to_str(pix_type_t type)
@@ -59,6 +63,8 @@ inline std::string pix_type_to_str(pix_type_t type)
         return "DL_IMAGE_PIX_TYPE_GRAY_QINT16";
     case DL_IMAGE_PIX_TYPE_RGB565:
         return "DL_IMAGE_PIX_TYPE_RGB565";
+    case DL_IMAGE_PIX_TYPE_YUV420:
+        return "DL_IMAGE_PIX_TYPE_YUV420";
     default:
         return "UNK_PIX_TYPE";
     }
@@ -90,6 +96,27 @@ inline size_t get_img_byte_size(const img_t &img)
         return img.height * img.width;
     case DL_IMAGE_PIX_TYPE_RGB888_QINT16:
         return img.height * img.width * 6;
+    case DL_IMAGE_PIX_TYPE_YUV420:
+        return img.height * img.width * 3 / 2;
+    default:
+        return 0;
+    }
+}
+
+inline int get_pix_byte_size(pix_type_t type)
+{
+    switch (type) {
+    case DL_IMAGE_PIX_TYPE_RGB888:
+    case DL_IMAGE_PIX_TYPE_RGB888_QINT8:
+        return 3;
+    case DL_IMAGE_PIX_TYPE_RGB565:
+    case DL_IMAGE_PIX_TYPE_GRAY_QINT16:
+        return 2;
+    case DL_IMAGE_PIX_TYPE_GRAY:
+    case DL_IMAGE_PIX_TYPE_GRAY_QINT8:
+        return 1;
+    case DL_IMAGE_PIX_TYPE_RGB888_QINT16:
+        return 6;
     default:
         return 0;
     }
@@ -106,12 +133,24 @@ inline int get_img_channel(const img_t &img)
     case DL_IMAGE_PIX_TYPE_GRAY:
     case DL_IMAGE_PIX_TYPE_GRAY_QINT8:
     case DL_IMAGE_PIX_TYPE_GRAY_QINT16:
+    case DL_IMAGE_PIX_TYPE_YUV420:
         return 1;
     default:
         return -1;
     }
 }
 
+/**
+ * @brief Luma of the pixel (x, y) of a gray or packed yuv420 image.
+ */
+inline const uint8_t *get_luma_ptr(const img_t &img, int x, int y)
+{
+    if (img.pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
+        return (const uint8_t *)img.data + (size_t)y * img.width * 3 / 2 + x / 2 * 3 + 1 + (x & 1);
+    }
+    return (const uint8_t *)img.data + (size_t)y * img.width + x;
+}
+
 typedef struct {
     uint8_t *data;
     int width;
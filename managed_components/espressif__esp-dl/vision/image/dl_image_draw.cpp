@@ -1,28 +1,193 @@
 #include "dl_image_draw.hpp"
+#include <algorithm>
 
 namespace dl {
 namespace image {
+// 5x7 glyphs of the printable ASCII characters, one byte per row, the MSB of the 5 bits is the left column.
+static const uint8_t s_font_5x7[95][DL_IMAGE_FONT_HEIGHT] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+    {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}, // '!'
+    {0x0a, 0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00}, // '"'
+    {0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a}, // '#'
+    {0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04}, // '$'
+    {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // '%'
+    {0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d}, // '&'
+    {0x0c, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00}, // '''
+    {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, // '('
+    {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // ')'
+    {0x00, 0x0a, 0x04, 0x1f, 0x04, 0x0a, 0x00}, // '*'
+    {0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00}, // '+'
+    {0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08}, // ','
+    {0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00}, // '-'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c}, // '.'
+    {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // '/'
+    {0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e}, // '0'
+    {0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e}, // '1'
+    {0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f}, // '2'
+    {0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e}, // '3'
+    {0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02}, // '4'
+    {0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e}, // '5'
+    {0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e}, // '6'
+    {0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // '7'
+    {0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e}, // '8'
+    {0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c}, // '9'
+    {0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00}, // ':'
+    {0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x04, 0x08}, // ';'
+    {0x01, 0x02, 0x04, 0x08, 0x04, 0x02, 0x01}, // '<'
+    {0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00}, // '='
+    {0x10, 0x08, 0x04, 0x02, 0x04, 0x08, 0x10}, // '>'
+    {0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}, // '?'
+    {0x0e, 0x11, 0x01, 0x0d, 0x15, 0x15, 0x0e}, // '@'
+    {0x0e, 0x11, 0x11, 0x11, 0x1f, 0x11, 0x11}, // 'A'
+    {0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e}, // 'B'
+    {0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e}, // 'C'
+    {0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c}, // 'D'
+    {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f}, // 'E'
+    {0x1f, 0x10, 0x10, 0x1c, 0x10, 0x10, 0x10}, // 'F'
+    {0x0e, 0x11, 0x10, 0x10, 0x13, 0x11, 0x0e}, // 'G'
+    {0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, // 'H'
+    {0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e}, // 'I'
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c}, // 'J'
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // 'K'
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f}, // 'L'
+    {0x11, 0x1b, 0x15, 0x11, 0x11, 0x11, 0x11}, // 'M'
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // 'N'
+    {0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}, // 'O'
+    {0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10}, // 'P'
+    {0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d}, // 'Q'
+    {0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11}, // 'R'
+    {0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e}, // 'S'
+    {0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // 'T'
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}, // 'U'
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04}, // 'V'
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x1b, 0x11}, // 'W'
+    {0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11}, // 'X'
+    {0x11, 0x11, 0x0a, 0x04, 0x04, 0x04, 0x04}, // 'Y'
+    {0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f}, // 'Z'
+    {0x07, 0x04, 0x04, 0x04, 0x04, 0x04, 0x07}, // '['
+    {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00}, // '\\'
+    {0x1c, 0x04, 0x04, 0x04, 0x04, 0x04, 0x1c}, // ']'
+    {0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00}, // '^'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f}, // '_'
+    {0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00}, // '`'
+    {0x00, 0x00, 0x0e, 0x01, 0x0f, 0x11, 0x0f}, // 'a'
+    {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1e}, // 'b'
+    {0x00, 0x00, 0x0e, 0x10, 0x10, 0x11, 0x0e}, // 'c'
+    {0x01, 0x01, 0x0d, 0x13, 0x11, 0x11, 0x0f}, // 'd'
+    {0x00, 0x00, 0x0e, 0x11, 0x1f, 0x10, 0x0e}, // 'e'
+    {0x06, 0x09, 0x08, 0x1c, 0x08, 0x08, 0x08}, // 'f'
+    {0x00, 0x00, 0x0f, 0x11, 0x0f, 0x01, 0x06}, // 'g'
+    {0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11}, // 'h'
+    {0x04, 0x00, 0x0c, 0x04, 0x04, 0x04, 0x0e}, // 'i'
+    {0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0c}, // 'j'
+    {0x08, 0x08, 0x09, 0x0a, 0x0c, 0x0a, 0x09}, // 'k'
+    {0x0c, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e}, // 'l'
+    {0x00, 0x00, 0x1a, 0x15, 0x15, 0x11, 0x11}, // 'm'
+    {0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11}, // 'n'
+    {0x00, 0x00, 0x0e, 0x11, 0x11, 0x11, 0x0e}, // 'o'
+    {0x00, 0x00, 0x1e, 0x11, 0x1e, 0x10, 0x10}, // 'p'
+    {0x00, 0x00, 0x0d, 0x13, 0x0f, 0x01, 0x01}, // 'q'
+    {0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10}, // 'r'
+    {0x00, 0x00, 0x0e, 0x10, 0x0e, 0x01, 0x1e}, // 's'
+    {0x08, 0x08, 0x1c, 0x08, 0x08, 0x09, 0x06}, // 't'
+    {0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0d}, // 'u'
+    {0x00, 0x00, 0x11, 0x11, 0x11, 0x0a, 0x04}, // 'v'
+    {0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0a}, // 'w'
+    {0x00, 0x00, 0x11, 0x0a, 0x04, 0x0a, 0x11}, // 'x'
+    {0x00, 0x00, 0x11, 0x11, 0x0f, 0x01, 0x0e}, // 'y'
+    {0x00, 0x00, 0x1f, 0x02, 0x04, 0x08, 0x1f}, // 'z'
+    {0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02}, // '{'
+    {0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // '|'
+    {0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08}, // '}'
+    {0x00, 0x04, 0x02, 0x1f, 0x02, 0x04, 0x00}, // '~'
+};
+
+// Fill the pixels [x1, x2] of row y, both ends are already clipped.
+template <typename T>
+static inline void fill_span(const img_t &img, int x1, int x2, int y, const T *pix, int step)
+{
+    if (img.pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
+        // Only the luma, a chroma sample is shared by the pixels around it.
+        uint8_t *luma = (uint8_t *)get_luma_ptr(img, x1, y);
+        for (int x = x1; x <= x2; x++) {
+            *luma = pix[0];
+            luma += 1 + (x & 1);
+        }
+        return;
+    }
+    T *ptr = (T *)img.data + (y * img.width + x1) * step;
+    int n = x2 - x1 + 1;
+    if (step == 1) {
+        std::fill_n(ptr, n, pix[0]);
+    } else {
+        for (int i = 0; i < n; i++) {
+            ptr[0] = pix[0];
+            ptr[1] = pix[1];
+            ptr[2] = pix[2];
+            ptr += 3;
+        }
+    }
+}
+
+template <typename T>
+static inline void fill_rect_clipped(const img_t &img, int x1, int y1, int x2, int y2, const T *pix, int step)
+{
+    x1 = std::max(x1, 0);
+    y1 = std::max(y1, 0);
+    x2 = std::min(x2, img.width - 1);
+    y2 = std::min(y2, img.height - 1);
+    for (int y = y1; y <= y2; y++) {
+        if (x1 <= x2) {
+            fill_span(img, x1, x2, y, pix, step);
+        }
+    }
+}
+
+// The pixel of color in the type of img, rgb565 holds the converted RGB565 pixel, or the luma of a RGB color drawn on
+// a YUV420 img. Returns false for quant images.
+static bool get_draw_pix(const img_t &img, const std::vector<uint8_t> &color, uint32_t caps, uint16_t *rgb565, pix_t &pix)
+{
+    if (DL_IMAGE_IS_PIX_TYPE_QUANT(img.pix_type)) {
+        ESP_LOGE("dl_image_draw", "Can not draw on a quant img.");
+        return false;
+    }
+    if (img.pix_type == DL_IMAGE_PIX_TYPE_YUV420 && color.size() == 3) {
+        pix_t rgb888_pix = {.data = (void *)color.data(), .type = DL_IMAGE_PIX_TYPE_RGB888};
+        pix = {.data = (void *)rgb565, .type = DL_IMAGE_PIX_TYPE_GRAY};
+        convert_pixel(rgb888_pix, pix, caps);
+        return true;
+    }
+    if (img.pix_type == DL_IMAGE_PIX_TYPE_GRAY || img.pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
+        assert(color.size() == 1);
+        pix = {.data = (void *)color.data(), .type = DL_IMAGE_PIX_TYPE_GRAY};
+        return true;
+    }
+    assert(color.size() == 3);
+    pix = {.data = (void *)color.data(), .type = DL_IMAGE_PIX_TYPE_RGB888};
+    if (img.pix_type == DL_IMAGE_PIX_TYPE_RGB565) {
+        pix_t rgb565_pix = {.data = (void *)rgb565, .type = DL_IMAGE_PIX_TYPE_RGB565};
+        convert_pixel(pix, rgb565_pix, caps);
+        pix = rgb565_pix;
+    }
+    return true;
+}
+
 template <typename T>
 void draw_point(const img_t &img, int x, int y, uint8_t radius, const pix_t &pix)
 {
-    T *img_ptr = (T *)img.data;
     T *pix_ptr = (T *)pix.data;
-
     int step = DL_IMAGE_IS_PIX_TYPE_RGB888(pix.type) ? 3 : 1;
     int radius_pow = radius * radius;
 
-    for (int i = -radius; i < radius + 1; i++) {
-        int y_ = DL_CLIP(y + i, 0, img.height - 1);
-        int i_pow = i * i;
-        for (int j = -radius; j < radius + 1; j++) {
-            int x_ = DL_CLIP(x + j, 0, img.width - 1);
-            int j_pow = j * j;
-            if (i_pow + j_pow <= radius_pow) {
-                T *ptr = img_ptr + y_ * img.width * step + x_ * step;
-                for (int s = 0; s < step; s++) {
-                    *ptr++ = pix_ptr[s];
-                }
-            }
+    // One span per row, its half width shrinks as the row gets away from the center.
+    int half = radius;
+    for (int i = 0; i <= radius; i++) {
+        while (half > 0 && half * half + i * i > radius_pow) {
+            half--;
+        }
+        fill_rect_clipped(img, x - half, y - i, x + half, y - i, pix_ptr, step);
+        if (i) {
+            fill_rect_clipped(img, x - half, y + i, x + half, y + i, pix_ptr, step);
         }
     }
 }
@@ -54,46 +219,27 @@ void draw_point(const img_t &img, int x, int y, const std::vector<uint8_t> &colo
         assert(color.size() == 1);
         pix_t pix = {.data = (void *)color.data(), .type = DL_IMAGE_PIX_TYPE_GRAY};
         draw_point<uint8_t>(img, x, y, radius, pix);
+    } else if (img.pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
+        uint16_t luma;
+        pix_t pix;
+        get_draw_pix(img, color, caps, &luma, pix);
+        draw_point<uint8_t>(img, x, y, radius, pix);
     }
 }
 
 template <typename T>
 void draw_hollow_rectangle(const img_t &img, int x1, int y1, int x2, int y2, uint8_t line_width, const pix_t &pix)
 {
-    T *img_ptr = (T *)img.data;
     T *pix_ptr = (T *)pix.data;
-
     int step = DL_IMAGE_IS_PIX_TYPE_RGB888(pix.type) ? 3 : 1;
+    int before = line_width / 2;
+    int after = line_width - line_width / 2 - 1;
 
-    // draw horizon
-    for (int i = -line_width / 2; i < line_width - line_width / 2; i++) {
-        int y1_ = DL_CLIP(y1 + i, 0, img.height - 1);
-        int y2_ = DL_CLIP(y2 + i, 0, img.height - 1);
-        T *row_up = img_ptr + y1_ * img.width * step + x1 * step;
-        T *row_down = img_ptr + y2_ * img.width * step + x1 * step;
-        for (int x = x1; x <= x2; x++) {
-            for (int s = 0; s < step; s++) {
-                *row_up++ = pix_ptr[s];
-                *row_down++ = pix_ptr[s];
-            }
-        }
-    }
-
-    // draw vertical
-    for (int i = -line_width / 2; i < line_width - line_width / 2; i++) {
-        int x1_ = DL_CLIP(x1 + i, 0, img.width - 1);
-        int x2_ = DL_CLIP(x2 + i, 0, img.width - 1);
-        T *colum_left = img_ptr + y1 * img.width * step + x1_ * step;
-        T *colum_right = img_ptr + y1 * img.width * step + x2_ * step;
-        for (int y = y1; y <= y2; y++) {
-            for (int s = 0; s < step; s++) {
-                *colum_left++ = pix_ptr[s];
-                *colum_right++ = pix_ptr[s];
-            }
-            colum_left += (img.width - 1) * step;
-            colum_right += (img.width - 1) * step;
-        }
-    }
+    // horizontal edges are line_width full spans, vertical edges a span of line_width on each row between them
+    fill_rect_clipped(img, x1, y1 - before, x2, y1 + after, pix_ptr, step);
+    fill_rect_clipped(img, x1, y2 - before, x2, y2 + after, pix_ptr, step);
+    fill_rect_clipped(img, x1 - before, y1, x1 + after, y2, pix_ptr, step);
+    fill_rect_clipped(img, x2 - before, y1, x2 + after, y2, pix_ptr, step);
 }
 
 template void draw_hollow_rectangle<uint8_t>(
@@ -134,7 +280,202 @@ void draw_hollow_rectangle(const img_t &img,
         assert(color.size() == 1);
         pix_t pix = {.data = (void *)color.data(), .type = DL_IMAGE_PIX_TYPE_GRAY};
         draw_hollow_rectangle<uint8_t>(img, x1, y1, x2, y2, line_width, pix);
+    } else if (img.pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
+        uint16_t luma;
+        pix_t pix;
+        get_draw_pix(img, color, caps, &luma, pix);
+        draw_hollow_rectangle<uint8_t>(img, x1, y1, x2, y2, line_width, pix);
+    }
+}
+
+template <typename T>
+void draw_filled_rectangle(const img_t &img, int x1, int y1, int x2, int y2, const pix_t &pix)
+{
+    int step = DL_IMAGE_IS_PIX_TYPE_RGB888(pix.type) ? 3 : 1;
+    fill_rect_clipped(img, x1, y1, x2, y2, (T *)pix.data, step);
+}
+
+template void draw_filled_rectangle<uint8_t>(const img_t &img, int x1, int y1, int x2, int y2, const pix_t &pix);
+template void draw_filled_rectangle<uint16_t>(const img_t &img, int x1, int y1, int x2, int y2, const pix_t &pix);
+
+void draw_filled_rectangle(
+    const img_t &img, int x1, int y1, int x2, int y2, const std::vector<uint8_t> &color, uint32_t caps)
+{
+    uint16_t rgb565;
+    pix_t pix;
+    if (!get_draw_pix(img, color, caps, &rgb565, pix)) {
+        return;
+    }
+    if (img.pix_type == DL_IMAGE_PIX_TYPE_RGB565) {
+        draw_filled_rectangle<uint16_t>(img, x1, y1, x2, y2, pix);
+    } else {
+        draw_filled_rectangle<uint8_t>(img, x1, y1, x2, y2, pix);
+    }
+}
+
+void draw_blended_rectangle(const img_t &img,
+                            int x1,
+                            int y1,
+                            int x2,
+                            int y2,
+                            const std::vector<uint8_t> &color,
+                            uint8_t alpha,
+                            uint32_t caps)
+{
+    uint16_t rgb565;
+    pix_t pix;
+    if (!get_draw_pix(img, color, caps, &rgb565, pix)) {
+        return;
+    }
+    x1 = std::max(x1, 0);
+    y1 = std::max(y1, 0);
+    x2 = std::min(x2, img.width - 1);
+    y2 = std::min(y2, img.height - 1);
+
+    if (img.pix_type == DL_IMAGE_PIX_TYPE_RGB565) {
+        // The three fields of both pixels are spread over 32 bits, so that one multiply blends them all.
+        bool swap = !(caps & DL_IMAGE_CAP_RGB565_BIG_ENDIAN);
+        uint32_t c = swap ? __builtin_bswap16(rgb565) : rgb565;
+        c = (c | (c << 16)) & 0x07E0F81F;
+        uint32_t a = (alpha + 4) >> 3;
+        uint32_t c_a = c * a;
+        for (int y = y1; y <= y2; y++) {
+            uint16_t *ptr = (uint16_t *)img.data + y * img.width + x1;
+            for (int x = x1; x <= x2; x++, ptr++) {
+                uint32_t p = swap ? __builtin_bswap16(*ptr) : *ptr;
+                p = (p | (p << 16)) & 0x07E0F81F;
+                p = ((c_a + p * (32 - a)) >> 5) & 0x07E0F81F;
+                p = (p | (p >> 16)) & 0xFFFF;
+                *ptr = swap ? __builtin_bswap16(p) : p;
+            }
+        }
+    } else if (img.pix_type == DL_IMAGE_PIX_TYPE_GRAY || img.pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
+        // The luma samples of a YUV420 row are in pairs, one byte apart within a pair and two bytes apart across.
+        int yuv420 = img.pix_type == DL_IMAGE_PIX_TYPE_YUV420;
+        uint32_t a = alpha + (alpha >> 7);
+        uint32_t c_a = *(uint8_t *)pix.data * a;
+        for (int y = y1; y <= y2; y++) {
+            uint8_t *ptr = (uint8_t *)get_luma_ptr(img, x1, y);
+            for (int x = x1; x <= x2; x++) {
+                *ptr = (c_a + *ptr * (256 - a)) >> 8;
+                ptr += 1 + (yuv420 & x);
+            }
+        }
+    } else {
+        ESP_LOGE("dl_image_draw", "Blending is only supported on RGB565, gray and YUV420 img.");
+    }
+}
+
+template <typename T>
+void draw_text(const img_t &img, int x, int y, const char *text, uint8_t scale, const pix_t &pix)
+{
+    T *pix_ptr = (T *)pix.data;
+    int step = DL_IMAGE_IS_PIX_TYPE_RGB888(pix.type) ? 3 : 1;
+
+    for (const char *c = text; *c; c++, x += DL_IMAGE_FONT_ADVANCE * scale) {
+        if (x >= img.width) {
+            break;
+        }
+        int index = (*c >= ' ' && *c <= '~') ? *c - ' ' : '?' - ' ';
+        const uint8_t *glyph = s_font_5x7[index];
+        for (int row = 0; row < DL_IMAGE_FONT_HEIGHT; row++) {
+            uint8_t bits = glyph[row];
+            int col = 0;
+            // each run of set bits is one span of scale rows
+            while (bits) {
+                while (!(bits & (1 << (DL_IMAGE_FONT_WIDTH - 1 - col)))) {
+                    col++;
+                }
+                int end = col;
+                while (end < DL_IMAGE_FONT_WIDTH && (bits & (1 << (DL_IMAGE_FONT_WIDTH - 1 - end)))) {
+                    bits &= ~(1 << (DL_IMAGE_FONT_WIDTH - 1 - end));
+                    end++;
+                }
+                fill_rect_clipped(img,
+                                  x + col * scale,
+                                  y + row * scale,
+                                  x + end * scale - 1,
+                                  y + (row + 1) * scale - 1,
+                                  pix_ptr,
+                                  step);
+                col = end;
+            }
+        }
+    }
+}
+
+template void draw_text<uint8_t>(const img_t &img, int x, int y, const char *text, uint8_t scale, const pix_t &pix);
+template void draw_text<uint16_t>(const img_t &img, int x, int y, const char *text, uint8_t scale, const pix_t &pix);
+
+void draw_text(const img_t &img,
+               int x,
+               int y,
+               const char *text,
+               const std::vector<uint8_t> &color,
+               uint8_t scale,
+               uint32_t caps)
+{
+    assert(scale > 0);
+    uint16_t rgb565;
+    pix_t pix;
+    if (!get_draw_pix(img, color, caps, &rgb565, pix)) {
+        return;
+    }
+    if (img.pix_type == DL_IMAGE_PIX_TYPE_RGB565) {
+        draw_text<uint16_t>(img, x, y, text, scale, pix);
+    } else {
+        draw_text<uint8_t>(img, x, y, text, scale, pix);
+    }
+}
+
+#if CONFIG_IDF_TARGET_ESP32P4
+esp_err_t draw_filled_rectangle(const img_t &img,
+                                int x1,
+                                int y1,
+                                int x2,
+                                int y2,
+                                const std::vector<uint8_t> &color,
+                                ppa_client_handle_t ppa_handle,
+                                uint32_t caps)
+{
+    assert(ppa_handle);
+    assert(color.size() == 3);
+    ppa_fill_color_mode_t fill_cm;
+    if (img.pix_type == DL_IMAGE_PIX_TYPE_RGB888) {
+        fill_cm = PPA_FILL_COLOR_MODE_RGB888;
+    } else if (img.pix_type == DL_IMAGE_PIX_TYPE_RGB565 && (caps & DL_IMAGE_CAP_RGB565_BIG_ENDIAN)) {
+        // The PPA writes RGB565 in the native byte order only.
+        fill_cm = PPA_FILL_COLOR_MODE_RGB565;
+    } else {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    x1 = std::max(x1, 0);
+    y1 = std::max(y1, 0);
+    x2 = std::min(x2, img.width - 1);
+    y2 = std::min(y2, img.height - 1);
+    if (x1 > x2 || y1 > y2) {
+        return ESP_OK;
     }
+
+    bool rgb_swap = caps & DL_IMAGE_CAP_RGB_SWAP;
+    ppa_fill_oper_config_t fill_oper_config;
+    memset(&fill_oper_config, 0, sizeof(ppa_fill_oper_config_t));
+    fill_oper_config.out.buffer = img.data;
+    fill_oper_config.out.buffer_size = get_img_byte_size(img);
+    fill_oper_config.out.pic_w = img.width;
+    fill_oper_config.out.pic_h = img.height;
+    fill_oper_config.out.block_offset_x = x1;
+    fill_oper_config.out.block_offset_y = y1;
+    fill_oper_config.out.fill_cm = fill_cm;
+    fill_oper_config.fill_block_w = x2 - x1 + 1;
+    fill_oper_config.fill_block_h = y2 - y1 + 1;
+    fill_oper_config.fill_argb_color.a = 255;
+    fill_oper_config.fill_argb_color.r = rgb_swap ? color[2] : color[0];
+    fill_oper_config.fill_argb_color.g = color[1];
+    fill_oper_config.fill_argb_color.b = rgb_swap ? color[0] : color[2];
+    fill_oper_config.mode = PPA_TRANS_MODE_BLOCKING;
+    return ppa_do_fill(ppa_handle, &fill_oper_config);
 }
+#endif
 } // namespace image
 } // namespace dl
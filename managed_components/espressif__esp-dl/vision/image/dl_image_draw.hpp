@@ -1,6 +1,11 @@
 #pragma once
 #include "dl_image_color.hpp"
 #include "dl_image_define.hpp"
+#include <cstring>
+
+#define DL_IMAGE_FONT_WIDTH 5  /*<! Glyph width of the built-in font, in pixels at scale 1 */
+#define DL_IMAGE_FONT_HEIGHT 7 /*<! Glyph height of the built-in font, in pixels at scale 1 */
+#define DL_IMAGE_FONT_ADVANCE 6 /*<! Distance between two glyphs, in pixels at scale 1 */
 
 namespace dl {
 namespace image {
@@ -19,5 +24,75 @@ void draw_hollow_rectangle(const img_t &img,
                            uint8_t line_width,
                            uint32_t caps = 0);
 
+/**
+ * @brief Fill a rectangle, clipped to the image. (x2, y2) is included.
+ *
+ * On a YUV420 image, as for every draw function, only the luma is drawn and a RGB color is drawn as its luma.
+ */
+template <typename T>
+void draw_filled_rectangle(const img_t &img, int x1, int y1, int x2, int y2, const pix_t &pix);
+void draw_filled_rectangle(
+    const img_t &img, int x1, int y1, int x2, int y2, const std::vector<uint8_t> &color, uint32_t caps = 0);
+
+/**
+ * @brief Blend a color over a rectangle of a RGB565, gray or YUV420 image, clipped to the image. (x2, y2) is included.
+ *
+ * @param alpha Opacity of the color, 0 keeps the image and 255 fills the rectangle
+ */
+void draw_blended_rectangle(const img_t &img,
+                            int x1,
+                            int y1,
+                            int x2,
+                            int y2,
+                            const std::vector<uint8_t> &color,
+                            uint8_t alpha,
+                            uint32_t caps = 0);
+
+/**
+ * @brief Draw a line of text with the built-in 5x7 font, clipped to the image. Characters out of the printable ASCII
+ * range are drawn as '?'.
+ *
+ * @param x      Left of the first glyph
+ * @param y      Top of the glyphs
+ * @param scale  Size of a font pixel in image pixels
+ */
+template <typename T>
+void draw_text(const img_t &img, int x, int y, const char *text, uint8_t scale, const pix_t &pix);
+void draw_text(const img_t &img,
+               int x,
+               int y,
+               const char *text,
+               const std::vector<uint8_t> &color,
+               uint8_t scale = 1,
+               uint32_t caps = 0);
+
+/**
+ * @brief Get the width of a line of text drawn by draw_text(), in pixels.
+ */
+inline int get_text_width(const char *text, uint8_t scale = 1)
+{
+    int n = strlen(text);
+    return n ? (n * DL_IMAGE_FONT_ADVANCE - 1) * scale : 0;
+}
+
+#if CONFIG_IDF_TARGET_ESP32P4
+/**
+ * @brief Fill a rectangle of a RGB565 or RGB888 image with the PPA, clipped to the image. (x2, y2) is included.
+ * Blocks until the fill is done, worth it for large rectangles only.
+ *
+ * @param ppa_handle A PPA client registered for PPA_OPERATION_FILL
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if the image type is not supported by the PPA
+ */
+esp_err_t draw_filled_rectangle(const img_t &img,
+                                int x1,
+                                int y1,
+                                int x2,
+                                int y2,
+                                const std::vector<uint8_t> &color,
+                                ppa_client_handle_t ppa_handle,
+                                uint32_t caps = 0);
+#endif
+
 } // namespace image
 } // namespace dl
@@ -5,17 +5,14 @@ namespace dl {
 namespace image {
 #if CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32P4
 // software decode
-esp_err_t sw_decode_jpeg(const jpeg_img_t &jpeg_img,
-                         img_t &decoded_img,
-                         bool swap_color_bytes,
-                         esp_jpeg_image_scale_t scale)
+static esp_err_t sw_decode_jpeg(const jpeg_img_t &jpeg_img,
+                                img_t &decoded_img,
+                                uint8_t *outbuf,
+                                uint32_t outbuf_size,
+                                dl_jpeg_engine_t *engine,
+                                bool swap_color_bytes,
+                                esp_jpeg_image_scale_t scale)
 {
-    uint32_t outbuf_size = jpeg_img.height * jpeg_img.width * 3;
-    uint8_t *outbuf = (uint8_t *)heap_caps_malloc(outbuf_size, MALLOC_CAP_SPIRAM);
-    if (!(decoded_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565 || decoded_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888)) {
-        ESP_LOGE(TAG, "Unsupported img pix format.");
-        return ESP_FAIL;
-    }
     esp_jpeg_image_format_t out_format;
     if (decoded_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888) {
         out_format = JPEG_IMAGE_FORMAT_RGB888;
@@ -34,7 +31,11 @@ esp_err_t sw_decode_jpeg(const jpeg_img_t &jpeg_img,
                                          {
                                              .swap_color_bytes = swap_color_bytes,
                                          },
-                                     .advanced = {},
+                                     .advanced =
+                                         {
+                                             .working_buffer = engine->work_buf,
+                                             .working_buffer_size = engine->work_buf_size,
+                                         },
                                      .priv = {}};
 
     esp_jpeg_image_output_t outimg;
@@ -45,10 +46,57 @@ esp_err_t sw_decode_jpeg(const jpeg_img_t &jpeg_img,
     decoded_img.width = jpeg_img.width;
     return ESP_OK;
 }
+
+esp_err_t sw_decode_jpeg(const jpeg_img_t &jpeg_img,
+                         img_t &decoded_img,
+                         bool swap_color_bytes,
+                         esp_jpeg_image_scale_t scale)
+{
+    if (!(decoded_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565 || decoded_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888)) {
+        ESP_LOGE(TAG, "Unsupported img pix format.");
+        return ESP_FAIL;
+    }
+    dl_jpeg_engine_t *engine;
+    ESP_RETURN_ON_ERROR(dl_jpeg_engine_acquire(DL_JPEG_ENGINE_SW_DECODER, 0, portMAX_DELAY, &engine),
+                        TAG,
+                        "Failed to acquire decoder engine.");
+    uint32_t outbuf_size = jpeg_img.height * jpeg_img.width * 3;
+    uint8_t *outbuf = (uint8_t *)heap_caps_malloc(outbuf_size, MALLOC_CAP_SPIRAM);
+    if (!outbuf) {
+        dl_jpeg_engine_release(engine);
+        ESP_LOGE(TAG, "Failed to allocate memory for jpeg decoder output.");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = sw_decode_jpeg(jpeg_img, decoded_img, outbuf, outbuf_size, engine, swap_color_bytes, scale);
+    dl_jpeg_engine_release(engine);
+    if (ret != ESP_OK) {
+        heap_caps_free(outbuf);
+    }
+    return ret;
+}
+
+esp_err_t sw_decode_jpeg(const jpeg_img_t &jpeg_img,
+                         img_t &decoded_img,
+                         dl_jpeg_engine_t *engine,
+                         bool swap_color_bytes,
+                         esp_jpeg_image_scale_t scale)
+{
+    if (!(decoded_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565 || decoded_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888)) {
+        ESP_LOGE(TAG, "Unsupported img pix format.");
+        return ESP_FAIL;
+    }
+    if (!engine || engine->type != DL_JPEG_ENGINE_SW_DECODER) {
+        ESP_LOGE(TAG, "Software decode needs a DL_JPEG_ENGINE_SW_DECODER engine.");
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t outbuf_size = jpeg_img.height * jpeg_img.width * 3;
+    ESP_RETURN_ON_ERROR(dl_jpeg_engine_reserve(engine, outbuf_size), TAG, "Failed to reserve decoder output.");
+    return sw_decode_jpeg(jpeg_img, decoded_img, engine->buf, outbuf_size, engine, swap_color_bytes, scale);
+}
 #endif
 #if CONFIG_IDF_TARGET_ESP32P4
 // hardware decode
-esp_err_t hw_decode_jpeg(const jpeg_img_t &jpeg_img, img_t &decoded_img, bool swap_color_bytes)
+static esp_err_t get_hw_decoded_img_shape(const jpeg_img_t &jpeg_img, img_t &decoded_img)
 {
     if (DL_IMAGE_IS_PIX_TYPE_QUANT(decoded_img.pix_type)) {
         ESP_LOGE(TAG, "Can not decode to a quant img.");
@@ -58,27 +106,6 @@ esp_err_t hw_decode_jpeg(const jpeg_img_t &jpeg_img, img_t &decoded_img, bool sw
     ESP_RETURN_ON_ERROR(jpeg_decoder_get_info((const uint8_t *)jpeg_img.data, jpeg_img.data_size, &header_info),
                         TAG,
                         "Failed to get jpeg header info.");
-    printf("%d\t%d\t%d\t%d\n",
-           JPEG_DOWN_SAMPLING_YUV444,
-           JPEG_DOWN_SAMPLING_YUV422,
-           JPEG_DOWN_SAMPLING_YUV420,
-           JPEG_DOWN_SAMPLING_GRAY);
-    printf("%d\n", header_info.sample_method);
-    // if (header_info.sample_method == JPEG_DOWN_SAMPLING_GRAY) {
-    //     if (decoded_img.pix_type != DL_IMAGE_PIX_TYPE_GRAY) {
-    //         ESP_LOGE(TAG,
-    //                  "Input jpeg is a gray img, can not decode to fmt %s",
-    //                  pix_type_to_str(decoded_img.pix_type).c_str());
-    //         return ESP_FAIL;
-    //     }
-    // } else {
-    //     if (decoded_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY) {
-    //         ESP_LOGE(TAG,
-    //                  "Input jpeg is a color img, can not decode to fmt %s",
-    //                  pix_type_to_str(decoded_img.pix_type).c_str());
-    //         return ESP_FAIL;
-    //     }
-    // }
     if (header_info.sample_method == JPEG_DOWN_SAMPLING_YUV422 ||
         header_info.sample_method == JPEG_DOWN_SAMPLING_YUV420) {
         decoded_img.height = DL_IMAGE_ALIGN_UP(header_info.height, 16);
@@ -87,52 +114,79 @@ esp_err_t hw_decode_jpeg(const jpeg_img_t &jpeg_img, img_t &decoded_img, bool sw
         decoded_img.height = header_info.height;
         decoded_img.width = header_info.width;
     }
+    return ESP_OK;
+}
 
-    // new engine
-    jpeg_decoder_handle_t jpgd_handle;
-    jpeg_decode_engine_cfg_t decode_eng_cfg = {
-        .intr_priority = 0,
-        .timeout_ms = 40,
-    };
+static esp_err_t hw_decode_jpeg(const jpeg_img_t &jpeg_img,
+                                img_t &decoded_img,
+                                jpeg_decoder_handle_t jpgd_handle,
+                                uint8_t *rx_buf,
+                                size_t rx_buffer_size,
+                                bool swap_color_bytes)
+{
+    jpeg_decode_cfg_t decode_cfg = {.output_format = convert_pix_type_to_dec_output_fmt(decoded_img.pix_type),
+                                    .rgb_order = swap_color_bytes ? JPEG_DEC_RGB_ELEMENT_ORDER_RGB
+                                                                  : JPEG_DEC_RGB_ELEMENT_ORDER_BGR,
+                                    .conv_std = JPEG_YUV_RGB_CONV_STD_BT601};
+    uint32_t out_size = 0;
     ESP_RETURN_ON_ERROR(
-        jpeg_new_decoder_engine(&decode_eng_cfg, &jpgd_handle), TAG, "Failed to create decoder engine.");
+        jpeg_decoder_process(
+            jpgd_handle, &decode_cfg, jpeg_img.data, jpeg_img.data_size, rx_buf, rx_buffer_size, &out_size),
+        TAG,
+        "Failed to run decoder process.");
+    decoded_img.data = (void *)rx_buf;
+    return ESP_OK;
+}
+
+esp_err_t hw_decode_jpeg(const jpeg_img_t &jpeg_img, img_t &decoded_img, bool swap_color_bytes)
+{
+    ESP_RETURN_ON_ERROR(get_hw_decoded_img_shape(jpeg_img, decoded_img), TAG, "Failed to get decoded img shape.");
+
+    dl_jpeg_engine_t *engine;
+    ESP_RETURN_ON_ERROR(dl_jpeg_engine_acquire(DL_JPEG_ENGINE_HW_DECODER, 0, portMAX_DELAY, &engine),
+                        TAG,
+                        "Failed to acquire decoder engine.");
 
     // alloc output buffer
     jpeg_decode_memory_alloc_cfg_t rx_mem_cfg = {
         .buffer_direction = JPEG_DEC_ALLOC_OUTPUT_BUFFER,
     };
-    size_t img_byte_size;
-    img_byte_size = get_img_byte_size(decoded_img);
+    size_t img_byte_size = get_img_byte_size(decoded_img);
     size_t rx_buffer_size = 0;
     uint8_t *rx_buf = (uint8_t *)jpeg_alloc_decoder_mem(img_byte_size, &rx_mem_cfg, &rx_buffer_size);
     if (!rx_buf) {
+        dl_jpeg_engine_release(engine);
         ESP_LOGE(TAG, "Failed to allocate memory for jpeg decoder output.");
         return ESP_FAIL;
     }
 
-    // decode
-    jpeg_decode_cfg_t decode_cfg = {.output_format = convert_pix_type_to_dec_output_fmt(decoded_img.pix_type),
-                                    .rgb_order = swap_color_bytes ? JPEG_DEC_RGB_ELEMENT_ORDER_RGB
-                                                                  : JPEG_DEC_RGB_ELEMENT_ORDER_BGR,
-                                    .conv_std = JPEG_YUV_RGB_CONV_STD_BT601};
-    uint32_t out_size = 0;
-    ESP_RETURN_ON_ERROR(
-        jpeg_decoder_process(
-            jpgd_handle, &decode_cfg, jpeg_img.data, jpeg_img.data_size, rx_buf, rx_buffer_size, &out_size),
-        TAG,
-        "Failed to run decoder process.");
-
-    // del engine
-    ESP_RETURN_ON_ERROR(jpeg_del_decoder_engine(jpgd_handle), TAG, "Failed to delete decoder engine.");
+    esp_err_t ret = hw_decode_jpeg(jpeg_img, decoded_img, engine->decoder, rx_buf, rx_buffer_size, swap_color_bytes);
+    dl_jpeg_engine_release(engine);
+    if (ret != ESP_OK) {
+        heap_caps_free(rx_buf);
+    }
+    return ret;
+}
 
-    decoded_img.data = (void *)rx_buf;
-    return ESP_OK;
+esp_err_t hw_decode_jpeg(const jpeg_img_t &jpeg_img,
+                         img_t &decoded_img,
+                         dl_jpeg_engine_t *engine,
+                         bool swap_color_bytes)
+{
+    if (!engine || engine->type != DL_JPEG_ENGINE_HW_DECODER) {
+        ESP_LOGE(TAG, "Hardware decode needs a DL_JPEG_ENGINE_HW_DECODER engine.");
+        return ESP_ERR_INVALID_ARG;
+    }
+    ESP_RETURN_ON_ERROR(get_hw_decoded_img_shape(jpeg_img, decoded_img), TAG, "Failed to get decoded img shape.");
+    ESP_RETURN_ON_ERROR(dl_jpeg_engine_reserve(engine, get_img_byte_size(decoded_img)),
+                        TAG,
+                        "Failed to reserve decoder output.");
+    return hw_decode_jpeg(
+        jpeg_img, decoded_img, engine->decoder, engine->buf, engine->buf_size, swap_color_bytes);
 }
+
 // hardware encode
-esp_err_t hw_encode_jpeg(const img_t &img,
-                         jpeg_img_t &encoded_img,
-                         jpeg_down_sampling_type_t down_sample_mode,
-                         uint8_t img_quality)
+static esp_err_t check_hw_encode_args(const img_t &img, jpeg_down_sampling_type_t down_sample_mode)
 {
     if (DL_IMAGE_IS_PIX_TYPE_QUANT(img.pix_type)) {
         ESP_LOGE(TAG, "Can not encode a quant img.");
@@ -149,52 +203,91 @@ esp_err_t hw_encode_jpeg(const img_t &img,
             return ESP_FAIL;
         }
     }
+    return ESP_OK;
+}
+
+static esp_err_t hw_encode_jpeg(const img_t &img,
+                                jpeg_img_t &encoded_img,
+                                jpeg_encoder_handle_t jpeg_handle,
+                                uint8_t *rx_buf,
+                                size_t rx_buffer_size,
+                                jpeg_down_sampling_type_t down_sample_mode,
+                                uint8_t img_quality)
+{
+    jpeg_encode_cfg_t enc_config = {
+        .height = (uint32_t)img.height,
+        .width = (uint32_t)img.width,
+        .src_type = convert_pix_type_to_enc_input_fmt(img.pix_type),
+        .sub_sample = down_sample_mode,
+        .image_quality = img_quality,
+    };
+    uint32_t out_size = 0;
+    ESP_RETURN_ON_ERROR(jpeg_encoder_process(jpeg_handle,
+                                             &enc_config,
+                                             (const uint8_t *)img.data,
+                                             get_img_byte_size(img),
+                                             rx_buf,
+                                             rx_buffer_size,
+                                             &out_size),
+                        TAG,
+                        "Failed to run encoder process.");
     encoded_img.height = img.height;
     encoded_img.width = img.width;
+    encoded_img.data = rx_buf;
+    encoded_img.data_size = out_size;
+    return ESP_OK;
+}
 
-    // new engine
-    jpeg_encoder_handle_t jpeg_handle;
-    jpeg_encode_engine_cfg_t encode_eng_cfg = {
-        .intr_priority = 0,
-        .timeout_ms = 70,
-    };
-    ESP_RETURN_ON_ERROR(
-        jpeg_new_encoder_engine(&encode_eng_cfg, &jpeg_handle), TAG, "Failed to create encoder engine.");
+esp_err_t hw_encode_jpeg(const img_t &img,
+                         jpeg_img_t &encoded_img,
+                         jpeg_down_sampling_type_t down_sample_mode,
+                         uint8_t img_quality)
+{
+    ESP_RETURN_ON_ERROR(check_hw_encode_args(img, down_sample_mode), TAG, "Invalid encode args.");
+
+    dl_jpeg_engine_t *engine;
+    ESP_RETURN_ON_ERROR(dl_jpeg_engine_acquire(DL_JPEG_ENGINE_HW_ENCODER, 0, portMAX_DELAY, &engine),
+                        TAG,
+                        "Failed to acquire encoder engine.");
 
     // alloc output buffer
     jpeg_encode_memory_alloc_cfg_t rx_mem_cfg = {
         .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
     };
     size_t rx_buffer_size = 0;
-    size_t img_size = get_img_byte_size(img);
     // Assume that compression ratio is 1 to ensure the img is encoded successfully.
-    uint8_t *rx_buf = (uint8_t *)jpeg_alloc_encoder_mem(img_size, &rx_mem_cfg, &rx_buffer_size);
+    uint8_t *rx_buf = (uint8_t *)jpeg_alloc_encoder_mem(get_img_byte_size(img), &rx_mem_cfg, &rx_buffer_size);
     if (!rx_buf) {
+        dl_jpeg_engine_release(engine);
         ESP_LOGE(TAG, "Failed to allocate memory for jpeg encoder output.");
         return ESP_FAIL;
     }
 
-    // encode
-    jpeg_encode_cfg_t enc_config = {
-        .height = (uint32_t)img.height,
-        .width = (uint32_t)img.width,
-        .src_type = convert_pix_type_to_enc_input_fmt(img.pix_type),
-        .sub_sample = down_sample_mode,
-        .image_quality = img_quality,
-    };
-    uint32_t out_size = 0;
-    ESP_RETURN_ON_ERROR(
-        jpeg_encoder_process(
-            jpeg_handle, &enc_config, (const uint8_t *)img.data, img_size, rx_buf, rx_buffer_size, &out_size),
-        TAG,
-        "Failed to run encoder process.");
-
-    // del engine
-    ESP_RETURN_ON_ERROR(jpeg_del_encoder_engine(jpeg_handle), TAG, "Failed to delete encoder engine.");
+    esp_err_t ret =
+        hw_encode_jpeg(img, encoded_img, engine->encoder, rx_buf, rx_buffer_size, down_sample_mode, img_quality);
+    dl_jpeg_engine_release(engine);
+    if (ret != ESP_OK) {
+        heap_caps_free(rx_buf);
+    }
+    return ret;
+}
 
-    encoded_img.data = rx_buf;
-    encoded_img.data_size = out_size;
-    return ESP_OK;
+esp_err_t hw_encode_jpeg(const img_t &img,
+                         jpeg_img_t &encoded_img,
+                         dl_jpeg_engine_t *engine,
+                         jpeg_down_sampling_type_t down_sample_mode,
+                         uint8_t img_quality)
+{
+    if (!engine || engine->type != DL_JPEG_ENGINE_HW_ENCODER) {
+        ESP_LOGE(TAG, "Hardware encode needs a DL_JPEG_ENGINE_HW_ENCODER engine.");
+        return ESP_ERR_INVALID_ARG;
+    }
+    ESP_RETURN_ON_ERROR(check_hw_encode_args(img, down_sample_mode), TAG, "Invalid encode args.");
+    // Assume that compression ratio is 1 to ensure the img is encoded successfully.
+    ESP_RETURN_ON_ERROR(
+        dl_jpeg_engine_reserve(engine, get_img_byte_size(img)), TAG, "Failed to reserve encoder output.");
+    return hw_encode_jpeg(
+        img, encoded_img, engine->encoder, engine->buf, engine->buf_size, down_sample_mode, img_quality);
 }
 
 esp_err_t write_jpeg(img_t &img, const char *file_name)
@@ -1,5 +1,6 @@
 #pragma once
 #include "dl_image_define.hpp"
+#include "dl_image_jpeg_pool.h"
 #include "esp_check.h"
 #include "esp_heap_caps.h"
 #include "esp_log.h"
@@ -19,11 +20,37 @@ esp_err_t sw_decode_jpeg(const jpeg_img_t &jpeg_img,
                          img_t &decoded_img,
                          bool swap_color_bytes = false,
                          esp_jpeg_image_scale_t scale = JPEG_IMAGE_SCALE_0);
+/**
+ * @brief Decode into the output buffer of a DL_JPEG_ENGINE_SW_DECODER engine, nothing is allocated once the buffer is
+ * large enough. decoded_img.data is valid until the engine is released.
+ */
+esp_err_t sw_decode_jpeg(const jpeg_img_t &jpeg_img,
+                         img_t &decoded_img,
+                         dl_jpeg_engine_t *engine,
+                         bool swap_color_bytes = false,
+                         esp_jpeg_image_scale_t scale = JPEG_IMAGE_SCALE_0);
 #endif
 #if CONFIG_IDF_TARGET_ESP32P4
 esp_err_t hw_decode_jpeg(const jpeg_img_t &jpeg_img, img_t &decoded_img, bool swap_color_bytes = false);
+/**
+ * @brief Decode into the output buffer of a DL_JPEG_ENGINE_HW_DECODER engine, nothing is allocated once the buffer is
+ * large enough. decoded_img.data is valid until the engine is released.
+ */
+esp_err_t hw_decode_jpeg(const jpeg_img_t &jpeg_img,
+                         img_t &decoded_img,
+                         dl_jpeg_engine_t *engine,
+                         bool swap_color_bytes = false);
+esp_err_t hw_encode_jpeg(const img_t &img,
+                         jpeg_img_t &encoded_img,
+                         jpeg_down_sampling_type_t sub_sample_mode = JPEG_DOWN_SAMPLING_YUV420,
+                         uint8_t img_quality = 80);
+/**
+ * @brief Encode into the output buffer of a DL_JPEG_ENGINE_HW_ENCODER engine, nothing is allocated once the buffer is
+ * large enough. encoded_img.data is valid until the engine is released.
+ */
 esp_err_t hw_encode_jpeg(const img_t &img,
                          jpeg_img_t &encoded_img,
+                         dl_jpeg_engine_t *engine,
                          jpeg_down_sampling_type_t sub_sample_mode = JPEG_DOWN_SAMPLING_YUV420,
                          uint8_t img_quality = 80);
 inline jpeg_dec_output_format_t convert_pix_type_to_dec_output_fmt(pix_type_t type)
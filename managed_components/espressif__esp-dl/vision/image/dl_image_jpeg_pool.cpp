@@ -0,0 +1,217 @@
+#include "dl_image_jpeg_pool.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/queue.h"
+
+static const char *TAG = "dl_image_jpeg_pool";
+
+#if defined(CONFIG_JD_FASTDECODE) && CONFIG_JD_FASTDECODE == 2
+#define DL_JPEG_WORK_BUF_SIZE 65472
+#else
+#define DL_JPEG_WORK_BUF_SIZE 3100
+#endif
+
+namespace {
+struct JpegEnginePool {
+    QueueHandle_t idle_engines[DL_JPEG_ENGINE_TYPE_MAX];
+    dl_jpeg_engine_t engines[DL_JPEG_ENGINE_TYPE_MAX][DL_JPEG_POOL_SIZE];
+
+    JpegEnginePool()
+    {
+        for (int type = 0; type < DL_JPEG_ENGINE_TYPE_MAX; type++) {
+            idle_engines[type] = xQueueCreate(DL_JPEG_POOL_SIZE, sizeof(dl_jpeg_engine_t *));
+            for (int i = 0; i < DL_JPEG_POOL_SIZE; i++) {
+                dl_jpeg_engine_t *engine = &engines[type][i];
+                *engine = {};
+                engine->type = (dl_jpeg_engine_type_t)type;
+                xQueueSend(idle_engines[type], &engine, 0);
+            }
+        }
+    }
+};
+
+// Function local static, so that the pool is created once even if the first acquires race.
+JpegEnginePool &get_pool()
+{
+    static JpegEnginePool pool;
+    return pool;
+}
+
+void free_engine(dl_jpeg_engine_t *engine)
+{
+#if CONFIG_IDF_TARGET_ESP32P4
+    if (engine->decoder) {
+        jpeg_del_decoder_engine(engine->decoder);
+        engine->decoder = nullptr;
+    }
+    if (engine->encoder) {
+        jpeg_del_encoder_engine(engine->encoder);
+        engine->encoder = nullptr;
+    }
+#endif
+    if (engine->work_buf) {
+        heap_caps_free(engine->work_buf);
+        engine->work_buf = nullptr;
+        engine->work_buf_size = 0;
+    }
+    if (engine->buf) {
+        heap_caps_free(engine->buf);
+        engine->buf = nullptr;
+        engine->buf_size = 0;
+    }
+}
+
+esp_err_t reserve_buf(dl_jpeg_engine_t *engine, size_t buf_size)
+{
+    if (buf_size <= engine->buf_size) {
+        return ESP_OK;
+    }
+    if (engine->buf) {
+        heap_caps_free(engine->buf);
+        engine->buf = nullptr;
+        engine->buf_size = 0;
+    }
+    size_t allocated_size = buf_size;
+    switch (engine->type) {
+    case DL_JPEG_ENGINE_SW_DECODER:
+        engine->buf = (uint8_t *)heap_caps_malloc(buf_size, MALLOC_CAP_SPIRAM);
+        break;
+#if CONFIG_IDF_TARGET_ESP32P4
+    case DL_JPEG_ENGINE_HW_DECODER: {
+        jpeg_decode_memory_alloc_cfg_t mem_cfg = {
+            .buffer_direction = JPEG_DEC_ALLOC_OUTPUT_BUFFER,
+        };
+        engine->buf = (uint8_t *)jpeg_alloc_decoder_mem(buf_size, &mem_cfg, &allocated_size);
+        break;
+    }
+    case DL_JPEG_ENGINE_HW_ENCODER: {
+        jpeg_encode_memory_alloc_cfg_t mem_cfg = {
+            .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
+        };
+        engine->buf = (uint8_t *)jpeg_alloc_encoder_mem(buf_size, &mem_cfg, &allocated_size);
+        break;
+    }
+#endif
+    default:
+        break;
+    }
+    if (!engine->buf) {
+        ESP_LOGE(TAG, "Failed to allocate %d bytes of output buffer.", (int)buf_size);
+        return ESP_ERR_NO_MEM;
+    }
+    engine->buf_size = allocated_size ? allocated_size : buf_size;
+    return ESP_OK;
+}
+
+esp_err_t prepare_engine(dl_jpeg_engine_t *engine, size_t buf_size)
+{
+    switch (engine->type) {
+    case DL_JPEG_ENGINE_SW_DECODER:
+        if (!engine->work_buf) {
+            engine->work_buf = heap_caps_malloc(DL_JPEG_WORK_BUF_SIZE, MALLOC_CAP_DEFAULT);
+            if (!engine->work_buf) {
+                ESP_LOGE(TAG, "Failed to allocate jpeg work buffer.");
+                return ESP_ERR_NO_MEM;
+            }
+            engine->work_buf_size = DL_JPEG_WORK_BUF_SIZE;
+        }
+        break;
+#if CONFIG_IDF_TARGET_ESP32P4
+    case DL_JPEG_ENGINE_HW_DECODER:
+        if (!engine->decoder) {
+            jpeg_decode_engine_cfg_t eng_cfg = {
+                .intr_priority = 0,
+                .timeout_ms = DL_JPEG_ENGINE_TIMEOUT_MS,
+            };
+            esp_err_t ret = jpeg_new_decoder_engine(&eng_cfg, &engine->decoder);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to create decoder engine.");
+                engine->decoder = nullptr;
+                return ret;
+            }
+        }
+        break;
+    case DL_JPEG_ENGINE_HW_ENCODER:
+        if (!engine->encoder) {
+            jpeg_encode_engine_cfg_t eng_cfg = {
+                .intr_priority = 0,
+                .timeout_ms = DL_JPEG_ENGINE_TIMEOUT_MS,
+            };
+            esp_err_t ret = jpeg_new_encoder_engine(&eng_cfg, &engine->encoder);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to create encoder engine.");
+                engine->encoder = nullptr;
+                return ret;
+            }
+        }
+        break;
+#endif
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+    return reserve_buf(engine, buf_size);
+}
+} // namespace
+
+esp_err_t dl_jpeg_engine_acquire(dl_jpeg_engine_type_t type,
+                                 size_t buf_size,
+                                 TickType_t timeout,
+                                 dl_jpeg_engine_t **engine)
+{
+    if (type < 0 || type >= DL_JPEG_ENGINE_TYPE_MAX || !engine) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    JpegEnginePool &pool = get_pool();
+    dl_jpeg_engine_t *idle_engine;
+    if (xQueueReceive(pool.idle_engines[type], &idle_engine, timeout) != pdTRUE) {
+        ESP_LOGE(TAG, "No idle jpeg engine.");
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t ret = prepare_engine(idle_engine, buf_size);
+    if (ret != ESP_OK) {
+        xQueueSend(pool.idle_engines[type], &idle_engine, 0);
+        return ret;
+    }
+    *engine = idle_engine;
+    return ESP_OK;
+}
+
+esp_err_t dl_jpeg_engine_reserve(dl_jpeg_engine_t *engine, size_t buf_size)
+{
+    if (!engine) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return reserve_buf(engine, buf_size);
+}
+
+void dl_jpeg_engine_release(dl_jpeg_engine_t *engine)
+{
+    if (engine) {
+        xQueueSend(get_pool().idle_engines[engine->type], &engine, 0);
+    }
+}
+
+void dl_jpeg_engine_pool_free_idle_type(dl_jpeg_engine_type_t type)
+{
+    if (type < 0 || type >= DL_JPEG_ENGINE_TYPE_MAX) {
+        return;
+    }
+    JpegEnginePool &pool = get_pool();
+    // Each idle engine is taken once, the engines in use are left to their owners.
+    int n = uxQueueMessagesWaiting(pool.idle_engines[type]);
+    for (int i = 0; i < n; i++) {
+        dl_jpeg_engine_t *engine;
+        if (xQueueReceive(pool.idle_engines[type], &engine, 0) != pdTRUE) {
+            break;
+        }
+        free_engine(engine);
+        xQueueSend(pool.idle_engines[type], &engine, 0);
+    }
+}
+
+void dl_jpeg_engine_pool_free_idle(void)
+{
+    for (int type = 0; type < DL_JPEG_ENGINE_TYPE_MAX; type++) {
+        dl_jpeg_engine_pool_free_idle_type((dl_jpeg_engine_type_t)type);
+    }
+}
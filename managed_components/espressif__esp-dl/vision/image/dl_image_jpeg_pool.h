@@ -0,0 +1,84 @@
+#pragma once
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include <stddef.h>
+#include <stdint.h>
+#if CONFIG_IDF_TARGET_ESP32P4
+#include "driver/jpeg_decode.h"
+#include "driver/jpeg_encode.h"
+#endif
+
+// C interface, so that the C components of the application share the engines with dl::image.
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DL_JPEG_POOL_SIZE 2               /*<! Engines of each type */
+#define DL_JPEG_ENGINE_TIMEOUT_MS 200     /*<! Timeout of one hardware decode or encode */
+
+typedef enum {
+    DL_JPEG_ENGINE_SW_DECODER, /*<! esp_jpeg decoder, buf is in PSRAM */
+#if CONFIG_IDF_TARGET_ESP32P4
+    DL_JPEG_ENGINE_HW_DECODER, /*<! buf is allocated by jpeg_alloc_decoder_mem() */
+    DL_JPEG_ENGINE_HW_ENCODER, /*<! buf is allocated by jpeg_alloc_encoder_mem() */
+#endif
+    DL_JPEG_ENGINE_TYPE_MAX,
+} dl_jpeg_engine_type_t;
+
+/**
+ * @brief An engine of the pool. The engine and its buffers live across acquires, the output buffer only grows.
+ */
+typedef struct {
+    dl_jpeg_engine_type_t type; /*<! Type of the engine */
+#if CONFIG_IDF_TARGET_ESP32P4
+    jpeg_decoder_handle_t decoder; /*<! DL_JPEG_ENGINE_HW_DECODER only */
+    jpeg_encoder_handle_t encoder; /*<! DL_JPEG_ENGINE_HW_ENCODER only */
+#endif
+    void *work_buf;       /*<! tjpgd scratchpad, DL_JPEG_ENGINE_SW_DECODER only */
+    size_t work_buf_size; /*<! Size of work_buf in bytes */
+    uint8_t *buf;         /*<! Output buffer */
+    size_t buf_size;      /*<! Size of buf in bytes */
+} dl_jpeg_engine_t;
+
+/**
+ * @brief Take an idle engine of the pool, it is created on the first use. Thread safe.
+ *
+ * @param type      Type of the engine
+ * @param buf_size  Minimum size of the output buffer in bytes, 0 if the output buffer is not used
+ * @param timeout   Ticks to wait for an idle engine
+ * @param engine    The engine, to be given back with dl_jpeg_engine_release()
+ *
+ * @return ESP_ERR_TIMEOUT if all the engines are taken, ESP_ERR_NO_MEM if the engine or the buffer can not be
+ * allocated, ESP_OK otherwise
+ */
+esp_err_t dl_jpeg_engine_acquire(dl_jpeg_engine_type_t type,
+                                 size_t buf_size,
+                                 TickType_t timeout,
+                                 dl_jpeg_engine_t **engine);
+
+/**
+ * @brief Grow the output buffer of an acquired engine. The content of the buffer is lost if it grows.
+ *
+ * @return ESP_ERR_NO_MEM if the buffer can not be allocated, ESP_OK otherwise
+ */
+esp_err_t dl_jpeg_engine_reserve(dl_jpeg_engine_t *engine, size_t buf_size);
+
+/**
+ * @brief Give an engine back to the pool, the content of its output buffer is no longer valid.
+ */
+void dl_jpeg_engine_release(dl_jpeg_engine_t *engine);
+
+/**
+ * @brief Delete the idle engines of one type and free their buffers, they are created again on the next acquire.
+ */
+void dl_jpeg_engine_pool_free_idle_type(dl_jpeg_engine_type_t type);
+
+/**
+ * @brief Delete the idle engines of all the types and free their buffers.
+ */
+void dl_jpeg_engine_pool_free_idle(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,22 +8,39 @@ ImagePreprocessor::ImagePreprocessor(Model *model,
                                      const std::vector<float> &std,
                                      uint32_t caps,
                                      const std::string &input_name) :
-    m_mean(mean), m_std(std), m_caps(caps)
+    m_model(model),
+    m_input_name(input_name),
+    m_mean(mean),
+    m_std(std),
+    m_caps(caps),
+    m_batch(nullptr),
+    m_done_cb(nullptr),
+    m_done_cb_user_data(nullptr)
 {
     if (input_name.empty()) {
         std::map<std::string, dl::TensorBase *> model_inputs_map = model->get_inputs();
         assert(model_inputs_map.size() == 1);
+        m_input_name = model_inputs_map.begin()->first;
         m_model_input = model_inputs_map.begin()->second;
     } else {
         m_model_input = model->get_intermediate(input_name);
     }
     assert(m_model_input->dtype == DATA_TYPE_INT8 || m_model_input->dtype == DATA_TYPE_INT16);
     assert(m_model_input->shape[3] == m_mean.size() && m_mean.size() == m_std.size());
+    assert(m_model_input->shape[3] == 1 || m_model_input->shape[3] == 3);
+    pix_type_t output_pix_type;
+    if (m_model_input->shape[3] == 1) {
+        // Models trained on gray images.
+        output_pix_type =
+            (m_model_input->dtype == DATA_TYPE_INT8) ? DL_IMAGE_PIX_TYPE_GRAY_QINT8 : DL_IMAGE_PIX_TYPE_GRAY_QINT16;
+    } else {
+        output_pix_type =
+            (m_model_input->dtype == DATA_TYPE_INT8) ? DL_IMAGE_PIX_TYPE_RGB888_QINT8 : DL_IMAGE_PIX_TYPE_RGB888_QINT16;
+    }
     m_output = {.data = m_model_input->data,
                 .width = m_model_input->shape[2],
                 .height = m_model_input->shape[1],
-                .pix_type = (m_model_input->dtype == DATA_TYPE_INT8) ? DL_IMAGE_PIX_TYPE_RGB888_QINT8
-                                                                     : DL_IMAGE_PIX_TYPE_RGB888_QINT16};
+                .pix_type = output_pix_type};
     if (m_model_input->dtype == DATA_TYPE_INT8) {
         create_norm_lut<int8_t>();
     } else {
@@ -37,11 +54,16 @@ ImagePreprocessor::ImagePreprocessor(Model *model,
         ESP_ERROR_CHECK(ppa_register_client(&ppa_client_config, &m_ppa_srm_handle));
         size_t cache_line_size;
         ESP_ERROR_CHECK(esp_cache_get_alignment(MALLOC_CAP_SPIRAM | MALLOC_CAP_DMA, &cache_line_size));
-        m_ppa_buffer_size = DL_IMAGE_ALIGN_UP(
-            m_model_input->shape[1] * m_model_input->shape[2] * m_model_input->shape[3], cache_line_size);
+        // The PPA writes rgb888 before the normalization, whatever the channels of the model.
+        m_ppa_buffer_size =
+            DL_IMAGE_ALIGN_UP(m_model_input->shape[1] * m_model_input->shape[2] * 3, cache_line_size);
         m_ppa_buffer = tool::calloc_aligned(
             m_ppa_buffer_size, sizeof(uint8_t), cache_line_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_DMA);
+        ppa_event_callbacks_t ppa_cbs = {.on_trans_done = ppa_trans_done_cb};
+        ESP_ERROR_CHECK(ppa_client_register_event_callbacks(m_ppa_srm_handle, &ppa_cbs));
+        m_ppa_done = xSemaphoreCreateBinary();
     }
+    m_ppa_pending = false;
 #endif
 }
 
@@ -51,8 +73,19 @@ ImagePreprocessor::~ImagePreprocessor()
         heap_caps_free(m_norm_lut);
         m_norm_lut = nullptr;
     }
+    if (m_batch) {
+        delete m_batch;
+        m_batch = nullptr;
+    }
 #if CONFIG_IDF_TARGET_ESP32P4
     if (m_caps & DL_IMAGE_CAP_PPA) {
+        if (m_ppa_pending) {
+            preprocess_wait();
+        }
+        if (m_ppa_done) {
+            vSemaphoreDelete(m_ppa_done);
+            m_ppa_done = nullptr;
+        }
         if (m_ppa_buffer) {
             heap_caps_free(m_ppa_buffer);
             m_ppa_buffer = nullptr;
@@ -65,6 +98,46 @@ ImagePreprocessor::~ImagePreprocessor()
 #endif
 }
 
+esp_err_t ImagePreprocessor::set_input_size(int width, int height)
+{
+#if CONFIG_IDF_TARGET_ESP32P4
+    if (m_ppa_pending) {
+        ESP_LOGE("ImagePreprocessor", "Call preprocess_wait() before changing the input size.");
+        return ESP_ERR_INVALID_STATE;
+    }
+#endif
+    std::vector<int> shape = get_model_input()->shape;
+    shape[1] = height;
+    shape[2] = width;
+    std::map<std::string, std::vector<int>> input_shapes = {{m_input_name, shape}};
+    esp_err_t ret = m_model->set_input_shapes(input_shapes);
+    get_model_input();
+    return ret;
+}
+
+TensorBase *ImagePreprocessor::get_model_input()
+{
+    m_model_input = m_model->get_intermediate(m_input_name);
+    m_output.data = m_model_input->data;
+    m_output.width = m_model_input->shape[2];
+    m_output.height = m_model_input->shape[1];
+#if CONFIG_IDF_TARGET_ESP32P4
+    // The PPA may still be writing the buffer of preprocess_async().
+    if ((m_caps & DL_IMAGE_CAP_PPA) && !m_ppa_pending) {
+        size_t cache_line_size;
+        ESP_ERROR_CHECK(esp_cache_get_alignment(MALLOC_CAP_SPIRAM | MALLOC_CAP_DMA, &cache_line_size));
+        size_t ppa_buffer_size = DL_IMAGE_ALIGN_UP(m_output.height * m_output.width * 3, cache_line_size);
+        if (ppa_buffer_size > m_ppa_buffer_size) {
+            heap_caps_free(m_ppa_buffer);
+            m_ppa_buffer_size = ppa_buffer_size;
+            m_ppa_buffer = tool::calloc_aligned(
+                m_ppa_buffer_size, sizeof(uint8_t), cache_line_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_DMA);
+        }
+    }
+#endif
+    return m_model_input;
+}
+
 template <typename T>
 void ImagePreprocessor::create_norm_lut()
 {
@@ -85,8 +158,15 @@ template void ImagePreprocessor::create_norm_lut<int16_t>();
 
 void ImagePreprocessor::preprocess(const img_t &img, const std::vector<int> &crop_area)
 {
-    assert(get_img_channel(img) == m_mean.size());
+    // A gray image feeds a rgb model with the luma in the three channels, a rgb image feeds a gray model.
+    assert(!DL_IMAGE_IS_PIX_TYPE_QUANT(img.pix_type));
     m_crop_area = crop_area;
+#if CONFIG_IDF_TARGET_ESP32P4
+    if (m_ppa_pending) {
+        preprocess_wait();
+    }
+#endif
+    get_model_input();
 #if CONFIG_IDF_TARGET_ESP32P4
     if (resize_ppa(img,
                    m_output,
@@ -94,7 +174,7 @@ void ImagePreprocessor::preprocess(const img_t &img, const std::vector<int> &cro
                    m_ppa_buffer,
                    m_ppa_buffer_size,
                    PPA_TRANS_MODE_BLOCKING,
-                   nullptr,
+                   this,
                    m_caps,
                    m_norm_lut,
                    crop_area,
@@ -121,10 +201,181 @@ void ImagePreprocessor::preprocess(const img_t &img, const std::vector<int> &cro
 #endif
 }
 
+#if CONFIG_IDF_TARGET_ESP32P4
+bool ImagePreprocessor::ppa_trans_done_cb(ppa_client_handle_t ppa_client, ppa_event_data_t *event_data, void *user_data)
+{
+    ImagePreprocessor *preprocessor = (ImagePreprocessor *)user_data;
+    // The blocking transactions of the client end here too, only the one of preprocess_async() is waited for.
+    if (!preprocessor || !preprocessor->m_ppa_pending) {
+        return false;
+    }
+    BaseType_t task_woken = pdFALSE;
+    xSemaphoreGiveFromISR(preprocessor->m_ppa_done, &task_woken);
+    bool cb_task_woken = false;
+    if (preprocessor->m_done_cb) {
+        cb_task_woken = preprocessor->m_done_cb(preprocessor, preprocessor->m_done_cb_user_data);
+    }
+    return task_woken == pdTRUE || cb_task_woken;
+}
+#endif
+
+esp_err_t ImagePreprocessor::preprocess_async(const img_t &img,
+                                              const std::vector<int> &crop_area,
+                                              preprocess_done_cb_t done_cb,
+                                              void *user_data)
+{
+    assert(!DL_IMAGE_IS_PIX_TYPE_QUANT(img.pix_type));
+#if CONFIG_IDF_TARGET_ESP32P4
+    if (m_ppa_pending) {
+        ESP_LOGE("ImagePreprocessor", "Call preprocess_wait() before preprocessing the next frame.");
+        return ESP_ERR_INVALID_STATE;
+    }
+    get_model_input();
+    int crop_width = crop_area.empty() ? img.width : crop_area[2] - crop_area[0];
+    int crop_height = crop_area.empty() ? img.height : crop_area[3] - crop_area[1];
+    // resize_ppa() doesn't scale by the PPA without resize, nothing to overlap.
+    if ((m_caps & DL_IMAGE_CAP_PPA) && (crop_width != m_output.width || crop_height != m_output.height)) {
+        m_crop_area = crop_area;
+        m_done_cb = done_cb;
+        m_done_cb_user_data = user_data;
+        m_ppa_pending = true;
+        if (resize_ppa(img,
+                       m_output,
+                       m_ppa_srm_handle,
+                       m_ppa_buffer,
+                       m_ppa_buffer_size,
+                       PPA_TRANS_MODE_NON_BLOCKING,
+                       this,
+                       m_caps,
+                       m_norm_lut,
+                       crop_area,
+                       &m_resize_scale_x,
+                       &m_resize_scale_y) == ESP_OK) {
+            return ESP_OK;
+        }
+        m_ppa_pending = false;
+        xSemaphoreTake(m_ppa_done, 0);
+    }
+#endif
+    m_done_cb = nullptr;
+    m_done_cb_user_data = nullptr;
+    preprocess(img, crop_area);
+    if (done_cb) {
+        done_cb(this, user_data);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ImagePreprocessor::preprocess_wait(TickType_t timeout)
+{
+#if CONFIG_IDF_TARGET_ESP32P4
+    if (!m_ppa_pending) {
+        return ESP_OK;
+    }
+    if (xSemaphoreTake(m_ppa_done, timeout) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    m_ppa_pending = false;
+    resize_ppa_finish(m_output, m_ppa_buffer, m_norm_lut);
+#endif
+    return ESP_OK;
+}
+
+#if CONFIG_IDF_TARGET_ESP32P4
+esp_err_t ImagePreprocessor::warp_affine_ppa(const img_t &img, img_t &dst_img, dl::math::Matrix<float> *M_inv)
+{
+    if (!(m_caps & DL_IMAGE_CAP_PPA)) {
+        return ESP_FAIL;
+    }
+    // Without rotation nor shear the warp is a resize of the crop that maps to dst_img.
+    float **M = M_inv->array;
+    if (fabsf(M[0][1]) > 1e-4f || fabsf(M[1][0]) > 1e-4f || M[0][0] <= 0 || M[1][1] <= 0) {
+        return ESP_FAIL;
+    }
+    std::vector<int> crop_area = {(int)lroundf(M[0][2]),
+                                  (int)lroundf(M[1][2]),
+                                  (int)lroundf(M[0][2] + M[0][0] * dst_img.width),
+                                  (int)lroundf(M[1][2] + M[1][1] * dst_img.height)};
+    if (crop_area[0] < 0 || crop_area[1] < 0 || crop_area[2] > img.width || crop_area[3] > img.height ||
+        crop_area[2] <= crop_area[0] || crop_area[3] <= crop_area[1]) {
+        return ESP_FAIL;
+    }
+    float scale_x, scale_y;
+    return resize_ppa(img,
+                      dst_img,
+                      m_ppa_srm_handle,
+                      m_ppa_buffer,
+                      m_ppa_buffer_size,
+                      PPA_TRANS_MODE_BLOCKING,
+                      this,
+                      m_caps,
+                      m_norm_lut,
+                      crop_area,
+                      &scale_x,
+                      &scale_y);
+}
+#endif
+
 void ImagePreprocessor::preprocess(const img_t &img, dl::math::Matrix<float> *M_inv)
 {
-    assert(get_img_channel(img) == m_mean.size());
+    assert(!DL_IMAGE_IS_PIX_TYPE_QUANT(img.pix_type));
+#if CONFIG_IDF_TARGET_ESP32P4
+    if (m_ppa_pending) {
+        preprocess_wait();
+    }
+    get_model_input();
+    if (warp_affine_ppa(img, m_output, M_inv) == ESP_OK) {
+        return;
+    }
+#else
+    get_model_input();
+#endif
     warp_affine(img, m_output, DL_IMAGE_INTERPOLATE_NEAREST, M_inv, m_caps, m_norm_lut);
 }
+
+void ImagePreprocessor::preprocess(const img_t &img, const std::vector<dl::math::Matrix<float> *> &M_invs)
+{
+    assert(!DL_IMAGE_IS_PIX_TYPE_QUANT(img.pix_type));
+    if (M_invs.empty()) {
+        return;
+    }
+#if CONFIG_IDF_TARGET_ESP32P4
+    if (m_ppa_pending) {
+        preprocess_wait();
+    }
+#endif
+    get_model_input();
+    std::vector<int> shape = m_model_input->shape;
+    shape[0] = M_invs.size();
+    if (!m_batch || m_batch->shape != shape || m_batch->exponent != m_model_input->exponent) {
+        if (m_batch) {
+            delete m_batch;
+        }
+        m_batch = new TensorBase(shape, nullptr, m_model_input->exponent, m_model_input->dtype);
+    }
+    int slice_bytes = get_img_byte_size(m_output);
+    std::vector<img_t> dst_imgs;
+    std::vector<dl::math::Matrix<float> *> cpu_M_invs;
+    for (int i = 0; i < M_invs.size(); i++) {
+        img_t dst_img = m_output;
+        dst_img.data = (uint8_t *)m_batch->data + i * slice_bytes;
+#if CONFIG_IDF_TARGET_ESP32P4
+        if (warp_affine_ppa(img, dst_img, M_invs[i]) == ESP_OK) {
+            continue;
+        }
+#endif
+        dst_imgs.push_back(dst_img);
+        cpu_M_invs.push_back(M_invs[i]);
+    }
+    warp_affine_batch(img, dst_imgs, DL_IMAGE_INTERPOLATE_NEAREST, cpu_M_invs, m_caps, m_norm_lut);
+}
+
+void ImagePreprocessor::load_batch(int index)
+{
+    assert(m_batch && index < m_batch->shape[0]);
+    get_model_input();
+    int slice_bytes = get_img_byte_size(m_output);
+    tool::copy_memory(m_model_input->data, (uint8_t *)m_batch->data + index * slice_bytes, slice_bytes);
+}
 } // namespace image
 } // namespace dl
@@ -13,12 +13,26 @@ namespace dl {
 namespace image {
 /**
  * @brief rgb565->rgb888, crop, resize, normalize, quantize
+ * A gray image can feed a rgb model and a rgb image a gray model, the input of a model with 1 channel is gray.
  */
 class ImagePreprocessor {
 public:
+    /**
+     * @brief Callback of preprocess_async(), called from the PPA interrupt when the PPA is done, or from
+     * preprocess_async() itself when the frame is preprocessed by the CPU.
+     *
+     * @param preprocessor The preprocessor, call preprocess_wait() in task context to finish the frame
+     * @param user_data    user_data of preprocess_async()
+     *
+     * @return Whether a higher priority task has been woken up by the callback
+     */
+    typedef bool (*preprocess_done_cb_t)(ImagePreprocessor *preprocessor, void *user_data);
+
     TensorBase *m_model_input;
 
 private:
+    Model *m_model;
+    std::string m_input_name;
     const std::vector<float> m_mean;
     const std::vector<float> m_std;
     uint32_t m_caps;
@@ -27,10 +41,19 @@ private:
     float m_resize_scale_x;
     float m_resize_scale_y;
     img_t m_output;
+    TensorBase *m_batch; /*<! [N, H, W, C] inputs of preprocess() with a matrix per crop */
+    preprocess_done_cb_t m_done_cb;
+    void *m_done_cb_user_data;
 #if CONFIG_IDF_TARGET_ESP32P4
     ppa_client_handle_t m_ppa_srm_handle;
     size_t m_ppa_buffer_size;
     void *m_ppa_buffer;
+    SemaphoreHandle_t m_ppa_done;
+    volatile bool m_ppa_pending; /*<! a PPA transaction of preprocess_async() is waiting for preprocess_wait(), read
+                                    by the done callback to skip the blocking transactions */
+
+    static bool ppa_trans_done_cb(ppa_client_handle_t ppa_client, ppa_event_data_t *event_data, void *user_data);
+    esp_err_t warp_affine_ppa(const img_t &img, img_t &dst_img, dl::math::Matrix<float> *M_inv);
 #endif
     template <typename T>
     void create_norm_lut();
@@ -49,9 +72,76 @@ public:
     float get_top_left_x() { return m_crop_area[0]; };
     float get_top_left_y() { return m_crop_area[1]; };
 
+    /**
+     * @brief Change the size of model input, e.g. to keep the aspect ratio of a crop instead of padding it. See
+     * Model::set_input_shapes().
+     *
+     * @param width   Width of model input
+     * @param height  Height of model input
+     */
+    esp_err_t set_input_size(int width, int height);
+
+    /**
+     * @brief Get the model input again from the model, its tensor changes with the memory plan of the model, e.g. when
+     * run() takes an input of other size. The preprocess functions call it.
+     *
+     * @return The model input
+     */
+    TensorBase *get_model_input();
+
     void preprocess(const img_t &img, const std::vector<int> &crop_area = {});
     void preprocess(const img_t &img, uint16_t rescaled_w, uint16_t rescaled_h, const std::vector<int> &crop_area = {});
     void preprocess(const img_t &img, dl::math::Matrix<float> *M_inv);
+
+    /**
+     * @brief Warp a crop per matrix in one call, e.g. align all the faces of a frame. Crop i is written to the slice i
+     * of the batch, load it into the model input with load_batch(i).
+     *
+     * @param img     Image
+     * @param M_invs  Inverse affine matrix of each crop, see warp_affine_batch()
+     */
+    void preprocess(const img_t &img, const std::vector<dl::math::Matrix<float> *> &M_invs);
+
+    /**
+     * @brief Copy a slice of the batch of preprocess() with matrices into the model input.
+     *
+     * @param index Index of the crop
+     */
+    void load_batch(int index);
+
+    /**
+     * @brief Get the batch of preprocess() with matrices.
+     *
+     * @return [N, H, W, C] tensor quantized like the model input, nullptr before the first batch
+     */
+    TensorBase *get_batch() { return m_batch; }
+
+    /**
+     * @brief Start preprocessing a frame without waiting for the PPA, so that the CPU can e.g. postprocess the previous
+     * frame meanwhile. The model input is left untouched until preprocess_wait(), which must be called before the next
+     * preprocess or running the model on this frame. The frame is preprocessed by the CPU before returning if the PPA
+     * is not used or can't take the scale.
+     *
+     * @param img        Frame, must stay valid until done_cb is called
+     * @param crop_area  Crop area, see preprocess()
+     * @param done_cb    Called when the PPA is done, nullptr if not needed
+     * @param user_data  Passed to done_cb
+     *
+     * @return ESP_OK if started, ESP_ERR_INVALID_STATE if the previous frame is not waited for
+     */
+    esp_err_t preprocess_async(const img_t &img,
+                               const std::vector<int> &crop_area = {},
+                               preprocess_done_cb_t done_cb = nullptr,
+                               void *user_data = nullptr);
+
+    /**
+     * @brief Wait for the frame of preprocess_async() and write it to the model input.
+     *
+     * @param timeout Ticks to wait for the PPA
+     *
+     * @return ESP_OK if the model input is ready, ESP_ERR_TIMEOUT if the PPA is not done yet
+     */
+    esp_err_t preprocess_wait(TickType_t timeout = portMAX_DELAY);
 };
 
 } // namespace image
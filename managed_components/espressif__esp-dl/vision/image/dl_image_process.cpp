@@ -125,11 +125,10 @@ void bilinear_interpolate_gray(
     int y1 = (int)y;
     int y2 = y1 + 1;
 
-    uint8_t *img_data_ptr = (uint8_t *)img.data;
-    uint8_t Q1 = img_data_ptr[x1 + img.width * y1];
-    uint8_t Q2 = img_data_ptr[x2 + img.width * y1];
-    uint8_t Q3 = img_data_ptr[x1 + img.width * y2];
-    uint8_t Q4 = img_data_ptr[x2 + img.width * y2];
+    uint8_t Q1 = *get_luma_ptr(img, x1, y1);
+    uint8_t Q2 = *get_luma_ptr(img, x2, y1);
+    uint8_t Q3 = *get_luma_ptr(img, x1, y2);
+    uint8_t Q4 = *get_luma_ptr(img, x2, y2);
 
     float A = (x2 - x) * (y2 - y);
     float B = (x - x1) * (y2 - y);
@@ -192,7 +191,7 @@ void nearest_interpolate_gray(
     int x1 = (int)(x + 0.5f);
     int y1 = (int)(y + 0.5f);
 
-    pix_t Q = {.data = (void *)((uint8_t *)img.data + x1 + img.width * y1), .type = DL_IMAGE_PIX_TYPE_GRAY};
+    pix_t Q = {.data = (void *)get_luma_ptr(img, x1, y1), .type = DL_IMAGE_PIX_TYPE_GRAY};
     convert_pixel(Q, pix, 0, norm_lut);
 }
 
@@ -236,7 +235,7 @@ void resize_loop(const img_t &src_img,
                     pix_ptr += step;
                 }
             }
-        } else if (src_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY) {
+        } else if (src_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY || src_img.pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
             for (int i = 0; i < dst_img.height; i++) {
                 y = (i + 0.5f) * scale_y_inv - 0.5f;
                 for (int j = 0; j < dst_img.width; j++) {
@@ -271,7 +270,7 @@ void resize_loop(const img_t &src_img,
                     pix_ptr += step;
                 }
             }
-        } else if (src_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY) {
+        } else if (src_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY || src_img.pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
             for (int i = 0; i < dst_img.height; i++) {
                 y = (i + 0.5f) * scale_y_inv - 0.5f;
                 for (int j = 0; j < dst_img.width; j++) {
@@ -321,6 +320,323 @@ template void resize_loop<uint16_t>(const img_t &src_img,
                                     float scale_x,
                                     float scale_y);
 
+#define DL_IMAGE_RESIZE_COEF_BITS 11
+#define DL_IMAGE_WORKER_STACK_SIZE 4096
+
+#if !CONFIG_FREERTOS_UNICORE
+/**
+ * @brief The task of one core that runs the second half of a dual core call, created by the first call from the other
+ * core and kept for the next ones.
+ */
+typedef struct {
+    SemaphoreHandle_t lock; /*<! held by the caller for the whole call, nullptr if the semaphores can't be created */
+    SemaphoreHandle_t start;
+    SemaphoreHandle_t done;
+    TaskHandle_t task;
+    void (*func)(void *);
+    void *args;
+} image_worker_t;
+
+static void image_worker_task(void *args)
+{
+    image_worker_t *worker = (image_worker_t *)args;
+    while (true) {
+        xSemaphoreTake(worker->start, portMAX_DELAY);
+        worker->func(worker->args);
+        xSemaphoreGive(worker->done);
+    }
+}
+
+static image_worker_t create_image_worker()
+{
+    image_worker_t worker = {};
+    worker.lock = xSemaphoreCreateMutex();
+    worker.start = xSemaphoreCreateBinary();
+    worker.done = xSemaphoreCreateBinary();
+    if (!worker.lock || !worker.start || !worker.done) {
+        worker.lock = nullptr;
+    }
+    return worker;
+}
+#endif
+
+/**
+ * @brief Run func(args2) on the worker of the other core while the current task runs func(args1). The current task
+ * runs both if the worker is busy with another caller or can't be created.
+ */
+static void image_forward_dual_core(void (*func)(void *), void *args1, void *args2)
+{
+#if !CONFIG_FREERTOS_UNICORE
+    static image_worker_t workers[2] = {create_image_worker(), create_image_worker()};
+    BaseType_t core_id = (xPortGetCoreID() + 1) % 2;
+    image_worker_t &worker = workers[core_id];
+    if (worker.lock && xSemaphoreTake(worker.lock, 0) == pdTRUE) {
+        UBaseType_t current_priority = uxTaskPriorityGet(xTaskGetCurrentTaskHandle());
+        if (!worker.task &&
+            xTaskCreatePinnedToCore(image_worker_task,
+                                    "dl_image",
+                                    DL_IMAGE_WORKER_STACK_SIZE,
+                                    &worker,
+                                    current_priority,
+                                    &worker.task,
+                                    core_id) != pdPASS) {
+            worker.task = nullptr;
+        }
+        if (worker.task) {
+            vTaskPrioritySet(worker.task, current_priority);
+            worker.func = func;
+            worker.args = args2;
+            xSemaphoreGive(worker.start);
+            func(args1);
+            xSemaphoreTake(worker.done, portMAX_DELAY);
+            xSemaphoreGive(worker.lock);
+            return;
+        }
+        xSemaphoreGive(worker.lock);
+    }
+#endif
+    func(args1);
+    func(args2);
+}
+
+/**
+ * @brief Arguments of the rows of resize_bilinear() done by one task.
+ */
+typedef struct {
+    const img_t *src_img;
+    img_t *dst_img;
+    int channel;                         /*<! 3 or 1 */
+    int src_x;                           /*<! first column of the crop */
+    int src_w;                           /*<! width of the crop */
+    const int *x_ofs;                    /*<! left and right columns of each destination column, relative to src_x */
+    const int16_t *x_alpha;              /*<! weight of the right column, of 1 << DL_IMAGE_RESIZE_COEF_BITS */
+    const int *y_ofs;                    /*<! top and bottom rows of each destination row */
+    const int16_t *y_alpha;              /*<! weight of the bottom row, of 1 << DL_IMAGE_RESIZE_COEF_BITS */
+    convert_row_func_t decode_row_func;  /*<! rgb565 to rgb888 of the source rows, nullptr if not rgb565 */
+    bool decode_luma;                    /*<! the luma of the yuv420 source rows is gathered first */
+    convert_row_func_t convert_row_func; /*<! interpolated row to destination, nullptr if they are the same */
+    void *norm_lut;
+    int row_begin;
+    int row_end;
+    bool done; /*<! false if the row buffers can't be allocated, the rows are left untouched */
+} resize_bilinear_args_t;
+
+/**
+ * @brief Compute the two source indices and the weight of the second one of each destination index, the way
+ * bilinear_interpolate_rgb888() samples, i.e. pixel centers aligned and clamped to the border.
+ */
+static void resize_bilinear_coefficients(int src_size, int dst_size, float scale, int offset, int *ofs, int16_t *alpha)
+{
+    float scale_inv = 1.f / scale;
+    for (int i = 0; i < dst_size; i++) {
+        float v = std::max(std::min((i + 0.5f) * scale_inv - 0.5f, (float)(src_size - 1)), 0.f);
+        int v1 = (int)v;
+        int v2 = std::min(v1 + 1, src_size - 1);
+        ofs[2 * i] = v1 + offset;
+        ofs[2 * i + 1] = v2 + offset;
+        alpha[i] = (int16_t)((v - v1) * (1 << DL_IMAGE_RESIZE_COEF_BITS) + 0.5f);
+    }
+}
+
+static void resize_bilinear_horizontal(resize_bilinear_args_t *args, int y, uint8_t *decode_buffer, int32_t *row)
+{
+    int channel = args->channel;
+    const uint8_t *src_ptr;
+    if (args->decode_row_func) {
+        args->decode_row_func((uint16_t *)args->src_img->data + y * args->src_img->width + args->src_x,
+                              decode_buffer,
+                              args->src_w,
+                              nullptr);
+        src_ptr = decode_buffer;
+    } else if (args->decode_luma) {
+        for (int x = 0; x < args->src_w; x++) {
+            decode_buffer[x] = *get_luma_ptr(*args->src_img, args->src_x + x, y);
+        }
+        src_ptr = decode_buffer;
+    } else {
+        src_ptr = (uint8_t *)args->src_img->data + (y * args->src_img->width + args->src_x) * channel;
+    }
+    for (int j = 0; j < args->dst_img->width; j++) {
+        const uint8_t *ptr1 = src_ptr + args->x_ofs[2 * j] * channel;
+        const uint8_t *ptr2 = src_ptr + args->x_ofs[2 * j + 1] * channel;
+        int32_t alpha = args->x_alpha[j];
+        for (int c = 0; c < channel; c++) {
+            row[c] = (ptr1[c] << DL_IMAGE_RESIZE_COEF_BITS) + (ptr2[c] - ptr1[c]) * alpha;
+        }
+        row += channel;
+    }
+}
+
+static void resize_bilinear_rows(void *resize_args)
+{
+    resize_bilinear_args_t *args = (resize_bilinear_args_t *)resize_args;
+    int dst_w = args->dst_img->width;
+    int row_size = dst_w * args->channel;
+    int dst_row_bytes = dst_w * get_pix_byte_size(args->dst_img->pix_type);
+    int32_t *rows_buffer = (int32_t *)tool::malloc_aligned(row_size * 2, sizeof(int32_t), 16, MALLOC_CAP_INTERNAL);
+    int32_t *rows[2] = {rows_buffer, rows_buffer + row_size};
+    uint8_t *mid_row = args->convert_row_func
+        ? (uint8_t *)tool::malloc_aligned(row_size, sizeof(uint8_t), 16, MALLOC_CAP_INTERNAL)
+        : nullptr;
+    bool decode = args->decode_row_func || args->decode_luma;
+    uint8_t *decode_buffer = decode
+        ? (uint8_t *)tool::malloc_aligned(args->src_w * args->channel, sizeof(uint8_t), 16, MALLOC_CAP_INTERNAL)
+        : nullptr;
+    args->done = rows_buffer && (mid_row || !args->convert_row_func) && (decode_buffer || !decode);
+    // source rows held by rows[0] and rows[1], consecutive destination rows mostly share them when upscaling.
+    int rows_y[2] = {-1, -1};
+    const int shift = 2 * DL_IMAGE_RESIZE_COEF_BITS;
+
+    for (int i = args->row_begin; i < args->row_end && args->done; i++) {
+        int y1 = args->y_ofs[2 * i];
+        int y2 = args->y_ofs[2 * i + 1];
+        if (rows_y[0] != y1) {
+            if (rows_y[1] == y1) {
+                std::swap(rows[0], rows[1]);
+                std::swap(rows_y[0], rows_y[1]);
+            } else {
+                resize_bilinear_horizontal(args, y1, decode_buffer, rows[0]);
+                rows_y[0] = y1;
+            }
+        }
+        if (y2 != y1 && rows_y[1] != y2) {
+            resize_bilinear_horizontal(args, y2, decode_buffer, rows[1]);
+            rows_y[1] = y2;
+        }
+        const int32_t *row1 = rows[0];
+        const int32_t *row2 = y2 != y1 ? rows[1] : rows[0];
+        int32_t alpha = args->y_alpha[i];
+
+        uint8_t *dst_row = (uint8_t *)args->dst_img->data + i * dst_row_bytes;
+        uint8_t *out_row = mid_row ? mid_row : dst_row;
+        for (int k = 0; k < row_size; k++) {
+            out_row[k] = (uint8_t)(((row1[k] << DL_IMAGE_RESIZE_COEF_BITS) + (row2[k] - row1[k]) * alpha +
+                                    (1 << (shift - 1))) >>
+                                   shift);
+        }
+        if (mid_row) {
+            args->convert_row_func(mid_row, dst_row, dst_w, args->norm_lut);
+        }
+    }
+
+    if (rows_buffer) {
+        heap_caps_free(rows_buffer);
+    }
+    if (mid_row) {
+        heap_caps_free(mid_row);
+    }
+    if (decode_buffer) {
+        heap_caps_free(decode_buffer);
+    }
+}
+
+esp_err_t resize_bilinear(const img_t &src_img,
+                          img_t &dst_img,
+                          uint32_t caps,
+                          void *norm_lut,
+                          const std::vector<int> &crop_area,
+                          float scale_x,
+                          float scale_y,
+                          runtime_mode_t mode)
+{
+    resize_bilinear_args_t args;
+    args.src_img = &src_img;
+    args.dst_img = &dst_img;
+    args.norm_lut = norm_lut;
+    pix_type_t mid_type;
+    uint32_t convert_caps;
+    args.decode_luma = src_img.pix_type == DL_IMAGE_PIX_TYPE_YUV420;
+    if (src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB888) {
+        args.channel = 3;
+        args.decode_row_func = nullptr;
+        mid_type = DL_IMAGE_PIX_TYPE_RGB888;
+        convert_caps = caps;
+    } else if (src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565) {
+        // swapped while decoding, as bilinear_interpolate_rgb565() does.
+        args.channel = 3;
+        args.decode_row_func = get_convert_row_func(DL_IMAGE_PIX_TYPE_RGB565, DL_IMAGE_PIX_TYPE_RGB888, caps);
+        mid_type = DL_IMAGE_PIX_TYPE_RGB888;
+        convert_caps = 0;
+    } else if (src_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY || src_img.pix_type == DL_IMAGE_PIX_TYPE_YUV420) {
+        args.channel = 1;
+        args.decode_row_func = nullptr;
+        mid_type = DL_IMAGE_PIX_TYPE_GRAY;
+        convert_caps = 0;
+    } else {
+        ESP_LOGE(TAG, "Do not support quant img type.");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (dst_img.pix_type == mid_type && !(convert_caps & DL_IMAGE_CAP_RGB_SWAP)) {
+        args.convert_row_func = nullptr;
+    } else {
+        args.convert_row_func = get_convert_row_func(mid_type, dst_img.pix_type, convert_caps);
+        if (!args.convert_row_func) {
+            ESP_LOGE(TAG,
+                     "img conversion between fmt %s and %s is not implemented yet.",
+                     pix_type_to_str(src_img.pix_type).c_str(),
+                     pix_type_to_str(dst_img.pix_type).c_str());
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+
+    int src_y, src_h;
+    if (crop_area.empty()) {
+        args.src_x = 0;
+        args.src_w = src_img.width;
+        src_y = 0;
+        src_h = src_img.height;
+    } else {
+        args.src_x = crop_area[0];
+        args.src_w = crop_area[2] - crop_area[0];
+        src_y = crop_area[1];
+        src_h = crop_area[3] - crop_area[1];
+    }
+    int *ofs = (int *)tool::malloc_aligned(
+        2 * (dst_img.width + dst_img.height), sizeof(int), 16, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+    int16_t *alpha = (int16_t *)tool::malloc_aligned(
+        dst_img.width + dst_img.height, sizeof(int16_t), 16, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+    if (!ofs || !alpha) {
+        if (ofs) {
+            heap_caps_free(ofs);
+        }
+        if (alpha) {
+            heap_caps_free(alpha);
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    resize_bilinear_coefficients(args.src_w, dst_img.width, scale_x, 0, ofs, alpha);
+    resize_bilinear_coefficients(
+        src_h, dst_img.height, scale_y, src_y, ofs + 2 * dst_img.width, alpha + dst_img.width);
+    args.x_ofs = ofs;
+    args.x_alpha = alpha;
+    args.y_ofs = ofs + 2 * dst_img.width;
+    args.y_alpha = alpha + dst_img.width;
+    args.row_begin = 0;
+    args.row_end = dst_img.height;
+
+    bool dual_core = false;
+#if !CONFIG_FREERTOS_UNICORE
+    dual_core = dst_img.height >= 2 &&
+        (mode == RUNTIME_MODE_MULTI_CORE ||
+         (mode == RUNTIME_MODE_AUTO && dst_img.width * dst_img.height * args.channel >= (1 << 14)));
+#endif
+    bool done;
+    if (dual_core) {
+        // The other core takes the bottom half, each task keeps its own row buffers.
+        resize_bilinear_args_t args2 = args;
+        args.row_end = dst_img.height / 2;
+        args2.row_begin = args.row_end;
+        image_forward_dual_core(resize_bilinear_rows, &args, &args2);
+        done = args.done && args2.done;
+    } else {
+        resize_bilinear_rows(&args);
+        done = args.done;
+    }
+    heap_caps_free(ofs);
+    heap_caps_free(alpha);
+    return done ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
 void resize(const img_t &src_img,
             img_t &dst_img,
             interpolate_type_t interpolate_type,
@@ -361,6 +677,14 @@ void resize(const img_t &src_img,
         return;
     }
 
+    if (interpolate_type == DL_IMAGE_INTERPOLATE_BILINEAR) {
+        esp_err_t ret = resize_bilinear(src_img, dst_img, caps, norm_lut, crop_area, scale_x, scale_y);
+        // Out of internal RAM, resize_loop() needs no buffer.
+        if (ret != ESP_ERR_NO_MEM) {
+            return;
+        }
+    }
+
     switch (dst_img.pix_type) {
     case DL_IMAGE_PIX_TYPE_RGB888:
     case DL_IMAGE_PIX_TYPE_GRAY:
@@ -504,11 +828,9 @@ esp_err_t resize_ppa(const img_t &src_img,
     srm_oper_config.out.pic_w = dst_img.width;
     srm_oper_config.out.block_offset_x = 0;
     srm_oper_config.out.block_offset_y = 0;
-    bool need_convert = false;
     ppa_srm_color_mode_t output_srm_color_mode;
     if (norm_lut || convert_pix_type_to_ppa_srm_fmt(dst_img.pix_type, &output_srm_color_mode) == ESP_FAIL) {
         output_srm_color_mode = PPA_SRM_COLOR_MODE_RGB888;
-        need_convert = true;
     }
     srm_oper_config.out.srm_cm = output_srm_color_mode;
     srm_oper_config.rotation_angle = PPA_SRM_ROTATION_ANGLE_0;
@@ -521,7 +843,16 @@ esp_err_t resize_ppa(const img_t &src_img,
     srm_oper_config.user_data = ppa_user_data;
     memset(ppa_buffer, 0, ppa_buffer_size);
     ESP_ERROR_CHECK(ppa_do_scale_rotate_mirror(ppa_handle, &srm_oper_config));
-    if (need_convert) {
+    if (ppa_mode == PPA_TRANS_MODE_BLOCKING) {
+        resize_ppa_finish(dst_img, ppa_buffer, norm_lut);
+    }
+    return ESP_OK;
+}
+
+void resize_ppa_finish(img_t &dst_img, void *ppa_buffer, void *norm_lut)
+{
+    ppa_srm_color_mode_t output_srm_color_mode;
+    if (norm_lut || convert_pix_type_to_ppa_srm_fmt(dst_img.pix_type, &output_srm_color_mode) == ESP_FAIL) {
         img_t ppa_output_img = {
             .data = ppa_buffer, .width = dst_img.width, .height = dst_img.height, .pix_type = DL_IMAGE_PIX_TYPE_RGB888};
         convert_img(ppa_output_img, dst_img, 0, norm_lut);
@@ -530,7 +861,6 @@ esp_err_t resize_ppa(const img_t &src_img,
             tool::copy_memory(dst_img.data, ppa_buffer, get_img_byte_size(dst_img));
         }
     }
-    return ESP_OK;
 }
 #endif
 template <typename T>
@@ -671,35 +1001,246 @@ template void warp_affine_loop<uint16_t>(const img_t &src_img,
                                          uint32_t caps,
                                          void *norm_lut);
 
+/**
+ * @brief A destination image, or some rows of it, warped by one task of warp_affine_batch().
+ */
+typedef struct {
+    img_t *dst_img;
+    const dl::math::Matrix<float> *M_inv;
+    int row_begin;
+    int row_end;
+    bool done; /*<! false if the row buffer can't be allocated, the rows are left untouched */
+} warp_affine_job_t;
+
+typedef struct {
+    const img_t *src_img;
+    interpolate_type_t interpolate_type;
+    uint32_t caps;
+    void *norm_lut;
+    std::vector<warp_affine_job_t> jobs;
+} warp_affine_args_t;
+
+/**
+ * @brief Sample the rows of a job. The source coordinates of a row are stepped in 16.16 fixed point, clamped to the
+ * border like bilinear_interpolate_rgb888() does, and bilinear weights are taken at 11 bits. Pixels are sampled into
+ * a row of the source type, or of rgb888 for rgb565 bilinear, which the row kernel of convert_img() converts and
+ * quantizes to the destination.
+ */
+static void warp_affine_job(const warp_affine_args_t *args, warp_affine_job_t &job, uint8_t *mid_row)
+{
+    const img_t &src_img = *args->src_img;
+    img_t &dst_img = *job.dst_img;
+    bool bilinear = args->interpolate_type == DL_IMAGE_INTERPOLATE_BILINEAR;
+    pix_type_t mid_type = src_img.pix_type;
+    uint32_t convert_caps = src_img.pix_type == DL_IMAGE_PIX_TYPE_GRAY ? 0 : args->caps;
+    if (bilinear && src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565) {
+        // swapped while decoding, as bilinear_interpolate_rgb565() does.
+        mid_type = DL_IMAGE_PIX_TYPE_RGB888;
+        convert_caps = 0;
+    }
+    convert_row_func_t convert_row_func = nullptr;
+    if (dst_img.pix_type != mid_type || (convert_caps & DL_IMAGE_CAP_RGB_SWAP) ||
+        (mid_type == DL_IMAGE_PIX_TYPE_RGB565 && convert_caps)) {
+        convert_row_func = get_convert_row_func(mid_type, dst_img.pix_type, convert_caps);
+        if (!convert_row_func) {
+            ESP_LOGE(TAG,
+                     "img conversion between fmt %s and %s is not implemented yet.",
+                     pix_type_to_str(src_img.pix_type).c_str(),
+                     pix_type_to_str(dst_img.pix_type).c_str());
+            return;
+        }
+        if (!mid_row) {
+            job.done = false;
+            return;
+        }
+    }
+
+    float **M = job.M_inv->array;
+    const int32_t one = 1 << 16;
+    int32_t max_x = (src_img.width - 1) << 16;
+    int32_t max_y = (src_img.height - 1) << 16;
+    int32_t dx_x = (int32_t)lroundf(M[0][0] * one);
+    int32_t dx_y = (int32_t)lroundf(M[1][0] * one);
+    int src_pix_size = get_pix_byte_size(src_img.pix_type);
+    int dst_row_bytes = dst_img.width * get_pix_byte_size(dst_img.pix_type);
+    int src_row_bytes = src_img.width * src_pix_size;
+    const uint8_t *src = (const uint8_t *)src_img.data;
+
+    for (int i = job.row_begin; i < job.row_end; i++) {
+        int32_t x = (int32_t)lroundf((M[0][1] * i + M[0][2]) * one);
+        int32_t y = (int32_t)lroundf((M[1][1] * i + M[1][2]) * one);
+        uint8_t *dst_row = (uint8_t *)dst_img.data + i * dst_row_bytes;
+        uint8_t *out = convert_row_func ? mid_row : dst_row;
+        for (int j = 0; j < dst_img.width; j++, x += dx_x, y += dx_y) {
+            int32_t cx = std::max(std::min(x, max_x), 0);
+            int32_t cy = std::max(std::min(y, max_y), 0);
+            if (!bilinear) {
+                int x1 = (cx + (one >> 1)) >> 16;
+                int y1 = (cy + (one >> 1)) >> 16;
+                const uint8_t *ptr = src + y1 * src_row_bytes + x1 * src_pix_size;
+                for (int c = 0; c < src_pix_size; c++) {
+                    out[c] = ptr[c];
+                }
+                out += src_pix_size;
+                continue;
+            }
+            int x1 = cx >> 16;
+            int y1 = cy >> 16;
+            int32_t ax = (cx >> (16 - DL_IMAGE_RESIZE_COEF_BITS)) & ((1 << DL_IMAGE_RESIZE_COEF_BITS) - 1);
+            int32_t ay = (cy >> (16 - DL_IMAGE_RESIZE_COEF_BITS)) & ((1 << DL_IMAGE_RESIZE_COEF_BITS) - 1);
+            int x_step = x1 < src_img.width - 1 ? src_pix_size : 0;
+            int y_step = y1 < src_img.height - 1 ? src_row_bytes : 0;
+            const uint8_t *ptr = src + y1 * src_row_bytes + x1 * src_pix_size;
+            const uint8_t *q[4] = {ptr, ptr + x_step, ptr + y_step, ptr + y_step + x_step};
+            uint8_t rgb[12];
+            int channel = src_pix_size;
+            if (src_img.pix_type == DL_IMAGE_PIX_TYPE_RGB565) {
+                for (int k = 0; k < 4; k++) {
+                    convert_pixel_from_rgb565_to_rgb888((uint16_t *)q[k], rgb + 3 * k, args->caps);
+                    q[k] = rgb + 3 * k;
+                }
+                channel = 3;
+            }
+            for (int c = 0; c < channel; c++) {
+                int32_t top = (q[0][c] << DL_IMAGE_RESIZE_COEF_BITS) + (q[1][c] - q[0][c]) * ax;
+                int32_t bottom = (q[2][c] << DL_IMAGE_RESIZE_COEF_BITS) + (q[3][c] - q[2][c]) * ax;
+                out[c] = (uint8_t)(((top << DL_IMAGE_RESIZE_COEF_BITS) + (bottom - top) * ay +
+                                    (1 << (2 * DL_IMAGE_RESIZE_COEF_BITS - 1))) >>
+                                   (2 * DL_IMAGE_RESIZE_COEF_BITS));
+            }
+            out += channel;
+        }
+        if (convert_row_func) {
+            convert_row_func(mid_row, dst_row, dst_img.width, args->norm_lut);
+        }
+    }
+}
+
+static void warp_affine_jobs(void *warp_args)
+{
+    warp_affine_args_t *args = (warp_affine_args_t *)warp_args;
+    int mid_row_size = 0;
+    for (const warp_affine_job_t &job : args->jobs) {
+        mid_row_size = std::max(mid_row_size, job.dst_img->width * 3);
+    }
+    uint8_t *mid_row = (uint8_t *)tool::malloc_aligned(mid_row_size, sizeof(uint8_t), 16, MALLOC_CAP_INTERNAL);
+    for (warp_affine_job_t &job : args->jobs) {
+        warp_affine_job(args, job, mid_row);
+    }
+    if (mid_row) {
+        heap_caps_free(mid_row);
+    }
+}
+
+/**
+ * @brief Out of internal RAM for the row buffer, warp the images left untouched with warp_affine_loop(), which needs
+ * no buffer.
+ */
+static void warp_affine_redo(const warp_affine_args_t &args,
+                             std::vector<img_t> &dst_imgs,
+                             const std::vector<dl::math::Matrix<float> *> &M_invs)
+{
+    std::vector<bool> redo(dst_imgs.size(), false);
+    for (const warp_affine_job_t &job : args.jobs) {
+        if (!job.done) {
+            redo[job.dst_img - dst_imgs.data()] = true;
+        }
+    }
+    for (int i = 0; i < dst_imgs.size(); i++) {
+        if (!redo[i]) {
+            continue;
+        }
+        const img_t &src_img = *args.src_img;
+        interpolate_type_t interpolate_type = args.interpolate_type;
+        switch (dst_imgs[i].pix_type) {
+        case DL_IMAGE_PIX_TYPE_RGB888:
+        case DL_IMAGE_PIX_TYPE_GRAY:
+            warp_affine_loop<uint8_t>(src_img, dst_imgs[i], interpolate_type, M_invs[i], args.caps, args.norm_lut);
+            break;
+        case DL_IMAGE_PIX_TYPE_RGB888_QINT8:
+        case DL_IMAGE_PIX_TYPE_GRAY_QINT8:
+            warp_affine_loop<int8_t>(src_img, dst_imgs[i], interpolate_type, M_invs[i], args.caps, args.norm_lut);
+            break;
+        case DL_IMAGE_PIX_TYPE_RGB888_QINT16:
+        case DL_IMAGE_PIX_TYPE_GRAY_QINT16:
+            warp_affine_loop<int16_t>(src_img, dst_imgs[i], interpolate_type, M_invs[i], args.caps, args.norm_lut);
+            break;
+        case DL_IMAGE_PIX_TYPE_RGB565:
+            warp_affine_loop<uint16_t>(src_img, dst_imgs[i], interpolate_type, M_invs[i], args.caps, args.norm_lut);
+            break;
+        }
+    }
+}
+
+void warp_affine_batch(const img_t &src_img,
+                       std::vector<img_t> &dst_imgs,
+                       interpolate_type_t interpolate_type,
+                       const std::vector<dl::math::Matrix<float> *> &M_invs,
+                       uint32_t caps,
+                       void *norm_lut,
+                       runtime_mode_t mode)
+{
+    assert(src_img.data);
+    assert(src_img.height > 0 && src_img.width > 0);
+    assert(dst_imgs.size() == M_invs.size());
+    if (src_img.pix_type != DL_IMAGE_PIX_TYPE_RGB888 && src_img.pix_type != DL_IMAGE_PIX_TYPE_RGB565 &&
+        src_img.pix_type != DL_IMAGE_PIX_TYPE_GRAY) {
+        ESP_LOGE(TAG, "Do not support quant img type.");
+        return;
+    }
+    if (dst_imgs.empty()) {
+        return;
+    }
+
+    warp_affine_args_t args;
+    args.src_img = &src_img;
+    args.interpolate_type = interpolate_type;
+    args.caps = caps;
+    args.norm_lut = norm_lut;
+    int total_size = 0;
+    for (int i = 0; i < dst_imgs.size(); i++) {
+        assert(dst_imgs[i].data);
+        assert(dst_imgs[i].height > 0 && dst_imgs[i].width > 0);
+        args.jobs.push_back({&dst_imgs[i], M_invs[i], 0, dst_imgs[i].height, true});
+        total_size += dst_imgs[i].height * dst_imgs[i].width;
+    }
+
+    bool dual_core = false;
+#if !CONFIG_FREERTOS_UNICORE
+    dual_core = (dst_imgs.size() >= 2 || dst_imgs[0].height >= 2) &&
+        (mode == RUNTIME_MODE_MULTI_CORE || (mode == RUNTIME_MODE_AUTO && total_size * 3 >= (1 << 14)));
+#endif
+    if (!dual_core) {
+        warp_affine_jobs(&args);
+        warp_affine_redo(args, dst_imgs, M_invs);
+        return;
+    }
+
+    // The other core takes the second half of the images, or of the rows of a single image.
+    warp_affine_args_t args2 = args;
+    if (dst_imgs.size() >= 2) {
+        int half = dst_imgs.size() / 2;
+        args.jobs.resize(half);
+        args2.jobs.erase(args2.jobs.begin(), args2.jobs.begin() + half);
+    } else {
+        args.jobs[0].row_end = dst_imgs[0].height / 2;
+        args2.jobs[0].row_begin = args.jobs[0].row_end;
+    }
+    image_forward_dual_core(warp_affine_jobs, &args, &args2);
+    args.jobs.insert(args.jobs.end(), args2.jobs.begin(), args2.jobs.end());
+    warp_affine_redo(args, dst_imgs, M_invs);
+}
+
 void warp_affine(const img_t &src_img,
                  img_t &dst_img,
                  interpolate_type_t interpolate_type,
                  dl::math::Matrix<float> *M_inv,
                  uint32_t caps,
-                 void *norm_lut)
+                 void *norm_lut,
+                 runtime_mode_t mode)
 {
-    assert(src_img.data);
-    assert(dst_img.data);
-    assert(src_img.height > 0 && src_img.width > 0);
-    assert(dst_img.height > 0 && dst_img.width > 0);
-
-    switch (dst_img.pix_type) {
-    case DL_IMAGE_PIX_TYPE_RGB888:
-    case DL_IMAGE_PIX_TYPE_GRAY:
-        warp_affine_loop<uint8_t>(src_img, dst_img, interpolate_type, M_inv, caps, norm_lut);
-        break;
-    case DL_IMAGE_PIX_TYPE_RGB888_QINT8:
-    case DL_IMAGE_PIX_TYPE_GRAY_QINT8:
-        warp_affine_loop<int8_t>(src_img, dst_img, interpolate_type, M_inv, caps, norm_lut);
-        break;
-    case DL_IMAGE_PIX_TYPE_RGB888_QINT16:
-    case DL_IMAGE_PIX_TYPE_GRAY_QINT16:
-        warp_affine_loop<int16_t>(src_img, dst_img, interpolate_type, M_inv, caps, norm_lut);
-        break;
-    case DL_IMAGE_PIX_TYPE_RGB565:
-        warp_affine_loop<uint16_t>(src_img, dst_img, interpolate_type, M_inv, caps, norm_lut);
-        break;
-    }
+    std::vector<img_t> dst_imgs = {dst_img};
+    warp_affine_batch(src_img, dst_imgs, interpolate_type, {M_inv}, caps, norm_lut, mode);
 }
 } // namespace image
 } // namespace dl
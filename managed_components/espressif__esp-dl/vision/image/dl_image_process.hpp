@@ -54,6 +54,33 @@ void resize_loop(const img_t &src_img,
                  const std::vector<int> &crop_area,
                  float scale_x,
                  float scale_y);
+/**
+ * @brief Bilinear resize in two fixed-point passes. Each source row used is interpolated horizontally once with
+ * precomputed column coefficients, then pairs of them are blended vertically into a destination row, which is
+ * converted and quantized right away by the row kernel of convert_img(). Rows are split across both cores when the
+ * image is large enough or RUNTIME_MODE_MULTI_CORE is set. resize() calls it for bilinear resize of rgb888, rgb565 and
+ * gray images, resize_loop() is the per-pixel reference.
+ *
+ * @param src_img   Source image, rgb888, rgb565 or gray
+ * @param dst_img   Destination image
+ * @param caps      Conversion caps, see convert_img()
+ * @param norm_lut  The normalization lut of the quantized destination types
+ * @param crop_area [x1, y1, x2, y2] of the source image to resize, the whole image if empty
+ * @param scale_x   dst_img.width / crop width
+ * @param scale_y   dst_img.height / crop height
+ * @param mode      Runtime mode, the rows are resized on one core if the task of the other can't be created
+ *
+ * @return ESP_OK, ESP_ERR_NO_MEM if the buffers can't be allocated in internal RAM, some rows may be left untouched
+ * then, ESP_ERR_NOT_SUPPORTED for other image types
+ */
+esp_err_t resize_bilinear(const img_t &src_img,
+                          img_t &dst_img,
+                          uint32_t caps,
+                          void *norm_lut,
+                          const std::vector<int> &crop_area,
+                          float scale_x,
+                          float scale_y,
+                          runtime_mode_t mode = RUNTIME_MODE_AUTO);
 void resize(const img_t &src_img,
             img_t &dst_img,
             interpolate_type_t interpolate_type,
@@ -76,12 +103,50 @@ esp_err_t resize_ppa(const img_t &src_img,
                      float *scale_x_ret = nullptr,
                      float *scale_y_ret = nullptr,
                      float ppa_error_thr = 0.3);
+/**
+ * @brief Finish a resize_ppa() done by the PPA, i.e. convert or copy the ppa_buffer to dst_img. resize_ppa() calls it
+ * in PPA_TRANS_MODE_BLOCKING, call it once the transaction is done in PPA_TRANS_MODE_NON_BLOCKING.
+ *
+ * @param dst_img    Destination image of resize_ppa()
+ * @param ppa_buffer PPA buffer of resize_ppa()
+ * @param norm_lut   Normalization lut of resize_ppa()
+ */
+void resize_ppa_finish(img_t &dst_img, void *ppa_buffer, void *norm_lut = nullptr);
 #endif
+template <typename T>
+void warp_affine_loop(const img_t &src_img,
+                      img_t &dst_img,
+                      interpolate_type_t interpolate_type,
+                      dl::math::Matrix<float> *M_inv,
+                      uint32_t caps,
+                      void *norm_lut);
+/**
+ * @brief Warp a source image into a destination image per matrix, e.g. align all the faces of a frame in one call.
+ * Source coordinates are stepped in fixed point along each row and the rows are converted and quantized by the row
+ * kernel of convert_img(). The images, or the rows of a single one, are split across both cores when they are large
+ * enough or RUNTIME_MODE_MULTI_CORE is set. warp_affine_loop() is the per-pixel reference.
+ *
+ * @param src_img          Source image, rgb888, rgb565 or gray
+ * @param dst_imgs         Destination images
+ * @param interpolate_type Interpolate type
+ * @param M_invs           Inverse affine matrix of each destination image, from destination to source coordinates
+ * @param caps             Conversion caps, see convert_img()
+ * @param norm_lut         The normalization lut of the quantized destination types
+ * @param mode             Runtime mode
+ */
+void warp_affine_batch(const img_t &src_img,
+                       std::vector<img_t> &dst_imgs,
+                       interpolate_type_t interpolate_type,
+                       const std::vector<dl::math::Matrix<float> *> &M_invs,
+                       uint32_t caps = 0,
+                       void *norm_lut = nullptr,
+                       runtime_mode_t mode = RUNTIME_MODE_AUTO);
 void warp_affine(const img_t &src_img,
                  img_t &dst_img,
                  interpolate_type_t interpolate_type,
                  dl::math::Matrix<float> *M_inv,
                  uint32_t caps = 0,
-                 void *norm_lut = nullptr);
+                 void *norm_lut = nullptr,
+                 runtime_mode_t mode = RUNTIME_MODE_AUTO);
 } // namespace image
 } // namespace dl
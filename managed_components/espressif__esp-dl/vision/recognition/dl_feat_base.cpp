@@ -17,6 +17,9 @@ FeatImpl::~FeatImpl()
         delete m_postprocessor;
         m_postprocessor = nullptr;
     }
+    for (TensorBase *feat : m_feats) {
+        delete feat;
+    }
 }
 
 TensorBase *FeatImpl::run(const dl::image::img_t &img, const std::vector<int> &landmarks)
@@ -40,5 +43,33 @@ TensorBase *FeatImpl::run(const dl::image::img_t &img, const std::vector<int> &l
     return feat;
 }
 
+std::vector<TensorBase *> FeatImpl::run(const dl::image::img_t &img, const std::vector<std::vector<int>> &landmarks)
+{
+    dl::tool::Latency latency[3] = {dl::tool::Latency(), dl::tool::Latency(), dl::tool::Latency()};
+    latency[0].start();
+    m_image_preprocessor->preprocess(img, landmarks);
+    latency[0].end();
+
+    for (int i = 0; i < landmarks.size(); i++) {
+        m_image_preprocessor->load_batch(i);
+        latency[1].start();
+        m_model->run();
+        latency[1].end();
+
+        latency[2].start();
+        dl::TensorBase *feat = m_postprocessor->postprocess();
+        if (i == m_feats.size()) {
+            m_feats.push_back(new TensorBase(feat->shape, nullptr, feat->exponent, feat->dtype));
+        }
+        m_feats[i]->assign(feat);
+        latency[2].end();
+    }
+
+    latency[0].print("feat", "preprocess");
+    latency[1].print("feat", "forward");
+    latency[2].print("feat", "postprocess");
+    return std::vector<TensorBase *>(m_feats.begin(), m_feats.begin() + landmarks.size());
+}
+
 } // namespace feat
 } // namespace dl
@@ -10,6 +10,13 @@ class Feat {
 public:
     virtual ~Feat() {};
     virtual TensorBase *run(const dl::image::img_t &img, const std::vector<int> &landmarks) = 0;
+    /**
+     * @brief Get the feature of each face of a frame, the faces are aligned in one batch.
+     *
+     * @return Features in the order of landmarks, owned by the model and valid until the next run
+     */
+    virtual std::vector<TensorBase *> run(const dl::image::img_t &img,
+                                          const std::vector<std::vector<int>> &landmarks) = 0;
 };
 
 class FeatWrapper : public Feat {
@@ -28,6 +35,10 @@ public:
     {
         return m_model->run(img, landmarks);
     }
+    std::vector<TensorBase *> run(const dl::image::img_t &img, const std::vector<std::vector<int>> &landmarks)
+    {
+        return m_model->run(img, landmarks);
+    }
 };
 
 class FeatImpl : public Feat {
@@ -35,10 +46,13 @@ protected:
     dl::Model *m_model;
     dl::image::FeatImagePreprocessor *m_image_preprocessor;
     dl::feat::FeatPostprocessor *m_postprocessor;
+    std::vector<TensorBase *> m_feats; /*<! features of the batched run(), only grows */
 
 public:
     ~FeatImpl();
     TensorBase *run(const dl::image::img_t &img, const std::vector<int> &landmarks) override;
+    std::vector<TensorBase *> run(const dl::image::img_t &img,
+                                  const std::vector<std::vector<int>> &landmarks) override;
 };
 } // namespace feat
 } // namespace dl
@@ -13,12 +13,13 @@ FeatImagePreprocessor::~FeatImagePreprocessor()
     }
 }
 
-void FeatImagePreprocessor::preprocess(const dl::image::img_t &img, const std::vector<int> &landmarks)
+dl::math::Matrix<float> FeatImagePreprocessor::get_M_inv(const std::vector<int> &landmarks)
 {
     assert(landmarks.size() == 10);
     // align face
-    float h_scale = (float)m_image_preprocessor->m_model_input->shape[1] / 112.0;
-    float w_scale = (float)m_image_preprocessor->m_model_input->shape[2] / 112.0;
+    TensorBase *model_input = m_image_preprocessor->get_model_input();
+    float h_scale = (float)model_input->shape[1] / 112.0;
+    float w_scale = (float)model_input->shape[2] / 112.0;
     dl::math::Matrix<float> source_coord(5, 2);
     dl::math::Matrix<float> dest_coord(5, 2);
     dest_coord.set_value(landmarks);
@@ -26,8 +27,25 @@ void FeatImagePreprocessor::preprocess(const dl::image::img_t &img, const std::v
         source_coord.array[i][0] = w_scale * s_std_ldks_112[2 * i];
         source_coord.array[i][1] = h_scale * s_std_ldks_112[2 * i + 1];
     }
-    dl::math::Matrix<float> M_inv = dl::math::get_similarity_transform(source_coord, dest_coord);
+    return dl::math::get_similarity_transform(source_coord, dest_coord);
+}
+
+void FeatImagePreprocessor::preprocess(const dl::image::img_t &img, const std::vector<int> &landmarks)
+{
+    dl::math::Matrix<float> M_inv = get_M_inv(landmarks);
     m_image_preprocessor->preprocess(img, &M_inv);
 }
+
+void FeatImagePreprocessor::preprocess(const dl::image::img_t &img, const std::vector<std::vector<int>> &landmarks)
+{
+    std::vector<dl::math::Matrix<float>> M_invs;
+    M_invs.reserve(landmarks.size());
+    std::vector<dl::math::Matrix<float> *> M_inv_ptrs;
+    for (const std::vector<int> &face_landmarks : landmarks) {
+        M_invs.push_back(get_M_inv(face_landmarks));
+        M_inv_ptrs.push_back(&M_invs.back());
+    }
+    m_image_preprocessor->preprocess(img, M_inv_ptrs);
+}
 } // namespace image
 } // namespace dl
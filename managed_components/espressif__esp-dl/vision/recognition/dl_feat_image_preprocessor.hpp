@@ -17,7 +17,19 @@ public:
 
     void preprocess(const dl::image::img_t &img, const std::vector<int> &landmarks);
 
+    /**
+     * @brief Align all the faces of a frame in one call, load face i into the model input with load_batch(i).
+     *
+     * @param img        Frame
+     * @param landmarks  Landmarks of each face
+     */
+    void preprocess(const dl::image::img_t &img, const std::vector<std::vector<int>> &landmarks);
+
+    void load_batch(int index) { m_image_preprocessor->load_batch(index); }
+
 private:
+    dl::math::Matrix<float> get_M_inv(const std::vector<int> &landmarks);
+
     static std::vector<float> s_std_ldks_112;
     dl::image::ImagePreprocessor *m_image_preprocessor;
 };
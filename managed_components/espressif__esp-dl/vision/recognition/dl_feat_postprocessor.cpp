@@ -3,21 +3,21 @@
 namespace dl {
 namespace feat {
 
-FeatPostprocessor::FeatPostprocessor(Model *model, const std::string &output_name)
+FeatPostprocessor::FeatPostprocessor(Model *model, const std::string &output_name) :
+    m_model(model), m_output_name(output_name)
 {
     if (output_name.empty()) {
         std::map<std::string, dl::TensorBase *> model_outputs_map = model->get_outputs();
         assert(model_outputs_map.size() == 1);
-        m_model_output = model_outputs_map.begin()->second;
-    } else {
-        m_model_output = model->get_intermediate(output_name);
+        m_output_name = model_outputs_map.begin()->first;
     }
-    m_feat = new TensorBase(m_model_output->shape, nullptr, 0, DATA_TYPE_FLOAT);
+    m_feat = new TensorBase(model->get_intermediate(m_output_name)->shape, nullptr, 0, DATA_TYPE_FLOAT);
 }
 
 TensorBase *FeatPostprocessor::postprocess()
 {
-    m_feat->assign(m_model_output);
+    // The tensor changes with the memory plan of the model.
+    m_feat->assign(m_model->get_intermediate(m_output_name));
     l2_norm();
     return m_feat;
 }
@@ -8,7 +8,8 @@ namespace dl {
 namespace feat {
 class FeatPostprocessor {
 private:
-    TensorBase *m_model_output;
+    Model *m_model;
+    std::string m_output_name;
     TensorBase *m_feat;
     void l2_norm();
 
@@ -1,16 +1,80 @@
 #include "dl_recognition_database.hpp"
+#include "dl_base_dotprod.hpp"
+#include <cmath>
 #include <unistd.h>
 
 static const char *TAG = "dl::recognition::DataBase";
+// int16 features are kept within 15 bits so that the 40-bit accumulator of esp32p4 can not overflow.
+static const int DB_QUANT16_MAX = 16383;
 
 namespace dl {
 namespace recognition {
-DataBase::DataBase(const char *db_path, db_type_t db_type, int feat_len) : m_db_type(db_type)
+template <typename T>
+static void quantize_feat(const float *feat, int feat_len, T *row, int feat_stride, float rescale, int quant_max)
+{
+    for (int i = 0; i < feat_len; i++) {
+        int value = tool::round(feat[i] * rescale);
+        row[i] = (T)(DL_CLIP(value, -quant_max, quant_max));
+    }
+    for (int i = feat_len; i < feat_stride; i++) {
+        row[i] = 0;
+    }
+}
+
+int quantize_feat(const float *feat, int feat_len, void *row, int feat_stride, quant_type_t quant_type)
+{
+    int quant_max = (quant_type == QUANT_TYPE_SYMM_16BIT) ? DB_QUANT16_MAX : DL_QUANT8_MAX;
+    float max_abs = 0;
+    for (int i = 0; i < feat_len; i++) {
+        max_abs = std::max(max_abs, fabsf(feat[i]));
+    }
+    // per-row power-of-two exponent, the smallest one that keeps the row inside the quant range.
+    int exponent = 0;
+    if (max_abs > 0) {
+        exponent = (int)ceilf(log2f(max_abs / quant_max));
+    }
+    if (quant_type == QUANT_TYPE_SYMM_16BIT) {
+        quantize_feat(feat, feat_len, (int16_t *)row, feat_stride, DL_RESCALE(exponent), quant_max);
+    } else {
+        quantize_feat(feat, feat_len, (int8_t *)row, feat_stride, DL_RESCALE(exponent), quant_max);
+    }
+    return exponent;
+}
+
+void dequantize_feat(const void *row, int exponent, int feat_len, quant_type_t quant_type, float *feat)
+{
+    for (int i = 0; i < feat_len; i++) {
+        if (quant_type == QUANT_TYPE_SYMM_16BIT) {
+            feat[i] = ldexpf(((const int16_t *)row)[i], exponent);
+        } else {
+            feat[i] = ldexpf(((const int8_t *)row)[i], exponent);
+        }
+    }
+}
+
+float cal_similarity(
+    const void *row1, int exponent1, const void *row2, int exponent2, int feat_stride, quant_type_t quant_type)
+{
+    int64_t sum;
+    if (quant_type == QUANT_TYPE_SYMM_16BIT) {
+        sum = base::dotprod((const int16_t *)row1, (const int16_t *)row2, feat_stride);
+    } else {
+        sum = base::dotprod((const int8_t *)row1, (const int8_t *)row2, feat_stride);
+    }
+    return ldexpf((float)sum, exponent1 + exponent2);
+}
+
+DataBase::DataBase(const char *db_path, db_type_t db_type, int feat_len, quant_type_t quant_type) :
+    m_db_type(db_type), m_quant_type(quant_type), m_capacity(0), m_feats(nullptr), m_index(nullptr)
 {
     assert(db_path);
+    assert(quant_type == QUANT_TYPE_SYMM_8BIT || quant_type == QUANT_TYPE_SYMM_16BIT);
     int length = strlen(db_path) + 1;
     m_db_path = (char *)malloc(sizeof(char) * length);
     memcpy(m_db_path, db_path, length);
+    int align = (m_quant_type == QUANT_TYPE_SYMM_16BIT) ? 8 : 16;
+    m_feat_stride = (feat_len + align - 1) / align * align;
+    m_query = tool::calloc_aligned(m_feat_stride, m_quant_type == QUANT_TYPE_SYMM_16BIT ? 2 : 1, 16, MALLOC_CAP_8BIT);
     if (access(db_path, F_OK) == 0) {
         load_database_from_storage(feat_len);
     } else {
@@ -20,7 +84,16 @@ DataBase::DataBase(const char *db_path, db_type_t db_type, int feat_len) : m_db_
 
 DataBase::~DataBase()
 {
+    remove_index();
     clear_all_feats_in_memory();
+    if (m_feats) {
+        heap_caps_free(m_feats);
+        m_feats = nullptr;
+    }
+    if (m_query) {
+        heap_caps_free(m_query);
+        m_query = nullptr;
+    }
     if (m_db_path) {
         free(m_db_path);
         m_db_path = nullptr;
@@ -56,16 +129,15 @@ esp_err_t DataBase::clear_all_feats()
     }
     ESP_RETURN_ON_ERROR(
         create_empty_database_in_storage(m_meta.feat_len), TAG, "Failed to create empty db in storage.");
+    remove_index();
     clear_all_feats_in_memory();
     return ESP_OK;
 }
 
 void DataBase::clear_all_feats_in_memory()
 {
-    for (auto it = m_feats.begin(); it != m_feats.end(); it++) {
-        heap_caps_free(it->feat);
-    }
-    m_feats.clear();
+    m_ids.clear();
+    m_exponents.clear();
     m_meta.num_feats_total = 0;
     m_meta.num_feats_valid = 0;
 }
@@ -90,33 +162,42 @@ esp_err_t DataBase::load_database_from_storage(int feat_len)
         fclose(f);
         return ESP_FAIL;
     }
+    if (reserve(m_meta.num_feats_valid) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to alloc memory for features.");
+        fclose(f);
+        return ESP_FAIL;
+    }
     uint16_t id;
+    float *feat = (float *)malloc(sizeof(float) * m_meta.feat_len);
     for (int i = 0; i < m_meta.num_feats_total; i++) {
         size = fread(&id, sizeof(uint16_t), 1, f);
         if (size != 1) {
             ESP_LOGE(TAG, "Failed to read feature id.");
+            free(feat);
             fclose(f);
             return ESP_FAIL;
         }
         if (id == 0) {
             if (fseek(f, sizeof(float) * m_meta.feat_len, SEEK_CUR) != 0) {
                 ESP_LOGE(TAG, "Failed to seek db file.");
+                free(feat);
                 fclose(f);
                 return ESP_FAIL;
             }
             continue;
         }
-        float *feat =
-            (float *)tool::malloc_aligned(m_meta.feat_len, sizeof(float), 16, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
         size = fread(feat, sizeof(float), m_meta.feat_len, f);
-        if (size != m_meta.feat_len) {
+        if (size != m_meta.feat_len || m_ids.size() == m_capacity) {
             ESP_LOGE(TAG, "Failed to read feature data.");
+            free(feat);
             fclose(f);
             return ESP_FAIL;
         }
-        m_feats.emplace_back(id, feat);
+        m_exponents.push_back(quantize_feat(feat, m_meta.feat_len, get_row(m_ids.size()), m_feat_stride, m_quant_type));
+        m_ids.push_back(id);
     }
-    if (m_feats.size() != m_meta.num_feats_valid) {
+    free(feat);
+    if (m_ids.size() != m_meta.num_feats_valid) {
         ESP_LOGE(TAG, "Incorrect valid feature num.");
         fclose(f);
         return ESP_FAIL;
@@ -135,11 +216,16 @@ esp_err_t DataBase::enroll_feat(TensorBase *feat)
         ESP_LOGE(TAG, "Feature len to enroll does not match feature len in db.");
         return ESP_FAIL;
     }
-    float *feat_copy =
-        (float *)tool::malloc_aligned(m_meta.feat_len, sizeof(float), 16, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
-    memcpy(feat_copy, feat->data, feat->get_bytes());
-
-    m_feats.emplace_back(m_meta.num_feats_total + 1, feat_copy);
+    if (m_ids.size() == m_capacity) {
+        ESP_RETURN_ON_ERROR(reserve(std::max(16, m_capacity * 2)), TAG, "Failed to alloc memory for features.");
+    }
+    uint16_t id = m_meta.num_feats_total + 1;
+    m_exponents.push_back(
+        quantize_feat((float *)feat->data, m_meta.feat_len, get_row(m_ids.size()), m_feat_stride, m_quant_type));
+    m_ids.push_back(id);
+    if (m_index) {
+        m_index->add(id, get_row(m_ids.size() - 1), m_exponents.back());
+    }
     m_meta.num_feats_total++;
     m_meta.num_feats_valid++;
 
@@ -160,13 +246,13 @@ esp_err_t DataBase::enroll_feat(TensorBase *feat)
         fclose(f);
         return ESP_FAIL;
     }
-    size = fwrite(&m_feats.back().id, sizeof(uint16_t), 1, f);
+    size = fwrite(&id, sizeof(uint16_t), 1, f);
     if (size != 1) {
         ESP_LOGE(TAG, "Failed to write feature id.");
         fclose(f);
         return ESP_FAIL;
     }
-    size = fwrite(m_feats.back().feat, sizeof(float), m_meta.feat_len, f);
+    size = fwrite(feat->data, sizeof(float), m_meta.feat_len, f);
     if (size != m_meta.feat_len) {
         ESP_LOGE(TAG, "Failed to write feature.");
         fclose(f);
@@ -178,22 +264,24 @@ esp_err_t DataBase::enroll_feat(TensorBase *feat)
 
 esp_err_t DataBase::delete_feat(uint16_t id)
 {
-    bool invalid_id = true;
-    for (auto it = m_feats.begin(); it != m_feats.end();) {
-        if (it->id != id) {
-            it++;
-        } else {
-            heap_caps_free(it->feat);
-            it = m_feats.erase(it);
-            m_meta.num_feats_valid--;
-            invalid_id = false;
-            break;
-        }
-    }
-    if (invalid_id) {
+    auto it = std::find(m_ids.begin(), m_ids.end(), id);
+    if (id == 0 || it == m_ids.end()) {
         ESP_LOGW(TAG, "Invalid id to delete.");
         return ESP_FAIL;
     }
+    // keep the rows packed and in enroll order, query results are reported by row position.
+    int index = it - m_ids.begin();
+    if (m_index) {
+        m_index->remove(id, get_row(index), m_exponents[index]);
+    }
+    int num_rows_after = m_ids.size() - index - 1;
+    if (num_rows_after > 0) {
+        size_t row_bytes = m_feat_stride * (m_quant_type == QUANT_TYPE_SYMM_16BIT ? 2 : 1);
+        memmove(get_row(index), get_row(index + 1), row_bytes * num_rows_after);
+    }
+    m_ids.erase(it);
+    m_exponents.erase(m_exponents.begin() + index);
+    m_meta.num_feats_valid--;
     size_t size = 0;
     FILE *f = fopen(m_db_path, "rb+");
     if (!f) {
@@ -232,49 +320,158 @@ esp_err_t DataBase::delete_feat(uint16_t id)
 
 esp_err_t DataBase::delete_last_feat()
 {
-    if (m_feats.empty()) {
+    if (m_ids.empty()) {
         ESP_LOGW(TAG, "Empty db, nothing to delete");
         return ESP_FAIL;
     }
-    uint16_t id = m_feats.back().id;
+    uint16_t id = m_ids.back();
     return delete_feat(id);
 }
 
-float DataBase::cal_similarity(float *feat1, float *feat2)
+esp_err_t DataBase::reserve(int capacity)
+{
+    if (capacity <= m_capacity) {
+        return ESP_OK;
+    }
+    int elem_size = (m_quant_type == QUANT_TYPE_SYMM_16BIT) ? 2 : 1;
+    void *feats =
+        tool::malloc_aligned(capacity * m_feat_stride, elem_size, 16, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+    if (!feats) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (m_feats) {
+        memcpy(feats, m_feats, m_ids.size() * m_feat_stride * elem_size);
+        heap_caps_free(m_feats);
+    }
+    m_feats = feats;
+    m_capacity = capacity;
+    m_ids.reserve(capacity);
+    m_exponents.reserve(capacity);
+    return ESP_OK;
+}
+
+void *DataBase::get_row(int index)
+{
+    if (m_quant_type == QUANT_TYPE_SYMM_16BIT) {
+        return (int16_t *)m_feats + index * m_feat_stride;
+    }
+    return (int8_t *)m_feats + index * m_feat_stride;
+}
+
+esp_err_t DataBase::build_index(int nlist, int nprobe, int iterations)
 {
-    float sum = 0;
-    for (int i = 0; i < m_meta.feat_len; i++) {
-        sum += feat1[i] * feat2[i];
+    remove_index();
+    m_index = new IVFIndex(m_meta.feat_len, m_feat_stride, m_quant_type, nlist, nprobe);
+    esp_err_t ret = m_index->train(m_feats, m_exponents.data(), m_ids.data(), m_ids.size(), iterations);
+    if (ret != ESP_OK) {
+        remove_index();
     }
-    return sum;
+    return ret;
 }
 
-std::vector<result_t> DataBase::query_feat(TensorBase *feat, float thr, int top_k)
+void DataBase::set_index_nprobe(int nprobe)
+{
+    if (m_index) {
+        m_index->set_nprobe(nprobe);
+    }
+}
+
+void DataBase::remove_index()
+{
+    if (m_index) {
+        delete m_index;
+        m_index = nullptr;
+    }
+}
+
+std::vector<result_t> DataBase::query_feat(TensorBase *feat, float thr, int top_k, bool exact)
 {
     if (top_k < 1) {
         ESP_LOGW(TAG, "Top_k should be greater than 0.");
         return {};
     }
+    if (feat->dtype != DATA_TYPE_FLOAT || feat->size != m_meta.feat_len) {
+        ESP_LOGE(TAG, "Feature to query does not match the float features in db.");
+        return {};
+    }
+    int query_exponent = quantize_feat((float *)feat->data, m_meta.feat_len, m_query, m_feat_stride, m_quant_type);
+    // min-heap of the best top_k results, the worst one kept sits at the front.
+    auto greater = [](const result_t &a, const result_t &b) -> bool { return a.similarity > b.similarity; };
     std::vector<result_t> results;
-    float sim;
-    int i = 1;
-    for (auto it = m_feats.begin(); it != m_feats.end(); it++, i++) {
-        sim = cal_similarity(it->feat, (float *)feat->data);
+    results.reserve(top_k);
+    auto score = [&](int i) {
+        float sim = cal_similarity(get_row(i), m_exponents[i], m_query, query_exponent, m_feat_stride, m_quant_type);
         if (sim <= thr) {
-            continue;
+            return;
+        }
+        if (results.size() < top_k) {
+            results.push_back({(uint16_t)(i + 1), sim});
+            std::push_heap(results.begin(), results.end(), greater);
+        } else if (sim > results.front().similarity) {
+            std::pop_heap(results.begin(), results.end(), greater);
+            results.back() = {(uint16_t)(i + 1), sim};
+            std::push_heap(results.begin(), results.end(), greater);
+        }
+    };
+    if (m_index && !exact) {
+        // candidates and m_ids are both sorted by id.
+        m_index->probe(m_query, query_exponent, m_candidates);
+        auto it = m_ids.begin();
+        for (uint16_t id : m_candidates) {
+            it = std::lower_bound(it, m_ids.end(), id);
+            score(it - m_ids.begin());
+        }
+    } else {
+        for (int i = 0; i < m_ids.size(); i++) {
+            score(i);
         }
-        // results.emplace_back(it->id, sim);
-        results.emplace_back(i, sim);
-    }
-    std::sort(results.begin(), results.end(), [](const result_t &a, const result_t &b) -> bool {
-        return a.similarity > b.similarity;
-    });
-    if (results.size() > top_k) {
-        results.resize(top_k);
     }
+    std::sort_heap(results.begin(), results.end(), greater);
     return results;
 }
 
+float DataBase::eval_index(int top_k, int num_queries)
+{
+    if (!m_index || m_ids.empty() || top_k < 1 || num_queries < 1) {
+        ESP_LOGW(TAG, "Build the index and enroll features before evaluating it.");
+        return 0;
+    }
+    num_queries = std::min(num_queries, (int)m_ids.size());
+    TensorBase feat({m_meta.feat_len}, nullptr, 0, DATA_TYPE_FLOAT);
+    int hits = 0, total = 0;
+    int64_t exact_latency = 0, index_latency = 0;
+    for (int q = 0; q < num_queries; q++) {
+        // the enrolled features themselves serve as queries, spread over the gallery.
+        int row = (int64_t)q * m_ids.size() / num_queries;
+        dequantize_feat(get_row(row), m_exponents[row], m_meta.feat_len, m_quant_type, (float *)feat.data);
+        int64_t start = esp_timer_get_time();
+        std::vector<result_t> exact = query_feat(&feat, -1, top_k, true);
+        exact_latency += esp_timer_get_time() - start;
+        start = esp_timer_get_time();
+        std::vector<result_t> approx = query_feat(&feat, -1, top_k, false);
+        index_latency += esp_timer_get_time() - start;
+        for (const result_t &r : exact) {
+            for (const result_t &a : approx) {
+                if (a.id == r.id) {
+                    hits++;
+                    break;
+                }
+            }
+        }
+        total += exact.size();
+    }
+    float recall = total ? (float)hits / total : 0;
+    ESP_LOGI(TAG,
+             "nlist: %d, nprobe: %d, recall@%d: %.4f, exact: %lld us/query, index: %lld us/query",
+             m_index->get_nlist(),
+             m_index->get_nprobe(),
+             top_k,
+             recall,
+             exact_latency / num_queries,
+             index_latency / num_queries);
+    return recall;
+}
+
 void DataBase::print()
 {
     printf("\n");
@@ -283,10 +480,12 @@ void DataBase::print()
            m_meta.num_feats_valid,
            m_meta.feat_len);
     printf("[feats]\n");
-    for (auto it : m_feats) {
-        printf("id: %d feat: ", it.id);
-        for (int i = 0; i < m_meta.feat_len; i++) {
-            printf("%f, ", it.feat[i]);
+    std::vector<float> feat(m_meta.feat_len);
+    for (int i = 0; i < m_ids.size(); i++) {
+        dequantize_feat(get_row(i), m_exponents[i], m_meta.feat_len, m_quant_type, feat.data());
+        printf("id: %d feat: ", m_ids[i]);
+        for (int j = 0; j < m_meta.feat_len; j++) {
+            printf("%f, ", feat[j]);
         }
         printf("\n");
     }
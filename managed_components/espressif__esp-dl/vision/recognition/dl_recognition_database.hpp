@@ -1,35 +1,107 @@
 #pragma once
 #include "dl_recognition_define.hpp"
+#include "dl_recognition_ivf_index.hpp"
 #include "dl_tensor_base.hpp"
 #include "esp_check.h"
 #include "esp_system.h"
 #include <algorithm>
-#include <list>
+#include <vector>
 
 namespace dl {
 namespace recognition {
+/**
+ * @brief Quantize a float feature into a row with a power-of-two exponent, the padding tail of the row is zeroed.
+ *
+ * @param feat        float feature.
+ * @param feat_len    length of the float feature.
+ * @param row         output row, feat_stride elements of int8_t or int16_t.
+ * @param feat_stride length of the row, feat_len padded to 16 bytes.
+ * @param quant_type  QUANT_TYPE_SYMM_8BIT or QUANT_TYPE_SYMM_16BIT.
+ * @return exponent of the row.
+ */
+int quantize_feat(const float *feat, int feat_len, void *row, int feat_stride, quant_type_t quant_type);
+
+/**
+ * @brief Dequantize a row back to float.
+ */
+void dequantize_feat(const void *row, int exponent, int feat_len, quant_type_t quant_type, float *feat);
+
+/**
+ * @brief Cosine similarity of two quantized rows of l2 normalized features.
+ */
+float cal_similarity(
+    const void *row1, int exponent1, const void *row2, int exponent2, int feat_stride, quant_type_t quant_type);
+
 class DataBase {
 public:
-    DataBase(const char *db_path, db_type_t db_type, int feat_len);
+    /**
+     * @brief Construct a new feature database.
+     *
+     * @param db_path    path of the database file.
+     * @param db_type    storage type of the database file.
+     * @param feat_len   length of the float feature.
+     * @param quant_type in-memory precision of the features, QUANT_TYPE_SYMM_8BIT or QUANT_TYPE_SYMM_16BIT. The file
+     * in storage always keeps the float features.
+     */
+    DataBase(const char *db_path,
+             db_type_t db_type,
+             int feat_len,
+             quant_type_t quant_type = QUANT_TYPE_SYMM_8BIT);
     virtual ~DataBase();
     esp_err_t clear_all_feats();
     esp_err_t enroll_feat(TensorBase *feat);
     esp_err_t delete_feat(uint16_t id);
     esp_err_t delete_last_feat();
-    std::vector<result_t> query_feat(TensorBase *feat, float thr, int top_k);
+    /**
+     * @brief Query the features most similar to feat.
+     *
+     * @param feat  l2 normalized float feature.
+     * @param thr   only results with a similarity greater than thr are returned.
+     * @param top_k max number of results.
+     * @param exact set to true to score every feature even if an index is built.
+     * @return results sorted by similarity, id is the 1-based position among the valid features.
+     */
+    std::vector<result_t> query_feat(TensorBase *feat, float thr, int top_k, bool exact = false);
+    /**
+     * @brief Build an approximate nearest neighbour index over the enrolled features. Features enrolled or deleted
+     * later are added to or removed from the index, rebuild it once the gallery has changed a lot.
+     *
+     * @param nlist      number of clusters, about sqrt(num_feats) is a good start.
+     * @param nprobe     number of clusters scored per query, larger is slower and more accurate.
+     * @param iterations k-means iterations.
+     */
+    esp_err_t build_index(int nlist, int nprobe = 1, int iterations = 10);
+    void set_index_nprobe(int nprobe);
+    void remove_index();
+    /**
+     * @brief Log recall@top_k and latency of the index against the exact search, the enrolled features are used as
+     * queries.
+     *
+     * @return recall@top_k
+     */
+    float eval_index(int top_k, int num_queries);
     void print();
     int get_num_feats() { return m_meta.num_feats_valid; }
 
 private:
     char *m_db_path;
     db_type_t m_db_type;
-    std::list<database_feat> m_feats;
+    quant_type_t m_quant_type;
     database_meta m_meta;
+    int m_feat_stride;               /*<! feat_len padded to 16 bytes, in elements */
+    int m_capacity;                  /*<! number of rows m_feats can hold */
+    void *m_feats;                   /*<! quantized features, one row of m_feat_stride elements per feature */
+    void *m_query;                   /*<! scratch row for the quantized query feature */
+    std::vector<uint16_t> m_ids;     /*<! id of each row */
+    std::vector<int8_t> m_exponents; /*<! per-row exponent */
+    IVFIndex *m_index;
+    std::vector<uint16_t> m_candidates;
 
     esp_err_t create_empty_database_in_storage(int feat_len);
     esp_err_t load_database_from_storage(int feat_len);
     void clear_all_feats_in_memory();
-    float cal_similarity(float *feat1, float *feat2);
+    esp_err_t reserve(int capacity);
+    void *get_row(int index);
 };
 } // namespace recognition
 } // namespace dl
@@ -0,0 +1,172 @@
+#include "dl_recognition_ivf_index.hpp"
+#include "dl_math.hpp"
+#include "dl_recognition_database.hpp"
+#include <cfloat>
+
+static const char *TAG = "dl::recognition::IVFIndex";
+
+namespace dl {
+namespace recognition {
+IVFIndex::IVFIndex(int feat_len, int feat_stride, quant_type_t quant_type, int nlist, int nprobe) :
+    m_feat_len(feat_len), m_feat_stride(feat_stride), m_quant_type(quant_type), m_nlist(nlist), m_nprobe(1)
+{
+    assert(nlist > 0);
+    int elem_size = (m_quant_type == QUANT_TYPE_SYMM_16BIT) ? 2 : 1;
+    m_centroids = tool::calloc_aligned(m_nlist * m_feat_stride, elem_size, 16, MALLOC_CAP_8BIT | MALLOC_CAP_SPIRAM);
+    m_centroid_exponents.resize(m_nlist, 0);
+    m_lists.resize(m_nlist);
+    set_nprobe(nprobe);
+}
+
+IVFIndex::~IVFIndex()
+{
+    if (m_centroids) {
+        heap_caps_free(m_centroids);
+        m_centroids = nullptr;
+    }
+}
+
+void *IVFIndex::get_centroid(int index)
+{
+    if (m_quant_type == QUANT_TYPE_SYMM_16BIT) {
+        return (int16_t *)m_centroids + index * m_feat_stride;
+    }
+    return (int8_t *)m_centroids + index * m_feat_stride;
+}
+
+void IVFIndex::set_nprobe(int nprobe)
+{
+    m_nprobe = (DL_CLIP(nprobe, 1, m_nlist));
+}
+
+int IVFIndex::find_nearest_centroid(const void *row, int exponent)
+{
+    // -INFINITY is not reliable with -ffast-math.
+    int nearest = 0;
+    float max_sim = -FLT_MAX;
+    for (int i = 0; i < m_nlist; i++) {
+        float sim = cal_similarity(get_centroid(i), m_centroid_exponents[i], row, exponent, m_feat_stride, m_quant_type);
+        if (sim > max_sim) {
+            max_sim = sim;
+            nearest = i;
+        }
+    }
+    return nearest;
+}
+
+esp_err_t IVFIndex::train(const void *rows, const int8_t *exponents, const uint16_t *ids, int num_rows, int iterations)
+{
+    if (!m_centroids) {
+        ESP_LOGE(TAG, "Failed to alloc memory for centroids.");
+        return ESP_ERR_NO_MEM;
+    }
+    if (num_rows < m_nlist) {
+        ESP_LOGE(TAG, "At least %d features are needed to train %d lists.", m_nlist, m_nlist);
+        return ESP_FAIL;
+    }
+    int elem_size = (m_quant_type == QUANT_TYPE_SYMM_16BIT) ? 2 : 1;
+    auto get_row = [&](int index) -> const void * {
+        return (const uint8_t *)rows + index * m_feat_stride * elem_size;
+    };
+
+    // init with evenly spaced rows, training is deterministic.
+    for (int i = 0; i < m_nlist; i++) {
+        int index = (int64_t)i * num_rows / m_nlist;
+        memcpy(get_centroid(i), get_row(index), m_feat_stride * elem_size);
+        m_centroid_exponents[i] = exponents[index];
+    }
+
+    std::vector<int> assignments(num_rows, -1);
+    std::vector<float> sums(m_nlist * m_feat_len);
+    std::vector<int> counts(m_nlist);
+    std::vector<float> feat(m_feat_len);
+    for (int iter = 0; iter < iterations; iter++) {
+        int changed = 0;
+        std::fill(sums.begin(), sums.end(), 0.f);
+        std::fill(counts.begin(), counts.end(), 0);
+        for (int i = 0; i < num_rows; i++) {
+            int nearest = find_nearest_centroid(get_row(i), exponents[i]);
+            if (nearest != assignments[i]) {
+                assignments[i] = nearest;
+                changed++;
+            }
+            dequantize_feat(get_row(i), exponents[i], m_feat_len, m_quant_type, feat.data());
+            float *sum = sums.data() + nearest * m_feat_len;
+            for (int j = 0; j < m_feat_len; j++) {
+                sum[j] += feat[j];
+            }
+            counts[nearest]++;
+        }
+        if (changed == 0) {
+            break;
+        }
+        // spherical k-means, the centroid is the l2 normalized mean. Empty lists keep their centroid.
+        for (int i = 0; i < m_nlist; i++) {
+            if (counts[i] == 0) {
+                continue;
+            }
+            float *sum = sums.data() + i * m_feat_len;
+            float norm = 0;
+            for (int j = 0; j < m_feat_len; j++) {
+                norm += sum[j] * sum[j];
+            }
+            norm = dl::math::sqrt_newton(norm);
+            if (norm == 0) {
+                continue;
+            }
+            for (int j = 0; j < m_feat_len; j++) {
+                sum[j] /= norm;
+            }
+            m_centroid_exponents[i] = quantize_feat(sum, m_feat_len, get_centroid(i), m_feat_stride, m_quant_type);
+        }
+    }
+
+    for (int i = 0; i < m_nlist; i++) {
+        m_lists[i].clear();
+    }
+    for (int i = 0; i < num_rows; i++) {
+        add(ids[i], get_row(i), exponents[i]);
+    }
+    return ESP_OK;
+}
+
+void IVFIndex::add(uint16_t id, const void *row, int exponent)
+{
+    std::vector<uint16_t> &list = m_lists[find_nearest_centroid(row, exponent)];
+    // keep ids sorted, the caller maps them back to rows by enroll order.
+    list.insert(std::upper_bound(list.begin(), list.end(), id), id);
+}
+
+void IVFIndex::remove(uint16_t id, const void *row, int exponent)
+{
+    // The row is in the list of its closest centroid unless a tie is broken otherwise, then look through them all.
+    int nearest = find_nearest_centroid(row, exponent);
+    for (int i = 0; i < m_nlist; i++) {
+        std::vector<uint16_t> &list = m_lists[(nearest + i) % m_nlist];
+        auto it = std::lower_bound(list.begin(), list.end(), id);
+        if (it != list.end() && *it == id) {
+            list.erase(it);
+            return;
+        }
+    }
+}
+
+void IVFIndex::probe(const void *query, int query_exponent, std::vector<uint16_t> &candidates)
+{
+    std::vector<std::pair<float, int>> sims(m_nlist);
+    for (int i = 0; i < m_nlist; i++) {
+        sims[i] = {cal_similarity(
+                       get_centroid(i), m_centroid_exponents[i], query, query_exponent, m_feat_stride, m_quant_type),
+                   i};
+    }
+    std::partial_sort(sims.begin(), sims.begin() + m_nprobe, sims.end(), std::greater<std::pair<float, int>>());
+    candidates.clear();
+    for (int i = 0; i < m_nprobe; i++) {
+        const std::vector<uint16_t> &list = m_lists[sims[i].second];
+        candidates.insert(candidates.end(), list.begin(), list.end());
+    }
+    std::sort(candidates.begin(), candidates.end());
+}
+
+} // namespace recognition
+} // namespace dl
@@ -0,0 +1,66 @@
+#pragma once
+#include "dl_define.hpp"
+#include "esp_err.h"
+#include <vector>
+
+namespace dl {
+namespace recognition {
+/**
+ * @brief Inverted file index over quantized feature rows.
+ *
+ * The features are clustered by spherical k-means into nlist centroids, each centroid owns the ids of the features
+ * closest to it. A query only scores the features of the nprobe centroids closest to it, so nprobe trades recall for
+ * latency: nprobe == nlist is exact.
+ *
+ * Rows, centroids and queries use the row format of quantize_feat().
+ */
+class IVFIndex {
+public:
+    IVFIndex(int feat_len, int feat_stride, quant_type_t quant_type, int nlist, int nprobe);
+    ~IVFIndex();
+
+    /**
+     * @brief Cluster the rows into centroids and fill the inverted lists.
+     *
+     * @param rows       num_rows contiguous rows.
+     * @param exponents  exponent of each row.
+     * @param ids        id of each row.
+     * @param num_rows   number of rows, should not be less than nlist.
+     * @param iterations k-means iterations.
+     */
+    esp_err_t train(const void *rows, const int8_t *exponents, const uint16_t *ids, int num_rows, int iterations);
+
+    /**
+     * @brief Put a new row into the list of its closest centroid. The centroids are not updated.
+     */
+    void add(uint16_t id, const void *row, int exponent);
+
+    /**
+     * @brief Remove a row. It has to be the same row passed to add() or train().
+     */
+    void remove(uint16_t id, const void *row, int exponent);
+
+    /**
+     * @brief Collect the ids in the nprobe lists closest to the query.
+     */
+    void probe(const void *query, int query_exponent, std::vector<uint16_t> &candidates);
+
+    void set_nprobe(int nprobe);
+    int get_nprobe() { return m_nprobe; }
+    int get_nlist() { return m_nlist; }
+
+private:
+    int m_feat_len;
+    int m_feat_stride;
+    quant_type_t m_quant_type;
+    int m_nlist;
+    int m_nprobe;
+    void *m_centroids;                          /*<! nlist quantized rows */
+    std::vector<int8_t> m_centroid_exponents;   /*<! exponent of each centroid */
+    std::vector<std::vector<uint16_t>> m_lists; /*<! ids owned by each centroid */
+
+    void *get_centroid(int index);
+    int find_nearest_centroid(const void *row, int exponent);
+};
+} // namespace recognition
+} // namespace dl
@@ -0,0 +1,509 @@
+#include "dl_recognition_partition_database.hpp"
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#include "spi_flash_mmap.h"
+#endif
+
+static const char *TAG = "dl::recognition::PartitionDataBase";
+
+namespace dl {
+namespace recognition {
+typedef struct {
+    char magic[4];
+    uint32_t generation;
+    uint16_t feat_len;
+    uint16_t feat_stride;
+    uint8_t quant_type;
+    uint8_t reserved[3];
+    uint32_t record_size;
+    uint32_t record_offset;
+    uint32_t capacity;
+    uint32_t next_id;
+    uint8_t padding[32];
+} fdb_header_t;
+
+typedef struct {
+    uint16_t id;
+    uint8_t state;
+    int8_t exponent;
+    uint8_t reserved[12];
+} fdb_record_header_t;
+
+static_assert(sizeof(fdb_header_t) == 64, "fdb_header_t must be 64 bytes");
+static_assert(sizeof(fdb_record_header_t) == 16, "fdb_record_header_t must keep the row 16-byte aligned");
+
+// record states only ever clear bits of erased flash.
+static const uint8_t FDB_RECORD_EMPTY = 0xff;
+static const uint8_t FDB_RECORD_WRITING = 0x7f;
+static const uint8_t FDB_RECORD_VALID = 0x3f;
+static const uint32_t FDB_MAX_ID = 0xfffe;
+static const int FDB_MIN_DELETED_TO_COMPACT = 16;
+
+PartitionDataBase::PartitionDataBase(const char *partition_label,
+                                     int feat_len,
+                                     quant_type_t quant_type,
+                                     bool background_compaction) :
+    m_partition(nullptr),
+    m_mmap_handle(0),
+    m_base(nullptr),
+    m_mutex(xSemaphoreCreateMutex()),
+    m_compact_mutex(xSemaphoreCreateMutex()),
+    m_compact_task(nullptr),
+    m_background_compaction(background_compaction),
+    m_quant_type(quant_type),
+    m_feat_len(feat_len),
+    m_bank(0),
+    m_generation(0),
+    m_next_id(1),
+    m_num_used(0),
+    m_num_deleted(0)
+{
+    assert(partition_label);
+    assert(quant_type == QUANT_TYPE_SYMM_8BIT || quant_type == QUANT_TYPE_SYMM_16BIT);
+    int elem_size = (m_quant_type == QUANT_TYPE_SYMM_16BIT) ? 2 : 1;
+    m_feat_stride = (feat_len * elem_size + 15) / 16 * 16 / elem_size;
+    m_query = tool::calloc_aligned(m_feat_stride, elem_size, 16, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+
+    m_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition_label);
+    if (!m_partition) {
+        ESP_LOGE(TAG, "Can not find %s in partition table", partition_label);
+        return;
+    }
+    if (m_partition->encrypted) {
+        ESP_LOGE(TAG, "Partition %s is encrypted, records can not be updated in place.", partition_label);
+        return;
+    }
+
+    // the same layout is used by both banks.
+    m_bank_size = m_partition->size / 2 / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+    m_record_size = sizeof(fdb_record_header_t) + m_feat_stride * elem_size;
+    m_capacity = (m_bank_size - sizeof(fdb_header_t)) * 8 / (m_record_size * 8 + 1);
+    m_record_offset = (sizeof(fdb_header_t) + (m_capacity + 7) / 8 + 15) / 16 * 16;
+    while (m_capacity > 0 && m_record_offset + m_capacity * m_record_size > m_bank_size) {
+        m_capacity--;
+        m_record_offset = (sizeof(fdb_header_t) + (m_capacity + 7) / 8 + 15) / 16 * 16;
+    }
+    if (m_capacity == 0) {
+        ESP_LOGE(TAG, "Partition %s is too small.", partition_label);
+        return;
+    }
+
+    if (esp_partition_mmap(m_partition,
+                           0,
+                           m_partition->size,
+                           ESP_PARTITION_MMAP_DATA,
+                           (const void **)&m_base,
+                           &m_mmap_handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to mmap partition %s.", partition_label);
+        m_base = nullptr;
+        return;
+    }
+
+    // pick the committed bank with the higher generation.
+    const fdb_header_t *header0 = (const fdb_header_t *)m_base;
+    const fdb_header_t *header1 = (const fdb_header_t *)(m_base + m_bank_size);
+    bool valid0 = memcmp(header0->magic, "FDB1", 4) == 0;
+    bool valid1 = memcmp(header1->magic, "FDB1", 4) == 0;
+    esp_err_t ret;
+    if (valid0 && valid1) {
+        ret = open_bank((int32_t)(header1->generation - header0->generation) > 0 ? 1 : 0);
+    } else if (valid0 || valid1) {
+        ret = open_bank(valid0 ? 0 : 1);
+    } else {
+        ret = esp_partition_erase_range(m_partition, 0, m_bank_size);
+        if (ret == ESP_OK) {
+            ret = write_header(0, 1, 1);
+        }
+        if (ret == ESP_OK) {
+            ret = open_bank(0);
+        }
+    }
+    if (ret != ESP_OK) {
+        esp_partition_munmap(m_mmap_handle);
+        m_base = nullptr;
+    }
+}
+
+PartitionDataBase::~PartitionDataBase()
+{
+    while (m_compact_task) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (m_base) {
+        esp_partition_munmap(m_mmap_handle);
+        m_base = nullptr;
+    }
+    if (m_query) {
+        heap_caps_free(m_query);
+        m_query = nullptr;
+    }
+    vSemaphoreDelete(m_compact_mutex);
+    vSemaphoreDelete(m_mutex);
+}
+
+esp_err_t PartitionDataBase::write_header(int bank, uint32_t generation, uint32_t next_id)
+{
+    fdb_header_t header;
+    memset(&header, 0, sizeof(fdb_header_t));
+    memcpy(header.magic, "FDB1", 4);
+    header.generation = generation;
+    header.feat_len = m_feat_len;
+    header.feat_stride = m_feat_stride;
+    header.quant_type = m_quant_type;
+    header.record_size = m_record_size;
+    header.record_offset = m_record_offset;
+    header.capacity = m_capacity;
+    header.next_id = next_id;
+
+    size_t offset = bank * m_bank_size;
+    ESP_RETURN_ON_ERROR(esp_partition_write(m_partition, offset + 4, (uint8_t *)&header + 4, sizeof(header) - 4),
+                        TAG,
+                        "Failed to write db header.");
+    ESP_RETURN_ON_ERROR(esp_partition_write(m_partition, offset, header.magic, 4), TAG, "Failed to commit db header.");
+    return ESP_OK;
+}
+
+esp_err_t PartitionDataBase::open_bank(int bank)
+{
+    const fdb_header_t *header = (const fdb_header_t *)(m_base + bank * m_bank_size);
+    if (header->feat_len != m_feat_len || header->quant_type != m_quant_type) {
+        ESP_LOGE(TAG, "Feature len or quant type in partition does not match the db.");
+        return ESP_FAIL;
+    }
+    if (header->record_size != m_record_size || header->record_offset != m_record_offset ||
+        header->capacity != m_capacity) {
+        ESP_LOGE(TAG, "Record layout in partition does not match the partition size.");
+        return ESP_FAIL;
+    }
+    m_bank = bank;
+    m_generation = header->generation;
+    m_next_id = header->next_id;
+    m_num_used = find_num_used();
+    m_num_deleted = 0;
+    const uint8_t *tombstone = m_base + m_bank * m_bank_size + sizeof(fdb_header_t);
+    for (int i = 0; i < (m_num_used + 7) / 8; i++) {
+        m_num_deleted += 8 - __builtin_popcount(tombstone[i]);
+    }
+    if (m_num_used > 0) {
+        const fdb_record_header_t *last = (const fdb_record_header_t *)get_record(m_num_used - 1);
+        m_next_id = std::max(m_next_id, (uint32_t)last->id + 1);
+        // only the last append can be interrupted by a power loss.
+        if (last->state != FDB_RECORD_VALID && !is_deleted(m_num_used - 1)) {
+            ESP_RETURN_ON_ERROR(mark_deleted(m_num_used - 1), TAG, "Failed to drop the incomplete record.");
+            m_num_deleted++;
+        }
+    }
+    return ESP_OK;
+}
+
+int PartitionDataBase::find_num_used()
+{
+    // records are appended, so the used slots are always a prefix.
+    int low = 0, high = m_capacity;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (((const fdb_record_header_t *)get_record(mid))->state == FDB_RECORD_EMPTY) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+int PartitionDataBase::find_record(uint16_t id)
+{
+    // ids increase with the slot index, compaction keeps the order.
+    int low = 0, high = m_num_used - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        uint16_t mid_id = ((const fdb_record_header_t *)get_record(mid))->id;
+        if (mid_id == id) {
+            return mid;
+        } else if (mid_id < id) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return -1;
+}
+
+bool PartitionDataBase::is_deleted(int index)
+{
+    const uint8_t *tombstone = m_base + m_bank * m_bank_size + sizeof(fdb_header_t);
+    return !(tombstone[index / 8] & (1 << (index % 8)));
+}
+
+esp_err_t PartitionDataBase::mark_deleted(int index)
+{
+    // keep the tombstones already cleared in this byte, the write must not rely on the flash ANDing the bits.
+    size_t offset = m_bank * m_bank_size + sizeof(fdb_header_t) + index / 8;
+    uint8_t value = m_base[offset] & ~(1 << (index % 8));
+    return esp_partition_write(m_partition, offset, &value, 1);
+}
+
+esp_err_t PartitionDataBase::clear_all_feats()
+{
+    ESP_RETURN_ON_FALSE(m_base, ESP_ERR_INVALID_STATE, TAG, "Database is not opened.");
+    xSemaphoreTake(m_compact_mutex, portMAX_DELAY);
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    int old_bank = m_bank;
+    int new_bank = 1 - m_bank;
+    esp_err_t ret = esp_partition_erase_range(m_partition, new_bank * m_bank_size, m_bank_size);
+    if (ret == ESP_OK) {
+        ret = write_header(new_bank, m_generation + 1, m_next_id);
+    }
+    if (ret == ESP_OK) {
+        ret = open_bank(new_bank);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_partition_erase_range(m_partition, old_bank * m_bank_size, SPI_FLASH_SEC_SIZE);
+    }
+    xSemaphoreGive(m_mutex);
+    xSemaphoreGive(m_compact_mutex);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to clear db.");
+    }
+    return ret;
+}
+
+esp_err_t PartitionDataBase::enroll_feat(TensorBase *feat)
+{
+    ESP_RETURN_ON_FALSE(m_base, ESP_ERR_INVALID_STATE, TAG, "Database is not opened.");
+    if (feat->dtype != DATA_TYPE_FLOAT) {
+        ESP_LOGE(TAG, "Only support float feature.");
+        return ESP_FAIL;
+    }
+    if (feat->size != m_feat_len) {
+        ESP_LOGE(TAG, "Feature len to enroll does not match feature len in db.");
+        return ESP_FAIL;
+    }
+    if (m_num_used == m_capacity && m_num_deleted > 0) {
+        ESP_RETURN_ON_ERROR(compact(), TAG, "Failed to compact db.");
+    }
+
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    if (m_num_used == m_capacity || m_next_id > FDB_MAX_ID) {
+        xSemaphoreGive(m_mutex);
+        ESP_LOGE(TAG, "Database is full.");
+        return ESP_ERR_NO_MEM;
+    }
+    fdb_record_header_t record;
+    memset(&record, 0, sizeof(fdb_record_header_t));
+    record.id = m_next_id;
+    record.state = FDB_RECORD_WRITING;
+    record.exponent = quantize_feat((float *)feat->data, m_feat_len, m_query, m_feat_stride, m_quant_type);
+
+    size_t offset = m_bank * m_bank_size + m_record_offset + m_num_used * m_record_size;
+    uint8_t state = FDB_RECORD_VALID;
+    esp_err_t ret = esp_partition_write(m_partition, offset, &record, sizeof(fdb_record_header_t));
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(
+            m_partition, offset + sizeof(fdb_record_header_t), m_query, m_record_size - sizeof(fdb_record_header_t));
+    }
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(m_partition, offset + offsetof(fdb_record_header_t, state), &state, 1);
+    }
+    // the slot is taken even if writing failed, open_bank() drops it on next boot.
+    m_num_used++;
+    m_next_id++;
+    if (ret != ESP_OK) {
+        mark_deleted(m_num_used - 1);
+        m_num_deleted++;
+        ESP_LOGE(TAG, "Failed to write feature.");
+    }
+    xSemaphoreGive(m_mutex);
+    return ret;
+}
+
+esp_err_t PartitionDataBase::delete_feat(uint16_t id)
+{
+    ESP_RETURN_ON_FALSE(m_base, ESP_ERR_INVALID_STATE, TAG, "Database is not opened.");
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    int index = find_record(id);
+    if (index < 0 || is_deleted(index)) {
+        xSemaphoreGive(m_mutex);
+        ESP_LOGW(TAG, "Invalid id to delete.");
+        return ESP_FAIL;
+    }
+    esp_err_t ret = mark_deleted(index);
+    if (ret == ESP_OK) {
+        m_num_deleted++;
+        if (m_background_compaction && m_num_deleted >= FDB_MIN_DELETED_TO_COMPACT &&
+            m_num_deleted * 2 >= m_num_used) {
+            request_compaction();
+        }
+    } else {
+        ESP_LOGE(TAG, "Failed to write tombstone.");
+    }
+    xSemaphoreGive(m_mutex);
+    return ret;
+}
+
+esp_err_t PartitionDataBase::delete_last_feat()
+{
+    ESP_RETURN_ON_FALSE(m_base, ESP_ERR_INVALID_STATE, TAG, "Database is not opened.");
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    int index = m_num_used - 1;
+    while (index >= 0 && is_deleted(index)) {
+        index--;
+    }
+    uint16_t id = index >= 0 ? ((const fdb_record_header_t *)get_record(index))->id : 0;
+    xSemaphoreGive(m_mutex);
+    if (index < 0) {
+        ESP_LOGW(TAG, "Empty db, nothing to delete");
+        return ESP_FAIL;
+    }
+    return delete_feat(id);
+}
+
+esp_err_t PartitionDataBase::compact()
+{
+    ESP_RETURN_ON_FALSE(m_base, ESP_ERR_INVALID_STATE, TAG, "Database is not opened.");
+    xSemaphoreTake(m_compact_mutex, portMAX_DELAY);
+    // only compaction and clear_all_feats() touch the inactive bank, erase it before blocking the queries.
+    int new_bank = 1 - m_bank;
+    esp_err_t ret = esp_partition_erase_range(m_partition, new_bank * m_bank_size, m_bank_size);
+    if (ret != ESP_OK) {
+        xSemaphoreGive(m_compact_mutex);
+        ESP_LOGE(TAG, "Failed to erase the inactive bank.");
+        return ret;
+    }
+
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    int old_bank = m_bank;
+    uint8_t *record = (uint8_t *)heap_caps_malloc(m_record_size, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+    if (!record) {
+        ret = ESP_ERR_NO_MEM;
+    }
+    size_t offset = new_bank * m_bank_size + m_record_offset;
+    for (int i = 0; i < m_num_used && ret == ESP_OK; i++) {
+        const uint8_t *src = get_record(i);
+        if (is_deleted(i) || ((const fdb_record_header_t *)src)->state != FDB_RECORD_VALID) {
+            continue;
+        }
+        // flash can not be written from a buffer mapped from flash.
+        memcpy(record, src, m_record_size);
+        ret = esp_partition_write(m_partition, offset, record, m_record_size);
+        offset += m_record_size;
+    }
+    if (ret == ESP_OK) {
+        ret = write_header(new_bank, m_generation + 1, m_next_id);
+    }
+    if (ret == ESP_OK) {
+        ret = open_bank(new_bank);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_partition_erase_range(m_partition, old_bank * m_bank_size, SPI_FLASH_SEC_SIZE);
+    }
+    if (record) {
+        heap_caps_free(record);
+    }
+    xSemaphoreGive(m_mutex);
+    xSemaphoreGive(m_compact_mutex);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to compact db.");
+    }
+    return ret;
+}
+
+void PartitionDataBase::compact_task(void *args)
+{
+    PartitionDataBase *self = (PartitionDataBase *)args;
+    self->compact();
+    self->m_compact_task = nullptr;
+    vTaskDelete(NULL);
+}
+
+void PartitionDataBase::request_compaction()
+{
+    // called with m_mutex held, the task can not finish before m_compact_task is set.
+    if (m_compact_task) {
+        return;
+    }
+    if (xTaskCreate(compact_task, "fdb_compact", 4096, this, tskIDLE_PRIORITY + 1, &m_compact_task) != pdPASS) {
+        m_compact_task = nullptr;
+        ESP_LOGW(TAG, "Failed to start compaction task.");
+    }
+}
+
+std::vector<result_t> PartitionDataBase::query_feat(TensorBase *feat, float thr, int top_k)
+{
+    if (top_k < 1) {
+        ESP_LOGW(TAG, "Top_k should be greater than 0.");
+        return {};
+    }
+    if (!m_base || feat->dtype != DATA_TYPE_FLOAT || feat->size != m_feat_len) {
+        ESP_LOGE(TAG, "Feature to query does not match the float features in db.");
+        return {};
+    }
+    // min-heap of the best top_k results, the worst one kept sits at the front.
+    auto greater = [](const result_t &a, const result_t &b) -> bool { return a.similarity > b.similarity; };
+    std::vector<result_t> results;
+    results.reserve(top_k);
+
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    int query_exponent = quantize_feat((float *)feat->data, m_feat_len, m_query, m_feat_stride, m_quant_type);
+    float sim;
+    int position = 0;
+    for (int i = 0; i < m_num_used; i++) {
+        const fdb_record_header_t *record = (const fdb_record_header_t *)get_record(i);
+        if (is_deleted(i) || record->state != FDB_RECORD_VALID) {
+            continue;
+        }
+        position++;
+        sim = cal_similarity(record + 1, record->exponent, m_query, query_exponent, m_feat_stride, m_quant_type);
+        if (sim <= thr) {
+            continue;
+        }
+        if (results.size() < top_k) {
+            results.push_back({(uint16_t)position, sim});
+            std::push_heap(results.begin(), results.end(), greater);
+        } else if (sim > results.front().similarity) {
+            std::pop_heap(results.begin(), results.end(), greater);
+            results.back() = {(uint16_t)position, sim};
+            std::push_heap(results.begin(), results.end(), greater);
+        }
+    }
+    xSemaphoreGive(m_mutex);
+    std::sort_heap(results.begin(), results.end(), greater);
+    return results;
+}
+
+void PartitionDataBase::print()
+{
+    if (!m_base) {
+        ESP_LOGE(TAG, "Database is not opened.");
+        return;
+    }
+    xSemaphoreTake(m_mutex, portMAX_DELAY);
+    printf("\n");
+    printf("[db meta]\nbank: %d, generation: %lu, num_feats_used: %d, num_feats_valid: %d, capacity: %lu, feat_len: "
+           "%d\n",
+           m_bank,
+           m_generation,
+           m_num_used,
+           m_num_used - m_num_deleted,
+           m_capacity,
+           m_feat_len);
+    printf("[feats]\n");
+    std::vector<float> feat(m_feat_len);
+    for (int i = 0; i < m_num_used; i++) {
+        const fdb_record_header_t *record = (const fdb_record_header_t *)get_record(i);
+        if (is_deleted(i) || record->state != FDB_RECORD_VALID) {
+            continue;
+        }
+        dequantize_feat(record + 1, record->exponent, m_feat_len, m_quant_type, feat.data());
+        printf("id: %d feat: ", record->id);
+        for (int j = 0; j < m_feat_len; j++) {
+            printf("%f, ", feat[j]);
+        }
+        printf("\n");
+    }
+    printf("\n");
+    xSemaphoreGive(m_mutex);
+}
+
+} // namespace recognition
+} // namespace dl
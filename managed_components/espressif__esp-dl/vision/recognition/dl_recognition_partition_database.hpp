@@ -0,0 +1,96 @@
+#pragma once
+#include "dl_recognition_database.hpp"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+namespace dl {
+namespace recognition {
+/**
+ * @brief Feature database kept in a raw data partition and memory-mapped, so that neither boot nor enrollment reads
+ * the gallery into RAM. Queries run the dot product directly on the mapped rows.
+ *
+ * The partition is split into two banks. Only one bank is active, its header carries the higher generation.
+ *
+ * FDB1 bank:
+ * {
+ *     header:    char[4] "FDB1", uint32 generation, uint16 feat_len, uint16 feat_stride, uint8 quant_type,
+ *                uint8[3] reserved, uint32 record_size, uint32 record_offset, uint32 capacity, uint32 next_id,
+ *                zero padding to 64 bytes. The magic is written last, it commits the bank.
+ *     tombstone: uint8[], one bit per record, a cleared bit marks a deleted record.
+ *     records:   16-byte aligned slots of record_size bytes, appended in id order.
+ *                {uint16 id, uint8 state, int8 exponent, uint8[12] reserved, int8/int16 row[feat_stride]}
+ * }
+ *
+ * Every update only clears bits of erased flash: a record is appended, a delete clears its tombstone bit. Compaction
+ * copies the live records into the erased inactive bank, commits it with generation + 1 and erases the old header.
+ * The partition must not be encrypted.
+ */
+class PartitionDataBase {
+public:
+    /**
+     * @brief Construct a new PartitionDataBase. A partition without a valid bank is formatted.
+     *
+     * @param partition_label       label of a data partition, its size should be a multiple of 8 KB.
+     * @param feat_len              length of the float feature.
+     * @param quant_type            precision of the stored features, QUANT_TYPE_SYMM_8BIT or QUANT_TYPE_SYMM_16BIT.
+     * @param background_compaction compact in a low priority task once half of the records are deleted.
+     */
+    PartitionDataBase(const char *partition_label,
+                      int feat_len,
+                      quant_type_t quant_type = QUANT_TYPE_SYMM_8BIT,
+                      bool background_compaction = true);
+    virtual ~PartitionDataBase();
+    esp_err_t clear_all_feats();
+    esp_err_t enroll_feat(TensorBase *feat);
+    esp_err_t delete_feat(uint16_t id);
+    esp_err_t delete_last_feat();
+    /**
+     * @brief Drop the deleted records by rewriting the live ones into the other bank.
+     */
+    esp_err_t compact();
+    /**
+     * @brief Same as DataBase::query_feat(), result id is the 1-based position among the valid features.
+     */
+    std::vector<result_t> query_feat(TensorBase *feat, float thr, int top_k);
+    void print();
+    int get_num_feats() { return m_num_used - m_num_deleted; }
+
+private:
+    const esp_partition_t *m_partition;
+    esp_partition_mmap_handle_t m_mmap_handle;
+    const uint8_t *m_base;
+    SemaphoreHandle_t m_mutex;         /*<! guards the active bank */
+    SemaphoreHandle_t m_compact_mutex; /*<! guards the inactive bank */
+    TaskHandle_t m_compact_task;
+    bool m_background_compaction;
+    quant_type_t m_quant_type;
+    int m_feat_len;
+    int m_feat_stride;
+    int m_bank_size;
+    int m_bank; /*<! index of the active bank */
+    uint32_t m_generation;
+    uint32_t m_record_size;
+    uint32_t m_record_offset;
+    uint32_t m_capacity;
+    uint32_t m_next_id;
+    int m_num_used; /*<! appended records, including the deleted ones */
+    int m_num_deleted;
+    void *m_query;
+
+    esp_err_t write_header(int bank, uint32_t generation, uint32_t next_id);
+    esp_err_t open_bank(int bank);
+    int find_num_used();
+    int find_record(uint16_t id);
+    bool is_deleted(int index);
+    esp_err_t mark_deleted(int index);
+    void request_compaction();
+    static void compact_task(void *args);
+    const uint8_t *get_record(int index)
+    {
+        return m_base + m_bank * m_bank_size + m_record_offset + index * m_record_size;
+    }
+};
+} // namespace recognition
+} // namespace dl
@@ -32,6 +32,17 @@ typedef enum {
     JPEG_IMAGE_FORMAT_RGB565,       /*!< Format RGB565 */
 } esp_jpeg_image_format_t;
 
+/**
+ * @brief Input callback of the streaming mode
+ *
+ * @param ctx: read_ctx of the configuration
+ * @param buf: Destination of the data, NULL to skip len bytes
+ * @param len: Number of bytes to read or skip
+ *
+ * @return Number of bytes read or skipped, less than len at the end of the data or on error
+ */
+typedef size_t (*esp_jpeg_read_cb_t)(void *ctx, uint8_t *buf, size_t len);
+
 /**
  * @brief JPEG Configuration Type
  *
@@ -46,6 +57,8 @@ typedef struct esp_jpeg_image_cfg_s {
 
     struct {
         uint8_t swap_color_bytes: 1; /*!< Swap first and last color bytes */
+        uint8_t multi_core: 1;       /*!< Decode the lower half of the image on the other core. Used only when the image
+                                          has restart intervals, indata holds the whole image and Tjpgd is not in ROM */
     } flags;
 
     struct {
@@ -56,7 +69,25 @@ typedef struct esp_jpeg_image_cfg_s {
     } advanced;
 
     struct {
-        uint32_t read;  /*!< Internal count of read bytes */
+        uint16_t left;      /*!< Left end of the region, in pixels of the scaled output image */
+        uint16_t top;       /*!< Top end of the region, in pixels of the scaled output image */
+        uint16_t width;     /*!< Width of the region, 0 to decode the whole image */
+        uint16_t height;    /*!< Height of the region, 0 to decode the whole image */
+    } roi;                  /*!< Region of interest written to outbuf. Decoding stops below the region and, unless Tjpgd
+                                 is in ROM, the MCUs out of the region are not transformed and the restart intervals
+                                 out of the region are skipped without entropy decoding */
+    uint32_t out_stride;    /*!< Bytes from a row to the next one in outbuf, 0 for the region width times the color bytes */
+
+    esp_jpeg_read_cb_t read_cb; /*!< If set, the JPEG image is read in chunks by this callback instead of from indata */
+    void *read_ctx;             /*!< Context passed to read_cb, e.g. a FILE * or a socket */
+
+    struct {
+        uint32_t read;          /*!< Internal count of read bytes */
+        uint16_t roi_left;      /*!< Internal region of interest, clipped to the output image */
+        uint16_t roi_top;
+        uint16_t roi_right;
+        uint16_t roi_bottom;
+        uint32_t out_stride;    /*!< Internal bytes from a row to the next one in outbuf */
     } priv;
 } esp_jpeg_image_cfg_t;
 
@@ -64,23 +95,27 @@ typedef struct esp_jpeg_image_cfg_s {
  * @brief JPEG output info
  */
 typedef struct esp_jpeg_image_output_s {
-    uint16_t width;    /*!< Width of the output image */
-    uint16_t height;   /*!< Height of the output image */
+    uint16_t width;    /*!< Width of the output image, or of the region of interest */
+    uint16_t height;   /*!< Height of the output image, or of the region of interest */
     size_t output_len; /*!< Length of the output image in bytes */
 } esp_jpeg_image_output_t;
 
 /**
  * @brief Decode JPEG image
  *
- * @note This function is blocking.
+ * @note This function is blocking. With flags.multi_core, the lower half of the image is decoded by a task on the
+ *       other core with the priority of the caller, in a working buffer of its own. The task and its buffer are
+ *       created by the first such decoding and kept for the next ones. When another decoding already uses the
+ *       task, the image is decoded on the calling core.
  *
  * @param[in]  cfg: Configuration structure
  * @param[out] img: Output image info
  *
  * @return
- *      - ESP_OK            on success
- *      - ESP_ERR_NO_MEM    if there is no memory for allocating main structure
- *      - ESP_FAIL          if there is an error in decoding JPEG
+ *      - ESP_OK              on success
+ *      - ESP_ERR_NO_MEM      if there is no memory for allocating main structure
+ *      - ESP_ERR_INVALID_ARG if the region of interest is out of the output image
+ *      - ESP_FAIL            if there is an error in decoding JPEG
  */
 esp_err_t esp_jpeg_decode(esp_jpeg_image_cfg_t *cfg, esp_jpeg_image_output_t *img);
 
@@ -90,7 +125,8 @@ esp_err_t esp_jpeg_decode(esp_jpeg_image_cfg_t *cfg, esp_jpeg_image_output_t *im
  * Use this function to get the size of the JPEG image without decoding it.
  * Allocate a buffer of size img->output_len to store the decoded image.
  *
- * @note cfg->outbuf and cfg->outbuf_size are not used in this function.
+ * @note cfg->outbuf and cfg->outbuf_size are not used in this function. The image is parsed from cfg->indata,
+ *       cfg->read_cb is not used.
  * @param[in]  cfg: Configuration structure
  * @param[out] img: Output image info
  *
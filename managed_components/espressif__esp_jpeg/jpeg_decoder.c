@@ -5,7 +5,10 @@
  */
 
 #include <string.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "esp_system.h"
 #include "esp_rom_caps.h"
 #include "esp_log.h"
@@ -57,13 +60,50 @@ static const char *TAG = "JPEG";
 #define ESP_JPEG_COLOR_BYTES    1
 #endif
 
+/* The lower half of the image is decoded on the other core when restart intervals allow to seek it */
+#if !CONFIG_JD_USE_ROM && !CONFIG_FREERTOS_UNICORE
+#define ESP_JPEG_MULTI_CORE     1
+#define ESP_JPEG_TASK_STACK     3072
+#else
+#define ESP_JPEG_MULTI_CORE     0
+#endif
+
+#if ESP_JPEG_MULTI_CORE
+/* Band of rows decoded by its own Tjpgd instance */
+typedef struct {
+    esp_jpeg_image_cfg_t cfg;   /* Copy of the configuration, priv.roi_top and outbuf are moved to the band */
+    JRECT rect;                 /* Band in the input image (pixel) */
+    uint8_t *workbuf;
+    size_t workbuf_size;
+    JRESULT res;
+} jpeg_band_t;
+
+/* Task decoding the bands on one core, kept with its working buffer between the decodings */
+typedef struct {
+    SemaphoreHandle_t lock;     /* Held by the decoding using the worker */
+    SemaphoreHandle_t start;
+    SemaphoreHandle_t done;
+    TaskHandle_t task;
+    uint8_t *workbuf;           /* Only grows */
+    size_t workbuf_size;
+    jpeg_band_t *band;
+} jpeg_band_worker_t;
+
+static jpeg_band_worker_t s_band_workers[portNUM_PROCESSORS];
+#endif
+
 /*******************************************************************************
 * Function definitions
 *******************************************************************************/
 static uint8_t jpeg_get_div_by_scale(esp_jpeg_image_scale_t scale);
 static uint8_t jpeg_get_color_bytes(esp_jpeg_image_format_t format);
+static bool jpeg_set_roi(esp_jpeg_image_cfg_t *cfg, uint16_t width, uint16_t height, esp_jpeg_image_output_t *img);
 
 static unsigned int jpeg_decode_in_cb(JDEC *jd, uint8_t *buff, unsigned int nbyte);
+#if ESP_JPEG_MULTI_CORE
+static esp_err_t jpeg_decode_multi_core(JDEC *jd, esp_jpeg_image_cfg_t *cfg, const JRECT *roi, uint8_t *workbuf,
+                                        size_t workbuf_size);
+#endif
 static jpeg_decode_out_t jpeg_decode_out_cb(JDEC *jd, void *bitmap, JRECT *rect);
 static inline uint16_t ldb_word(const void *ptr);
 /*******************************************************************************
@@ -98,19 +138,34 @@ esp_err_t esp_jpeg_decode(esp_jpeg_image_cfg_t *cfg, esp_jpeg_image_output_t *im
     ESP_GOTO_ON_FALSE((res == JDR_OK), ESP_FAIL, err, TAG, "Error in preparing JPEG image! %d", res);
 
     const uint8_t scale_div       = jpeg_get_div_by_scale(cfg->out_scale);
-    const uint8_t out_color_bytes = jpeg_get_color_bytes(cfg->out_format);
 
     /* Size of output image */
-    const uint32_t outsize = (JDEC.height / scale_div) * (JDEC.width / scale_div) * out_color_bytes;
-    ESP_GOTO_ON_FALSE((outsize <= cfg->outbuf_size), ESP_ERR_NO_MEM, err, TAG, "Not enough size in output buffer!");
-
-    /* Size of output image */
-    img->height = JDEC.height / scale_div;
-    img->width = JDEC.width / scale_div;
-    img->output_len = outsize;
+    ESP_GOTO_ON_FALSE(jpeg_set_roi(cfg, JDEC.width / scale_div, JDEC.height / scale_div, img),
+                      ESP_ERR_INVALID_ARG, err, TAG, "Region of interest is out of the image!");
+    ESP_GOTO_ON_FALSE((img->output_len <= cfg->outbuf_size), ESP_ERR_NO_MEM, err, TAG, "Not enough size in output buffer!");
 
     /* Decode JPEG */
+#if CONFIG_JD_USE_ROM
     res = jd_decomp(&JDEC, jpeg_decode_out_cb, cfg->out_scale);
+    if (res == JDR_INTR) {
+        res = JDR_OK;   /* Stopped by the output callback below the region of interest */
+    }
+#else
+    const JRECT roi = {
+        .left = cfg->priv.roi_left * scale_div,
+        .right = (cfg->priv.roi_right + 1) * scale_div - 1,
+        .top = cfg->priv.roi_top * scale_div,
+        .bottom = (cfg->priv.roi_bottom + 1) * scale_div - 1,
+    };
+#if ESP_JPEG_MULTI_CORE
+    /* Restart intervals let the other core find the lower half without decoding the upper one */
+    if (cfg->flags.multi_core && JDEC.nrst && cfg->read_cb == NULL) {
+        ret = jpeg_decode_multi_core(&JDEC, cfg, &roi, workbuf, workbuf_size);
+        goto err;
+    }
+#endif
+    res = jd_decomp_rect(&JDEC, jpeg_decode_out_cb, cfg->out_scale, &roi);
+#endif
     ESP_GOTO_ON_FALSE((res == JDR_OK), ESP_FAIL, err, TAG, "Error in decoding JPEG image! %d", res);
 
 err:
@@ -152,12 +207,12 @@ esp_err_t esp_jpeg_get_image_info(esp_jpeg_image_cfg_t *cfg, esp_jpeg_image_outp
             seg += 4; /* Skip marker and length field */
 
             /* Size of output image */
-            img->height = ldb_word(seg + 1);
-            img->width = ldb_word(seg + 3);
-            const uint8_t scale_div       = jpeg_get_div_by_scale(cfg->out_scale);
-            const uint8_t out_color_bytes = jpeg_get_color_bytes(cfg->out_format);
-            img->output_len = (img->height / scale_div) * (img->width / scale_div) * out_color_bytes;
-            ret = ESP_OK;
+            const uint8_t scale_div = jpeg_get_div_by_scale(cfg->out_scale);
+            if (jpeg_set_roi(cfg, ldb_word(seg + 3) / scale_div, ldb_word(seg + 1) / scale_div, img)) {
+                ret = ESP_OK;
+            } else {
+                ret = ESP_ERR_INVALID_ARG;
+            }
             break;
         }
     }
@@ -176,7 +231,11 @@ static unsigned int jpeg_decode_in_cb(JDEC *dec, uint8_t *buff, unsigned int nby
     esp_jpeg_image_cfg_t *cfg = (esp_jpeg_image_cfg_t *)dec->device;
     assert(cfg != NULL);
 
-    if (buff) {
+    if (cfg->read_cb) {
+        /* Streaming mode, the callback skips the data when buff is NULL */
+        to_read = cfg->read_cb(cfg->read_ctx, buff, nbyte);
+        cfg->priv.read += to_read;
+    } else if (buff) {
         if (cfg->priv.read + to_read > cfg->indata_size) {
             to_read = cfg->indata_size - cfg->priv.read;
         }
@@ -192,6 +251,126 @@ static unsigned int jpeg_decode_in_cb(JDEC *dec, uint8_t *buff, unsigned int nby
     return to_read;
 }
 
+#if ESP_JPEG_MULTI_CORE
+static JRESULT jpeg_decode_band(jpeg_band_t *band)
+{
+    JDEC jdec;
+
+    band->cfg.priv.read = 0;
+    JRESULT res = jd_prepare(&jdec, jpeg_decode_in_cb, band->workbuf, band->workbuf_size, &band->cfg);
+    if (res == JDR_OK) {
+        res = jd_decomp_rect(&jdec, jpeg_decode_out_cb, band->cfg.out_scale, &band->rect);
+    }
+    return res;
+}
+
+static void jpeg_decode_band_task(void *arg)
+{
+    jpeg_band_worker_t *worker = (jpeg_band_worker_t *)arg;
+
+    while (1) {
+        xSemaphoreTake(worker->start, portMAX_DELAY);
+        worker->band->res = jpeg_decode_band(worker->band);
+        xSemaphoreGive(worker->done);
+    }
+}
+
+/* Takes the worker of the other core, NULL if another decoding uses it or it cannot be created */
+static jpeg_band_worker_t *jpeg_band_worker_take(size_t workbuf_size)
+{
+    const BaseType_t core = !xPortGetCoreID();
+    jpeg_band_worker_t *worker = &s_band_workers[core];
+
+    /* The lock is created once, by whichever decoding comes first */
+    SemaphoreHandle_t lock = __atomic_load_n(&worker->lock, __ATOMIC_ACQUIRE);
+    if (lock == NULL) {
+        SemaphoreHandle_t created = xSemaphoreCreateMutex();
+        if (created == NULL) {
+            return NULL;
+        }
+        if (__atomic_compare_exchange_n(&worker->lock, &lock, created, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            lock = created;
+        } else {
+            vSemaphoreDelete(created);
+        }
+    }
+    if (xSemaphoreTake(lock, 0) != pdTRUE) {
+        return NULL;
+    }
+
+    if (worker->workbuf_size < workbuf_size) {
+        free(worker->workbuf);
+        worker->workbuf = heap_caps_malloc(workbuf_size, MALLOC_CAP_DEFAULT);
+        worker->workbuf_size = worker->workbuf ? workbuf_size : 0;
+    }
+    if (worker->start == NULL) {
+        worker->start = xSemaphoreCreateBinary();
+    }
+    if (worker->done == NULL) {
+        worker->done = xSemaphoreCreateBinary();
+    }
+    if (worker->workbuf && worker->start && worker->done && worker->task == NULL &&
+            xTaskCreatePinnedToCore(jpeg_decode_band_task, "jpeg_band", ESP_JPEG_TASK_STACK, worker,
+                                    uxTaskPriorityGet(NULL), &worker->task, core) != pdPASS) {
+        worker->task = NULL;
+    }
+    if (worker->workbuf == NULL || worker->task == NULL) {
+        ESP_LOGW(TAG, "Failed to create JPEG task, decoding on one core");
+        xSemaphoreGive(lock);
+        return NULL;
+    }
+    vTaskPrioritySet(worker->task, uxTaskPriorityGet(NULL));
+    return worker;
+}
+
+static esp_err_t jpeg_decode_multi_core(JDEC *jd, esp_jpeg_image_cfg_t *cfg, const JRECT *roi, uint8_t *workbuf,
+                                        size_t workbuf_size)
+{
+    const unsigned int my = jd->msy * 8;    /* Height of the MCU (pixel) */
+    const uint8_t scale_div = jpeg_get_div_by_scale(cfg->out_scale);
+    /* The halves are split between two MCU rows, so that no MCU is decoded twice */
+    const unsigned int mid = (roi->top + roi->bottom + 1) / 2 / my * my;
+    JRESULT res;
+
+    if (mid <= roi->top) {
+        /* The region is in one MCU row */
+        res = jd_decomp_rect(jd, jpeg_decode_out_cb, cfg->out_scale, roi);
+        ESP_RETURN_ON_FALSE((res == JDR_OK), ESP_FAIL, TAG, "Error in decoding JPEG image! %d", res);
+        return ESP_OK;
+    }
+
+    jpeg_band_t band = {
+        .cfg = *cfg,
+        .rect = {.left = roi->left, .right = roi->right, .top = mid, .bottom = roi->bottom},
+        .workbuf_size = workbuf_size,
+        .res = JDR_OK,
+    };
+    band.cfg.priv.roi_top = mid / scale_div;
+    band.cfg.outbuf += (band.cfg.priv.roi_top - cfg->priv.roi_top) * cfg->priv.out_stride;
+    const JRECT upper = {.left = roi->left, .right = roi->right, .top = roi->top, .bottom = mid - 1};
+
+    jpeg_band_worker_t *worker = jpeg_band_worker_take(workbuf_size);
+    if (worker) {
+        band.workbuf = worker->workbuf;
+        worker->band = &band;
+        xSemaphoreGive(worker->start);
+    }
+
+    res = jd_decomp_rect(jd, jpeg_decode_out_cb, cfg->out_scale, &upper);
+    if (worker) {
+        xSemaphoreTake(worker->done, portMAX_DELAY);
+        xSemaphoreGive(worker->lock);
+    } else if (res == JDR_OK) {
+        /* The upper half is done with the working buffer of the caller */
+        band.workbuf = workbuf;
+        band.res = jpeg_decode_band(&band);
+    }
+    ESP_RETURN_ON_FALSE((res == JDR_OK), ESP_FAIL, TAG, "Error in decoding JPEG image! %d", res);
+    ESP_RETURN_ON_FALSE((band.res == JDR_OK), ESP_FAIL, TAG, "Error in decoding JPEG image! %d", band.res);
+    return ESP_OK;
+}
+#endif
+
 static jpeg_decode_out_t jpeg_decode_out_cb(JDEC *dec, void *bitmap, JRECT *rect)
 {
     uint16_t color = 0;
@@ -202,23 +381,33 @@ static jpeg_decode_out_t jpeg_decode_out_cb(JDEC *dec, void *bitmap, JRECT *rect
     assert(bitmap != NULL);
     assert(rect != NULL);
 
-    uint8_t scale_div = jpeg_get_div_by_scale(cfg->out_scale);
+    if (rect->top > cfg->priv.roi_bottom) {
+        return 0;   /* Below the region of interest, stop decoding */
+    }
+
     uint8_t out_color_bytes = jpeg_get_color_bytes(cfg->out_format);
 
+    /* Part of the rectangle in the region of interest */
+    const int left = MAX(rect->left, cfg->priv.roi_left);
+    const int right = MIN(rect->right, cfg->priv.roi_right);
+    const int top = MAX(rect->top, cfg->priv.roi_top);
+    const int bottom = MIN(rect->bottom, cfg->priv.roi_bottom);
+    const uint32_t rect_width = rect->right - rect->left + 1;
+
     /* Copy decoded image data to output buffer */
-    uint8_t *in = (uint8_t *)bitmap;
-    uint32_t line = dec->width / scale_div;
-    uint8_t *dst = (uint8_t *)cfg->outbuf;
-    for (int y = rect->top; y <= rect->bottom; y++) {
-        for (int x = rect->left; x <= rect->right; x++) {
+    for (int y = top; y <= bottom; y++) {
+        uint8_t *in = (uint8_t *)bitmap + ((y - rect->top) * rect_width + (left - rect->left)) * ESP_JPEG_COLOR_BYTES;
+        uint8_t *dst = cfg->outbuf + (y - cfg->priv.roi_top) * cfg->priv.out_stride +
+                       (left - cfg->priv.roi_left) * out_color_bytes;
+        for (int x = left; x <= right; x++) {
             if ( (JD_FORMAT == 0 && cfg->out_format == JPEG_IMAGE_FORMAT_RGB888) ||
                     (JD_FORMAT == 1 && cfg->out_format == JPEG_IMAGE_FORMAT_RGB565) ) {
                 /* Output image format is same as set in TJPGD */
                 for (int b = 0; b < ESP_JPEG_COLOR_BYTES; b++) {
                     if (cfg->flags.swap_color_bytes) {
-                        dst[(y * line * out_color_bytes) + x * out_color_bytes + b] = in[out_color_bytes - b - 1];
+                        dst[b] = in[out_color_bytes - b - 1];
                     } else {
-                        dst[(y * line * out_color_bytes) + x * out_color_bytes + b] = in[b];
+                        dst[b] = in[b];
                     }
                 }
             } else if (JD_FORMAT == 0 && cfg->out_format == JPEG_IMAGE_FORMAT_RGB565) {
@@ -229,23 +418,58 @@ static jpeg_decode_out_t jpeg_decode_out_cb(JDEC *dec, void *bitmap, JRECT *rect
                 color |= (in[2] >> 3);
 
                 if (cfg->flags.swap_color_bytes) {
-                    dst[(y * line * out_color_bytes) + (x * out_color_bytes)] = HIBYTE(color);
-                    dst[(y * line * out_color_bytes) + (x * out_color_bytes) + 1] = LOBYTE(color);
+                    dst[0] = HIBYTE(color);
+                    dst[1] = LOBYTE(color);
                 } else {
-                    dst[(y * line * out_color_bytes) + (x * out_color_bytes) + 1] = HIBYTE(color);
-                    dst[(y * line * out_color_bytes) + (x * out_color_bytes)] = LOBYTE(color);
+                    dst[1] = HIBYTE(color);
+                    dst[0] = LOBYTE(color);
                 }
             } else {
                 ESP_LOGE(TAG, "Selected output format is not supported!");
                 assert(0);
             }
             in += ESP_JPEG_COLOR_BYTES;
+            dst += out_color_bytes;
         }
     }
 
     return 1;
 }
 
+static bool jpeg_set_roi(esp_jpeg_image_cfg_t *cfg, uint16_t width, uint16_t height, esp_jpeg_image_output_t *img)
+{
+    const uint8_t out_color_bytes = jpeg_get_color_bytes(cfg->out_format);
+
+    if (width == 0 || height == 0) {
+        return false;
+    }
+    if (cfg->roi.width == 0 || cfg->roi.height == 0) {
+        /* Whole image */
+        cfg->priv.roi_left = 0;
+        cfg->priv.roi_top = 0;
+        cfg->priv.roi_right = width - 1;
+        cfg->priv.roi_bottom = height - 1;
+    } else {
+        if ((uint32_t)cfg->roi.left + cfg->roi.width > width || (uint32_t)cfg->roi.top + cfg->roi.height > height) {
+            return false;
+        }
+        cfg->priv.roi_left = cfg->roi.left;
+        cfg->priv.roi_top = cfg->roi.top;
+        cfg->priv.roi_right = cfg->roi.left + cfg->roi.width - 1;
+        cfg->priv.roi_bottom = cfg->roi.top + cfg->roi.height - 1;
+    }
+
+    img->width = cfg->priv.roi_right - cfg->priv.roi_left + 1;
+    img->height = cfg->priv.roi_bottom - cfg->priv.roi_top + 1;
+    cfg->priv.out_stride = cfg->out_stride ? cfg->out_stride : img->width * out_color_bytes;
+    if (cfg->priv.out_stride < img->width * out_color_bytes) {
+        return false;
+    }
+    /* The last row doesn't need the whole stride */
+    img->output_len = (img->height - 1) * cfg->priv.out_stride + img->width * out_color_bytes;
+    return true;
+}
+
 static uint8_t jpeg_get_div_by_scale(esp_jpeg_image_scale_t scale)
 {
     switch (scale) {
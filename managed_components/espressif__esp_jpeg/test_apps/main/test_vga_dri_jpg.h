@@ -0,0 +1,12 @@
+/*
+vga_dri.jpg was generated with Pillow from a Mandelbrot set and gradients:
+image.save("vga_dri.jpg", quality=80, restart_marker_rows=1)
+*/
+
+// JPEG encoded image 640x480, 23328 bytes, 4:2:0, restart interval of one MCU row (40 MCUs)
+extern const unsigned char vga_dri_jpg[] asm("_binary_vga_dri_jpg_start");
+
+extern char _binary_vga_dri_jpg_start;
+extern char _binary_vga_dri_jpg_end;
+// Must be defined as macro because extern variables are not known at compile time (but at link time)
+#define vga_dri_jpg_len (&_binary_vga_dri_jpg_end - &_binary_vga_dri_jpg_start)
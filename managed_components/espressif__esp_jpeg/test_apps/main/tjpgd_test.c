@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include "sdkconfig.h"
 #include "unity.h"
+#include "esp_timer.h"
 
 
 #include "jpeg_decoder.h"
@@ -16,6 +17,7 @@
 #include "test_logo_rgb888.h"
 #include "test_usb_camera_2_jpg.h"
 #include "test_usb_camera_2_rgb888.h"
+#include "test_vga_dri_jpg.h"
 
 #define TESTW 46
 #define TESTH 46
@@ -198,6 +200,184 @@ TEST_CASE("Test JPEG decompression library: User defined working buffer", "[esp_
     free(decoded);
 }
 
+/**
+ * @brief Region of interest test
+ *
+ * This test case decodes a region of the logo into a buffer with wider rows
+ * than the region and checks it against the same region of the reference
+ * image. The padding bytes at the end of each row must stay untouched.
+ */
+#define ROI_LEFT 5
+#define ROI_TOP 9
+#define ROI_W 30
+#define ROI_H 20
+#define ROI_STRIDE ((ROI_W + 4) * 3)
+TEST_CASE("Test JPEG decompression library: Region of interest", "[esp_jpeg]")
+{
+    unsigned char *decoded, *p;
+    const unsigned char *o;
+    int decoded_outsize = ROI_H * ROI_STRIDE;
+
+    decoded = malloc(decoded_outsize);
+    assert(decoded);
+    memset(decoded, 0xa5, decoded_outsize);
+
+    /* JPEG decode */
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)logo_jpg,
+        .indata_size = logo_jpg_len,
+        .outbuf = decoded,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+        .roi = {
+            .left = ROI_LEFT,
+            .top = ROI_TOP,
+            .width = ROI_W,
+            .height = ROI_H,
+        },
+        .out_stride = ROI_STRIDE,
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_OK);
+
+    /* Decoded region size */
+    TEST_ASSERT_EQUAL(outimg.width, ROI_W);
+    TEST_ASSERT_EQUAL(outimg.height, ROI_H);
+    TEST_ASSERT_EQUAL((ROI_H - 1) * ROI_STRIDE + ROI_W * 3, outimg.output_len);
+
+    for (int y = 0; y < ROI_H; y++) {
+        p = decoded + y * ROI_STRIDE;
+        o = logo_rgb888 + ((ROI_TOP + y) * TESTW + ROI_LEFT) * 3;
+        for (int x = 0; x < ROI_W; x++) {
+            /* The color can be +- 2 */
+            TEST_ASSERT_UINT8_WITHIN(2, o[0], p[0]);
+            TEST_ASSERT_UINT8_WITHIN(2, o[1], p[1]);
+            TEST_ASSERT_UINT8_WITHIN(2, o[2], p[2]);
+
+            p += 3;
+            o += 3;
+        }
+        if (y < ROI_H - 1) {
+            for (; p < decoded + (y + 1) * ROI_STRIDE; p++) {
+                TEST_ASSERT_EQUAL_HEX8(0xa5, *p);
+            }
+        }
+    }
+
+    /* A region out of the image is rejected */
+    jpeg_cfg.roi.left = TESTW - ROI_W + 1;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_ERR_INVALID_ARG);
+
+    free(decoded);
+}
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t read;
+} test_stream_t;
+
+static size_t test_stream_read(void *ctx, uint8_t *buf, size_t len)
+{
+    test_stream_t *stream = (test_stream_t *)ctx;
+    if (len > stream->size - stream->read) {
+        len = stream->size - stream->read;
+    }
+    if (buf) {
+        memcpy(buf, stream->data + stream->read, len);
+    }
+    stream->read += len;
+    return len;
+}
+
+#define BENCHMARK_RUNS 50
+
+static uint32_t test_checksum(const uint8_t *data, size_t size)
+{
+    uint32_t sum = 2166136261u; /* FNV-1a */
+    for (size_t i = 0; i < size; i++) {
+        sum = (sum ^ data[i]) * 16777619u;
+    }
+    return sum;
+}
+
+/**
+ * @brief Streaming input and multi core benchmark
+ *
+ * Decodes the image BENCHMARK_RUNS times from memory, from a read callback and
+ * with the lower half on the other core, and prints the best and the mean time
+ * of each. The outputs must stay identical to the first plain decoding, they
+ * are compared by checksum so that large images need only one output buffer.
+ */
+static void test_benchmark_decode(const char *image, const uint8_t *jpg, size_t jpg_size,
+                                  esp_jpeg_image_format_t format, esp_jpeg_image_scale_t scale)
+{
+    const char *names[] = {"memory", "streaming", "multi core"};
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)jpg,
+        .indata_size = jpg_size,
+        .out_format = format,
+        .out_scale = scale,
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_get_image_info(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_OK);
+    unsigned char *decoded = malloc(outimg.output_len);
+    TEST_ASSERT_NOT_NULL(decoded);
+    jpeg_cfg.outbuf = decoded;
+    jpeg_cfg.outbuf_size = outimg.output_len;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_OK);
+    const uint32_t reference = test_checksum(decoded, outimg.output_len);
+
+    for (int mode = 0; mode < 3; mode++) {
+        int64_t best = INT64_MAX;
+        int64_t total = 0;
+        for (int i = 0; i < BENCHMARK_RUNS; i++) {
+            test_stream_t stream = {
+                .data = jpg,
+                .size = jpg_size,
+            };
+            esp_jpeg_image_cfg_t cfg = jpeg_cfg;
+            if (mode == 1) {
+                cfg.indata = NULL;
+                cfg.indata_size = 0;
+                cfg.read_cb = test_stream_read;
+                cfg.read_ctx = &stream;
+            }
+            cfg.flags.multi_core = mode == 2;
+            memset(decoded, 0, outimg.output_len);
+
+            int64_t start = esp_timer_get_time();
+            err = esp_jpeg_decode(&cfg, &outimg);
+            int64_t latency = esp_timer_get_time() - start;
+            TEST_ASSERT_EQUAL(err, ESP_OK);
+            TEST_ASSERT_EQUAL_HEX32(reference, test_checksum(decoded, outimg.output_len));
+            best = latency < best ? latency : best;
+            total += latency;
+        }
+        printf("%-10s %-10s best %lld us, mean %lld us\n", image, names[mode], (long long)best,
+               (long long)(total / BENCHMARK_RUNS));
+    }
+
+    free(decoded);
+}
+
+/**
+ * @brief Streaming input and multi core benchmark of a VGA image
+ *
+ * The 640x480 image has a restart interval on every MCU row, like the frames of
+ * the camera encoders. It is decoded at half scale to RGB565 so that the output
+ * fits in the internal RAM of every target, Tjpgd still decodes all the MCUs.
+ */
+TEST_CASE("Benchmark JPEG decompression library: VGA image with restart intervals", "[esp_jpeg]")
+{
+    test_benchmark_decode("vga", vga_dri_jpg, vga_dri_jpg_len, JPEG_IMAGE_FORMAT_RGB565, JPEG_IMAGE_SCALE_1_2);
+}
+
 #if CONFIG_JD_DEFAULT_HUFFMAN
 #include "test_usb_camera_jpg.h"
 #include "test_usb_camera_rgb888.h"
@@ -280,6 +460,72 @@ TEST_CASE("Test JPEG decompression library: No Huffman tables", "[esp_jpeg]")
     free(decoded);
 }
 
+/**
+ * @brief Streaming input and multi core test
+ *
+ * The USB camera frame has restart intervals. It is decoded from a read
+ * callback and with the lower half on the other core, both outputs must be
+ * identical to the output of the plain decoding.
+ */
+TEST_CASE("Test JPEG decompression library: Streaming input and multi core", "[esp_jpeg]")
+{
+    int decoded_outsize = 160 * 120 * 3;
+    unsigned char *reference = malloc(decoded_outsize);
+    unsigned char *decoded = malloc(decoded_outsize);
+    assert(reference);
+    assert(decoded);
+
+    /* JPEG decode */
+    esp_jpeg_image_cfg_t jpeg_cfg = {
+        .indata = (uint8_t *)jpeg_no_huffman,
+        .indata_size = jpeg_no_huffman_len,
+        .outbuf = reference,
+        .outbuf_size = decoded_outsize,
+        .out_format = JPEG_IMAGE_FORMAT_RGB888,
+        .out_scale = JPEG_IMAGE_SCALE_0,
+    };
+    esp_jpeg_image_output_t outimg;
+    esp_err_t err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_OK);
+
+    /* Lower half on the other core */
+    memset(decoded, 0, decoded_outsize);
+    jpeg_cfg.outbuf = decoded;
+    jpeg_cfg.flags.multi_core = 1;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_OK);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(reference, decoded, decoded_outsize);
+
+    /* Streaming input */
+    test_stream_t stream = {
+        .data = jpeg_no_huffman,
+        .size = jpeg_no_huffman_len,
+    };
+    memset(decoded, 0, decoded_outsize);
+    jpeg_cfg.flags.multi_core = 0;
+    jpeg_cfg.indata = NULL;
+    jpeg_cfg.indata_size = 0;
+    jpeg_cfg.read_cb = test_stream_read;
+    jpeg_cfg.read_ctx = &stream;
+    err = esp_jpeg_decode(&jpeg_cfg, &outimg);
+    TEST_ASSERT_EQUAL(err, ESP_OK);
+    TEST_ASSERT_EQUAL(outimg.width, 160);
+    TEST_ASSERT_EQUAL(outimg.height, 120);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(reference, decoded, decoded_outsize);
+
+    free(decoded);
+    free(reference);
+}
+
+/**
+ * @brief Streaming input and multi core benchmark of the USB camera frame
+ */
+TEST_CASE("Benchmark JPEG decompression library: Streaming input and multi core", "[esp_jpeg]")
+{
+    test_benchmark_decode("usb camera", jpeg_no_huffman, jpeg_no_huffman_len, JPEG_IMAGE_FORMAT_RGB888,
+                          JPEG_IMAGE_SCALE_0);
+}
+
 #endif
 
 /**
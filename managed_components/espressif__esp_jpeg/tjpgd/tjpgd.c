@@ -695,6 +695,56 @@ static JRESULT restart (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Skip a restart interval by searching the next restart marker          */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT skip_restart_interval (
+    JDEC *jd,       /* Pointer to the decompressor object (at the top of an interval) */
+    uint16_t rstn   /* Expected restert sequense number at the end of the interval */
+)
+{
+    uint8_t *dp = jd->dptr;
+    size_t dc = jd->dctr;
+    unsigned int d, flg = 0;
+
+
+    for (;;) {  /* Search RSTn without decoding the entropy coded data */
+        if (!dc) {  /* No input data is available, re-fill input buffer */
+            dp = jd->inbuf;
+            dc = jd->infunc(jd, dp, JD_SZBUF);
+            if (!dc) {
+                return JDR_INP;
+            }
+        } else if (JD_FASTDECODE == 0) {
+            dp++;   /* Data ptr points the last byte read in basic mode */
+        }
+        d = *dp;
+        if (JD_FASTDECODE != 0) {
+            dp++;
+        }
+        dc--;
+        if (flg && (d & 0xF8) == 0xD0) {
+            break;  /* RSTn is found */
+        }
+        flg = (d == 0xFF);  /* 0xFF00 is a data 0xFF and 0xFFFF is a fill byte */
+    }
+    jd->dptr = dp; jd->dctr = dc; jd->dbit = 0;
+#if JD_FASTDECODE >= 1
+    jd->marker = 0;
+#endif
+
+    if ((d & 7) != (rstn & 7)) {
+        return JDR_FMT1;    /* Err: expected RSTn marker was not detected (may be collapted data) */
+    }
+
+    jd->dcv[2] = jd->dcv[1] = jd->dcv[0] = 0;   /* Reset DC offset */
+    return JDR_OK;
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Apply Inverse-DCT in Arai Algorithm (see also aa_idct.png)            */
 /*-----------------------------------------------------------------------*/
@@ -920,6 +970,75 @@ static JRESULT mcu_load (
 
 
 
+/*-----------------------------------------------------------------------*/
+/* Skip all blocks in an MCU, only DC values are tracked                 */
+/*-----------------------------------------------------------------------*/
+
+static JRESULT mcu_skip (
+    JDEC *jd        /* Pointer to the decompressor object */
+)
+{
+    int d, e;
+    unsigned int blk, nby, bc, z, id, cmp;
+
+
+    nby = jd->msx * jd->msy;    /* Number of Y blocks (1, 2 or 4) */
+
+    for (blk = 0; blk < nby + 2; blk++) {   /* Skip nby Y blocks and two C blocks */
+        cmp = (blk < nby) ? 0 : blk - nby + 1;  /* Component number 0:Y, 1:Cb, 2:Cr */
+        if (cmp && jd->ncomp != 3) {
+            continue;    /* No C blocks (monochrome image) */
+        }
+        id = cmp ? 1 : 0;                       /* Huffman table ID of this component */
+
+        /* Extract a DC element, the DC value is kept for the next block */
+        d = huffext(jd, id, 0);
+        if (d < 0) {
+            return (JRESULT)(0 - d);    /* Err: invalid code or input */
+        }
+        bc = (unsigned int)d;
+        if (bc) {
+            e = bitext(jd, bc);
+            if (e < 0) {
+                return (JRESULT)(0 - e);    /* Err: input */
+            }
+            bc = 1 << (bc - 1);
+            if (!(e & bc)) {
+                e -= (bc << 1) - 1;
+            }
+            jd->dcv[cmp] = (int16_t)(jd->dcv[cmp] + e);
+        }
+
+        /* Discard following 63 AC elements, without de-quantize and IDCT */
+        z = 1;
+        do {
+            d = huffext(jd, id, 1);
+            if (d == 0) {
+                break;    /* EOB? */
+            }
+            if (d < 0) {
+                return (JRESULT)(0 - d);    /* Err: invalid code or input error */
+            }
+            bc = (unsigned int)d;
+            z += bc >> 4;
+            if (z >= 64) {
+                return JDR_FMT1;    /* Too long zero run */
+            }
+            if (bc &= 0x0F) {
+                d = bitext(jd, bc);
+                if (d < 0) {
+                    return (JRESULT)(0 - d);    /* Err: input device */
+                }
+            }
+        } while (++z < 64);
+    }
+
+    return JDR_OK;
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Output an MCU: Convert YCrCb to RGB and output it in RGB form         */
 /*-----------------------------------------------------------------------*/
@@ -1390,3 +1509,83 @@ JRESULT jd_decomp (
 
     return rc;
 }
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Decompress a rectangular region of the JPEG picture                  */
+/*-----------------------------------------------------------------------*/
+
+JRESULT jd_decomp_rect (
+    JDEC *jd,                               /* Initialized decompression object */
+    int (*outfunc)(JDEC *, void *, JRECT *), /* RGB output function */
+    uint8_t scale,                          /* Output de-scaling factor (0 to 3) */
+    const JRECT *roi                        /* Region to decompress in the input image (pixel) */
+)
+{
+    unsigned int x, y, mx, my, nmx, n, i, j;
+    uint16_t rsc;
+    JRESULT rc;
+
+
+    if (scale > (JD_USE_SCALE ? 3 : 0) || roi->left > roi->right || roi->top > roi->bottom) {
+        return JDR_PAR;
+    }
+    jd->scale = scale;
+
+    mx = jd->msx * 8; my = jd->msy * 8;         /* Size of the MCU (pixel) */
+    nmx = (jd->width + mx - 1) / mx;            /* Number of MCUs in a row */
+    n = nmx * ((jd->height + my - 1) / my);     /* Number of MCUs in the image */
+
+    jd->dcv[2] = jd->dcv[1] = jd->dcv[0] = 0;   /* Initialize DC values */
+    rsc = 0;
+
+    for (i = 0; i < n; i++) {
+        if (i / nmx * my > roi->bottom) {
+            break;      /* No more MCUs in the region, the rest of the stream is not read */
+        }
+        if (jd->nrst && i % jd->nrst == 0) {    /* Top of a restart interval */
+            if (i) {
+                rc = restart(jd, rsc++);
+                if (rc != JDR_OK) {
+                    return rc;
+                }
+            }
+            while (i + jd->nrst < n) {  /* Search the next RSTn while the interval is out of the region */
+                for (j = i; j < i + jd->nrst; j++) {
+                    x = j % nmx * mx; y = j / nmx * my;
+                    if (x <= roi->right && x + mx > roi->left && y <= roi->bottom && y + my > roi->top) {
+                        break;
+                    }
+                }
+                if (j < i + jd->nrst) {
+                    break;
+                }
+                rc = skip_restart_interval(jd, rsc++);
+                if (rc != JDR_OK) {
+                    return rc;
+                }
+                i += jd->nrst;
+            }
+            if (i / nmx * my > roi->bottom) {
+                break;
+            }
+        }
+        x = i % nmx * mx; y = i / nmx * my;
+        if (x <= roi->right && x + mx > roi->left && y + my > roi->top) {   /* Is the MCU in the region? */
+            rc = mcu_load(jd);
+            if (rc != JDR_OK) {
+                return rc;
+            }
+            rc = mcu_output(jd, outfunc, x, y);
+        } else {
+            rc = mcu_skip(jd);
+        }
+        if (rc != JDR_OK) {
+            return rc;
+        }
+    }
+
+    return JDR_OK;
+}